@@ -357,6 +357,9 @@ BIF_RETTYPE finish_after_on_load_2(BIF_ALIST_2)
 	end = (Eterm *)((char *)code + modp->code_length);
 	erts_cleanup_funs_on_purge(code, end);
 	beam_catches_delmod(modp->catches, code, modp->code_length);
+	if (code[MI_LITERALS_START]) {
+	    erts_release_literal_area(ERTS_CODE_LITERAL_AREA(code));
+	}
 	erts_free(ERTS_ALC_T_CODE, (void *) code);
 	modp->code = NULL;
 	modp->code_length = 0;
@@ -398,10 +401,11 @@ static Eterm
 check_process_code(Process* rp, Module* modp)
 {
     Eterm* start;
-    char* mod_start;
-    Uint mod_size;
     Eterm* end;
     Eterm* sp;
+    Eterm* literals;
+    char* lit_start;
+    Uint lit_size;
 #ifndef HYBRID /* FIND ME! */
     ErlFunThing* funp;
     int done_gc = 0;
@@ -419,8 +423,6 @@ check_process_code(Process* rp, Module* modp)
      */
     start = modp->old_code;
     end = (Eterm *)((char *)start + modp->old_code_length);
-    mod_start = (char *) start;
-    mod_size = modp->old_code_length;
 
     /*
      * Check if current instruction or continuation pointer points into module.
@@ -499,64 +501,52 @@ check_process_code(Process* rp, Module* modp)
 
     /*
      * See if there are constants inside the module referenced by the process.
+     * Such references do not prevent the module from being purged. The
+     * process instead gets a reference to the literal area, and the
+     * literals it uses are copied into its heap by its next garbage
+     * collection.
      */
-    done_gc = 0;
-    for (;;) {
+    literals = (Eterm *) modp->old_code[MI_LITERALS_START];
+    if (literals != NULL) {
 	ErlMessage* mp;
 
-	if (any_heap_ref_ptrs(&rp->fvalue, &rp->fvalue+1, mod_start, mod_size)) {
+	lit_start = (char *) literals;
+	lit_size = (char *) modp->old_code[MI_LITERALS_END] - lit_start;
+
+	if (any_heap_ref_ptrs(&rp->fvalue, &rp->fvalue+1, lit_start, lit_size)) {
 	    rp->freason = EXC_NULL;
 	    rp->fvalue = NIL;
 	    rp->ftrace = NIL;
 	}
-	if (any_heap_ref_ptrs(rp->stop, rp->hend, mod_start, mod_size)) {
-	    goto need_gc;
+	if (any_heap_ref_ptrs(rp->stop, rp->hend, lit_start, lit_size)) {
+	    goto literal_ref;
 	}
-	if (any_heap_refs(rp->heap, rp->htop, mod_start, mod_size)) {
-	    goto need_gc;
+	if (any_heap_refs(rp->heap, rp->htop, lit_start, lit_size)) {
+	    goto literal_ref;
 	}
 
-	if (any_heap_refs(rp->old_heap, rp->old_htop, mod_start, mod_size)) {
-	    goto need_gc;
+	if (any_heap_refs(rp->old_heap, rp->old_htop, lit_start, lit_size)) {
+	    goto literal_ref;
 	}
 
 	if (rp->dictionary != NULL) {
 	    Eterm* start = rp->dictionary->data;
 	    Eterm* end = start + rp->dictionary->used;
 
-	    if (any_heap_ref_ptrs(start, end, mod_start, mod_size)) {
-		goto need_gc;
+	    if (any_heap_ref_ptrs(start, end, lit_start, lit_size)) {
+		goto literal_ref;
 	    }
 	}
 
 	for (mp = rp->msg.first; mp != NULL; mp = mp->next) {
-	    if (any_heap_ref_ptrs(mp->m, mp->m+2, mod_start, mod_size)) {
-		goto need_gc;
+	    if (any_heap_ref_ptrs(mp->m, mp->m+2, lit_start, lit_size)) {
+		goto literal_ref;
 	    }
 	}
-	break;
-
-    need_gc:
-	if (done_gc) {
-	    return am_true;
-	} else {
-	    Eterm* literals;
-	    Uint lit_size;
+	return am_false;
 
-	    /*
-	     * Try to get rid of constants by by garbage collecting.
-	     * Clear both fvalue and ftrace.
-	     */
-	    rp->freason = EXC_NULL;
-	    rp->fvalue = NIL;
-	    rp->ftrace = NIL;
-	    done_gc = 1;
-	    FLAGS(rp) |= F_NEED_FULLSWEEP;
-	    (void) erts_garbage_collect(rp, 0, rp->arg_reg, rp->arity);
-	    literals = (Eterm *) modp->old_code[MI_LITERALS_START];
-	    lit_size = (Eterm *) modp->old_code[MI_LITERALS_END] - literals;
-	    erts_garbage_collect_literals(rp, literals, lit_size);
-	}
+    literal_ref:
+	erts_proc_ref_literal_area(rp, ERTS_LITERAL_AREA_FROM_START(literals));
     }
     return am_false;
 #undef INSIDE
@@ -668,6 +658,14 @@ purge_module(int module)
     end = (Eterm *)((char *)code + modp->old_code_length);
     erts_cleanup_funs_on_purge(code, end);
     beam_catches_delmod(modp->old_catches, code, modp->old_code_length);
+    if (code[MI_LITERALS_START]) {
+	/*
+	 * Processes still referring to the literals have their own
+	 * references to the area; it is freed when the last one of
+	 * them has garbage collected.
+	 */
+	erts_release_literal_area(ERTS_CODE_LITERAL_AREA(code));
+    }
     erts_free(ERTS_ALC_T_CODE, (void *) code);
     modp->old_code = NULL;
     modp->old_code_length = 0;
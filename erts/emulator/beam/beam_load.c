@@ -327,6 +327,7 @@ typedef struct {
     Literal* literals;		/* Array of literals. */
     LiteralPatch* literal_patches; /* Operands that need to be patched. */
     Uint total_literal_size;	/* Total heap size for all literals. */
+    ErtsLiteralArea* literal_area; /* Final location of the literals. */
 
     /*
      * Floating point.
@@ -529,6 +530,7 @@ int allocated_modules;	    /* Number of slots allocated. */
 Range* mid_module = NULL;   /* Cached search start point */
 
 Uint erts_total_code_size;
+static erts_smp_atomic_t literal_areas_size; /* Bytes in literal areas. */
 /**********************************************************************/
 
 
@@ -537,6 +539,7 @@ void init_load(void)
     FloatDef f;
 
     erts_total_code_size = 0;
+    erts_smp_atomic_init(&literal_areas_size, 0);
 
     beam_catches_init();
 
@@ -550,6 +553,29 @@ void init_load(void)
     num_loaded_modules = 0;
 }
 
+/*
+ * Drop one reference to a literal area; the last one frees it.
+ */
+void
+erts_release_literal_area(ErtsLiteralArea* area)
+{
+    if (erts_refc_dectest(&area->refc, 0) == 0) {
+	if (area->shared) {
+	    erts_free_shared_term_area(area);
+	    return;
+	}
+	erts_smp_atomic_add(&literal_areas_size,
+			    -((long) ERTS_LITERAL_AREA_ALLOC_SIZE(area->size)));
+	erts_free(ERTS_ALC_T_LITERAL, (void *) area);
+    }
+}
+
+Uint
+erts_literal_areas_size(void)
+{
+    return (Uint) erts_smp_atomic_read(&literal_areas_size);
+}
+
 static void
 define_file(LoaderState* stp, char* name, int idx)
 {
@@ -702,6 +728,7 @@ bin_load(Process *c_p, ErtsProcLocks c_p_locks,
      */
     rval = 0;
     state.code = NULL;		/* Prevent code from being freed. */
+    state.literal_area = NULL;	/* Now owned by the module. */
     *modp = state.module;
 
     /*
@@ -716,6 +743,9 @@ bin_load(Process *c_p, ErtsProcLocks c_p_locks,
     if (state.code != 0) {
 	erts_free(ERTS_ALC_T_CODE, state.code);
     }
+    if (state.literal_area != NULL) {
+	erts_release_literal_area(state.literal_area);
+    }
     if (state.labels != NULL) {
 	erts_free(ERTS_ALC_T_LOADER_TMP, (void *) state.labels);
     }
@@ -782,6 +812,7 @@ init_state(LoaderState* stp)
     stp->allocated_literals = 0;
     stp->literals = 0;
     stp->total_literal_size = 0;
+    stp->literal_area = NULL;
     stp->literal_patches = 0;
     stp->string_patches = 0;
     stp->new_float_instructions = 0;
@@ -3401,8 +3432,7 @@ freeze_code(LoaderState* stp)
      * Calculate the final size of the code.
      */
 
-    size = (stp->ci + stp->total_literal_size) * sizeof(Eterm) +
-	strtab_size + attr_size + compile_size;
+    size = stp->ci * sizeof(Eterm) + strtab_size + attr_size + compile_size;
 
     /*
      * Move the code to its final location.
@@ -3428,16 +3458,36 @@ freeze_code(LoaderState* stp)
     }
 
     /*
-     * Place the literal heap directly after the code and fix up all
+     * Place the literal heap in a literal area of its own and fix up all
      * put_literal instructions that refer to it.
      */
-    {
+    if (stp->total_literal_size == 0) {
+	code[MI_LITERALS_START] = (Eterm) NULL;
+	code[MI_LITERALS_END] = (Eterm) NULL;
+    } else {
+	ErtsLiteralArea* area;
 	Eterm* ptr;
 	Eterm* low;
 	Eterm* high;
 	LiteralPatch* lp;
 
-	low = code+stp->ci;
+	area = (ErtsLiteralArea *)
+	    erts_alloc(ERTS_ALC_T_LITERAL,
+		       ERTS_LITERAL_AREA_ALLOC_SIZE(stp->total_literal_size));
+	erts_refc_init(&area->refc, 1);
+	area->shared = 0;
+	area->off_heap.mso = NULL;
+#ifndef HYBRID /* FIND ME! */
+	area->off_heap.funs = NULL;
+#endif
+	area->off_heap.externals = NULL;
+	area->off_heap.overhead = 0;
+	area->size = stp->total_literal_size;
+	erts_smp_atomic_add(&literal_areas_size,
+			    ERTS_LITERAL_AREA_ALLOC_SIZE(area->size));
+	stp->literal_area = area;
+
+	low = area->start;
 	high = low + stp->total_literal_size;
 	code[MI_LITERALS_START] = (Eterm) low;
 	code[MI_LITERALS_END] = (Eterm) high;
@@ -3485,11 +3535,10 @@ freeze_code(LoaderState* stp)
 	    op_ptr[0] = literal;
 	    lp = lp->next;
 	}
-	stp->ci += stp->total_literal_size;
     }
     
     /*
-     * Place the string table and, optionally, attributes, after the literal heap.
+     * Place the string table and, optionally, attributes, after the code.
      */
 
     sys_memcpy(code+stp->ci, stp->chunks[STR_CHUNK].start, strtab_size);
@@ -5090,6 +5139,8 @@ erts_make_stub_module(Process* p, Eterm Mod, Eterm Beam, Eterm Info)
     code[MI_COMPILE_PTR] = 0;
     code[MI_COMPILE_SIZE_ON_HEAP] = 0;
     code[MI_NUM_BREAKPOINTS] = 0;
+    code[MI_LITERALS_START] = (Eterm) NULL;
+    code[MI_LITERALS_END] = (Eterm) NULL;
     ci = MI_FUNCTIONS + n + 1;
 
     /*
@@ -20,6 +20,7 @@
 #ifndef _BEAM_LOAD_H
 #  define _BEAM_LOAD_H
 
+#include <stddef.h> /* offsetof() */
 #include "beam_opcodes.h"
 #include "erl_process.h"
 
@@ -66,6 +67,43 @@ extern Range* mid_module;
 
 /* Total code size in bytes */
 extern Uint erts_total_code_size;
+
+/*
+ * The literal area (constant pool) of a module is allocated apart from
+ * the code. The module holds one reference to it, and each process that
+ * still referred to it when the module was purged holds one reference
+ * until its next garbage collection has copied the literals it uses
+ * (or until it exits). A purge will thus never force a garbage
+ * collection on processes that only refer to literals of the module.
+ *
+ * Published terms (see erl_shared_term.c) are kept in literal areas too.
+ */
+typedef struct {
+    erts_refc_t refc;		/* Module + referring processes. */
+    int shared;			/* Published term; not module literals. */
+    ErlOffHeap off_heap;	/* Off-heap data of a published term. */
+    Uint size;			/* Size of the literal heap in words. */
+    Eterm start[1];		/* The literal heap. */
+} ErtsLiteralArea;
+
+#define ERTS_LITERAL_AREA_ALLOC_SIZE(Words) \
+  (offsetof(ErtsLiteralArea, start) + (Words)*sizeof(Eterm))
+#define ERTS_LITERAL_AREA_FROM_START(Start) \
+  ((ErtsLiteralArea *) (((char *) (Start)) - offsetof(ErtsLiteralArea, start)))
+#define ERTS_CODE_LITERAL_AREA(Code) \
+  ((Code)[MI_LITERALS_START] \
+   ? ERTS_LITERAL_AREA_FROM_START((Code)[MI_LITERALS_START]) \
+   : (ErtsLiteralArea *) NULL)
+
+/* A process' reference to a literal area (see erts_proc_ref_literal_area()). */
+typedef struct ErtsLiteralAreaRef_ ErtsLiteralAreaRef;
+struct ErtsLiteralAreaRef_ {
+    ErtsLiteralAreaRef* next;
+    ErtsLiteralArea* area;
+};
+
+void erts_release_literal_area(ErtsLiteralArea* area);
+Uint erts_literal_areas_size(void);
 /*
  * Index into start of code chunks which contains additional information
  * about the loaded module.
@@ -97,7 +135,8 @@ extern Uint erts_total_code_size;
 #define MI_NUM_BREAKPOINTS      7
 
 /*
- * Literal area (constant pool).
+ * Literal area (constant pool). Both are NULL if the module has
+ * no literals; otherwise they point into an ErtsLiteralArea.
  */
 #define MI_LITERALS_START	8
 #define MI_LITERALS_END		9
@@ -36,6 +36,7 @@
 #include "beam_bp.h"
 #include "erl_db_util.h"
 #include "register.h"
+#include "erl_spawn_site.h"
 
 static Export* flush_monitor_message_trap = NULL;
 static Export* set_cpu_topology_trap = NULL;
@@ -1625,11 +1626,13 @@ ebif_bang_2(Process* p, Eterm To, Eterm Message)
 #define SEND_BADARG		(-4)
 #define SEND_USER_ERROR		(-5)
 #define SEND_INTERNAL_ERROR	(-6)
+#define SEND_YIELD_CONTINUE	(-7)
 
-Sint do_send(Process *p, Eterm to, Eterm msg, int suspend);
+Sint do_send(Process *p, Eterm to, Eterm msg, int suspend, Eterm *ctxp);
 
 static Sint remote_send(Process *p, DistEntry *dep,
-			Eterm to, Eterm full_to, Eterm msg, int suspend)
+			Eterm to, Eterm full_to, Eterm msg, int suspend,
+			Eterm *ctxp)
 {
     Sint res;
     int code;
@@ -1658,7 +1661,12 @@ static Sint remote_send(Process *p, DistEntry *dep,
 	 * process by erts_dsig_send_reg_msg() or
 	 * erts_dsig_send_msg().
 	 */
-	if (code == ERTS_DSIG_SEND_YIELD)
+	if (code == ERTS_DSIG_SEND_CONTINUE) {
+	    /* Message is sent in fragments; continue in the trap */
+	    *ctxp = dsd.frag_cont;
+	    res = SEND_YIELD_CONTINUE;
+	}
+	else if (code == ERTS_DSIG_SEND_YIELD)
 	    res = SEND_YIELD_RETURN;
 	else
 	    res = 0;
@@ -1669,7 +1677,7 @@ static Sint remote_send(Process *p, DistEntry *dep,
 	res = SEND_INTERNAL_ERROR;
     }
 
-    if (res >= 0) {
+    if (res >= 0 || res == SEND_YIELD_CONTINUE) {
 	if (IS_TRACED(p))
 	    trace_send(p, full_to, msg);
 	if (ERTS_PROC_GET_SAVED_CALLS_BUF(p))
@@ -1680,7 +1688,7 @@ static Sint remote_send(Process *p, DistEntry *dep,
 }
 
 Sint
-do_send(Process *p, Eterm to, Eterm msg, int suspend) {
+do_send(Process *p, Eterm to, Eterm msg, int suspend, Eterm *ctxp) {
     Eterm portid;
     Port *pt;
     Process* rp;
@@ -1718,7 +1726,7 @@ do_send(Process *p, Eterm to, Eterm msg, int suspend) {
 	    erts_send_error_to_logger(p->group_leader, dsbufp);
 	    return 0;
 	}
-	return remote_send(p, dep, to, to, msg, suspend);
+	return remote_send(p, dep, to, to, msg, suspend, ctxp);
     } else if (is_atom(to)) {
 	
 	/* Need to virtual schedule out sending process
@@ -1906,7 +1914,7 @@ do_send(Process *p, Eterm to, Eterm msg, int suspend) {
 	    goto send_message;
 	}
 
-	ret = remote_send(p, dep, tp[1], to, msg, suspend);
+	ret = remote_send(p, dep, tp[1], to, msg, suspend, ctxp);
 	if (dep)
 	    erts_deref_dist_entry(dep);
 	return ret;
@@ -1953,6 +1961,7 @@ send_3(Process *p, Eterm to, Eterm msg, Eterm opts) {
     int connect = !0;
     int suspend = !0;
     Eterm l = opts;
+    Eterm ctx;
     Sint result;
     
     while (is_list(l)) {
@@ -1969,7 +1978,7 @@ send_3(Process *p, Eterm to, Eterm msg, Eterm opts) {
 	BIF_ERROR(p, BADARG);
     }
     
-    result = do_send(p, to, msg, suspend);
+    result = do_send(p, to, msg, suspend, &ctx);
     if (result > 0) {
 	ERTS_VBUMP_REDS(p, result);
 	BIF_RET(am_ok);
@@ -1996,6 +2005,9 @@ send_3(Process *p, Eterm to, Eterm msg, Eterm opts) {
 	    ERTS_BIF_YIELD_RETURN(p, am_ok);
 	else
 	    BIF_RET(am_nosuspend);
+    case SEND_YIELD_CONTINUE:
+	ERTS_BIF_YIELD2(&erts_dsig_send_frag_trap_export, p, ctx, am_ok);
+	break;
     case SEND_BADARG:
 	BIF_ERROR(p, BADARG); 
 	break;
@@ -2015,7 +2027,8 @@ send_3(Process *p, Eterm to, Eterm msg, Eterm opts) {
 
 Eterm
 send_2(Process *p, Eterm to, Eterm msg) {
-    Sint result = do_send(p, to, msg, !0);
+    Eterm ctx;
+    Sint result = do_send(p, to, msg, !0, &ctx);
     
     if (result > 0) {
 	ERTS_VBUMP_REDS(p, result);
@@ -2032,6 +2045,9 @@ send_2(Process *p, Eterm to, Eterm msg) {
 	break;
     case SEND_YIELD_RETURN:
 	ERTS_BIF_YIELD_RETURN(p, msg);
+    case SEND_YIELD_CONTINUE:
+	ERTS_BIF_YIELD2(&erts_dsig_send_frag_trap_export, p, ctx, msg);
+	break;
     case SEND_BADARG:
 	BIF_ERROR(p, BADARG); 
 	break;
@@ -2049,6 +2065,181 @@ send_2(Process *p, Eterm to, Eterm msg) {
     BIF_ERROR(p, BADARG);
 }
 
+/*
+ * erlang:send_multi/2 sends the same message to a list of processes.
+ * The message is sized once for all local receivers, and encoded once
+ * per node for remote receivers (see erts_dsig_send_msg_multi()).
+ * Each local receiver still gets a copy of its own: a message heap
+ * fragment is owned by the receiver and is merged into its heap at the
+ * next garbage collection, so one fragment cannot be shared by several
+ * receivers without a shared heap. Published terms (erl_shared_term.c)
+ * are not used either since they stay until explicitly unpublished,
+ * which blocks the system.
+ * Receivers on nodes that are not connected, remote receivers of a
+ * message large enough to be sent in fragments, and all receivers when
+ * the sender is traced, are passed to erlang:dsend_multi/3 which uses
+ * ordinary sends. Long lists are handled a chunk at a time.
+ */
+
+#define ERTS_SEND_MULTI_CHUNK 500
+
+typedef struct {
+    DistEntry *dep;
+    Eterm to;
+} ErtsSendMultiRemote;
+
+static int
+send_multi_remote_cmp(const void *a, const void *b)
+{
+    DistEntry *adep = ((ErtsSendMultiRemote *) a)->dep;
+    DistEntry *bdep = ((ErtsSendMultiRemote *) b)->dep;
+    return adep < bdep ? -1 : (adep > bdep ? 1 : 0);
+}
+
+BIF_RETTYPE send_multi_2(BIF_ALIST_2)
+{
+    Process *p = BIF_P;
+    Eterm msg = BIF_ARG_2;
+    Eterm l, rest;
+    Eterm ordinary = NIL;
+    ErtsSendMultiRemote *remote = NULL;
+    Uint n, no_local, no_remote;
+    Uint msize = 0;
+    int sized = 0;
+    int yield = 0;
+
+    if (is_nil(BIF_ARG_1))
+	BIF_RET(msg);
+    if (IS_TRACED(p)
+	|| SEQ_TRACE_TOKEN(p) != NIL
+	|| ERTS_PROC_GET_SAVED_CALLS_BUF(p))
+	BIF_TRAP3(dsend_multi_trap, p, BIF_ARG_1, NIL, msg);
+
+    /* Check the chunk before sending anything */
+    no_remote = 0;
+    l = BIF_ARG_1;
+    for (n = 0; n < ERTS_SEND_MULTI_CHUNK && is_list(l); n++) {
+	Eterm to = CAR(list_val(l));
+	if (is_internal_pid(to)) {
+	    if (internal_pid_index(to) >= erts_max_processes)
+		BIF_ERROR(p, BADARG);
+	}
+	else if (is_external_pid(to))
+	    no_remote++;
+	else
+	    BIF_ERROR(p, BADARG);
+	l = CDR(list_val(l));
+    }
+    if (is_not_list(l) && is_not_nil(l))
+	BIF_ERROR(p, BADARG);
+    rest = l;
+    no_local = n - no_remote;
+
+    if (no_remote)
+	remote = erts_alloc(ERTS_ALC_T_TMP,
+			    no_remote*(sizeof(ErtsSendMultiRemote)
+				       + sizeof(Eterm)));
+
+    /* Local receivers get their copies right away */
+    no_remote = 0;
+    for (l = BIF_ARG_1; l != rest; l = CDR(list_val(l))) {
+	Eterm to = CAR(list_val(l));
+	if (is_external_pid(to)) {
+	    DistEntry *dep = external_pid_dist_entry(to);
+	    if (dep == erts_this_dist_entry)
+		continue; /* Old incarnation of this node; dropped */
+	    remote[no_remote].dep = dep;
+	    remote[no_remote].to = to;
+	    no_remote++;
+	}
+	else {
+	    ErtsProcLocks rp_locks = 0;
+	    Process *rp = erts_pid2proc_opt(p, ERTS_PROC_LOCK_MAIN,
+					    to, 0, ERTS_P2P_FLG_SMP_INC_REFC);
+	    if (!rp) {
+		ERTS_SMP_ASSERT_IS_NOT_EXITING(p);
+		continue;
+	    }
+	    if (rp == p) {
+#ifdef ERTS_SMP
+		rp_locks |= ERTS_PROC_LOCK_MAIN;
+#endif
+		erts_send_message(p, rp, &rp_locks, msg, 0);
+	    }
+	    else {
+		if (!sized) {
+		    msize = size_object_shared(msg);
+		    sized = 1;
+		}
+		erts_send_message_sized(p, rp, &rp_locks, msg, msize);
+	    }
+	    erts_smp_proc_unlock(rp,
+				 p == rp
+				 ? (rp_locks & ~ERTS_PROC_LOCK_MAIN)
+				 : rp_locks);
+	    erts_smp_proc_dec_refc(rp);
+	}
+    }
+    BUMP_REDS(p, no_local);
+
+    /* Remote receivers are grouped by node */
+    if (remote) {
+	Eterm *to = (Eterm *) &remote[no_remote];
+	Uint i, j, k;
+
+	qsort((void *) remote, no_remote, sizeof(ErtsSendMultiRemote),
+	      send_multi_remote_cmp);
+	for (i = 0; i < no_remote; i = j) {
+	    DistEntry *dep = remote[i].dep;
+	    ErtsDSigData dsd;
+	    Eterm *hp;
+	    for (j = i; j < no_remote && remote[j].dep == dep; j++)
+		to[j - i] = remote[j].to;
+	    if (erts_dsig_prepare(&dsd, dep, p, ERTS_DSP_NO_LOCK, 0)
+		== ERTS_DSIG_PREP_CONNECTED) {
+		switch (erts_dsig_send_msg_multi(&dsd, to, j - i, msg)) {
+		case ERTS_DSIG_SEND_YIELD:
+		    yield = 1;
+		    continue;
+		case ERTS_DSIG_SEND_FRAGMENT:
+		    break;
+		default:
+		    continue;
+		}
+	    }
+	    hp = HAlloc(p, 2*(j - i));
+	    for (k = i; k < j; k++) {
+		ordinary = CONS(hp, remote[k].to, ordinary);
+		hp += 2;
+	    }
+	}
+	erts_free(ERTS_ALC_T_TMP, (void *) remote);
+    }
+
+    if (is_not_nil(ordinary)) {
+	Eterm *hp;
+	if (!yield)
+	    BIF_TRAP3(dsend_multi_trap, p, ordinary, rest, msg);
+	/*
+	 * Suspended on a busy connection; we have to yield before any
+	 * Erlang code runs, so these receivers are sent to by the next
+	 * call instead.
+	 */
+	for (n = 0, l = ordinary; is_list(l); l = CDR(list_val(l)))
+	    n++;
+	hp = HAlloc(p, 2*n);
+	for (l = ordinary; is_list(l); l = CDR(list_val(l))) {
+	    rest = CONS(hp, CAR(list_val(l)), rest);
+	    hp += 2;
+	}
+    }
+    if (yield && is_nil(rest))
+	ERTS_BIF_YIELD_RETURN(p, msg);
+    if (is_not_nil(rest))
+	ERTS_BIF_YIELD2(bif_export[BIF_send_multi_2], p, rest, msg);
+    BIF_RET(msg);
+}
+
 /**********************************************************************/
 /*
  * apply/3 is implemented as an instruction and as erlang code in the
@@ -3741,6 +3932,18 @@ BIF_RETTYPE system_flag_2(BIF_ALIST_2)
 	}
 	H_MIN_SIZE = erts_next_heap_size(n, 0);
 	BIF_RET(make_small(oval));
+    } else if (BIF_ARG_1 == am_spawn_site_heap_sizing) {
+	Eterm oval = erts_spawn_site_heap_sizing ? am_true : am_false;
+	if (BIF_ARG_2 == am_true) {
+	    erts_spawn_site_heap_sizing = 1;
+	} else if (BIF_ARG_2 == am_false) {
+	    erts_spawn_site_heap_sizing = 0;
+	} else if (BIF_ARG_2 == am_reset) {
+	    erts_reset_spawn_sites();
+	} else {
+	    goto error;
+	}
+	BIF_RET(oval);
     } else if (BIF_ARG_1 == am_display_items) {
 	int oval = display_items;
 	if (!is_small(BIF_ARG_2) || (n = signed_val(BIF_ARG_2)) < 0) {
@@ -30,6 +30,13 @@
 #include "big.h"
 #include "erl_binary.h"
 #include "erl_bits.h"
+#include "erl_shared_term.h"
+
+/*
+ * When copying a message, published terms (see erl_shared_term.c)
+ * are treated like constants; i.e., only a pointer to them is copied.
+ */
+#define IS_SHARED_PTR(Ptr) (shared && erts_is_shared_term_ptr((Ptr)))
 
 #ifdef HYBRID
 MA_STACK_DECLARE(src);
@@ -70,8 +77,8 @@ copy_object(Eterm obj, Process* to)
  * Return the "flat" size of the object.
  */
 
-Uint
-size_object(Eterm obj)
+static ERTS_INLINE Uint
+do_size_object(Eterm obj, int shared)
 {
     Uint sum = 0;
     Eterm* ptr;
@@ -79,6 +86,9 @@ size_object(Eterm obj)
 
     DECLARE_ESTACK(s);
     for (;;) {
+	if (!IS_CONST(obj) && IS_SHARED_PTR(ptr_val(obj))) {
+	    obj = NIL;
+	}
 	switch (primary_tag(obj)) {
 	case TAG_PRIMARY_LIST:
 	    sum += 2;
@@ -183,11 +193,36 @@ size_object(Eterm obj)
     }
 }
 
+Uint
+size_object(Eterm obj)
+{
+    return do_size_object(obj, 0);
+}
+
+/*
+ * Return the size of the object, not counting any published terms
+ * in it. Use together with copy_struct_shared().
+ */
+Uint
+size_object_shared(Eterm obj)
+{
+    Uint sz;
+
+    if (!erts_have_shared_terms()) {
+	return do_size_object(obj, 0);
+    }
+    erts_shared_terms_rlock();
+    sz = do_size_object(obj, 1);
+    erts_shared_terms_runlock();
+    return sz;
+}
+
 /*
  *  Copy a structure to a heap.
  */
-Eterm
-copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
+static ERTS_INLINE Eterm
+do_copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap,
+	       int shared)
 {
     char* hstart;
     Uint hsize;
@@ -208,7 +243,7 @@ copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
     Uint org_sz = sz;
 #endif
 
-    if (IS_CONST(obj))
+    if (IS_CONST(obj) || IS_SHARED_PTR(ptr_val(obj)))
 	return obj;
 
     hp = htop = *hpp;
@@ -237,7 +272,7 @@ copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
 	    break;
 	case TAG_PRIMARY_LIST:
 	    objp = list_val(obj);
-	    if (in_area(objp,hstart,hsize)) {
+	    if (in_area(objp,hstart,hsize) || IS_SHARED_PTR(objp)) {
 		hp++;
 		break;
 	    }
@@ -246,7 +281,7 @@ copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
 
 	L_copy_list:
 	    tailp = argp;
-	    while (is_list(obj)) {
+	    while (is_list(obj) && !IS_SHARED_PTR(list_val(obj))) {
 		objp = list_val(obj);
 		tp = tailp;
 		elem = *objp;
@@ -265,7 +300,14 @@ copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
 	    }
 	    switch (primary_tag(obj)) {
 	    case TAG_PRIMARY_IMMED1: *tailp = obj; goto L_copy;
-	    case TAG_PRIMARY_BOXED: argp = tailp; goto L_copy_boxed;
+	    case TAG_PRIMARY_LIST: *tailp = obj; goto L_copy; /* Shared. */
+	    case TAG_PRIMARY_BOXED:
+		if (IS_SHARED_PTR(boxed_val(obj))) {
+		    *tailp = obj;
+		    goto L_copy;
+		}
+		argp = tailp;
+		goto L_copy_boxed;
 	    default:
 		erl_exit(ERTS_ABORT_EXIT,
 			 "%s, line %d: Internal error in copy_struct: 0x%08x\n",
@@ -273,7 +315,8 @@ copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
 	    }
 	    
 	case TAG_PRIMARY_BOXED:
-	    if (in_area(boxed_val(obj),hstart,hsize)) {
+	    if (in_area(boxed_val(obj),hstart,hsize)
+		|| IS_SHARED_PTR(boxed_val(obj))) {
 		hp++;
 		break;
 	    }
@@ -467,6 +510,30 @@ copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
     return res;
 }
 
+Eterm
+copy_struct(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
+{
+    return do_copy_struct(obj, sz, hpp, off_heap, 0);
+}
+
+/*
+ * Copy a structure to a heap, leaving any published terms in it in
+ * place. The size must have been calculated by size_object_shared().
+ */
+Eterm
+copy_struct_shared(Eterm obj, Uint sz, Eterm** hpp, ErlOffHeap* off_heap)
+{
+    Eterm res;
+
+    if (!erts_have_shared_terms()) {
+	return do_copy_struct(obj, sz, hpp, off_heap, 0);
+    }
+    erts_shared_terms_rlock();
+    res = do_copy_struct(obj, sz, hpp, off_heap, 1);
+    erts_shared_terms_runlock();
+    return res;
+}
+
 #ifdef HYBRID
 
 #ifdef BM_MESSAGE_SIZES
@@ -64,8 +64,13 @@ static void
 dist_msg_dbg(ErtsDistExternal *edep, char *what, byte *buf, int sz)
 {
     byte *extp = edep->extp;
+    byte *ext_endp = edep->ext_endp;
+    Binary *bin = edep->bin;
+    byte *lz_buf;
     Eterm msg;
-    Sint size = erts_decode_dist_ext_size(edep, 0);
+    Sint size = -1;
+    if (erts_dist_ext_uncompress(edep, &lz_buf) == 0)
+	size = erts_decode_dist_ext_size(edep, 0);
     if (size < 0) {
 	erts_fprintf(stderr,
 		     "DIST MSG DEBUG: erts_decode_dist_ext_size(%s) failed:\n",
@@ -86,8 +91,12 @@ dist_msg_dbg(ErtsDistExternal *edep, char *what, byte *buf, int sz)
 	    bw(buf, sz);
 	}
 	free_message_buffer(mbuf);
-	edep->extp = extp;
     }
+    if (lz_buf)
+	erts_free(ERTS_ALC_T_TMP, (void *) lz_buf);
+    edep->extp = extp;
+    edep->ext_endp = ext_endp;
+    edep->bin = bin;
 }
 
 #endif
@@ -101,6 +110,7 @@ int erts_is_alive; /* System must be blocked on change */
 /* distribution trap functions */
 Export* dsend2_trap = NULL;
 Export* dsend3_trap = NULL;
+Export* dsend_multi_trap = NULL;
 /*Export* dsend_nosuspend_trap = NULL;*/
 Export* dlink_trap = NULL;
 Export* dunlink_trap = NULL;
@@ -115,7 +125,8 @@ Export* dmonitor_p_trap = NULL;
 /* forward declarations */
 
 static void clear_dist_entry(DistEntry*);
-static int dsig_send(ErtsDSigData *, Eterm, Eterm, int);
+static int dsig_send(ErtsDSigData *, Eterm, Eterm, Eterm, int);
+static BIF_RETTYPE dsend_continue_trap(BIF_ALIST_2);
 static void send_nodes_mon_msgs(Process *, Eterm, Eterm, Eterm, Eterm);
 static void init_nodes_monitors(void);
 
@@ -149,7 +160,11 @@ create_cache(DistEntry *dep)
     for (i = 0; i < sizeof(cp->in_arr)/sizeof(cp->in_arr[0]); i++) {
 	cp->in_arr[i] = THE_NON_VALUE;
 	cp->out_arr[i] = THE_NON_VALUE;
+	cp->out_used[i] = 0;
     }
+    cp->out_clock = 0;
+    cp->out_hits = 0;
+    cp->out_misses = 0;
 }
 
 Uint erts_dist_cache_size(void)
@@ -157,6 +172,156 @@ Uint erts_dist_cache_size(void)
     return (Uint) erts_smp_atomic_read(&no_caches)*sizeof(ErtsAtomCache);
 }
 
+/*
+ * erlang:system_info({dist_atom_cache, Node}); the output atom cache
+ * counters of all connections to Node. The counters are updated under
+ * the port lock, so they are only read loosely here.
+ */
+Eterm
+erts_dist_atom_cache_info(Process *c_p, Eterm node)
+{
+    Eterm tags[4] = {am_size, am_ways, am_hits, am_misses};
+    Uint values[4] = {ERTS_ATOM_CACHE_SIZE, ERTS_ATOM_CACHE_WAYS, 0, 0};
+    Uint sz = 0, *hp;
+    DistEntry *dep;
+    int i;
+
+    if (is_not_atom(node))
+	return THE_NON_VALUE;
+    dep = erts_sysname_to_connected_dist_entry(node);
+    if (!dep)
+	return am_undefined;
+    if (dep == erts_this_dist_entry) {
+	erts_deref_dist_entry(dep);
+	return am_undefined;
+    }
+
+    erts_smp_de_rlock(dep);
+    if (dep->cache) {
+	values[2] += dep->cache->out_hits;
+	values[3] += dep->cache->out_misses;
+    }
+    for (i = 0; i < dep->no_lanes; i++) {
+	DistEntry *lane = dep->lanes[i];
+	erts_smp_de_rlock(lane);
+	if (lane->cache) {
+	    values[2] += lane->cache->out_hits;
+	    values[3] += lane->cache->out_misses;
+	}
+	erts_smp_de_runlock(lane);
+    }
+    erts_smp_de_runlock(dep);
+    erts_deref_dist_entry(dep);
+
+    (void) erts_bld_atom_uint_2tup_list(NULL, &sz, 4, tags, values);
+    hp = HAlloc(c_p, sz);
+    return erts_bld_atom_uint_2tup_list(&hp, NULL, 4, tags, values);
+}
+
+#define ERTS_DIST_STATS_COUNTERS 11
+
+static void
+add_dist_stats(DistEntry *dep, Uint64 *values, Uint64 *latency)
+{
+    ErtsDistStats *sp = &dep->stats;
+    int i;
+
+    values[0] += sp->out_msgs;
+    values[1] += sp->out_bytes;
+    values[2] += sp->in_msgs;
+    values[3] += sp->in_bytes;
+    values[4] += sp->encode_time;
+    values[5] += sp->decode_time;
+    if (dep->cache) {
+	values[6] += dep->cache->out_hits;
+	values[7] += dep->cache->out_misses;
+    }
+    values[8] += sp->busy;
+    values[9] += (Uint64) dep->qsize;
+    if ((Uint64) sp->max_qsize > values[10])
+	values[10] = (Uint64) sp->max_qsize;
+    for (i = 0; i < ERTS_DIST_LATENCY_SLOTS; i++)
+	latency[i] += sp->latency[i];
+}
+
+/*
+ * Statistics of the connection to node, summed over its lanes. The
+ * counters are read without locking the queues or the ports, so they
+ * may be slightly behind.
+ */
+Eterm
+erts_dist_stats_info(Process *c_p, Eterm node)
+{
+    Eterm tags[ERTS_DIST_STATS_COUNTERS] = {am_out_msgs, am_out_bytes,
+					    am_in_msgs, am_in_bytes,
+					    am_encode_time, am_decode_time,
+					    am_atom_cache_hits,
+					    am_atom_cache_misses,
+					    am_busy_dist_port, am_queue_size,
+					    am_max_queue_size};
+    Uint64 values[ERTS_DIST_STATS_COUNTERS];
+    Uint64 latency[ERTS_DIST_LATENCY_SLOTS];
+    Uint sz, *hp, **hpp, *szp;
+    Eterm res = NIL, hist;
+    DistEntry *dep;
+    int i;
+
+    if (is_not_atom(node))
+	return THE_NON_VALUE;
+    dep = erts_sysname_to_connected_dist_entry(node);
+    if (!dep)
+	return am_undefined;
+    if (dep == erts_this_dist_entry) {
+	erts_deref_dist_entry(dep);
+	return am_undefined;
+    }
+
+    sys_memzero((void *) values, sizeof(values));
+    sys_memzero((void *) latency, sizeof(latency));
+    erts_smp_de_rlock(dep);
+    add_dist_stats(dep, values, latency);
+    for (i = 0; i < dep->no_lanes; i++) {
+	DistEntry *lane = dep->lanes[i];
+	erts_smp_de_rlock(lane);
+	add_dist_stats(lane, values, latency);
+	erts_smp_de_runlock(lane);
+    }
+    erts_smp_de_runlock(dep);
+    erts_deref_dist_entry(dep);
+
+    /* The first pass sizes the result, the second builds it */
+    sz = 0;
+    hpp = NULL;
+    szp = &sz;
+    while (1) {
+	hist = NIL;
+	for (i = ERTS_DIST_LATENCY_SLOTS - 1; i >= 0; i--) {
+	    Eterm limit = (i == ERTS_DIST_LATENCY_SLOTS - 1
+			   ? am_infinity
+			   : make_small(((Uint) 1) << i));
+	    hist = erts_bld_cons(hpp, szp,
+				 erts_bld_tuple(hpp, szp, 2, limit,
+						erts_bld_uint64(hpp, szp,
+								latency[i])),
+				 hist);
+	}
+	res = erts_bld_cons(hpp, szp,
+			    erts_bld_tuple(hpp, szp, 2, am_send_latency, hist),
+			    NIL);
+	for (i = ERTS_DIST_STATS_COUNTERS - 1; i >= 0; i--)
+	    res = erts_bld_cons(hpp, szp,
+				erts_bld_tuple(hpp, szp, 2, tags[i],
+					       erts_bld_uint64(hpp, szp,
+							       values[i])),
+				res);
+	if (hpp)
+	    return res;
+	hp = HAlloc(c_p, sz);
+	hpp = &hp;
+	szp = NULL;
+    }
+}
+
 static ErtsProcList *
 get_suspended_on_de(DistEntry *dep, Uint32 unset_qflgs)
 {
@@ -383,7 +548,88 @@ static void doit_node_link_net_exits(ErtsLink *lnk, void *vnecp)
     erts_destroy_link(lnk);
 }
 
-	
+
+/*
+ * Extra connections (lanes).
+ *
+ * A node can be connected over several connections, so that encoding
+ * and decoding of signals to and from it are spread over schedulers.
+ * The primary connection is set up by setnode/3 as usual; the other
+ * ones, lanes, are attached to the dist entry by setnode/3 before that
+ * (see setnode_lane()), and are taken into use by the setnode/3 call
+ * that sets up the primary connection. Signals are then spread over
+ * the connections by sender (see erts_dist_lane()), which preserves
+ * signal order between pairs of processes. Links, monitors and the
+ * connection state are kept in the primary dist entry only; a lane has
+ * its own output queue, atom cache and port, and is protected by its
+ * own lock, which is ordered after the lock of the primary.
+ *
+ * When a lane goes down the whole connection to the node is taken
+ * down, and when the primary connection goes down its lanes are
+ * killed.
+ */
+
+/* connection_id of lanes not taken into use */
+#define ERTS_DIST_LANE_NOT_IN_USE (~((Uint32) 0))
+
+static void
+lane_net_exits(DistEntry *lane)
+{
+    DistEntry *dep = lane->primary;
+    Uint32 connection_id = 0;
+    int i, kill = 0, detached = 0;
+
+    erts_smp_de_rwlock(dep);
+    for (i = 0; i < dep->no_lanes; i++) {
+	if (dep->lanes[i] == lane)
+	    break;
+    }
+    if (i < dep->no_lanes) {
+	if (is_internal_port(dep->cid)
+	    && dep->connection_id == lane->connection_id) {
+	    connection_id = dep->connection_id;
+	    kill = 1;
+	}
+	else {
+	    /* Not taken into use yet */
+	    dep->lanes[i] = dep->lanes[--dep->no_lanes];
+	    if (!dep->no_lanes) {
+		erts_free(ERTS_ALC_T_DIST_LANES, (void *) dep->lanes);
+		dep->lanes = NULL;
+	    }
+	    detached = 1;
+	}
+    }
+    erts_smp_de_rwunlock(dep);
+
+    if (kill)
+	erts_kill_dist_connection(dep, connection_id);
+
+    erts_smp_atomic_set(&lane->dist_cmd_scheduled, 1);
+    erts_smp_de_rwlock(lane);
+
+    ERTS_SMP_LC_ASSERT(is_internal_port(lane->cid)
+		       && erts_lc_is_port_locked(&erts_port[internal_port_index(lane->cid)]));
+
+    if (erts_port_task_is_scheduled(&lane->dist_cmd))
+	erts_port_task_abort(lane->cid, &lane->dist_cmd);
+
+    if (!(lane->status & ERTS_DE_SFLG_EXITING)) {
+	lane->status |= ERTS_DE_SFLG_EXITING;
+	erts_smp_spin_lock(&lane->qlock);
+	lane->qflgs |= ERTS_DE_QFLG_EXIT;
+	erts_smp_spin_unlock(&lane->qlock);
+    }
+    lane->cid = NIL;
+    lane->flags = 0;
+    erts_smp_de_rwunlock(lane);
+
+    clear_dist_entry(lane);
+
+    if (detached)
+	erts_deref_dist_entry(lane);
+}
+
 /*
  * proc is currently running or exiting process.
  */
@@ -432,12 +678,18 @@ int erts_do_net_exits(DistEntry *dep, Eterm reason)
 	erts_smp_release_system();
 
     }
+    else if (dep->primary) {
+	/* A lane; the connection to the node goes down with it */
+	lane_net_exits(dep);
+    }
     else { /* recursive call via erts_do_exit_port() will end up here */
 	NetExitsContext nec = {dep};
 	ErtsLink *nlinks;
 	ErtsLink *node_links;
 	ErtsMonitor *monitors;
 	Uint32 flags;
+	DistEntry **lanes;
+	int i, no_lanes;
 
 	erts_smp_atomic_set(&dep->dist_cmd_scheduled, 1);
 	erts_smp_de_rwlock(dep);
@@ -474,11 +726,22 @@ int erts_do_net_exits(DistEntry *dep, Eterm reason)
 
 	nodename = dep->sysname;
 	flags = dep->flags;
+	lanes = dep->lanes;
+	no_lanes = dep->no_lanes;
+	dep->lanes = NULL;
+	dep->no_lanes = 0;
 
 	erts_set_dist_entry_not_connected(dep);
 
 	erts_smp_de_rwunlock(dep);
 
+	for (i = 0; i < no_lanes; i++) {
+	    erts_kill_dist_connection(lanes[i], lanes[i]->connection_id);
+	    erts_deref_dist_entry(lanes[i]);
+	}
+	if (lanes)
+	    erts_free(ERTS_ALC_T_DIST_LANES, (void *) lanes);
+
 	erts_sweep_monitors(monitors, &doit_monitor_net_exits, (void *) &nec);
 	erts_sweep_links(nlinks, &doit_link_net_exits, (void *) &nec);
 	erts_sweep_links(node_links, &doit_node_link_net_exits, (void *) &nec);
@@ -510,6 +773,7 @@ void init_dist(void)
     /* Lookup/Install all references to trap functions */
     dsend2_trap = trap_function(am_dsend,2);
     dsend3_trap = trap_function(am_dsend,3);
+    dsend_multi_trap = trap_function(am_dsend_multi,3);
     /*    dsend_nosuspend_trap = trap_function(am_dsend_nosuspend,2);*/
     dlink_trap = trap_function(am_dlink,1);
     dunlink_trap = trap_function(am_dunlink,1);
@@ -517,17 +781,37 @@ void init_dist(void)
     dgroup_leader_trap = trap_function(am_dgroup_leader,2);
     dexit_trap = trap_function(am_dexit, 2);
     dmonitor_p_trap = trap_function(am_dmonitor_p, 2);
+
+    /* dsend_continue_trap/2 is a hidden BIF that send/2,3 trap to. */
+    sys_memset((void *) &erts_dsig_send_frag_trap_export, 0, sizeof(Export));
+    erts_dsig_send_frag_trap_export.address =
+	&erts_dsig_send_frag_trap_export.code[3];
+    erts_dsig_send_frag_trap_export.code[0] = am_erlang;
+    erts_dsig_send_frag_trap_export.code[1] = am_dsend_continue_trap;
+    erts_dsig_send_frag_trap_export.code[2] = 2;
+    erts_dsig_send_frag_trap_export.code[3] = (Eterm) em_apply_bif;
+    erts_dsig_send_frag_trap_export.code[4] = (Eterm) &dsend_continue_trap;
 }
 
 #define ErtsDistOutputBuf2Binary(OB) \
   ((Binary *) (((char *) (OB)) - offsetof(Binary, orig_bytes)))
 
+/*
+ * Allocates an output buffer with size bytes of own data and room for
+ * max_refs references to binaries (see ErtsDistOutputRef).
+ */
 static ERTS_INLINE ErtsDistOutputBuf *
-alloc_dist_obuf(Uint size)
+alloc_dist_obuf(Uint size, Uint max_refs)
 {
     ErtsDistOutputBuf *obuf;
     Uint obuf_size = sizeof(ErtsDistOutputBuf)+sizeof(byte)*(size-1);
-    Binary *bin = erts_bin_drv_alloc(obuf_size);
+    Uint refs_offs = 0;
+    Binary *bin;
+    if (max_refs) {
+	refs_offs = obuf_size + ERTS_WORD_ALIGN_PAD_SZ(obuf_size);
+	obuf_size = refs_offs + max_refs*sizeof(ErtsDistOutputRef);
+    }
+    bin = erts_bin_drv_alloc(obuf_size);
     bin->flags = BIN_FLAG_DRV;
     erts_refc_init(&bin->refc, 1);
     bin->orig_size = (long) obuf_size;
@@ -536,14 +820,29 @@ alloc_dist_obuf(Uint size)
     obuf->dbg_pattern = ERTS_DIST_OUTPUT_BUF_DBG_PATTERN;
     ASSERT(bin == ErtsDistOutputBuf2Binary(obuf));
 #endif
+    obuf->refs = (max_refs
+		  ? (ErtsDistOutputRef *) (((char *) obuf) + refs_offs)
+		  : NULL);
+    obuf->no_refs = 0;
+    obuf->refs_size = 0;
     return obuf;
 }
 
+/*
+ * The references to binaries are released right away; a driver that
+ * keeps the data of a buffer has taken its own references to them.
+ */
 static ERTS_INLINE void
 free_dist_obuf(ErtsDistOutputBuf *obuf)
 {
     Binary *bin = ErtsDistOutputBuf2Binary(obuf);
+    Uint i;
     ASSERT(obuf->dbg_pattern == ERTS_DIST_OUTPUT_BUF_DBG_PATTERN);
+    for (i = 0; i < obuf->no_refs; i++) {
+	Binary *rbin = obuf->refs[i].bin;
+	if (erts_refc_dectest(&rbin->refc, 0) == 0)
+	    erts_bin_free(rbin);
+    }
     if (erts_refc_dectest(&bin->refc, 0) == 0)
 	erts_bin_free(bin);
 }
@@ -552,19 +851,96 @@ static ERTS_INLINE Sint
 size_obuf(ErtsDistOutputBuf *obuf)
 {
     Binary *bin = ErtsDistOutputBuf2Binary(obuf);
-    return bin->orig_size;
+    return bin->orig_size + obuf->refs_size;
+}
+
+/*
+ * Connection statistics, see ErtsDistStats. Times are taken in
+ * microseconds from the high resolution timer when there is one.
+ */
+
+static ERTS_INLINE Uint64
+dist_stat_time(void)
+{
+#ifdef HAVE_GETHRTIME
+    return (Uint64) (sys_gethrtime() / 1000);
+#else
+    SysTimeval tv;
+    sys_gettimeofday(&tv);
+    return ((Uint64) tv.tv_sec) * 1000000 + tv.tv_usec;
+#endif
+}
+
+/* Called with the port locked when obuf has been written to the port */
+static ERTS_INLINE void
+dist_stat_sent(DistEntry *dep, ErtsDistOutputBuf *obuf, Uint size)
+{
+    Uint64 now = dist_stat_time();
+    Uint64 latency = now > obuf->enq_time ? now - obuf->enq_time : 0;
+    int i = 0;
+    while (i < ERTS_DIST_LATENCY_SLOTS - 1 && latency >= (((Uint64) 1) << i))
+	i++;
+    dep->stats.latency[i]++;
+    dep->stats.out_msgs++;
+    dep->stats.out_bytes += size;
+}
+
+/* Called with qlock locked */
+static ERTS_INLINE void
+set_de_busy(DistEntry *dep)
+{
+    if (!(dep->qflgs & ERTS_DE_QFLG_BUSY)) {
+	dep->qflgs |= ERTS_DE_QFLG_BUSY;
+	dep->stats.busy++;
+    }
+}
+
+/*
+ * Reassembly of fragmented messages (see dsig_frag_encode()). The dist
+ * header of the first fragment is processed when that fragment arrives,
+ * so that the atom cache is updated in the same order as on the sending
+ * side; its atom translations are saved until the message is complete.
+ */
+#define ERTS_DIST_FRAG_PREALLOC 16
+
+typedef struct ErtsDistFragAsm_ {
+    struct ErtsDistFragAsm_ *next;
+    Uint64 seq_id;
+    Uint64 frag_id;		/* Id of last received fragment */
+    Binary *bin;		/* The message so far, which decoded
+				   binaries may refer to */
+    Uint size;
+    ErtsDistExternal ede;
+} ErtsDistFragAsm;
+
+static ERTS_INLINE Uint64
+get_dist_frag_id(byte *ep)
+{
+    return ((((Uint64) (Uint32) get_int32(ep)) << 32)
+	    | ((Uint64) (Uint32) get_int32(ep + 4)));
+}
+
+static void
+free_dist_frag_asm(ErtsDistFragAsm *fap)
+{
+    if (erts_refc_dectest(&fap->bin->refc, 0) == 0)
+	erts_bin_free(fap->bin);
+    erts_free(ERTS_ALC_T_DIST_FRAG_ASM, (void *) fap);
 }
 
 static void clear_dist_entry(DistEntry *dep)
 {
     Sint obufsize = 0;
     ErtsAtomCache *cache;
+    ErtsDistFragAsm *fap;
     ErtsProcList *suspendees;
     ErtsDistOutputBuf *obuf;
 
     erts_smp_de_rwlock(dep);
     cache = dep->cache;
     dep->cache = NULL;
+    fap = dep->frag_asm;
+    dep->frag_asm = NULL;
 
 #ifdef DEBUG
     erts_smp_de_links_lock(dep);
@@ -599,6 +975,12 @@ static void clear_dist_entry(DistEntry *dep)
 
     delete_cache(cache);
 
+    while (fap) {
+	ErtsDistFragAsm *ffap = fap;
+	fap = fap->next;
+	free_dist_frag_asm(ffap);
+    }
+
     while (obuf) {
 	ErtsDistOutputBuf *fobuf;
 	fobuf = obuf;
@@ -635,7 +1017,7 @@ erts_dsig_send_link(ErtsDSigData *dsdp, Eterm local, Eterm remote)
     Eterm ctl_heap[4];
     Eterm ctl = TUPLE3(&ctl_heap[0], make_small(DOP_LINK), local, remote);
 
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 0);
+    return dsig_send(dsdp, local, ctl, THE_NON_VALUE, 0);
 }
 
 int
@@ -644,7 +1026,7 @@ erts_dsig_send_unlink(ErtsDSigData *dsdp, Eterm local, Eterm remote)
     Eterm ctl_heap[4];
     Eterm ctl = TUPLE3(&ctl_heap[0], make_small(DOP_UNLINK), local, remote);
 
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 0);
+    return dsig_send(dsdp, local, ctl, THE_NON_VALUE, 0);
 }
 
 
@@ -653,7 +1035,7 @@ erts_dsig_send_unlink(ErtsDSigData *dsdp, Eterm local, Eterm remote)
    which is rather sad as only the ref is needed, no pid's... */
 int
 erts_dsig_send_m_exit(ErtsDSigData *dsdp, Eterm watcher, Eterm watched, 
-			  Eterm ref, Eterm reason)
+		      Eterm ref, Eterm reason, Eterm local)
 {
     Eterm ctl;
     Eterm ctl_heap[6];
@@ -667,7 +1049,7 @@ erts_dsig_send_m_exit(ErtsDSigData *dsdp, Eterm watcher, Eterm watched,
     erts_smp_de_links_unlock(dsdp->dep);
 #endif
 
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 1);
+    return dsig_send(dsdp, local, ctl, THE_NON_VALUE, 1);
 }
 
 /* We want to monitor a process (named or unnamed) on another node, we send:
@@ -684,7 +1066,7 @@ erts_dsig_send_monitor(ErtsDSigData *dsdp, Eterm watcher, Eterm watched,
 		 make_small(DOP_MONITOR_P),
 		 watcher, watched, ref);
 
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 0);
+    return dsig_send(dsdp, watcher, ctl, THE_NON_VALUE, 0);
 }
 
 /* A local process monitoring a remote one wants to stop monitoring, either 
@@ -702,7 +1084,7 @@ erts_dsig_send_demonitor(ErtsDSigData *dsdp, Eterm watcher,
 		 make_small(DOP_DEMONITOR_P),
 		 watcher, watched, ref);
 
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, force);
+    return dsig_send(dsdp, watcher, ctl, THE_NON_VALUE, force);
 }
 
 int
@@ -724,7 +1106,7 @@ erts_dsig_send_msg(ErtsDSigData *dsdp, Eterm remote, Eterm message)
 		     make_small(DOP_SEND_TT), am_Cookie, remote, token);
     else
 	ctl = TUPLE3(&ctl_heap[0], make_small(DOP_SEND), am_Cookie, remote);
-    return dsig_send(dsdp, ctl, message, 0);
+    return dsig_send(dsdp, sender->id, ctl, message, 0);
 }
 
 int
@@ -747,7 +1129,7 @@ erts_dsig_send_reg_msg(ErtsDSigData *dsdp, Eterm remote_name, Eterm message)
     else
 	ctl = TUPLE4(&ctl_heap[0], make_small(DOP_REG_SEND),
 		     sender->id, am_Cookie, remote_name);
-    return dsig_send(dsdp, ctl, message, 0);
+    return dsig_send(dsdp, sender->id, ctl, message, 0);
 }
 
 /* local has died, deliver the exit signal to remote */
@@ -767,7 +1149,7 @@ erts_dsig_send_exit_tt(ErtsDSigData *dsdp, Eterm local, Eterm remote,
 	ctl = TUPLE4(&ctl_heap[0], make_small(DOP_EXIT), local, remote, reason);
     }
     /* forced, i.e ignore busy */
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 1);
+    return dsig_send(dsdp, local, ctl, THE_NON_VALUE, 1);
 }
 
 int
@@ -777,7 +1159,7 @@ erts_dsig_send_exit(ErtsDSigData *dsdp, Eterm local, Eterm remote, Eterm reason)
     Eterm ctl = TUPLE4(&ctl_heap[0],
 		       make_small(DOP_EXIT), local, remote, reason);
     /* forced, i.e ignore busy */
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 1);
+    return dsig_send(dsdp, local, ctl, THE_NON_VALUE, 1);
 }
 
 int
@@ -787,7 +1169,7 @@ erts_dsig_send_exit2(ErtsDSigData *dsdp, Eterm local, Eterm remote, Eterm reason
     Eterm ctl = TUPLE4(&ctl_heap[0],
 		       make_small(DOP_EXIT2), local, remote, reason);
 
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 0);
+    return dsig_send(dsdp, local, ctl, THE_NON_VALUE, 0);
 }
 
 
@@ -798,7 +1180,8 @@ erts_dsig_send_group_leader(ErtsDSigData *dsdp, Eterm leader, Eterm remote)
     Eterm ctl = TUPLE3(&ctl_heap[0],
 		       make_small(DOP_GROUP_LEADER), leader, remote);
 
-    return dsig_send(dsdp, ctl, THE_NON_VALUE, 0);
+    return dsig_send(dsdp, dsdp->proc ? dsdp->proc->id : NIL,
+		     ctl, THE_NON_VALUE, 0);
 }
 
 #if defined(PURIFY)
@@ -823,6 +1206,95 @@ erts_dsig_send_group_leader(ErtsDSigData *dsdp, Eterm leader, Eterm remote)
 #  define PURIFY_MSG(msg)
 #endif
 
+/*
+ * Returns 1 and sets up edep when the message is complete; the caller
+ * should free *fapp when done with it. Returns 0 if more fragments are
+ * expected, and -1 on error.
+ */
+static int
+dist_frag_input(DistEntry *dep, DistEntry *ldep, byte *t, int len,
+		ErtsDistExternal *edep, ErtsDistFragAsm **fapp)
+{
+    ErtsDistFragAsm *fap, **fapp_prev;
+    Uint64 seq_id, frag_id;
+    Uint size, alloc_size;
+
+    if (len < 2 + ERTS_DIST_FRAG_IDS_SIZE)
+	return -1;
+    seq_id = get_dist_frag_id(&t[2]);
+    frag_id = get_dist_frag_id(&t[2+8]);
+    if (frag_id == 0)
+	return -1;
+
+    fapp_prev = &ldep->frag_asm;
+    while (*fapp_prev && (*fapp_prev)->seq_id != seq_id)
+	fapp_prev = &(*fapp_prev)->next;
+    fap = *fapp_prev;
+
+    if (t[1] == DIST_FRAG_HEADER) {
+	if (fap) {
+	    /* Stale message from a previous use of the sequence id */
+	    *fapp_prev = fap->next;
+	    free_dist_frag_asm(fap);
+	}
+	fap = erts_alloc(ERTS_ALC_T_DIST_FRAG_ASM, sizeof(ErtsDistFragAsm));
+	if (erts_prepare_dist_ext(&fap->ede, t, len, dep, ldep->cache) < 0) {
+	    erts_free(ERTS_ALC_T_DIST_FRAG_ASM, (void *) fap);
+	    return -1;
+	}
+	fap->seq_id = seq_id;
+	fap->frag_id = frag_id;
+	size = fap->ede.ext_endp - fap->ede.extp;
+	/* Assume equally sized fragments, but do not trust the fragment
+	   count too far ahead; the buffer grows when needed */
+	alloc_size = size * (frag_id < ERTS_DIST_FRAG_PREALLOC
+			     ? frag_id
+			     : ERTS_DIST_FRAG_PREALLOC);
+	fap->bin = erts_bin_nrml_alloc(alloc_size);
+	fap->bin->flags = 0;
+	fap->bin->orig_size = (long) alloc_size;
+	erts_refc_init(&fap->bin->refc, 1);
+	sys_memcpy((void *) fap->bin->orig_bytes, (void *) fap->ede.extp, size);
+	fap->size = size;
+	fap->next = ldep->frag_asm;
+	ldep->frag_asm = fap;
+	fapp_prev = &ldep->frag_asm;
+    }
+    else {
+	if (!fap || fap->frag_id - 1 != frag_id)
+	    return -1;
+	size = len - (2 + ERTS_DIST_FRAG_IDS_SIZE);
+	if (fap->size + size > (Uint) fap->bin->orig_size) {
+	    /* Nothing refers to the binary until the message is done */
+	    alloc_size = 2*(fap->size + size);
+	    fap->bin = erts_bin_realloc(fap->bin, alloc_size);
+	    fap->bin->orig_size = (long) alloc_size;
+	}
+	sys_memcpy((void *) (fap->bin->orig_bytes + fap->size),
+		   (void *) &t[2 + ERTS_DIST_FRAG_IDS_SIZE],
+		   size);
+	fap->size += size;
+	fap->frag_id = frag_id;
+    }
+
+    if (frag_id > 1)
+	return 0;
+
+    /* Last fragment received */
+    *fapp_prev = fap->next;
+    if ((Uint) fap->bin->orig_size > fap->size) {
+	/* Decoded binaries may refer to it; drop the slack */
+	fap->bin = erts_bin_realloc(fap->bin, fap->size);
+	fap->bin->orig_size = (long) fap->size;
+    }
+    sys_memcpy((void *) edep, (void *) &fap->ede, ERTS_DIST_EXT_SIZE(&fap->ede));
+    edep->extp = (byte *) fap->bin->orig_bytes;
+    edep->ext_endp = edep->extp + fap->size;
+    edep->bin = fap->bin;
+    *fapp = fap;
+    return 1;
+}
+
 /*
 ** Input from distribution port.
 **  Input follows the distribution protocol v4.5
@@ -832,12 +1304,13 @@ erts_dsig_send_group_leader(ErtsDSigData *dsdp, Eterm leader, Eterm remote)
 **
 **   assert  hlen == 0 !!!
 */
-int erts_net_message(Port *prt,
-		     DistEntry *dep,
-		     byte *hbuf,
-		     int hlen,
-		     byte *buf,
-		     int len)
+static int net_message(Port *prt,
+		       DistEntry *dep,
+		       byte *hbuf,
+		       int hlen,
+		       Binary *bin,
+		       byte *buf,
+		       int len)
 {
     ErtsDistExternal ede;
     byte *t;
@@ -859,6 +1332,9 @@ int erts_net_message(Port *prt,
     Eterm token_size;
     ErtsMonitor *mon;
     ErtsLink *lnk;
+    ErtsDistFragAsm *fap = NULL;
+    byte *lz_buf = NULL;
+    DistEntry *ldep = dep; /* Dist entry of the connection (prt) */
     int res;
 #ifdef ERTS_DIST_MSG_DBG
     int orig_len = len;
@@ -883,6 +1359,18 @@ int erts_net_message(Port *prt,
     if (len == 0)  /* HANDLE TICK !!! */
 	return 0;
 
+    if (ldep->primary) {
+	/* Input on a lane; the node is represented by the primary */
+	int in_use;
+	dep = ldep->primary;
+	erts_smp_de_rlock(dep);
+	in_use = (is_internal_port(dep->cid)
+		  && dep->connection_id == ldep->connection_id);
+	erts_smp_de_runlock(dep);
+	if (!in_use)
+	    return 0;
+    }
+
 #ifdef ERTS_RAW_DIST_MSG_DBG
     erts_fprintf(stderr, "<< ");
     bw(buf, len);
@@ -901,7 +1389,18 @@ int erts_net_message(Port *prt,
 	goto data_error;
     }
 
-    res = erts_prepare_dist_ext(&ede, t, len, dep, dep->cache);
+    if ((dep->flags & DFLAG_DIST_HDR_ATOM_CACHE)
+	&& len > 1
+	&& t[0] == VERSION_MAGIC
+	&& (t[1] == DIST_FRAG_HEADER || t[1] == DIST_FRAG_CONT)) {
+	res = dist_frag_input(dep, ldep, t, len, &ede, &fap);
+	if (res == 0)
+	    return 0; /* More fragments to come */
+    }
+    else {
+	res = erts_prepare_dist_ext(&ede, t, len, dep, ldep->cache);
+	ede.bin = bin;
+    }
 
     if (res >= 0)
 	res = ctl_len = erts_decode_dist_ext_size(&ede, 0);
@@ -952,8 +1451,21 @@ int erts_net_message(Port *prt,
     }
 
     token_size = 0;
+    type = unsigned_val(tuple[1]);
+
+    /*
+     * The message, if any, may be LZ compressed. Messages without a
+     * trace token are queued as they are and uncompressed by the
+     * receiver (see erts_uncompress_dist_ext_copy()), so that the work
+     * is not done by the scheduler running the port.
+     */
+    if (type != DOP_SEND && type != DOP_REG_SEND
+	&& erts_dist_ext_uncompress(&ede, &lz_buf) < 0) {
+	PURIFY_MSG("data error");
+	goto data_error;
+    }
 
-    switch (type = unsigned_val(tuple[1])) {
+    switch (type) {
     case DOP_LINK:
 	from = tuple[2];
 	to   = tuple[3];  /* local proc to link to */
@@ -1056,7 +1568,7 @@ int erts_net_message(Port *prt,
 	    code = erts_dsig_prepare(&dsd, dep, NULL, ERTS_DSP_NO_LOCK, 0);
 	    if (code == ERTS_DSIG_PREP_CONNECTED) {
 		code = erts_dsig_send_m_exit(&dsd, watcher, watched, ref,
-					     am_noproc);
+					     am_noproc, watched);
 		ASSERT(code == ERTS_DSIG_SEND_OK);
 	    }
 	}
@@ -1384,6 +1896,10 @@ int erts_net_message(Port *prt,
 	erts_free(ERTS_ALC_T_DCTRL_BUF, (void *) ctl);
     }
 #endif
+    if (fap)
+	free_dist_frag_asm(fap);
+    if (lz_buf)
+	erts_free(ERTS_ALC_T_TMP, (void *) lz_buf);
     ERTS_SMP_CHK_NO_PROC_LOCKS;
     return 0;
 
@@ -1402,100 +1918,176 @@ int erts_net_message(Port *prt,
 	erts_free(ERTS_ALC_T_DCTRL_BUF, (void *) ctl);
     }
 #endif
-    erts_do_exit_port(prt, dep->cid, am_killed);
+    if (fap)
+	free_dist_frag_asm(fap);
+    if (lz_buf)
+	erts_free(ERTS_ALC_T_TMP, (void *) lz_buf);
+    erts_do_exit_port(prt, ldep->cid, am_killed);
     ERTS_SMP_CHK_NO_PROC_LOCKS;
     return -1;
 }
 
-#define ERTS_DE_BUSY_LIMIT (128*1024)
-
-static int
-dsig_send(ErtsDSigData *dsdp, Eterm ctl, Eterm msg, int force_busy)
+/*
+ * bin, if not NULL, is the binary that buf is in; the message may then
+ * refer to the data instead of copying it.
+ */
+int erts_net_message(Port *prt,
+		     DistEntry *dep,
+		     byte *hbuf,
+		     int hlen,
+		     Binary *bin,
+		     byte *buf,
+		     int len)
 {
-    Eterm cid;
-    int suspended = 0;
-    int resume = 0;
-    Uint32 pass_through_size;
-    Uint data_size, dhdr_ext_size;
-    ErtsAtomCacheMap *acmp;
-    ErtsDistOutputBuf *obuf;
-    DistEntry *dep = dsdp->dep;
-    Uint32 flags = dep->flags;
-    Process *c_p = dsdp->proc;
-
-    if (!c_p || dsdp->no_suspend)
-	force_busy = 1;
-
-    ERTS_SMP_LC_ASSERT(!c_p
-		       || (ERTS_PROC_LOCK_MAIN
-			   == erts_proc_lc_my_proc_locks(c_p)));
-
-    if (!erts_is_alive)
-	return ERTS_DSIG_SEND_OK;
+    Uint64 start, end;
+    int res;
 
-    if (flags & DFLAG_DIST_HDR_ATOM_CACHE) {
-	acmp = erts_get_atom_cache_map(c_p);
-	pass_through_size = 0;
-    }
-    else {
-	acmp = NULL;
-	pass_through_size = 1;
+    if (len == 0)
+	return net_message(prt, dep, hbuf, hlen, bin, buf, len);
+
+    start = dist_stat_time();
+    res = net_message(prt, dep, hbuf, hlen, bin, buf, len);
+    if (prt->dist_entry == dep) {
+	/* Not dropped by a terminated port */
+	end = dist_stat_time();
+	dep->stats.in_msgs++;
+	dep->stats.in_bytes += len;
+	if (end > start)
+	    dep->stats.decode_time += end - start;
     }
+    return res;
+}
 
-#ifdef ERTS_DIST_MSG_DBG
-    erts_fprintf(stderr, ">>%s CTL: %T\n", pass_through_size ? "P" : " ", ctl);
-    if (is_value(msg))
-	erts_fprintf(stderr, "    MSG: %T\n", msg);
-#endif
+#define ERTS_DE_BUSY_LIMIT (128*1024)
 
-    data_size = pass_through_size;
-    erts_reset_atom_cache_map(acmp);
-    data_size += erts_encode_dist_ext_size(ctl, flags, acmp);
-    if (is_value(msg))
-	data_size += erts_encode_dist_ext_size(msg, flags, acmp);
-    erts_finalize_atom_cache_map(acmp);
+/*
+ * Fragmented messages.
+ *
+ * When the other node has announced DFLAG_FRAGMENTS, messages sent by
+ * processes that encode larger than ERTS_DIST_FRAG_SIZE bytes are split
+ * into fragments which are enqueued on the dist entry one by one. Other
+ * signals on the connection are thereby interleaved with the fragments
+ * instead of waiting for the whole message to be written.
+ *
+ * The whole message is normally encoded at once. The first fragment
+ * carries the dist header; the sending process then traps to
+ * dsend_continue_trap/2 which enqueues the remaining fragments. Since
+ * the sender does not continue before its last fragment has been
+ * enqueued, signal order from the sender is preserved. The sender pid is
+ * used as sequence id, and fragment ids count down to 1, which
+ * identifies the last fragment. The state of the trap is also kept in
+ * the process specific data of the sender, so that a sender that is
+ * killed in the trap can enqueue its remaining fragments before its
+ * exit signals (see erts_dsig_send_frag_exiting()).
+ *
+ * A message too large to be sized within the reductions the sender has
+ * left is instead sized and encoded by dsend_continue_trap/2 in several
+ * steps before any fragment is enqueued. The atom cache map belongs to
+ * the scheduler and cannot be kept meanwhile, so such a message is
+ * encoded without atom cache references. The sender is not garbage
+ * collected until it has been encoded.
+ */
 
-    dhdr_ext_size = erts_encode_ext_dist_header_size(acmp);
-    data_size += dhdr_ext_size;
+#define ERTS_DIST_FRAG_SIZE (64*1024)
 
-    obuf = alloc_dist_obuf(data_size);
-    obuf->ext_endp = &obuf->data[0] + pass_through_size + dhdr_ext_size;
+typedef struct {
+    DistEntry *dep;
+    Eterm cid;
+    Uint32 connection_id;
+    Eterm sender;
+    Uint64 seq_id;
+    Uint64 frag_id;		/* Id of next fragment to enqueue */
+    byte *datap;		/* Data of next fragment */
+    Uint ref_ix;		/* ... or the binary it starts in */
+    Uint ref_offs;
+    ErtsDistOutputBuf *obuf;	/* The whole encoded message */
+    /* Used while the message is being encoded by the trap: */
+    int phase;
+    Uint32 flags;
+    Eterm msg;
+    byte *ctl_ext;		/* The encoded control message */
+    Uint ctl_size;
+    ErtsExtBinRefs brefs;
+    int lz;			/* Compressed, with binaries copied */
+    ErtsExtSizeContext sc;
+    ErtsExtEncodeContext ec;
+} ErtsDistFragSendState;
+
+#define ERTS_DFS_SIZE	0
+#define ERTS_DFS_ENCODE	1
+#define ERTS_DFS_FRAGS	2
 
-    /* Encode internal version of dist header */
-    obuf->extp = erts_encode_ext_dist_header_setup(obuf->ext_endp, acmp);
-    /* Encode control message */
-    erts_encode_dist_ext(ctl, &obuf->ext_endp, flags, acmp);
-    if (is_value(msg)) {
-	/* Encode message */
-	erts_encode_dist_ext(msg, &obuf->ext_endp, flags, acmp);
-    }
+/*
+ * A message on a connection using LZ compression is compressed unless
+ * the binaries it refers to (see ErtsExtBinRefs) make up most of it.
+ * Its binaries are then copied into the output buffer like the rest of
+ * it: *data_sizep grows by what they take there and *brefsp is cleared,
+ * and the message must be encoded without an ErtsExtBinRefs. Returns 1
+ * if the message is to be compressed.
+ */
+static ERTS_INLINE int
+dist_lz_copy_refs(Uint32 flags, Uint *data_sizep, ErtsExtBinRefs *brefsp)
+{
+    if (!(flags & DFLAG_LZ_COMPRESSION) || brefsp->size > *data_sizep)
+	return 0;
+    /* A copied binary may need 5 more bytes, see enc_term_int() */
+    *data_sizep += brefsp->size + 5*brefsp->no;
+    brefsp->no = 0;
+    brefsp->size = 0;
+    return 1;
+}
 
-    ASSERT(obuf->extp < obuf->ext_endp);
-    ASSERT(&obuf->data[0] <= obuf->extp - pass_through_size);
-    ASSERT(obuf->ext_endp <= &obuf->data[0] + data_size);
+Export erts_dsig_send_frag_trap_export;
 
-    data_size = obuf->ext_endp - obuf->extp;
+/*
+ * Enqueues an encoded signal; start is the time encoding began, or 0
+ * if the encoding time has already been accounted for.
+ */
+static int
+dsig_enqueue(ErtsDSigData *dsdp, Eterm sender, ErtsDistOutputBuf *obuf,
+	     int force_busy, Uint64 start)
+{
+    Eterm cid;
+    int suspended = 0;
+    int resume = 0;
+    DistEntry *pdep = dsdp->dep;
+    DistEntry *dep;
+    Process *c_p = dsdp->proc;
 
     /*
      * Signal encoded; now verify that the connection still exists,
-     * and if so enqueue the signal and schedule it for send.
+     * and if so enqueue the signal on the connection used by the
+     * sender and schedule it for send.
      */
     obuf->next = NULL;
-    erts_smp_de_rlock(dep);
-    cid = dep->cid;
+    erts_smp_de_rlock(pdep);
+    dep = erts_dist_lane(pdep, sender);
+    if (dep != pdep)
+	erts_smp_de_rlock(dep);
+    cid = pdep->cid;
     if (cid != dsdp->cid
-	|| dep->connection_id != dsdp->connection_id
-	|| dep->status & ERTS_DE_SFLG_EXITING) {
+	|| pdep->connection_id != dsdp->connection_id
+	|| pdep->status & ERTS_DE_SFLG_EXITING
+	|| (dep != pdep
+	    && (is_nil(dep->cid) || dep->status & ERTS_DE_SFLG_EXITING))) {
 	/* Not the same connection as when we started; drop message... */
-	erts_smp_de_runlock(dep);
+	if (dep != pdep)
+	    erts_smp_de_runlock(dep);
+	erts_smp_de_runlock(pdep);
 	free_dist_obuf(obuf);
     }
     else {
 	ErtsProcList *plp = NULL;
+	cid = dep->cid;
+	obuf->enq_time = dist_stat_time();
 	erts_smp_spin_lock(&dep->qlock);
+	if (start && obuf->enq_time > start)
+	    dep->stats.encode_time += obuf->enq_time - start;
 	dep->qsize += size_obuf(obuf);
+	if (dep->qsize > dep->stats.max_qsize)
+	    dep->stats.max_qsize = dep->qsize;
 	if (dep->qsize >= ERTS_DE_BUSY_LIMIT)
-	    dep->qflgs |= ERTS_DE_QFLG_BUSY;
+	    set_de_busy(dep);
 	if (!force_busy && (dep->qflgs & ERTS_DE_QFLG_BUSY)) {
 	    erts_smp_spin_unlock(&dep->qlock);
 
@@ -1531,7 +2123,9 @@ dsig_send(ErtsDSigData *dsdp, Eterm ctl, Eterm msg, int force_busy)
 
 	erts_smp_spin_unlock(&dep->qlock);
 	erts_schedule_dist_command(NULL, dep);
-	erts_smp_de_runlock(dep);
+	if (dep != pdep)
+	    erts_smp_de_runlock(dep);
+	erts_smp_de_runlock(pdep);
 	
 	if (resume) {
 	    erts_resume(c_p, ERTS_PROC_LOCK_MAIN);
@@ -1544,14 +2138,558 @@ dsig_send(ErtsDSigData *dsdp, Eterm ctl, Eterm msg, int force_busy)
 	}
     }
 
-    if (c_p) {
-	int reds;
-	/* 
-	 * Bump reductions on calling process.
-	 *
-	 * This is the reduction cost: Always a base cost of 8 reductions
-	 * plus 16 reductions per kilobyte generated external data.
-	 */
+    if (suspended) {
+	if (!resume && erts_system_monitor_flags.busy_dist_port)
+	    monitor_generic(c_p, am_busy_dist_port, cid);
+	return ERTS_DSIG_SEND_YIELD;
+    }
+    return ERTS_DSIG_SEND_OK;
+}
+
+/*
+ * Move the next at most ERTS_DIST_FRAG_SIZE bytes of the whole message
+ * to the end of the fragment obuf. Own data of the whole message is
+ * copied, and the fragment refers to the parts of the binaries that
+ * the whole message refers to. With obuf NULL, nothing is moved; only
+ * the own data size and the number of references needed are returned.
+ */
+static void
+take_dist_frag(ErtsDistFragSendState *fsp, ErtsDistOutputBuf *obuf,
+	       Uint *own_sizep, Uint *no_refsp)
+{
+    ErtsDistOutputBuf *whole = fsp->obuf;
+    byte *datap = fsp->datap;
+    Uint ref_ix = fsp->ref_ix;
+    Uint ref_offs = fsp->ref_offs;
+    Uint left = ERTS_DIST_FRAG_SIZE;
+    Uint n;
+
+    *own_sizep = *no_refsp = 0;
+    while (left > 0) {
+	ErtsDistOutputRef *ref = (ref_ix < whole->no_refs
+				  ? &whole->refs[ref_ix]
+				  : NULL);
+	if (ref && datap == ref->pos) {
+	    n = ref->size - ref_offs;
+	    if (n > left)
+		n = left;
+	    if (obuf) {
+		ErtsDistOutputRef *fref = &obuf->refs[obuf->no_refs++];
+		erts_refc_inc(&ref->bin->refc, 2);
+		fref->pos = obuf->ext_endp;
+		fref->bin = ref->bin;
+		fref->bytes = ref->bytes + ref_offs;
+		fref->size = n;
+		obuf->refs_size += n;
+	    }
+	    (*no_refsp)++;
+	    ref_offs += n;
+	    if (ref_offs == ref->size) {
+		ref_ix++;
+		ref_offs = 0;
+	    }
+	}
+	else {
+	    byte *endp = ref ? ref->pos : whole->ext_endp;
+	    if (datap == endp)
+		break;
+	    n = endp - datap;
+	    if (n > left)
+		n = left;
+	    if (obuf) {
+		sys_memcpy((void *) obuf->ext_endp, (void *) datap, n);
+		obuf->ext_endp += n;
+	    }
+	    *own_sizep += n;
+	    datap += n;
+	}
+	left -= n;
+    }
+
+    if (obuf) {
+	fsp->datap = datap;
+	fsp->ref_ix = ref_ix;
+	fsp->ref_offs = ref_offs;
+    }
+}
+
+/*
+ * Create an output buffer for the next continuation fragment. The
+ * whole message is freed when its last fragment has been created.
+ */
+static ErtsDistOutputBuf *
+next_dist_frag(ErtsDistFragSendState *fsp)
+{
+    ErtsDistOutputBuf *obuf;
+    byte *ep;
+    Uint size, no_refs;
+
+    ASSERT(fsp->frag_id > 0);
+    take_dist_frag(fsp, NULL, &size, &no_refs);
+    obuf = alloc_dist_obuf(2 + ERTS_DIST_FRAG_IDS_SIZE + size, no_refs);
+    ep = obuf->extp = &obuf->data[0];
+    *ep++ = VERSION_MAGIC;
+    *ep++ = DIST_FRAG_CONT;
+    put_int32((Uint32) (fsp->seq_id >> 32), ep);
+    put_int32((Uint32) fsp->seq_id, ep + 4);
+    put_int32((Uint32) (fsp->frag_id >> 32), ep + 8);
+    put_int32((Uint32) fsp->frag_id, ep + 12);
+    obuf->ext_endp = ep + ERTS_DIST_FRAG_IDS_SIZE;
+    take_dist_frag(fsp, obuf, &size, &no_refs);
+    if (--fsp->frag_id == 0) {
+	ASSERT(fsp->datap == fsp->obuf->ext_endp);
+	ASSERT(fsp->ref_ix == fsp->obuf->no_refs);
+	free_dist_obuf(fsp->obuf);
+	fsp->obuf = NULL;
+    }
+    return obuf;
+}
+
+/*
+ * Create the output buffer of the first fragment, which carries the
+ * dist header. Without an atom cache map the header has no atom cache
+ * references.
+ */
+static ErtsDistOutputBuf *
+first_dist_frag(ErtsDistFragSendState *fsp, ErtsAtomCacheMap *acmp)
+{
+    ErtsDistOutputBuf *obuf;
+    Uint dhdr_ext_size = (acmp
+			  ? erts_encode_ext_dist_header_size(acmp)
+			  : 3 /* VERSION_MAGIC, DIST_HEADER, 0 */);
+    Uint size = (fsp->obuf->ext_endp - fsp->obuf->extp
+		 + fsp->obuf->refs_size);
+    Uint no_refs;
+
+    ASSERT(size > 0);
+    fsp->frag_id = (size - 1) / ERTS_DIST_FRAG_SIZE + 1;
+    fsp->datap = fsp->obuf->extp;
+    fsp->ref_ix = 0;
+    fsp->ref_offs = 0;
+
+    take_dist_frag(fsp, NULL, &size, &no_refs);
+    obuf = alloc_dist_obuf(dhdr_ext_size + ERTS_DIST_FRAG_IDS_SIZE + size,
+			   no_refs);
+    obuf->ext_endp = &obuf->data[0] + dhdr_ext_size + ERTS_DIST_FRAG_IDS_SIZE;
+    obuf->extp = erts_encode_ext_dist_frag_header_setup(obuf->ext_endp,
+							 acmp,
+							 fsp->seq_id,
+							 fsp->frag_id);
+    take_dist_frag(fsp, obuf, &size, &no_refs);
+    if (--fsp->frag_id == 0) {
+	free_dist_obuf(fsp->obuf);
+	fsp->obuf = NULL;
+    }
+    return obuf;
+}
+
+/*
+ * Size and encode a message in the state of dsend_continue_trap/2.
+ * Returns 0 if out of reductions, and 1 when the whole message has
+ * been encoded in fsp->obuf.
+ */
+static int
+dsig_frag_encode_continue(Process *c_p, ErtsDistFragSendState *fsp)
+{
+    Sint loops = (ERTS_BIF_REDS_LEFT(c_p) + 1) * ERTS_EXT_LOOP_FACTOR;
+    Sint reds = loops;
+    int res = 0;
+
+    switch (fsp->phase) {
+    case ERTS_DFS_SIZE: {
+	Uint size;
+	if (!erts_encode_dist_ext_size_int(fsp->msg, fsp->flags, NULL,
+					   &fsp->brefs, &fsp->sc, &reds, &size))
+	    break;
+	fsp->lz = dist_lz_copy_refs(fsp->flags, &size, &fsp->brefs);
+	fsp->obuf = alloc_dist_obuf(fsp->ctl_size + size, fsp->brefs.no);
+	fsp->brefs.refs = fsp->obuf->refs;
+	fsp->obuf->extp = &fsp->obuf->data[0];
+	sys_memcpy((void *) fsp->obuf->extp,
+		   (void *) fsp->ctl_ext,
+		   fsp->ctl_size);
+	fsp->obuf->ext_endp = fsp->obuf->extp + fsp->ctl_size;
+	erts_free(ERTS_ALC_T_TMP, (void *) fsp->ctl_ext);
+	fsp->ctl_ext = NULL;
+	fsp->phase = ERTS_DFS_ENCODE;
+    }
+	/* Fall through */
+    case ERTS_DFS_ENCODE:
+	res = erts_encode_dist_ext_int(fsp->msg, &fsp->obuf->ext_endp,
+				       fsp->flags, NULL,
+				       fsp->lz ? NULL : &fsp->brefs,
+				       &fsp->ec, &reds);
+	/* Binaries referred to so far are released with the buffer */
+	fsp->obuf->no_refs = fsp->brefs.refs - fsp->obuf->refs;
+	if (!res)
+	    break;
+	ASSERT(fsp->obuf->no_refs == fsp->brefs.no);
+	fsp->obuf->refs_size = fsp->brefs.size;
+	if (fsp->lz)
+	    erts_encode_dist_ext_compress(fsp->obuf->extp + fsp->ctl_size,
+					  &fsp->obuf->ext_endp, fsp->flags);
+	fsp->phase = ERTS_DFS_FRAGS;
+	res = 1;
+	break;
+    default:
+	ASSERT(0);
+	break;
+    }
+    if (res)
+	BUMP_REDS(c_p, (loops - reds) / ERTS_EXT_LOOP_FACTOR);
+    return res;
+}
+
+static void
+frag_send_state_destructor(Binary *mbp)
+{
+    ErtsDistFragSendState *fsp = ERTS_MAGIC_BIN_DATA(mbp);
+    if (fsp->phase != ERTS_DFS_FRAGS) {
+	DESTROY_SAVED_ESTACK(&fsp->sc.estack);
+	DESTROY_SAVED_ESTACK(&fsp->ec.estack);
+	if (fsp->ctl_ext)
+	    erts_free(ERTS_ALC_T_TMP, (void *) fsp->ctl_ext);
+    }
+    /*
+     * Nothing enqueued yet, or the connection is gone; the fragments
+     * of a sender that exits have already been enqueued by
+     * erts_dsig_send_frag_exiting().
+     */
+    if (fsp->obuf)
+	free_dist_obuf(fsp->obuf);
+    erts_deref_dist_entry(fsp->dep);
+}
+
+/*
+ * The sender no longer sends the message of its trap state.
+ */
+static void
+frag_send_state_release(Process *c_p)
+{
+    Binary *mbp = ERTS_PROC_SET_DIST_FRAG_SEND(c_p, ERTS_PROC_LOCK_MAIN, NULL);
+    ASSERT(mbp);
+    if (erts_refc_dectest(&mbp->refc, 0) == 0)
+	erts_bin_free(mbp);
+}
+
+#define ERTS_DIST_FRAG_EXIT_BATCH 16
+
+/*
+ * Called by an exiting process that was killed in dsend_continue_trap/2,
+ * before any of its exit signals are sent. Enqueues the remaining
+ * fragments of its message, which the receiver would otherwise get
+ * after a 'DOWN' or 'EXIT' from the sender. A message that has not
+ * been encoded yet is dropped; nothing of it has been enqueued. Returns
+ * 0 if the exiting process has to yield and call again, and 1 when
+ * done.
+ */
+int
+erts_dsig_send_frag_exiting(Process *c_p)
+{
+    Binary *mbp = ERTS_PROC_GET_DIST_FRAG_SEND(c_p);
+    ErtsDistFragSendState *fsp = ERTS_MAGIC_BIN_DATA(mbp);
+
+    ASSERT(ERTS_MAGIC_BIN_DESTRUCTOR(mbp) == frag_send_state_destructor);
+
+    if (fsp->phase == ERTS_DFS_FRAGS && fsp->obuf) {
+	ErtsDSigData dsd;
+	int i;
+	dsd.proc = NULL;
+	dsd.dep = fsp->dep;
+	dsd.cid = fsp->cid;
+	dsd.connection_id = fsp->connection_id;
+	dsd.no_suspend = 1;
+	dsd.frag_cont = THE_NON_VALUE;
+	for (i = 0; fsp->obuf && i < ERTS_DIST_FRAG_EXIT_BATCH; i++) {
+	    if (fsp->dep->connection_id != fsp->connection_id) {
+		free_dist_obuf(fsp->obuf);
+		fsp->obuf = NULL;
+		break;
+	    }
+	    (void) dsig_enqueue(&dsd, fsp->sender, next_dist_frag(fsp), 1, 0);
+	}
+	if (fsp->obuf)
+	    return 0;
+    }
+    frag_send_state_release(c_p);
+    return 1;
+}
+
+/*
+ * dsend_continue_trap/2 is a hidden BIF that send/2 and send/3 trap
+ * to while fragments of a message remain to be enqueued.
+ */
+static BIF_RETTYPE
+dsend_continue_trap(BIF_ALIST_2)
+{
+    Binary *mbp = ((ProcBin *) binary_val(BIF_ARG_1))->val;
+    ErtsDistFragSendState *fsp = ERTS_MAGIC_BIN_DATA(mbp);
+    ErtsDSigData dsd;
+    int res = ERTS_DSIG_SEND_OK;
+
+    ASSERT(ERTS_MAGIC_BIN_DESTRUCTOR(mbp) == frag_send_state_destructor);
+
+    dsd.proc = BIF_P;
+    dsd.dep = fsp->dep;
+    dsd.cid = fsp->cid;
+    dsd.connection_id = fsp->connection_id;
+    dsd.no_suspend = 0;
+    dsd.frag_cont = THE_NON_VALUE;
+
+    if (fsp->phase != ERTS_DFS_FRAGS) {
+	if (fsp->dep->connection_id != fsp->connection_id) {
+	    /* Connection gone; drop the message */
+	    FLAGS(BIF_P) &= ~F_DISABLE_GC;
+	    frag_send_state_release(BIF_P);
+	    BIF_RET(BIF_ARG_2);
+	}
+	if (!dsig_frag_encode_continue(BIF_P, fsp))
+	    ERTS_BIF_YIELD2(&erts_dsig_send_frag_trap_export,
+			    BIF_P, BIF_ARG_1, BIF_ARG_2);
+	FLAGS(BIF_P) &= ~F_DISABLE_GC;
+	res = dsig_enqueue(&dsd, fsp->sender, first_dist_frag(fsp, NULL), 0, 0);
+	if (fsp->obuf
+	    && (res == ERTS_DSIG_SEND_YIELD || ERTS_BIF_REDS_LEFT(BIF_P) <= 0))
+	    ERTS_BIF_YIELD2(&erts_dsig_send_frag_trap_export,
+			    BIF_P, BIF_ARG_1, BIF_ARG_2);
+    }
+
+    while (fsp->obuf) {
+	if (fsp->dep->connection_id != fsp->connection_id) {
+	    /* Connection gone; no use in producing more fragments */
+	    free_dist_obuf(fsp->obuf);
+	    fsp->obuf = NULL;
+	    break;
+	}
+	res = dsig_enqueue(&dsd, fsp->sender, next_dist_frag(fsp), 0, 0);
+	BUMP_REDS(BIF_P, 8 + (ERTS_DIST_FRAG_SIZE >> 10));
+	if (fsp->obuf
+	    && (res == ERTS_DSIG_SEND_YIELD || ERTS_BIF_REDS_LEFT(BIF_P) <= 0))
+	    ERTS_BIF_YIELD2(&erts_dsig_send_frag_trap_export,
+			    BIF_P, BIF_ARG_1, BIF_ARG_2);
+    }
+
+    frag_send_state_release(BIF_P);
+    if (res == ERTS_DSIG_SEND_YIELD)
+	ERTS_BIF_YIELD_RETURN(BIF_P, BIF_ARG_2);
+    BIF_RET(BIF_ARG_2);
+}
+
+static ErtsDistFragSendState *
+create_frag_send_state(ErtsDSigData *dsdp, Binary **mbpp)
+{
+    Process *c_p = dsdp->proc;
+    ErtsDistFragSendState *fsp;
+    Binary *mbp = erts_create_magic_binary(sizeof(ErtsDistFragSendState),
+					   frag_send_state_destructor);
+    fsp = ERTS_MAGIC_BIN_DATA(mbp);
+    fsp->dep = dsdp->dep;
+    erts_refc_inc(&fsp->dep->refc, 1);
+    fsp->cid = dsdp->cid;
+    fsp->connection_id = dsdp->connection_id;
+    fsp->sender = c_p->id;
+    fsp->seq_id = (Uint64) c_p->id;
+    fsp->obuf = NULL;
+    fsp->phase = ERTS_DFS_FRAGS;
+    fsp->flags = dsdp->dep->flags;
+    fsp->msg = THE_NON_VALUE;
+    fsp->ctl_ext = NULL;
+    fsp->brefs.no = 0;
+    fsp->brefs.size = 0;
+    fsp->brefs.refs = NULL;
+    fsp->lz = 0;
+    fsp->sc.estack.start = NULL;
+    fsp->ec.estack.start = NULL;
+    /* Released by frag_send_state_release() */
+    erts_refc_inc(&mbp->refc, 1);
+    ASSERT(!ERTS_PROC_GET_DIST_FRAG_SEND(c_p));
+    (void) ERTS_PROC_SET_DIST_FRAG_SEND(c_p, ERTS_PROC_LOCK_MAIN, mbp);
+    *mbpp = mbp;
+    return fsp;
+}
+
+/*
+ * Encode a message that will be sent in fragments. Returns the output
+ * buffer of the first fragment and sets the continuation in dsdp.
+ */
+static ErtsDistOutputBuf *
+dsig_frag_encode(ErtsDSigData *dsdp, Eterm ctl, Eterm msg,
+		 Uint data_size, ErtsExtBinRefs *brefsp, int lz,
+		 ErtsAtomCacheMap *acmp)
+{
+    Binary *mbp;
+    ErtsDistFragSendState *fsp = create_frag_send_state(dsdp, &mbp);
+    Process *c_p = dsdp->proc;
+    byte *msg_ext;
+    Eterm *hp;
+
+    fsp->obuf = alloc_dist_obuf(data_size, brefsp->no);
+    fsp->obuf->extp = fsp->obuf->ext_endp = &fsp->obuf->data[0];
+    erts_encode_dist_ext(ctl, &fsp->obuf->ext_endp, fsp->flags, acmp, NULL);
+    msg_ext = fsp->obuf->ext_endp;
+    brefsp->refs = fsp->obuf->refs;
+    erts_encode_dist_ext(msg, &fsp->obuf->ext_endp, fsp->flags, acmp,
+			 lz ? NULL : brefsp);
+    fsp->obuf->no_refs = brefsp->no;
+    fsp->obuf->refs_size = brefsp->size;
+    if (lz)
+	erts_encode_dist_ext_compress(msg_ext, &fsp->obuf->ext_endp,
+				      fsp->flags);
+    ASSERT(fsp->obuf->ext_endp <= &fsp->obuf->data[0] + data_size);
+
+    hp = HAlloc(c_p, PROC_BIN_SIZE);
+    dsdp->frag_cont = erts_mk_magic_binary_term(&hp, &MSO(c_p), mbp);
+    return first_dist_frag(fsp, acmp);
+}
+
+/*
+ * Leave the encoding of a large message to dsend_continue_trap/2. The
+ * control message, which may be on the C stack, is encoded right away.
+ */
+static int
+dsig_frag_encode_yield(ErtsDSigData *dsdp, Eterm ctl, Eterm msg)
+{
+    Binary *mbp;
+    ErtsDistFragSendState *fsp = create_frag_send_state(dsdp, &mbp);
+    Process *c_p = dsdp->proc;
+    byte *ep;
+    Eterm *hp;
+
+    fsp->phase = ERTS_DFS_SIZE;
+    fsp->msg = msg;
+    fsp->ctl_size = erts_encode_dist_ext_size(ctl, fsp->flags, NULL, NULL);
+    ep = fsp->ctl_ext = erts_alloc(ERTS_ALC_T_TMP, fsp->ctl_size);
+    erts_encode_dist_ext(ctl, &ep, fsp->flags, NULL, NULL);
+    ASSERT(ep <= fsp->ctl_ext + fsp->ctl_size);
+    fsp->ctl_size = ep - fsp->ctl_ext;
+
+    hp = HAlloc(c_p, PROC_BIN_SIZE);
+    dsdp->frag_cont = erts_mk_magic_binary_term(&hp, &MSO(c_p), mbp);
+    FLAGS(c_p) |= F_DISABLE_GC;
+    BUMP_ALL_REDS(c_p);
+    return ERTS_DSIG_SEND_CONTINUE;
+}
+
+static int
+dsig_send(ErtsDSigData *dsdp, Eterm sender, Eterm ctl, Eterm msg,
+	  int force_busy)
+{
+    int res;
+    Uint32 pass_through_size;
+    Uint data_size, dhdr_ext_size;
+    ErtsAtomCacheMap *acmp;
+    ErtsDistOutputBuf *obuf;
+    ErtsExtBinRefs brefs;
+    int lz;
+    DistEntry *dep = dsdp->dep;
+    Uint32 flags = dep->flags;
+    Process *c_p = dsdp->proc;
+    Uint64 start;
+
+    if (!c_p || dsdp->no_suspend)
+	force_busy = 1;
+
+    ERTS_SMP_LC_ASSERT(!c_p
+		       || (ERTS_PROC_LOCK_MAIN
+			   == erts_proc_lc_my_proc_locks(c_p)));
+
+    if (!erts_is_alive)
+	return ERTS_DSIG_SEND_OK;
+
+    start = dist_stat_time();
+
+    if (flags & DFLAG_DIST_HDR_ATOM_CACHE) {
+	acmp = erts_get_atom_cache_map(c_p);
+	pass_through_size = 0;
+    }
+    else {
+	acmp = NULL;
+	pass_through_size = 1;
+    }
+
+#ifdef ERTS_DIST_MSG_DBG
+    erts_fprintf(stderr, ">>%s CTL: %T\n", pass_through_size ? "P" : " ", ctl);
+    if (is_value(msg))
+	erts_fprintf(stderr, "    MSG: %T\n", msg);
+#endif
+
+    /*
+     * Large binaries in the message are not copied into the output
+     * buffer but referred to by it (see ErtsExtBinRefs), unless the
+     * message is compressed (see dist_lz_copy_refs()).
+     */
+    brefs.no = 0;
+    brefs.size = 0;
+
+    data_size = pass_through_size;
+    erts_reset_atom_cache_map(acmp);
+    data_size += erts_encode_dist_ext_size(ctl, flags, acmp, NULL);
+    if (is_value(msg)) {
+	if (acmp && !force_busy && (flags & DFLAG_FRAGMENTS)) {
+	    Sint reds = (ERTS_BIF_REDS_LEFT(c_p) + 1) * ERTS_EXT_LOOP_FACTOR;
+	    ErtsExtSizeContext sc;
+	    Uint msg_size;
+	    sc.estack.start = NULL;
+	    if (!erts_encode_dist_ext_size_int(msg, flags, acmp, &brefs,
+					       &sc, &reds, &msg_size)) {
+		DESTROY_SAVED_ESTACK(&sc.estack);
+		return dsig_frag_encode_yield(dsdp, ctl, msg);
+	    }
+	    data_size += msg_size;
+	}
+	else
+	    data_size += erts_encode_dist_ext_size(msg, flags, acmp, &brefs);
+    }
+    erts_finalize_atom_cache_map(acmp);
+    lz = is_value(msg) && dist_lz_copy_refs(flags, &data_size, &brefs);
+
+    if (acmp
+	&& !force_busy
+	&& is_value(msg)
+	&& (flags & DFLAG_FRAGMENTS)
+	&& data_size + brefs.size > ERTS_DIST_FRAG_SIZE) {
+	obuf = dsig_frag_encode(dsdp, ctl, msg, data_size, &brefs, lz, acmp);
+    }
+    else {
+	dhdr_ext_size = erts_encode_ext_dist_header_size(acmp);
+	data_size += dhdr_ext_size;
+
+	obuf = alloc_dist_obuf(data_size, brefs.no);
+	obuf->ext_endp = &obuf->data[0] + pass_through_size + dhdr_ext_size;
+
+	/* Encode internal version of dist header */
+	obuf->extp = erts_encode_ext_dist_header_setup(obuf->ext_endp, acmp);
+	/* Encode control message */
+	erts_encode_dist_ext(ctl, &obuf->ext_endp, flags, acmp, NULL);
+	if (is_value(msg)) {
+	    /* Encode message */
+	    byte *msg_ext = obuf->ext_endp;
+	    brefs.refs = obuf->refs;
+	    erts_encode_dist_ext(msg, &obuf->ext_endp, flags, acmp,
+				 lz ? NULL : &brefs);
+	    obuf->no_refs = brefs.no;
+	    obuf->refs_size = brefs.size;
+	    if (lz)
+		erts_encode_dist_ext_compress(msg_ext, &obuf->ext_endp, flags);
+	}
+
+	ASSERT(obuf->extp < obuf->ext_endp);
+	ASSERT(&obuf->data[0] <= obuf->extp - pass_through_size);
+	ASSERT(obuf->ext_endp <= &obuf->data[0] + data_size);
+
+	data_size = obuf->ext_endp - obuf->extp;
+    }
+
+    res = dsig_enqueue(dsdp, sender, obuf, force_busy, start);
+
+    if (c_p) {
+	int reds;
+	/* 
+	 * Bump reductions on calling process.
+	 *
+	 * This is the reduction cost: Always a base cost of 8 reductions
+	 * plus 16 reductions per kilobyte generated external data.
+	 */
 
 	data_size >>= (10-4);
 #if defined(ARCH_64)
@@ -1565,12 +2703,143 @@ dsig_send(ErtsDSigData *dsdp, Eterm ctl, Eterm msg, int force_busy)
 	BUMP_REDS(c_p, reds);
     }
 
-    if (suspended) {
-	if (!resume && erts_system_monitor_flags.busy_dist_port)
-	    monitor_generic(c_p, am_busy_dist_port, cid);
-	return ERTS_DSIG_SEND_YIELD;
+    if (is_value(dsdp->frag_cont))
+	return ERTS_DSIG_SEND_CONTINUE;
+    return res;
+}
+
+/*
+ * Send the same message to n processes on the node of dsdp->dep. The
+ * message is encoded once; each destination gets a copy of the output
+ * buffer where only the control message differs. The control messages
+ * all encode to the same size since the destinations share node name.
+ * The caller is suspended, and ERTS_DSIG_SEND_YIELD returned, if the
+ * connection is busy once all buffers have been enqueued. A message
+ * that would be sent in fragments is not sent; ERTS_DSIG_SEND_FRAGMENT
+ * is returned and the caller sends it to each destination by itself.
+ */
+int
+erts_dsig_send_msg_multi(ErtsDSigData *dsdp, Eterm *to, Uint n, Eterm message)
+{
+    int res;
+    Uint32 pass_through_size;
+    Uint i, j, data_size, dhdr_ext_size, ctl_offs, msg_offs, end_offs;
+    ErtsAtomCacheMap *acmp;
+    ErtsDistOutputBuf *obuf;
+    ErtsExtBinRefs brefs;
+    int lz;
+    Eterm ctl_heap[4];
+    byte *ep;
+    DistEntry *dep = dsdp->dep;
+    Uint32 flags = dep->flags;
+    Process *c_p = dsdp->proc;
+    int reds;
+    Uint64 start;
+
+    ASSERT(c_p && SEQ_TRACE_TOKEN(c_p) == NIL);
+    ASSERT(n > 0);
+
+    if (!erts_is_alive)
+	return ERTS_DSIG_SEND_OK;
+
+    start = dist_stat_time();
+
+    if (flags & DFLAG_DIST_HDR_ATOM_CACHE) {
+	acmp = erts_get_atom_cache_map(c_p);
+	pass_through_size = 0;
     }
-    return ERTS_DSIG_SEND_OK;
+    else {
+	acmp = NULL;
+	pass_through_size = 1;
+    }
+
+    brefs.no = 0;
+    brefs.size = 0;
+
+    data_size = pass_through_size;
+    erts_reset_atom_cache_map(acmp);
+    data_size += erts_encode_dist_ext_size(TUPLE3(&ctl_heap[0],
+						  make_small(DOP_SEND),
+						  am_Cookie,
+						  to[0]),
+					   flags, acmp, NULL);
+    data_size += erts_encode_dist_ext_size(message, flags, acmp, &brefs);
+    erts_finalize_atom_cache_map(acmp);
+    if (acmp
+	&& (flags & DFLAG_FRAGMENTS)
+	&& data_size + brefs.size > ERTS_DIST_FRAG_SIZE)
+	return ERTS_DSIG_SEND_FRAGMENT;
+    lz = dist_lz_copy_refs(flags, &data_size, &brefs);
+
+    dhdr_ext_size = erts_encode_ext_dist_header_size(acmp);
+    data_size += dhdr_ext_size;
+
+    obuf = alloc_dist_obuf(data_size, brefs.no);
+    obuf->ext_endp = &obuf->data[0] + pass_through_size + dhdr_ext_size;
+    obuf->extp = erts_encode_ext_dist_header_setup(obuf->ext_endp, acmp);
+    ctl_offs = obuf->ext_endp - &obuf->data[0];
+    erts_encode_dist_ext(TUPLE3(&ctl_heap[0],
+				make_small(DOP_SEND),
+				am_Cookie,
+				to[0]),
+			 &obuf->ext_endp, flags, acmp, NULL);
+    msg_offs = obuf->ext_endp - &obuf->data[0];
+    brefs.refs = obuf->refs;
+    erts_encode_dist_ext(message, &obuf->ext_endp, flags, acmp,
+			 lz ? NULL : &brefs);
+    obuf->no_refs = brefs.no;
+    obuf->refs_size = brefs.size;
+    if (lz)
+	erts_encode_dist_ext_compress(&obuf->data[0] + msg_offs,
+				      &obuf->ext_endp, flags);
+    end_offs = obuf->ext_endp - &obuf->data[0];
+
+    ASSERT(obuf->extp < obuf->ext_endp);
+    ASSERT(obuf->ext_endp <= &obuf->data[0] + data_size);
+
+    for (i = 1; i < n; i++) {
+	ErtsDistOutputBuf *cobuf = alloc_dist_obuf(data_size, obuf->no_refs);
+	sys_memcpy((void *) &cobuf->data[0],
+		   (void *) &obuf->data[0],
+		   end_offs);
+	cobuf->extp = &cobuf->data[0] + (obuf->extp - &obuf->data[0]);
+	cobuf->ext_endp = &cobuf->data[0] + end_offs;
+	for (j = 0; j < obuf->no_refs; j++) {
+	    cobuf->refs[j] = obuf->refs[j];
+	    cobuf->refs[j].pos = (&cobuf->data[0]
+				  + (obuf->refs[j].pos - &obuf->data[0]));
+	    erts_refc_inc(&obuf->refs[j].bin->refc, 2);
+	}
+	cobuf->no_refs = obuf->no_refs;
+	cobuf->refs_size = obuf->refs_size;
+	ep = &cobuf->data[0] + ctl_offs;
+	erts_encode_dist_ext(TUPLE3(&ctl_heap[0],
+				    make_small(DOP_SEND),
+				    am_Cookie,
+				    to[i]),
+			     &ep, flags, acmp, NULL);
+	ASSERT(ep == &cobuf->data[0] + msg_offs);
+	(void) dsig_enqueue(dsdp, c_p->id, cobuf, 1, 0);
+    }
+
+    /* Only the last buffer may suspend the caller */
+    res = dsig_enqueue(dsdp, c_p->id, obuf, dsdp->no_suspend, start);
+
+    /* Same cost as dsig_send() for the encoded message, plus a
+       reduction per copy. */
+    data_size = (end_offs - (obuf->extp - &obuf->data[0])) >> (10-4);
+#if defined(ARCH_64)
+    data_size &= 0x003fffffffffffff;
+#elif defined(ARCH_32)
+    data_size &= 0x003fffff;
+#else
+#       error "Ohh come on ... !?!"
+#endif
+    reds = 8 + ((int) data_size > 1000000 ? 1000000 : (int) data_size);
+    reds += (int) (n - 1);
+    BUMP_REDS(c_p, reds);
+
+    return res;
 }
 
 
@@ -1578,7 +2847,8 @@ static Uint
 dist_port_command(Port *prt, ErtsDistOutputBuf *obuf)
 {
     int fpe_was_unmasked;
-    Uint size = obuf->ext_endp - obuf->extp;
+    Uint size = obuf->ext_endp - obuf->extp + obuf->refs_size;
+    byte *buf = obuf->extp;
 
     ERTS_SMP_CHK_NO_PROC_LOCKS;
     ERTS_SMP_LC_ASSERT(erts_lc_is_port_locked(prt));
@@ -1589,23 +2859,54 @@ dist_port_command(Port *prt, ErtsDistOutputBuf *obuf)
 		 "(%bpu bytes) passed.\n",
 		 size);
 
+    if (obuf->no_refs) {
+	/* The driver wants the data in one piece */
+	byte *dp = obuf->extp;
+	byte *bp;
+	Uint i, n;
+	bp = buf = erts_alloc(ERTS_ALC_T_TMP, size);
+	for (i = 0; i < obuf->no_refs; i++) {
+	    ErtsDistOutputRef *ref = &obuf->refs[i];
+	    n = ref->pos - dp;
+	    sys_memcpy((void *) bp, (void *) dp, n);
+	    bp += n;
+	    sys_memcpy((void *) bp, (void *) ref->bytes, ref->size);
+	    bp += ref->size;
+	    dp = ref->pos;
+	}
+	sys_memcpy((void *) bp, (void *) dp, obuf->ext_endp - dp);
+    }
+
     prt->caller = NIL;
     fpe_was_unmasked = erts_block_fpe();
     (*prt->drv_ptr->output)((ErlDrvData) prt->drv_data,
-			    (char*) obuf->extp,
+			    (char*) buf,
 			    (int) size);
     erts_unblock_fpe(fpe_was_unmasked);
+    if (buf != obuf->extp)
+	erts_free(ERTS_ALC_T_TMP, (void *) buf);
     return size;
 }
 
+#define ERTS_DIST_DEF_IOV_LEN 16
+
+/*
+ * The data that obuf refers to is passed in place; the driver takes
+ * references to the binaries of the data that it keeps queued.
+ */
 static Uint
 dist_port_commandv(Port *prt, ErtsDistOutputBuf *obuf)
 {
     int fpe_was_unmasked;
-    Uint size = obuf->ext_endp - obuf->extp;
-    SysIOVec iov[2];
-    ErlDrvBinary* bv[2];
+    Uint size = obuf->ext_endp - obuf->extp + obuf->refs_size;
+    SysIOVec iov_def[ERTS_DIST_DEF_IOV_LEN];
+    ErlDrvBinary* bv_def[ERTS_DIST_DEF_IOV_LEN];
+    SysIOVec *iov = iov_def;
+    ErlDrvBinary** bv = bv_def;
+    ErlDrvBinary* own_bin;
     ErlIOVec eiov;
+    Uint i, vlen, max_vlen;
+    byte *dp;
 
     ERTS_SMP_CHK_NO_PROC_LOCKS;
     ERTS_SMP_LC_ASSERT(erts_lc_is_port_locked(prt));
@@ -1616,15 +2917,42 @@ dist_port_commandv(Port *prt, ErtsDistOutputBuf *obuf)
 		 "(%bpu bytes) passed.\n",
 		 size);
 
+    max_vlen = 2 + 2*obuf->no_refs;
+    if (max_vlen > ERTS_DIST_DEF_IOV_LEN) {
+	iov = erts_alloc(ERTS_ALC_T_TMP, max_vlen*sizeof(SysIOVec));
+	bv = erts_alloc(ERTS_ALC_T_TMP, max_vlen*sizeof(ErlDrvBinary *));
+    }
+
     iov[0].iov_base = NULL;
     iov[0].iov_len = 0;
     bv[0] = NULL;
+    vlen = 1;
+
+    own_bin = Binary2ErlDrvBinary(ErtsDistOutputBuf2Binary(obuf));
+    dp = obuf->extp;
+    for (i = 0; i < obuf->no_refs; i++) {
+	ErtsDistOutputRef *ref = &obuf->refs[i];
+	if (ref->pos > dp) {
+	    iov[vlen].iov_base = dp;
+	    iov[vlen].iov_len = ref->pos - dp;
+	    bv[vlen] = own_bin;
+	    vlen++;
+	}
+	iov[vlen].iov_base = ref->bytes;
+	iov[vlen].iov_len = ref->size;
+	bv[vlen] = Binary2ErlDrvBinary(ref->bin);
+	vlen++;
+	dp = ref->pos;
+    }
+    if (obuf->ext_endp > dp) {
+	iov[vlen].iov_base = dp;
+	iov[vlen].iov_len = obuf->ext_endp - dp;
+	bv[vlen] = own_bin;
+	vlen++;
+    }
+    ASSERT(vlen <= max_vlen);
 
-    iov[1].iov_base = obuf->extp;
-    iov[1].iov_len = size;
-    bv[1] = Binary2ErlDrvBinary(ErtsDistOutputBuf2Binary(obuf));
-
-    eiov.vsize = 2;
+    eiov.vsize = vlen;
     eiov.size = size;
     eiov.iov = iov;
     eiov.binv = bv;
@@ -1636,6 +2964,11 @@ dist_port_commandv(Port *prt, ErtsDistOutputBuf *obuf)
     (*prt->drv_ptr->outputv)((ErlDrvData) prt->drv_data, &eiov);
     erts_unblock_fpe(fpe_was_unmasked);
 
+    if (iov != iov_def) {
+	erts_free(ERTS_ALC_T_TMP, (void *) iov);
+	erts_free(ERTS_ALC_T_TMP, (void *) bv);
+    }
+
     return size;
 }
 
@@ -1722,7 +3055,7 @@ erts_dist_command(Port *prt, int reds_limit)
     if (prt_busy) {
 	if (!de_busy) {
 	    erts_smp_spin_lock(&dep->qlock);
-	    dep->qflgs |= ERTS_DE_QFLG_BUSY;
+	    set_de_busy(dep);
 	    erts_smp_spin_unlock(&dep->qlock);
 	    de_busy = 1;
 	}
@@ -1736,8 +3069,9 @@ erts_dist_command(Port *prt, int reds_limit)
 	    size = (*send)(prt, foq.first);
 #ifdef ERTS_RAW_DIST_MSG_DBG
 	    erts_fprintf(stderr, ">> ");
-	    bw(foq.first->extp, size);
+	    bw(foq.first->extp, foq.first->ext_endp - foq.first->extp);
 #endif
+	    dist_stat_sent(dep, foq.first, size);
 	    reds += ERTS_PORT_REDS_DIST_CMD_DATA(size);
 	    fob = foq.first;
 	    obufsize += size_obuf(fob);
@@ -1746,7 +3080,7 @@ erts_dist_command(Port *prt, int reds_limit)
 	    preempt = reds > reds_limit || (prt->status & ERTS_PORT_SFLGS_DEAD);
 	    if (prt->status & ERTS_PORT_SFLG_PORT_BUSY) {
 		erts_smp_spin_lock(&dep->qlock);
-		dep->qflgs |= ERTS_DE_QFLG_BUSY;
+		set_de_busy(dep);
 		erts_smp_spin_unlock(&dep->qlock);
 		de_busy = prt_busy = 1;
 		break;
@@ -1822,8 +3156,9 @@ erts_dist_command(Port *prt, int reds_limit)
 	    size = (*send)(prt, oq.first);
 #ifdef ERTS_RAW_DIST_MSG_DBG
 	    erts_fprintf(stderr, ">> ");
-	    bw(oq.first->extp, size);
+	    bw(oq.first->extp, oq.first->ext_endp - oq.first->extp);
 #endif
+	    dist_stat_sent(dep, oq.first, size);
 	    reds += ERTS_PORT_REDS_DIST_CMD_DATA(size);
 	    fob = oq.first;
 	    obufsize += size_obuf(fob);
@@ -1832,7 +3167,7 @@ erts_dist_command(Port *prt, int reds_limit)
 	    preempt = reds > reds_limit || (prt->status & ERTS_PORT_SFLGS_DEAD);
 	    if (prt->status & ERTS_PORT_SFLG_PORT_BUSY) {
 		erts_smp_spin_lock(&dep->qlock);
-		dep->qflgs |= ERTS_DE_QFLG_BUSY;
+		set_de_busy(dep);
 		erts_smp_spin_unlock(&dep->qlock);
 		de_busy = prt_busy = 1;
 		if (oq.first && !preempt)
@@ -2212,6 +3547,7 @@ BIF_RETTYPE setnode_2(BIF_ALIST_2)
     /* Check that all trap functions are defined !! */
     if (dsend2_trap->address == NULL ||
 	dsend3_trap->address == NULL ||
+	dsend_multi_trap->address == NULL ||
 	/*	dsend_nosuspend_trap->address == NULL ||*/
 	dlink_trap->address == NULL ||
 	dunlink_trap->address == NULL ||
@@ -2274,12 +3610,152 @@ BIF_RETTYPE setnode_2(BIF_ALIST_2)
  **
  ***********************************************************************/
 
+/*
+ * setnode(Node, Port, {lane, Flags, Version}) attaches Port as a lane to
+ * Node (see lane_net_exits()); Node may not be connected. Lanes are taken
+ * into use by setnode(Node, Port, {Flags, Version, IC, OC, LanePorts}).
+ */
+static BIF_RETTYPE
+setnode_lane(Process *c_p, Eterm node, Eterm port, Eterm *tp)
+{
+    BIF_RETTYPE ret;
+    Uint flags;
+    unsigned long version;
+    DistEntry *dep, *lane;
+    Port *pp;
+
+    if (!is_small(tp[2]) || !is_small(tp[3])
+	|| (version = unsigned_val(tp[3])) == 0)
+	BIF_ERROR(c_p, BADARG);
+    flags = unsigned_val(tp[2]);
+
+    dep = erts_find_or_insert_dist_entry(node);
+    if (dep == erts_this_dist_entry) {
+	erts_deref_dist_entry(dep);
+	BIF_ERROR(c_p, BADARG);
+    }
+    else if (!dep)
+	BIF_ERROR(c_p, SYSTEM_LIMIT);
+
+    pp = erts_id2port(port, c_p, ERTS_PROC_LOCK_MAIN);
+    erts_smp_de_rwlock(dep);
+
+    if (!pp
+	|| (pp->status & ERTS_PORT_SFLG_EXITING)
+	|| (pp->drv_ptr->flags & ERL_DRV_FLAG_SOFT_BUSY) == 0
+	|| pp->dist_entry
+	|| is_not_nil(dep->cid)
+	|| (dep->status & ERTS_DE_SFLG_EXITING)) {
+	ERTS_BIF_PREP_ERROR(ret, c_p, BADARG);
+    }
+    else if (dep->no_lanes >= ERTS_DIST_MAX_LANES) {
+	ERTS_BIF_PREP_ERROR(ret, c_p, SYSTEM_LIMIT);
+    }
+    else {
+	lane = erts_create_dist_lane(dep);
+	lane->cid = port;
+	lane->connection_id = ERTS_DIST_LANE_NOT_IN_USE;
+	lane->flags = flags;
+	lane->version = version;
+	ASSERT(pp->drv_ptr->outputv || pp->drv_ptr->output);
+	lane->send = (pp->drv_ptr->outputv
+		      ? dist_port_commandv
+		      : dist_port_command);
+	if (flags & DFLAG_DIST_HDR_ATOM_CACHE)
+	    create_cache(lane);
+
+	erts_port_status_bor_set(pp, ERTS_PORT_SFLG_DISTRIBUTION);
+	pp->dist_entry = lane;
+
+	dep->lanes = (dep->lanes
+		      ? erts_realloc(ERTS_ALC_T_DIST_LANES,
+				     (void *) dep->lanes,
+				     sizeof(DistEntry *)*(dep->no_lanes + 1))
+		      : erts_alloc(ERTS_ALC_T_DIST_LANES,
+				   sizeof(DistEntry *)));
+	dep->lanes[dep->no_lanes++] = lane;
+	ERTS_BIF_PREP_RET(ret, am_true);
+    }
+
+    erts_smp_de_rwunlock(dep);
+    erts_deref_dist_entry(dep);
+    if (pp)
+	erts_smp_port_unlock(pp);
+    return ret;
+}
+
+/*
+ * Check that lane_ports is a list of distinct ports attached as lanes
+ * to dep.
+ */
+static int
+check_lane_ports(DistEntry *dep, Eterm lane_ports)
+{
+    Eterm l, l2;
+    int i, n = 0;
+
+    for (l = lane_ports; is_list(l); l = CDR(list_val(l))) {
+	Eterm port = CAR(list_val(l));
+	for (i = 0; i < dep->no_lanes; i++) {
+	    if (dep->lanes[i]->cid == port)
+		break;
+	}
+	if (i == dep->no_lanes)
+	    return 0;
+	for (l2 = lane_ports; l2 != l; l2 = CDR(list_val(l2))) {
+	    if (CAR(list_val(l2)) == port)
+		return 0;
+	}
+	n++;
+    }
+    return is_nil(l) && n <= dep->no_lanes;
+}
+
+/*
+ * Take the lanes listed in lane_ports into use for the connection just
+ * set up, in the order listed. Other lanes attached to dep are left to
+ * be cleaned up when their ports terminate.
+ */
+static void
+use_lanes(DistEntry *dep, Eterm lane_ports)
+{
+    DistEntry **lanes = dep->lanes;
+    int i, n = 0, no_lanes = dep->no_lanes;
+    Eterm l;
+
+    ERTS_SMP_LC_ASSERT(erts_lc_is_de_rwlocked(dep));
+
+    dep->lanes = NULL;
+    dep->no_lanes = 0;
+    for (l = lane_ports; is_list(l); l = CDR(list_val(l)))
+	n++;
+    if (n > 0)
+	dep->lanes = erts_alloc(ERTS_ALC_T_DIST_LANES,
+				sizeof(DistEntry *)*n);
+
+    for (l = lane_ports; is_list(l); l = CDR(list_val(l))) {
+	for (i = 0; !lanes[i] || lanes[i]->cid != CAR(list_val(l)); i++)
+	    ASSERT(i < no_lanes);
+	lanes[i]->connection_id = dep->connection_id;
+	dep->lanes[dep->no_lanes++] = lanes[i];
+	lanes[i] = NULL;
+    }
+
+    for (i = 0; i < no_lanes; i++) {
+	if (lanes[i])
+	    erts_deref_dist_entry(lanes[i]);
+    }
+    if (lanes)
+	erts_free(ERTS_ALC_T_DIST_LANES, (void *) lanes);
+}
+
 BIF_RETTYPE setnode_3(BIF_ALIST_3)
 {
     BIF_RETTYPE ret;
     Uint flags;
     unsigned long version;
     Eterm ic, oc;
+    Eterm lane_ports = NIL;
     Eterm *tp;
     DistEntry *dep = NULL;
     Port *pp = NULL;
@@ -2300,8 +3776,13 @@ BIF_RETTYPE setnode_3(BIF_ALIST_3)
     if (!is_tuple(BIF_ARG_3))
 	goto badarg;
     tp = tuple_val(BIF_ARG_3);
-    if (*tp++ != make_arityval(4))
+    if (*tp == make_arityval(3) && tp[1] == am_lane)
+	return setnode_lane(BIF_P, BIF_ARG_1, BIF_ARG_2, tp);
+    if (*tp == make_arityval(5))
+	lane_ports = tp[5];
+    else if (*tp != make_arityval(4))
 	goto badarg;
+    tp++;
     if (!is_small(*tp))
 	goto badarg;
     flags = unsigned_val(*tp++);
@@ -2369,6 +3850,9 @@ BIF_RETTYPE setnode_3(BIF_ALIST_3)
     if (pp->dist_entry || is_not_nil(dep->cid))
 	goto badarg;
 
+    if (!check_lane_ports(dep, lane_ports))
+	goto badarg;
+
     erts_port_status_bor_set(pp, ERTS_PORT_SFLG_DISTRIBUTION);
 
     pp->dist_entry = dep;
@@ -2398,6 +3882,8 @@ BIF_RETTYPE setnode_3(BIF_ALIST_3)
     if (flags & DFLAG_DIST_HDR_ATOM_CACHE)
 	create_cache(dep);
 
+    use_lanes(dep, lane_ports);
+
     erts_smp_de_rwunlock(dep);
     dep = NULL; /* inc of refc transferred to port (dist_entry field) */
 
@@ -38,6 +38,9 @@
 #define DFLAG_UNICODE_IO          0x1000
 #define DFLAG_DIST_HDR_ATOM_CACHE 0x2000
 #define DFLAG_SMALL_ATOM_TAGS     0x4000
+#define DFLAG_FRAGMENTS           0x8000
+#define DFLAG_DIST_LANES          0x10000
+#define DFLAG_LZ_COMPRESSION      0x20000
 
 /* All flags that should be enabled when term_to_binary/1 is used. */
 #define TERM_TO_BINARY_DFLAGS (DFLAG_EXTENDED_REFERENCES	\
@@ -68,6 +71,7 @@
 /* distribution trap functions */
 extern Export* dsend2_trap;
 extern Export* dsend3_trap;
+extern Export* dsend_multi_trap;
 /*extern Export* dsend_nosuspend_trap;*/
 extern Export* dlink_trap;
 extern Export* dunlink_trap;
@@ -89,6 +93,7 @@ typedef struct {
     Eterm cid;
     Eterm connection_id;
     int no_suspend;
+    Eterm frag_cont;
 } ErtsDSigData;
 
 #define ERTS_DE_IS_NOT_CONNECTED(DEP) \
@@ -120,6 +125,10 @@ extern int erts_is_alive;
 /* System not alive (distributed) */
 #define ERTS_DSIG_PREP_NOT_ALIVE	3
 
+/* Max number of extra connections (lanes) to a node */
+#define ERTS_DIST_MAX_LANES 63
+
+ERTS_GLB_INLINE DistEntry *erts_dist_lane(DistEntry *, Eterm);
 ERTS_GLB_INLINE int erts_dsig_prepare(ErtsDSigData *,
 				      DistEntry *,
 				      Process *,
@@ -131,6 +140,24 @@ void erts_schedule_dist_command(Port *, DistEntry *);
 
 #if ERTS_GLB_INLINE_INCL_FUNC_DEF
 
+/*
+ * Select the connection that signals from sender are sent over when
+ * the node is connected over lanes. A process always uses the same
+ * connection, so that signal order is preserved; signals without a
+ * local sender use the primary connection. dep has to be locked.
+ */
+ERTS_GLB_INLINE DistEntry *
+erts_dist_lane(DistEntry *dep, Eterm sender)
+{
+    Uint ix;
+    ERTS_SMP_LC_ASSERT(erts_lc_rwmtx_is_rlocked(&dep->rwmtx)
+		       || erts_lc_rwmtx_is_rwlocked(&dep->rwmtx));
+    if (!dep->no_lanes || is_not_internal_pid(sender))
+	return dep;
+    ix = internal_pid_number(sender) % (dep->no_lanes + 1);
+    return ix == 0 ? dep : dep->lanes[ix - 1];
+}
+
 ERTS_GLB_INLINE int 
 erts_dsig_prepare(ErtsDSigData *dsdp,
 		  DistEntry *dep,
@@ -152,11 +179,12 @@ erts_dsig_prepare(ErtsDSigData *dsdp,
 	goto fail;
     }
     if (no_suspend) {
+	DistEntry *qdep = erts_dist_lane(dep, proc ? proc->id : NIL);
 	failure = ERTS_DSIG_PREP_CONNECTED;
-	erts_smp_spin_lock(&dep->qlock);
-	if (dep->qflgs & ERTS_DE_QFLG_BUSY)
+	erts_smp_spin_lock(&qdep->qlock);
+	if (qdep->qflgs & ERTS_DE_QFLG_BUSY)
 	    failure = ERTS_DSIG_PREP_WOULD_SUSPEND;
-	erts_smp_spin_unlock(&dep->qlock);
+	erts_smp_spin_unlock(&qdep->qlock);
 	if (failure == ERTS_DSIG_PREP_WOULD_SUSPEND)
 	    goto fail;
     }
@@ -165,6 +193,7 @@ erts_dsig_prepare(ErtsDSigData *dsdp,
     dsdp->cid = dep->cid;
     dsdp->connection_id = dep->connection_id;
     dsdp->no_suspend = no_suspend;
+    dsdp->frag_cont = THE_NON_VALUE;
     if (dspl == ERTS_DSP_NO_LOCK)
 	erts_smp_de_runlock(dep);
     return ERTS_DSIG_PREP_CONNECTED;
@@ -268,9 +297,14 @@ erts_destroy_dist_link(ErtsDistLinkData *dldp)
  */
 #define ERTS_DSIG_SEND_OK	0
 #define ERTS_DSIG_SEND_YIELD	1
+#define ERTS_DSIG_SEND_CONTINUE	2 /* Fragments left; continuation in
+				     the frag_cont field of ErtsDSigData */
+#define ERTS_DSIG_SEND_FRAGMENT	3 /* Not sent; to be sent in fragments
+				     to one receiver at a time */
 
 extern int erts_dsig_send_link(ErtsDSigData *, Eterm, Eterm);
 extern int erts_dsig_send_msg(ErtsDSigData *, Eterm, Eterm);
+extern int erts_dsig_send_msg_multi(ErtsDSigData *, Eterm *, Uint, Eterm);
 extern int erts_dsig_send_exit_tt(ErtsDSigData *, Eterm, Eterm, Eterm, Eterm);
 extern int erts_dsig_send_unlink(ErtsDSigData *, Eterm, Eterm);
 extern int erts_dsig_send_reg_msg(ErtsDSigData *, Eterm, Eterm);
@@ -279,12 +313,18 @@ extern int erts_dsig_send_exit(ErtsDSigData *, Eterm, Eterm, Eterm);
 extern int erts_dsig_send_exit2(ErtsDSigData *, Eterm, Eterm, Eterm);
 extern int erts_dsig_send_demonitor(ErtsDSigData *, Eterm, Eterm, Eterm, int);
 extern int erts_dsig_send_monitor(ErtsDSigData *, Eterm, Eterm, Eterm);
-extern int erts_dsig_send_m_exit(ErtsDSigData *, Eterm, Eterm, Eterm, Eterm);
+extern int erts_dsig_send_m_exit(ErtsDSigData *, Eterm, Eterm, Eterm, Eterm,
+				 Eterm);
+
+extern Export erts_dsig_send_frag_trap_export;
+extern int erts_dsig_send_frag_exiting(Process *);
 
 extern int erts_dist_command(Port *prt, int reds);
 extern void erts_dist_port_not_busy(Port *prt);
 extern void erts_kill_dist_connection(DistEntry *dep, Uint32);
 
 extern Uint erts_dist_cache_size(void);
+extern Eterm erts_dist_atom_cache_info(Process *c_p, Eterm node);
+extern Eterm erts_dist_stats_info(Process *c_p, Eterm node);
 
 #endif
@@ -53,6 +53,8 @@
 #include "erl_bestfit_alloc.h"
 #define GET_ERL_AF_ALLOC_IMPL
 #include "erl_afit_alloc.h"
+#define GET_ERL_AOFF_ALLOC_IMPL
+#include "erl_ao_firstfit_alloc.h"
 
 #define ERTS_ALC_DEFAULT_MAX_THR_PREF 16
 
@@ -81,6 +83,8 @@ typedef union {
     char align_bfa[ERTS_ALC_CACHE_LINE_ALIGN_SIZE(sizeof(BFAllctr_t))];
     AFAllctr_t afa;
     char align_afa[ERTS_ALC_CACHE_LINE_ALIGN_SIZE(sizeof(AFAllctr_t))];
+    AOFFAllctr_t aoffa;
+    char align_aoffa[ERTS_ALC_CACHE_LINE_ALIGN_SIZE(sizeof(AOFFAllctr_t))];
 } ErtsAllocatorState_t;
 
 static ErtsAllocatorState_t sl_alloc_state;
@@ -112,7 +116,8 @@ static void *fix_core_alloc(Uint size)
 enum allctr_type {
     GOODFIT,
     BESTFIT,
-    AFIT
+    AFIT,
+    AOFIRSTFIT
 };
 
 struct au_init {
@@ -124,6 +129,7 @@ struct au_init {
 	GFAllctrInit_t	gf;
 	BFAllctrInit_t	bf;
 	AFAllctrInit_t	af;
+	AOFFAllctrInit_t aoff;
     } init;
     struct {
 	int mmbcs;
@@ -137,7 +143,8 @@ struct au_init {
     ERTS_DEFAULT_ALLCTR_INIT,		\
     ERTS_DEFAULT_GF_ALLCTR_INIT,	\
     ERTS_DEFAULT_BF_ALLCTR_INIT,	\
-    ERTS_DEFAULT_AF_ALLCTR_INIT		\
+    ERTS_DEFAULT_AF_ALLCTR_INIT,	\
+    ERTS_DEFAULT_AOFF_ALLCTR_INIT	\
 }
 
 typedef struct {
@@ -151,6 +158,7 @@ typedef struct {
     struct {
 	int stat;
 	int map;
+	Uint sample;
 	char *mtrace;
 	char *nodename;
     } instr;
@@ -488,6 +496,7 @@ erts_alloc_init(int *argc, char **argv, ErtsAllocInitOpts *eaiop)
     erts_afalc_init();
     erts_bfalc_init();
     erts_gfalc_init();
+    erts_aoffalc_init();
 
     for (i = ERTS_ALC_A_MIN; i <= ERTS_ALC_A_MAX; i++) {
 	erts_allctrs[i].alloc		= NULL;
@@ -586,7 +595,9 @@ erts_alloc_init(int *argc, char **argv, ErtsAllocInitOpts *eaiop)
     fix_core_extra	= erts_allctrs[erts_fix_core_allocator_ix].extra;
 
     erts_mtrace_install_wrapper_functions();
-    extra_block_size += erts_instr_init(init.instr.stat, init.instr.map);
+    extra_block_size += erts_instr_init(init.instr.stat,
+					init.instr.map,
+					init.instr.sample);
 
 #ifdef DEBUG
     extra_block_size += install_debug_functions();
@@ -775,6 +786,11 @@ start_au_allocator(ErtsAlcType_t alctr_n,
 					   &init->init.af,
 					   &init->init.util);
 	    break;
+	case AOFIRSTFIT:
+	    as = (void *) erts_aoffalc_start((AOFFAllctr_t *) as0,
+					     &init->init.aoff,
+					     &init->init.util);
+	    break;
 	default:
 	    as = NULL;
 	    ASSERT(0);
@@ -955,6 +971,9 @@ handle_au_arg(struct au_init *auip,
 	    else if (strcmp("af", alg) == 0) {
 		auip->atype = AFIT;
 	    }
+	    else if (strcmp("aoffcbf", alg) == 0) {
+		auip->atype = AOFIRSTFIT;
+	    }
 	    else {
 		bad_value(param, sub_param + 1, alg);
 	    }
@@ -1264,6 +1283,9 @@ handle_args(int *argc, char **argv, erts_alc_hndl_args_init_t *init)
 			else
 			    bad_value(param, param+3, arg);
 			break;
+		    case 'p':
+			init->instr.sample = get_amount_value(argv[i]+4, argv, &i);
+			break;
 		    case 't':
 			init->instr.mtrace = get_value(argv[i]+4, argv, &i);
 			break;
@@ -1839,6 +1861,7 @@ erts_memory(int *print_to_p, void *print_to_arg, void *proc, Eterm earg)
 	size.code += efi.used;
 	size.code += allocated_modules*sizeof(Range);
 	size.code += erts_total_code_size;
+	size.code += erts_literal_areas_size();
     }
 
     if (want.ets) {
@@ -2510,6 +2533,7 @@ erts_allocator_info(int to, void *arg)
     erts_print(to, arg, "=allocator:instr\n");
     erts_print(to, arg, "option m: %s\n",
 	       erts_instr_memory_map ? "true" : "false");
+    erts_print(to, arg, "option p: %bpu\n", erts_instr_sample_period);
     erts_print(to, arg, "option s: %s\n",
 	       erts_instr_stat ? "true" : "false");
     erts_print(to, arg, "option t: %s\n",
@@ -2617,16 +2641,18 @@ erts_allocator_options(void *proc)
     terms[length++] = erts_alcu_au_info_options(NULL, NULL, hpp, szp);
 
     {
-	Eterm o[3], v[3];
+	Eterm o[4], v[4];
 	o[0] = am_atom_put("m", 1);
 	v[0] = erts_instr_memory_map ? am_true : am_false;
-	o[1] = am_atom_put("s", 1);
-	v[1] = erts_instr_stat ? am_true : am_false;
-	o[2] = am_atom_put("t", 1);
-	v[2] = erts_mtrace_enabled ? am_true : am_false;
+	o[1] = am_atom_put("p", 1);
+	v[1] = erts_bld_uint(hpp, szp, erts_instr_sample_period);
+	o[2] = am_atom_put("s", 1);
+	v[2] = erts_instr_stat ? am_true : am_false;
+	o[3] = am_atom_put("t", 1);
+	v[3] = erts_mtrace_enabled ? am_true : am_false;
 
 	atoms[length] = am_atom_put("instr", 5); 
-	terms[length++] = erts_bld_2tup_list(hpp, szp, 3, o, v);
+	terms[length++] = erts_bld_2tup_list(hpp, szp, 4, o, v);
     }
 
     settings = erts_bld_2tup_list(hpp, szp, length, atoms, terms);
@@ -2747,6 +2773,7 @@ unsigned long erts_alc_test(unsigned long op,
     case 0x2:	return erts_bfalc_test(op, a1, a2);
     case 0x3:	return erts_afalc_test(op, a1, a2);
     case 0x4:	return erts_mseg_test(op,  a1, a2, a3);
+    case 0x5:	return erts_aoffalc_test(op, a1, a2);
     case 0xf:
 	switch (op) {
 	case 0xf00:
@@ -2825,6 +2852,13 @@ unsigned long erts_alc_test(unsigned long op,
 					  &init.init.af,
 					  &init.init.util);
 		break;
+	    case AOFIRSTFIT:
+		allctr = erts_aoffalc_start((AOFFAllctr_t *)
+					    erts_alloc(ERTS_ALC_T_UNDEF,
+						       sizeof(AOFFAllctr_t)),
+					    &init.init.aoff,
+					    &init.init.util);
+		break;
 	    default:
 		ASSERT(0);
 		allctr = NULL;
@@ -0,0 +1,1010 @@
+/*
+ * %CopyrightBegin%
+ * 
+ * Copyright Ericsson AB 2009. All Rights Reserved.
+ * 
+ * The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved online at http://www.erlang.org/.
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * %CopyrightEnd%
+ */
+
+
+/*
+ * Description:	An "address order first fit, carrier best fit" allocator.
+ *
+ *              Blocks are placed in the multiblock carrier with the
+ *              lowest address that has a free block large enough for
+ *              the request. Within that carrier the smallest fitting
+ *              block is used (lowest address if several blocks of the
+ *              same size fit). By always preferring low carriers, free
+ *              space accumulates in carriers with high addresses which
+ *              eventually become empty and can be destroyed.
+ *
+ *              All free blocks are kept in one Red-Black Tree ordered on
+ *              carrier address, block size, and block address. Each
+ *              node also keeps track of the size of the largest block
+ *              in its sub-tree, so the first fitting block can be found
+ *              in O(log n) time where n equals the number of free
+ *              blocks. Since alloc_util block headers do not reference
+ *              the carrier, the carriers are kept in a second
+ *              Red-Black Tree ordered on address. It is used in order
+ *              to find the carrier of a block when it is linked, which
+ *              is an O(log m) operation where m equals the number of
+ *              multiblock carriers.
+ *
+ *              This module is a callback-module for erl_alloc_util.c
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+#include <stddef.h> /* offsetof() */
+#include "global.h"
+#define GET_ERL_AOFF_ALLOC_IMPL
+#include "erl_ao_firstfit_alloc.h"
+
+#ifdef DEBUG
+#if 0
+#define HARD_DEBUG
+#endif
+#else
+#undef HARD_DEBUG
+#endif
+
+#define MIN_MBC_SZ		(16*1024)
+#define MIN_MBC_FIRST_FREE_SZ	(4*1024)
+
+#define RED_FLG			(((Uint) 1) << 0)
+#ifdef HARD_DEBUG
+#  define LEFT_VISITED_FLG	(((Uint) 1) << 1)
+#  define RIGHT_VISITED_FLG	(((Uint) 1) << 2)
+#endif
+
+#define IS_RED(N)		(((AOFF_RBTree_t *) (N)) \
+				 && ((AOFF_RBTree_t *) (N))->flags & RED_FLG)
+#define IS_BLACK(N)		(!IS_RED(((AOFF_RBTree_t *) (N))))
+
+#define SET_RED(N)		(((AOFF_RBTree_t *) (N))->flags |= RED_FLG)
+#define SET_BLACK(N)		(((AOFF_RBTree_t *) (N))->flags &= ~RED_FLG)
+
+#undef ASSERT
+#define ASSERT ASSERT_EXPR
+
+#if 1
+#define RBT_ASSERT	ASSERT
+#else
+#define RBT_ASSERT(x)
+#endif
+
+
+/* Types... */
+
+/*
+ * Tree node used both for free blocks and for carriers. In carrier
+ * nodes the block header is always zero, i.e. the node has size zero.
+ */
+struct AOFF_RBTree_t_ {
+    Block_t hdr;
+    Uint flags;
+    AOFF_RBTree_t *parent;
+    AOFF_RBTree_t *left;
+    AOFF_RBTree_t *right;
+    Uint max_sz;  /* Size of the largest block in this sub-tree */
+};
+
+typedef struct {
+    Carrier_t crr; /* Has to be first! */
+    AOFF_RBTree_t node;
+} AOFFCarrier_t;
+
+#define CRR_NODE2CRR(N) \
+  ((AOFFCarrier_t *) (((char *) (N)) - offsetof(AOFFCarrier_t, node)))
+#define CRR_START(C)	((char *) (C))
+#define CRR_END(C)	(((char *) (C)) + CARRIER_SZ(&(C)->crr))
+
+#ifdef DEBUG
+
+/* Destroy all tree fields */
+#define DESTROY_TREE_NODE(N)						\
+  sys_memset((void *) (((Block_t *) (N)) + 1),				\
+	     0xff,							\
+	     (sizeof(AOFF_RBTree_t) - sizeof(Block_t)))
+
+#else
+
+#define DESTROY_TREE_NODE(N)
+
+#endif
+
+
+#ifdef HARD_DEBUG
+static AOFF_RBTree_t * check_tree(AOFFAllctr_t *, Uint);
+#endif
+
+/* Prototypes of callback functions */
+static Block_t *	aoff_get_free_block	(Allctr_t *, Uint,
+						 Block_t *, Uint);
+static void		aoff_link_free_block	(Allctr_t *, Block_t *);
+static void		aoff_unlink_free_block	(Allctr_t *, Block_t *);
+static void		aoff_creating_mbc	(Allctr_t *, Carrier_t *);
+static void		aoff_destroying_mbc	(Allctr_t *, Carrier_t *);
+
+static Eterm		info_options		(Allctr_t *, char *, int *,
+						 void *, Uint **, Uint *);
+static void		init_atoms		(void);
+
+
+static int atoms_initialized = 0;
+
+void
+erts_aoffalc_init(void)
+{
+    atoms_initialized = 0;
+}
+
+Allctr_t *
+erts_aoffalc_start(AOFFAllctr_t *aoffallctr,
+		   AOFFAllctrInit_t *aoffinit,
+		   AllctrInit_t *init)
+{
+    AOFFAllctr_t nulled_state = {{0}};
+    /* {{0}} is used instead of {0}, in order to avoid (an incorrect) gcc
+       warning. gcc warns if {0} is used as initializer of a struct when
+       the first member is a struct (not if, for example, the third member
+       is a struct). */
+    Allctr_t *allctr = (Allctr_t *) aoffallctr;
+
+    sys_memcpy((void *) aoffallctr, (void *) &nulled_state,
+	       sizeof(AOFFAllctr_t));
+
+    allctr->mbc_header_size		= sizeof(AOFFCarrier_t);
+    allctr->min_mbc_size		= MIN_MBC_SZ;
+    allctr->min_mbc_first_free_size	= MIN_MBC_FIRST_FREE_SZ;
+    allctr->min_block_size		= sizeof(AOFF_RBTree_t);
+
+    allctr->vsn_str			= ERTS_ALC_AOFFCBF_ALLOC_VSN_STR;
+
+
+    /* Callback functions */
+
+    allctr->get_free_block		= aoff_get_free_block;
+    allctr->link_free_block		= aoff_link_free_block;
+    allctr->unlink_free_block		= aoff_unlink_free_block;
+    allctr->info_options		= info_options;
+
+    allctr->get_next_mbc_size		= NULL;
+    allctr->creating_mbc		= aoff_creating_mbc;
+    allctr->destroying_mbc		= aoff_destroying_mbc;
+    allctr->init_atoms			= init_atoms;
+
+#ifdef ERTS_ALLOC_UTIL_HARD_DEBUG
+    allctr->check_block			= NULL;
+    allctr->check_mbc			= NULL;
+#endif
+
+    allctr->atoms_initialized		= 0;
+
+    if (!erts_alcu_start(allctr, init))
+	return NULL;
+
+    return allctr;
+}
+
+/*
+ * Red-Black Tree operations needed
+ *
+ * The rotations and the delete operation keep the max_sz field of
+ * all nodes up to date.
+ */
+
+static ERTS_INLINE void
+update_max_sz(AOFF_RBTree_t *x)
+{
+    Uint sz = BLK_SZ(x);
+    if (x->left && x->left->max_sz > sz)
+	sz = x->left->max_sz;
+    if (x->right && x->right->max_sz > sz)
+	sz = x->right->max_sz;
+    x->max_sz = sz;
+}
+
+static ERTS_INLINE void
+left_rotate(AOFF_RBTree_t **root, AOFF_RBTree_t *x)
+{
+    AOFF_RBTree_t *y = x->right;
+    x->right = y->left;
+    if (y->left)
+	y->left->parent = x;
+    y->parent = x->parent;
+    if (!y->parent) {
+	RBT_ASSERT(*root == x);
+	*root = y;
+    }
+    else if (x == x->parent->left)
+	x->parent->left = y;
+    else {
+	RBT_ASSERT(x == x->parent->right);
+	x->parent->right = y;
+    }
+    y->left = x;
+    x->parent = y;
+
+    y->max_sz = x->max_sz;
+    update_max_sz(x);
+}
+
+static ERTS_INLINE void
+right_rotate(AOFF_RBTree_t **root, AOFF_RBTree_t *x)
+{
+    AOFF_RBTree_t *y = x->left;
+    x->left = y->right;
+    if (y->right)
+	y->right->parent = x;
+    y->parent = x->parent;
+    if (!y->parent) {
+	RBT_ASSERT(*root == x);
+	*root = y;
+    }
+    else if (x == x->parent->right)
+	x->parent->right = y;
+    else {
+	RBT_ASSERT(x == x->parent->left);
+	x->parent->left = y;
+    }
+    y->right = x;
+    x->parent = y;
+
+    y->max_sz = x->max_sz;
+    update_max_sz(x);
+}
+
+
+/*
+ * Replace node x with node y
+ * NOTE: block header of y is not changed, and neither is max_sz
+ */
+static ERTS_INLINE void
+replace(AOFF_RBTree_t **root, AOFF_RBTree_t *x, AOFF_RBTree_t *y)
+{
+
+    if (!x->parent) {
+	RBT_ASSERT(*root == x);
+	*root = y;
+    }
+    else if (x == x->parent->left)
+	x->parent->left = y;
+    else {
+	RBT_ASSERT(x == x->parent->right);
+	x->parent->right = y;
+    }
+    if (x->left) {
+	RBT_ASSERT(x->left->parent == x);
+	x->left->parent = y;
+    }
+    if (x->right) {
+	RBT_ASSERT(x->right->parent == x);
+	x->right->parent = y;
+    }
+
+    y->flags	= x->flags;
+    y->parent	= x->parent;
+    y->right	= x->right;
+    y->left	= x->left;
+
+    DESTROY_TREE_NODE(x);
+
+}
+
+static void
+tree_insert_fixup(AOFF_RBTree_t **root, AOFF_RBTree_t *blk)
+{
+    AOFF_RBTree_t *x = blk, *y;
+
+    /*
+     * Rearrange the tree so that it satisfies the Red-Black Tree properties
+     */
+
+    RBT_ASSERT(x != *root && IS_RED(x->parent));
+    do {
+
+	/*
+	 * x and its parent are both red. Move the red pair up the tree
+	 * until we get to the root or until we can separate them.
+	 */
+
+	RBT_ASSERT(IS_RED(x));
+	RBT_ASSERT(IS_BLACK(x->parent->parent));
+	RBT_ASSERT(x->parent->parent);
+
+	if (x->parent == x->parent->parent->left) {
+	    y = x->parent->parent->right;
+	    if (IS_RED(y)) {
+		SET_BLACK(y);
+		x = x->parent;
+		SET_BLACK(x);
+		x = x->parent;
+		SET_RED(x);
+	    }
+	    else {
+
+		if (x == x->parent->right) {
+		    x = x->parent;
+		    left_rotate(root, x);
+		}
+
+		RBT_ASSERT(x == x->parent->parent->left->left);
+		RBT_ASSERT(IS_RED(x));
+		RBT_ASSERT(IS_RED(x->parent));
+		RBT_ASSERT(IS_BLACK(x->parent->parent));
+		RBT_ASSERT(IS_BLACK(y));
+
+		SET_BLACK(x->parent);
+		SET_RED(x->parent->parent);
+		right_rotate(root, x->parent->parent);
+
+		RBT_ASSERT(x == x->parent->left);
+		RBT_ASSERT(IS_RED(x));
+		RBT_ASSERT(IS_RED(x->parent->right));
+		RBT_ASSERT(IS_BLACK(x->parent));
+		break;
+	    }
+	}
+	else {
+	    RBT_ASSERT(x->parent == x->parent->parent->right);
+	    y = x->parent->parent->left;
+	    if (IS_RED(y)) {
+		SET_BLACK(y);
+		x = x->parent;
+		SET_BLACK(x);
+		x = x->parent;
+		SET_RED(x);
+	    }
+	    else {
+
+		if (x == x->parent->left) {
+		    x = x->parent;
+		    right_rotate(root, x);
+		}
+
+		RBT_ASSERT(x == x->parent->parent->right->right);
+		RBT_ASSERT(IS_RED(x));
+		RBT_ASSERT(IS_RED(x->parent));
+		RBT_ASSERT(IS_BLACK(x->parent->parent));
+		RBT_ASSERT(IS_BLACK(y));
+
+		SET_BLACK(x->parent);
+		SET_RED(x->parent->parent);
+		left_rotate(root, x->parent->parent);
+
+		RBT_ASSERT(x == x->parent->right);
+		RBT_ASSERT(IS_RED(x));
+		RBT_ASSERT(IS_RED(x->parent->left));
+		RBT_ASSERT(IS_BLACK(x->parent));
+		break;
+	    }
+	}
+    } while (x != *root && IS_RED(x->parent));
+
+    SET_BLACK(*root);
+
+}
+
+static void
+tree_delete(AOFF_RBTree_t **root, AOFF_RBTree_t *z)
+{
+    Uint spliced_is_black;
+    AOFF_RBTree_t *x, *y, *p;
+    AOFF_RBTree_t null_x; /* null_x is used to get the fixup started when we
+			     splice out a node without children. */
+
+    null_x.hdr = 0;
+    null_x.max_sz = 0;
+    null_x.parent = NULL;
+
+    /* Remove node from tree... */
+
+    /* Find node to splice out */
+    if (!z->left || !z->right)
+	y = z;
+    else
+	/* Set y to z:s successor */
+	for(y = z->right; y->left; y = y->left);
+    /* Lowest node whose sub-tree changes; max_sz is recalculated from
+       there and up to the root */
+    p = y->parent == z ? y : y->parent;
+    /* splice out y */
+    x = y->left ? y->left : y->right;
+    spliced_is_black = IS_BLACK(y);
+    if (x) {
+	x->parent = y->parent;
+    }
+    else if (!x && spliced_is_black) {
+	x = &null_x;
+	x->flags = 0;
+	SET_BLACK(x);
+	x->right = x->left = NULL;
+	x->parent = y->parent;
+	y->left = x;
+    }
+
+    if (!y->parent) {
+	RBT_ASSERT(*root == y);
+	*root = x;
+    }
+    else if (y == y->parent->left)
+	y->parent->left = x;
+    else {
+	RBT_ASSERT(y == y->parent->right);
+	y->parent->right = x;
+    }
+    if (y != z) {
+	/* We spliced out the successor of z; replace z by the successor */
+	replace(root, z, y);
+    }
+
+    for (; p; p = p->parent)
+	update_max_sz(p);
+
+    if (spliced_is_black) {
+	/* We removed a black node which makes the resulting tree
+	   violate the Red-Black Tree properties. Fixup tree... */
+
+	while (IS_BLACK(x) && x->parent) {
+
+	    /*
+	     * x has an "extra black" which we move up the tree
+	     * until we reach the root or until we can get rid of it.
+	     *
+	     * y is the sibbling of x
+	     */
+
+	    if (x == x->parent->left) {
+		y = x->parent->right;
+		RBT_ASSERT(y);
+		if (IS_RED(y)) {
+		    RBT_ASSERT(y->right);
+		    RBT_ASSERT(y->left);
+		    SET_BLACK(y);
+		    RBT_ASSERT(IS_BLACK(x->parent));
+		    SET_RED(x->parent);
+		    left_rotate(root, x->parent);
+		    y = x->parent->right;
+		}
+		RBT_ASSERT(y);
+		RBT_ASSERT(IS_BLACK(y));
+		if (IS_BLACK(y->left) && IS_BLACK(y->right)) {
+		    SET_RED(y);
+		    x = x->parent;
+		}
+		else {
+		    if (IS_BLACK(y->right)) {
+			SET_BLACK(y->left);
+			SET_RED(y);
+			right_rotate(root, y);
+			y = x->parent->right;
+		    }
+		    RBT_ASSERT(y);
+		    if (IS_RED(x->parent)) {
+
+			SET_BLACK(x->parent);
+			SET_RED(y);
+		    }
+		    RBT_ASSERT(y->right);
+		    SET_BLACK(y->right);
+		    left_rotate(root, x->parent);
+		    x = *root;
+		    break;
+		}
+	    }
+	    else {
+		RBT_ASSERT(x == x->parent->right);
+		y = x->parent->left;
+		RBT_ASSERT(y);
+		if (IS_RED(y)) {
+		    RBT_ASSERT(y->right);
+		    RBT_ASSERT(y->left);
+		    SET_BLACK(y);
+		    RBT_ASSERT(IS_BLACK(x->parent));
+		    SET_RED(x->parent);
+		    right_rotate(root, x->parent);
+		    y = x->parent->left;
+		}
+		RBT_ASSERT(y);
+		RBT_ASSERT(IS_BLACK(y));
+		if (IS_BLACK(y->right) && IS_BLACK(y->left)) {
+		    SET_RED(y);
+		    x = x->parent;
+		}
+		else {
+		    if (IS_BLACK(y->left)) {
+			SET_BLACK(y->right);
+			SET_RED(y);
+			left_rotate(root, y);
+			y = x->parent->left;
+		    }
+		    RBT_ASSERT(y);
+		    if (IS_RED(x->parent)) {
+			SET_BLACK(x->parent);
+			SET_RED(y);
+		    }
+		    RBT_ASSERT(y->left);
+		    SET_BLACK(y->left);
+		    right_rotate(root, x->parent);
+		    x = *root;
+		    break;
+		}
+	    }
+	}
+	SET_BLACK(x);
+
+	if (null_x.parent) {
+	    if (null_x.parent->left == &null_x)
+		null_x.parent->left = NULL;
+	    else {
+		RBT_ASSERT(null_x.parent->right == &null_x);
+		null_x.parent->right = NULL;
+	    }
+	    RBT_ASSERT(!null_x.left);
+	    RBT_ASSERT(!null_x.right);
+	}
+	else if (*root == &null_x) {
+	    *root = NULL;
+	    RBT_ASSERT(!null_x.left);
+	    RBT_ASSERT(!null_x.right);
+	}
+    }
+
+    DESTROY_TREE_NODE(z);
+}
+
+/*
+ * Find the carrier that a block is placed in. Carriers never overlap,
+ * so it is the carrier with the highest address below the block.
+ */
+static ERTS_INLINE AOFFCarrier_t *
+blk_to_crr(AOFFAllctr_t *aoffallctr, Block_t *blk)
+{
+    AOFF_RBTree_t *x = aoffallctr->crr_root;
+    AOFF_RBTree_t *res = NULL;
+
+    while (x) {
+	if (((char *) x) < ((char *) blk)) {
+	    res = x;
+	    x = x->right;
+	}
+	else
+	    x = x->left;
+    }
+
+    ASSERT(res);
+    ASSERT(((char *) blk) < CRR_END(CRR_NODE2CRR(res)));
+    return CRR_NODE2CRR(res);
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * "Address order first fit, carrier best fit" callbacks.                    *
+\*                                                                           */
+
+static void
+aoff_link_free_block(Allctr_t *allctr, Block_t *block)
+{
+    AOFFAllctr_t *aoffallctr = (AOFFAllctr_t *) allctr;
+    AOFF_RBTree_t *blk = (AOFF_RBTree_t *) block;
+    Uint blk_sz = BLK_SZ(blk);
+
+    blk->flags	= 0;
+    blk->left	= NULL;
+    blk->right	= NULL;
+    blk->max_sz	= blk_sz;
+
+    if (!aoffallctr->root) {
+	blk->parent = NULL;
+	SET_BLACK(blk);
+	aoffallctr->root = blk;
+    }
+    else {
+	AOFFCarrier_t *crr = blk_to_crr(aoffallctr, block);
+	char *crr_start = CRR_START(crr);
+	char *crr_end = CRR_END(crr);
+	AOFF_RBTree_t *x = aoffallctr->root;
+	while (1) {
+	    int left;
+
+	    if (x->max_sz < blk_sz)
+		x->max_sz = blk_sz;
+
+	    /* Order on carrier, size, and address */
+	    if (((char *) x) < crr_start)
+		left = 0;
+	    else if (((char *) x) >= crr_end)
+		left = 1;
+	    else {
+		Uint size = BLK_SZ(x);
+		left = blk_sz < size || (blk_sz == size && blk < x);
+	    }
+
+	    if (left) {
+		if (!x->left) {
+		    blk->parent = x;
+		    x->left = blk;
+		    break;
+		}
+		x = x->left;
+	    }
+	    else {
+		if (!x->right) {
+		    blk->parent = x;
+		    x->right = blk;
+		    break;
+		}
+		x = x->right;
+	    }
+
+	}
+
+	RBT_ASSERT(blk->parent);
+
+	SET_RED(blk);
+	if (IS_RED(blk->parent))
+	    tree_insert_fixup(&aoffallctr->root, blk);
+    }
+
+#ifdef HARD_DEBUG
+    check_tree(aoffallctr, 0);
+#endif
+}
+
+static void
+aoff_unlink_free_block(Allctr_t *allctr, Block_t *block)
+{
+    AOFFAllctr_t *aoffallctr = (AOFFAllctr_t *) allctr;
+
+    tree_delete(&aoffallctr->root, (AOFF_RBTree_t *) block);
+
+#ifdef HARD_DEBUG
+    check_tree(aoffallctr, 0);
+#endif
+}
+
+static Block_t *
+aoff_get_free_block(Allctr_t *allctr, Uint size,
+		    Block_t *cand_blk, Uint cand_size)
+{
+    AOFFAllctr_t *aoffallctr = (AOFFAllctr_t *) allctr;
+    AOFF_RBTree_t *x = aoffallctr->root;
+    AOFF_RBTree_t *blk;
+
+    ASSERT(!cand_blk || cand_size >= size);
+
+    if (!x || x->max_sz < size)
+	return NULL;
+
+    /* Find the first block (in tree order) that is large enough */
+    while (1) {
+	if (x->left && x->left->max_sz >= size)
+	    x = x->left;
+	else if (BLK_SZ(x) >= size)
+	    break;
+	else {
+	    x = x->right;
+	    RBT_ASSERT(x && x->max_sz >= size);
+	}
+    }
+    blk = x;
+
+#ifdef HARD_DEBUG
+    ASSERT(blk == check_tree(aoffallctr, size));
+#endif
+
+    if (cand_blk) {
+	AOFFCarrier_t *crr = blk_to_crr(aoffallctr, cand_blk);
+	if (((char *) blk) >= CRR_END(crr))
+	    return NULL; /* cand_blk was better; placed in a lower carrier */
+	if (((char *) blk) >= CRR_START(crr)) {
+	    Uint blk_sz = BLK_SZ(blk);
+	    if (cand_size < blk_sz)
+		return NULL; /* cand_blk was better */
+	    if (cand_size == blk_sz && ((void *) cand_blk) < ((void *) blk))
+		return NULL; /* cand_blk was better */
+	}
+    }
+
+    aoff_unlink_free_block(allctr, (Block_t *) blk);
+
+    return (Block_t *) blk;
+}
+
+static void
+aoff_creating_mbc(Allctr_t *allctr, Carrier_t *carrier)
+{
+    AOFFAllctr_t *aoffallctr = (AOFFAllctr_t *) allctr;
+    AOFF_RBTree_t *crr_node = &((AOFFCarrier_t *) carrier)->node;
+
+    crr_node->hdr	= 0;
+    crr_node->flags	= 0;
+    crr_node->left	= NULL;
+    crr_node->right	= NULL;
+    crr_node->max_sz	= 0;
+
+    if (!aoffallctr->crr_root) {
+	crr_node->parent = NULL;
+	SET_BLACK(crr_node);
+	aoffallctr->crr_root = crr_node;
+    }
+    else {
+	AOFF_RBTree_t *x = aoffallctr->crr_root;
+	while (1) {
+	    if (crr_node < x) {
+		if (!x->left) {
+		    crr_node->parent = x;
+		    x->left = crr_node;
+		    break;
+		}
+		x = x->left;
+	    }
+	    else {
+		if (!x->right) {
+		    crr_node->parent = x;
+		    x->right = crr_node;
+		    break;
+		}
+		x = x->right;
+	    }
+	}
+
+	SET_RED(crr_node);
+	if (IS_RED(crr_node->parent))
+	    tree_insert_fixup(&aoffallctr->crr_root, crr_node);
+    }
+}
+
+static void
+aoff_destroying_mbc(Allctr_t *allctr, Carrier_t *carrier)
+{
+    AOFFAllctr_t *aoffallctr = (AOFFAllctr_t *) allctr;
+
+    tree_delete(&aoffallctr->crr_root, &((AOFFCarrier_t *) carrier)->node);
+}
+
+
+/*
+ * info_options()
+ */
+
+static struct {
+    Eterm as;
+    Eterm aoffcbf;
+#ifdef DEBUG
+    Eterm end_of_atoms;
+#endif
+} am;
+
+static void ERTS_INLINE atom_init(Eterm *atom, char *name)
+{
+    *atom = am_atom_put(name, strlen(name));
+}
+#define AM_INIT(AM) atom_init(&am.AM, #AM)
+
+static void
+init_atoms(void)
+{
+#ifdef DEBUG
+    Eterm *atom;
+#endif
+
+    if (atoms_initialized)
+	return;
+
+#ifdef DEBUG
+    for (atom = (Eterm *) &am; atom <= &am.end_of_atoms; atom++) {
+	*atom = THE_NON_VALUE;
+    }
+#endif
+    AM_INIT(as);
+    AM_INIT(aoffcbf);
+
+#ifdef DEBUG
+    for (atom = (Eterm *) &am; atom < &am.end_of_atoms; atom++) {
+	ASSERT(*atom != THE_NON_VALUE);
+    }
+#endif
+
+    atoms_initialized = 1;
+}
+
+
+#define bld_uint	erts_bld_uint
+#define bld_cons	erts_bld_cons
+#define bld_tuple	erts_bld_tuple
+
+static ERTS_INLINE void
+add_2tup(Uint **hpp, Uint *szp, Eterm *lp, Eterm el1, Eterm el2)
+{
+    *lp = bld_cons(hpp, szp, bld_tuple(hpp, szp, 2, el1, el2), *lp);
+}
+
+static Eterm
+info_options(Allctr_t *allctr,
+	     char *prefix,
+	     int *print_to_p,
+	     void *print_to_arg,
+	     Uint **hpp,
+	     Uint *szp)
+{
+    Eterm res = THE_NON_VALUE;
+
+    if (print_to_p) {
+	erts_print(*print_to_p,
+		   print_to_arg,
+		   "%sas: aoffcbf\n",
+		   prefix);
+    }
+
+    if (hpp || szp) {
+	
+	if (!atoms_initialized)
+	    erl_exit(1, "%s:%d: Internal error: Atoms not initialized",
+		     __FILE__, __LINE__);;
+
+	res = NIL;
+	add_2tup(hpp, szp, &res, am.as, am.aoffcbf);
+    }
+
+    return res;
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * NOTE:  erts_aoffalc_test() is only supposed to be used for testing.       *
+ *                                                                           *
+ * Keep alloc_SUITE_data/allocator_test.h updated if changes are made        *
+ * to erts_aoffalc_test()                                                    *
+\*                                                                           */
+
+unsigned long
+erts_aoffalc_test(unsigned long op, unsigned long a1, unsigned long a2)
+{
+    switch (op) {
+    case 0x500:	return (unsigned long) ((AOFFAllctr_t *) a1)->root;
+    case 0x501:	return (unsigned long) ((AOFF_RBTree_t *) a1)->parent;
+    case 0x502:	return (unsigned long) ((AOFF_RBTree_t *) a1)->left;
+    case 0x503:	return (unsigned long) ((AOFF_RBTree_t *) a1)->right;
+    case 0x504:	return (unsigned long) IS_BLACK((AOFF_RBTree_t *) a1);
+    case 0x505:	return (unsigned long) ((AOFF_RBTree_t *) a1)->max_sz;
+    case 0x506:	return (unsigned long) ((AOFFAllctr_t *) a1)->crr_root;
+    default:	ASSERT(0); return ~((unsigned long) 0);
+    }
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * Debug functions                                                           *
+\*                                                                           */
+
+
+#ifdef HARD_DEBUG
+
+#define IS_LEFT_VISITED(FB)	((FB)->flags & LEFT_VISITED_FLG)
+#define IS_RIGHT_VISITED(FB)	((FB)->flags & RIGHT_VISITED_FLG)
+
+#define SET_LEFT_VISITED(FB)	((FB)->flags |= LEFT_VISITED_FLG)
+#define SET_RIGHT_VISITED(FB)	((FB)->flags |= RIGHT_VISITED_FLG)
+
+#define UNSET_LEFT_VISITED(FB)	((FB)->flags &= ~LEFT_VISITED_FLG)
+#define UNSET_RIGHT_VISITED(FB)	((FB)->flags &= ~RIGHT_VISITED_FLG)
+
+/*
+ * Checks that the order between parent and children are correct,
+ * that max_sz of each node is correct, and that the Red-Black Tree
+ * properies are satisfied. If size > 0, check_tree() returns the
+ * first block in tree order that is at least size large, i.e. the
+ * block that "address order first fit, carrier best fit" should
+ * choose.
+ */
+
+static AOFF_RBTree_t *
+check_tree(AOFFAllctr_t *aoffallctr, Uint size)
+{
+    AOFF_RBTree_t *res = NULL;
+    AOFF_RBTree_t *prev = NULL;
+    Sint blacks;
+    Sint curr_blacks;
+    AOFF_RBTree_t *x;
+
+    if (!aoffallctr->root)
+	return res;
+
+    x = aoffallctr->root;
+    ASSERT(IS_BLACK(x));
+    ASSERT(!x->parent);
+    curr_blacks = 1;
+    blacks = -1;
+
+    while (x) {
+	if (!IS_LEFT_VISITED(x)) {
+	    SET_LEFT_VISITED(x);
+	    if (x->left) {
+		x = x->left;
+		if (IS_BLACK(x))
+		    curr_blacks++;
+		continue;
+	    }
+	    else {
+		if (blacks < 0)
+		    blacks = curr_blacks;
+		ASSERT(blacks == curr_blacks);
+	    }
+	}
+
+	if (!IS_RIGHT_VISITED(x)) {
+	    /* In-order visit of x */
+	    if (prev) {
+		AOFFCarrier_t *crr = blk_to_crr(aoffallctr, (Block_t *) x);
+		if (((char *) prev) >= CRR_START(crr)) {
+		    ASSERT(BLK_SZ(prev) < BLK_SZ(x)
+			   || (BLK_SZ(prev) == BLK_SZ(x) && prev < x));
+		}
+	    }
+	    prev = x;
+	    if (size && !res && BLK_SZ(x) >= size)
+		res = x;
+
+	    SET_RIGHT_VISITED(x);
+	    if (x->right) {
+		x = x->right;
+		if (IS_BLACK(x))
+		    curr_blacks++;
+		continue;
+	    }
+	    else {
+		if (blacks < 0)
+		    blacks = curr_blacks;
+		ASSERT(blacks == curr_blacks);
+	    }
+	}
+
+
+	if (IS_RED(x)) {
+	    ASSERT(IS_BLACK(x->right));
+	    ASSERT(IS_BLACK(x->left));
+	}
+
+	ASSERT(x->parent || x == aoffallctr->root);
+
+	if (x->left)
+	    ASSERT(x->left->parent == x);
+	if (x->right)
+	    ASSERT(x->right->parent == x);
+
+	{
+	    Uint max_sz = x->max_sz;
+	    update_max_sz(x);
+	    ASSERT(max_sz == x->max_sz);
+	}
+
+	UNSET_LEFT_VISITED(x);
+	UNSET_RIGHT_VISITED(x);
+	if (IS_BLACK(x))
+	    curr_blacks--;
+	x = x->parent;
+
+    }
+
+    ASSERT(curr_blacks == 0);
+
+    return res;
+
+}
+
+#endif
@@ -38,6 +38,8 @@
 #include "erl_instrument.h"
 #include "dist.h"
 #include "erl_gc.h"
+#include "erl_spawn_site.h"
+#include "erl_shared_term.h"
 #ifdef ELIB_ALLOC_IS_CLIB
 #include "elib_stat.h"
 #endif
@@ -1639,6 +1641,16 @@ info_1_tuple(Process* BIF_P,	/* Pointer to current process. */
 	Eterm res = erts_get_cpu_topology_term(BIF_P, *tp);
 	ERTS_BIF_PREP_TRAP1(ret, erts_format_cpu_topology_trap, BIF_P, res);
 	return ret;
+    } else if (ERTS_IS_ATOM_STR("dist_atom_cache", sel) && arity == 2) {
+	Eterm res = erts_dist_atom_cache_info(BIF_P, *tp);
+	if (is_non_value(res))
+	    goto badarg;
+	return res;
+    } else if (ERTS_IS_ATOM_STR("dist_stats", sel) && arity == 2) {
+	Eterm res = erts_dist_stats_info(BIF_P, *tp);
+	if (is_non_value(res))
+	    goto badarg;
+	return res;
 #if defined(PURIFY) || defined(VALGRIND)
     } else if (ERTS_IS_ATOM_STR("error_checker", sel)
 #if defined(PURIFY)
@@ -1879,6 +1891,10 @@ BIF_RETTYPE system_info_1(BIF_ALIST_1)
 	BIF_RET(res);
     } else if (BIF_ARG_1 == am_allocated) {
 	BIF_RET(erts_instr_get_memory_map(BIF_P));
+    } else if (BIF_ARG_1 == am_allocation_histograms) {
+	BIF_RET(erts_instr_get_sample_stat(BIF_P));
+    } else if (BIF_ARG_1 == am_allocation_samples) {
+	BIF_RET(erts_instr_get_samples(BIF_P));
     } else if (BIF_ARG_1 == am_hipe_architecture) {
 #if defined(HIPE)
 	BIF_RET(hipe_arch_name);
@@ -1907,6 +1923,20 @@ BIF_RETTYPE system_info_1(BIF_ALIST_1)
 	hp = HAlloc(BIF_P, 3);
 	res = TUPLE2(hp, am_fullsweep_after, make_small(val));
 	BIF_RET(res);
+    } else if (BIF_ARG_1 == am_spawn_site_heap_sizing) {
+	BIF_RET(erts_spawn_site_heap_sizing ? am_true : am_false);
+    } else if (BIF_ARG_1 == am_spawn_site_heap_sizes) {
+	BIF_RET(erts_spawn_site_info(BIF_P));
+    } else if (BIF_ARG_1 == am_published_terms) {
+	Uint n = (Uint) erts_smp_atomic_read(&erts_shared_terms);
+	Uint bytes = erts_shared_terms_size();
+	Uint sz = 3;
+	Eterm bytes_term;
+	(void) erts_bld_uint(NULL, &sz, bytes);
+	hp = HAlloc(BIF_P, sz);
+	bytes_term = erts_bld_uint(&hp, NULL, bytes);
+	res = TUPLE2(hp, make_small(n), bytes_term);
+	BIF_RET(res);
     } else if (BIF_ARG_1 == am_process_count) {
 	BIF_RET(make_small(erts_process_count()));
     } else if (BIF_ARG_1 == am_process_limit) {
@@ -119,6 +119,8 @@ static void offset_rootset(Process *p, Sint offs, char* area, Uint area_size,
 			   Eterm* objv, int nobj);
 static void offset_off_heap(Process* p, Sint offs, char* area, Uint area_size);
 static void offset_mqueue(Process *p, Sint offs, char* area, Uint area_size);
+static void release_literal_area_ref(Process* p, Eterm* objv, int nobj);
+static void link_literal_off_heap(Process* p, Eterm* hp, Eterm* htop);
 
 #ifdef HARDDEBUG
 static void disallow_heap_frag_ref_in_heap(Process* p);
@@ -347,6 +349,17 @@ erts_garbage_collect(Process* p, int need, Eterm* objv, int nobj)
     int done = 0;
     Uint ms1, s1, us1;
 
+    if (FLAGS(p) & F_DISABLE_GC) {
+	/*
+	 * A BIF that has trapped keeps pointers into the heap; collect
+	 * when it is done. Such a process only runs the BIF, which
+	 * never needs more heap than is available.
+	 */
+	ASSERT(need <= HEAP_LIMIT(p) - HEAP_TOP(p));
+	FLAGS(p) |= F_FORCE_GC;
+	return 1;
+    }
+
     if (IS_TRACED_FL(p, F_TRACE_GC)) {
         trace_gc(p, am_gc_start);
     }
@@ -368,6 +381,14 @@ erts_garbage_collect(Process* p, int need, Eterm* objv, int nobj)
         FLAGS(p) |= F_NEED_FULLSWEEP;
     }
 
+    /*
+     * Literals of purged modules can only be copied into the heap
+     * after a major collection (see release_literal_area_ref() below).
+     */
+    if (ERTS_PROC_GET_LITERAL_AREAS(p) != NULL) {
+        FLAGS(p) |= F_NEED_FULLSWEEP;
+    }
+
     /*
      * Test which type of GC to do.
      */
@@ -423,6 +444,10 @@ erts_garbage_collect(Process* p, int need, Eterm* objv, int nobj)
 
     FLAGS(p) &= ~F_FORCE_GC;
 
+    if (ERTS_PROC_GET_LITERAL_AREAS(p) != NULL && OLD_HEAP(p) == NULL) {
+	release_literal_area_ref(p, objv, nobj);
+    }
+
 #ifdef CHECK_FOR_HOLES
     /*
      * We intentionally do not rescan the areas copied by the GC.
@@ -593,8 +618,69 @@ erts_garbage_collect_hibernate(Process* p)
 }
 
 
+/*
+ * Make the process hold a reference to the literal area of a module
+ * that is about to be purged. Instead of forcing a garbage collection
+ * right away, the literals that the process uses are copied into its
+ * heap by its next ordinary garbage collection, which then releases
+ * the reference.
+ */
+void
+erts_proc_ref_literal_area(Process* p, ErtsLiteralArea* area)
+{
+    ErtsLiteralAreaRef* ref;
+
+    ERTS_SMP_LC_ASSERT(ERTS_PROC_LOCK_MAIN & erts_proc_lc_my_proc_locks(p));
+
+    for (ref = ERTS_PROC_GET_LITERAL_AREAS(p); ref != NULL; ref = ref->next) {
+	if (ref->area == area) {
+	    return;
+	}
+    }
+    ref = (ErtsLiteralAreaRef *) erts_alloc(ERTS_ALC_T_LITERAL_REF,
+					    sizeof(ErtsLiteralAreaRef));
+    erts_refc_inc(&area->refc, 2);
+    ref->area = area;
+    ref->next = ERTS_PROC_GET_LITERAL_AREAS(p);
+    (void) ERTS_PROC_SET_LITERAL_AREAS(p, ERTS_PROC_LOCK_MAIN, ref);
+}
+
+/*
+ * Release the literal area references that an exited process held.
+ */
+void
+erts_release_literal_area_refs(ErtsLiteralAreaRef* ref)
+{
+    while (ref != NULL) {
+	ErtsLiteralAreaRef* next = ref->next;
+	erts_release_literal_area(ref->area);
+	erts_free(ERTS_ALC_T_LITERAL_REF, (void *) ref);
+	ref = next;
+    }
+}
+
+/*
+ * Copy the literals that the process uses from one of the literal
+ * areas it holds a reference to, and release the reference. Must be
+ * called directly after a major collection. If the process holds
+ * references to more than one area, the remaining ones are taken care
+ * of by subsequent collections.
+ */
+static void
+release_literal_area_ref(Process* p, Eterm* objv, int nobj)
+{
+    ErtsLiteralAreaRef* ref = ERTS_PROC_GET_LITERAL_AREAS(p);
+    ErtsLiteralArea* area = ref->area;
+
+    erts_garbage_collect_literals(p, area->start, area->size, objv, nobj);
+    (void) ERTS_PROC_SET_LITERAL_AREAS(p, ERTS_PROC_LOCK_MAIN, ref->next);
+    erts_release_literal_area(area);
+    erts_free(ERTS_ALC_T_LITERAL_REF, (void *) ref);
+}
+
 void
-erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size)
+erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size,
+			      Eterm* objv, int nobj)
 {
     Uint byte_lit_size = sizeof(Eterm)*lit_size;
     Uint old_heap_size;
@@ -639,7 +725,7 @@ erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size)
     offs = temp_lit - literals;
     offset_heap(temp_lit, lit_size, offs, (char *) literals, byte_lit_size);
     offset_heap(p->heap, p->htop - p->heap, offs, (char *) literals, byte_lit_size);
-    offset_rootset(p, offs, (char *) literals, byte_lit_size, p->arg_reg, p->arity);
+    offset_rootset(p, offs, (char *) literals, byte_lit_size, objv, nobj);
 
     /*
      * Now the literals are placed in memory that is safe to write into,
@@ -649,7 +735,7 @@ erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size)
 
     area = (char *) temp_lit;
     area_size = byte_lit_size;
-    n = setup_rootset(p, p->arg_reg, p->arity, &rootset);
+    n = setup_rootset(p, objv, nobj, &rootset);
     roots = rootset.roots;
     old_htop = p->old_htop;
     while (n--) {
@@ -704,6 +790,7 @@ erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size)
     old_htop = sweep_one_heap(p->heap, p->htop, old_htop, area, area_size);
     old_htop = sweep_one_area(p->old_heap, old_htop, area, area_size);
     ASSERT(p->old_htop <= old_htop && old_htop <= p->old_hend);
+    link_literal_off_heap(p, p->old_htop, old_htop);
     p->old_htop = old_htop;
 
     /*
@@ -720,6 +807,56 @@ erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size)
     erts_smp_locked_activity_end(ERTS_ACTIVITY_GC);
 }
 
+/*
+ * Literal areas of published terms may contain binaries, funs, and
+ * external pids/ports/refs. Those that have been copied into the heap
+ * must be linked into the off-heap lists of the process.
+ */
+static void
+link_literal_off_heap(Process* p, Eterm* hp, Eterm* htop)
+{
+    while (hp < htop) {
+	Eterm val = *hp;
+
+	if (!is_header(val) || !header_is_thing(val)) {
+	    hp++;
+	    continue;
+	}
+	switch (thing_subtag(val)) {
+	case REFC_BINARY_SUBTAG:
+	    {
+		ProcBin* pb = (ProcBin *) hp;
+		erts_refc_inc(&pb->val->refc, 2);
+		pb->next = MSO(p).mso;
+		MSO(p).mso = pb;
+		MSO(p).overhead += pb->size / sizeof(Eterm);
+	    }
+	    break;
+#ifndef HYBRID /* FIND ME! */
+	case FUN_SUBTAG:
+	    {
+		ErlFunThing* funp = (ErlFunThing *) hp;
+		erts_refc_inc(&funp->fe->refc, 2);
+		funp->next = MSO(p).funs;
+		MSO(p).funs = funp;
+	    }
+	    break;
+#endif
+	case EXTERNAL_PID_SUBTAG:
+	case EXTERNAL_PORT_SUBTAG:
+	case EXTERNAL_REF_SUBTAG:
+	    {
+		ExternalThing* etp = (ExternalThing *) hp;
+		erts_refc_inc(&etp->node->refc, 2);
+		etp->next = MSO(p).externals;
+		MSO(p).externals = etp;
+	    }
+	    break;
+	}
+	hp += thing_arityval(val) + 1;
+    }
+}
+
 static int
 minor_collection(Process* p, int need, Eterm* objv, int nobj, Uint *recl)
 {
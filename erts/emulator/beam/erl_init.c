@@ -41,6 +41,8 @@
 #include "erl_printf_term.h"
 #include "erl_misc_utils.h"
 #include "packet_parser.h"
+#include "erl_spawn_site.h"
+#include "erl_shared_term.h"
 
 #ifdef HIPE
 #include "hipe_mode_switch.h"	/* for hipe_mode_switch_init() */
@@ -258,6 +260,8 @@ erl_init(void)
     erts_init_binary();
     erts_init_bits();
     erts_init_fun_table();
+    erts_init_spawn_sites();
+    erts_init_shared_terms();
     init_atom_table();
     init_export_table();
     init_module_table();
@@ -279,6 +283,7 @@ erl_init(void)
     erts_init_bif_chksum();
     erts_init_bif_re();
     erts_init_unicode(); /* after RE to get access to PCRE unicode */
+    erts_init_external();
     erts_delay_trap = erts_export_put(am_erlang, am_delay_trap, 2);
     erts_late_init_process();
 #if HAVE_ERTS_MSEG
@@ -535,6 +540,7 @@ void erts_usage(void)
 
     erts_fprintf(stderr, "-h number  set minimum heap size in words (default %d)\n",
 	       H_DEFAULT_SIZE);
+    erts_fprintf(stderr, "-hss bool  learn initial heap sizes per spawn site\n");
 
     /*    erts_fprintf(stderr, "-i module  set the boot module (default init)\n"); */
 
@@ -923,6 +929,21 @@ erl_start(int argc, char **argv)
 	    break;
 
 	case 'h':
+	    if (has_prefix("ss", argv[i]+2)) {
+		/* learn initial heap sizes per spawn site */
+		arg = get_arg(argv[i]+4, argv[i+1], &i);
+		if (sys_strcmp(arg, "true") == 0)
+		    erts_spawn_site_heap_sizing = 1;
+		else if (sys_strcmp(arg, "false") == 0)
+		    erts_spawn_site_heap_sizing = 0;
+		else {
+		    erts_fprintf(stderr, "bad spawn site heap sizing %s\n", arg);
+		    erts_usage();
+		}
+		VERBOSE(DEBUG_SYSTEM,
+			("spawn site heap sizing %s\n", arg));
+		break;
+	    }
 	    /* set default heap size */
 	    arg = get_arg(argv[i]+2, argv[i+1], &i);
 	    if ((H_MIN_SIZE = atoi(arg)) <= 0) {
@@ -60,11 +60,62 @@ typedef struct {
     Uint max_blocks_ever;
 } Stat_t;
 
+/*
+ * Sampling: every Nth allocation (per thread) is recorded. Sampled
+ * blocks are marked with the time of the allocation, so that their
+ * lifetime can be recorded when they are freed.
+ */
+
+#define ERTS_INSTR_SAMPLE_BUCKETS	32	/* log2 buckets */
+#define ERTS_INSTR_SAMPLE_RING		128	/* Recent samples per slot */
+
+typedef struct {
+    Uint size;
+    Uint time;			/* Micro seconds; 0 if not sampled */
+    Align_t mem[1];
+} SampleBlock_t;
+
+#define SAMPLE_BLOCK_HEADER_SIZE (sizeof(SampleBlock_t) - sizeof(Align_t))
+
+typedef struct {
+    Uint allocs;
+    Uint frees;
+    Sint live;			/* Bytes in sampled blocks not yet freed */
+    Uint size[ERTS_INSTR_SAMPLE_BUCKETS];
+    Uint lifetime[ERTS_INSTR_SAMPLE_BUCKETS];
+} SampleStat_t;
+
+typedef struct {
+    ErtsAlcType_t type_no;
+    Uint size;
+    Eterm mfa[3];		/* mfa[0] is THE_NON_VALUE if unknown */
+    void *pc;
+} Sample_t;
+
+/*
+ * One slot per scheduler, and one (slot 0) shared by all other
+ * threads. The countdown is only touched by the owner of the slot
+ * (races on slot 0 only skew the sampling a bit); the rest is
+ * protected by the slot mutex, which is only taken when sampling.
+ */
+typedef struct {
+    Sint countdown;
+    erts_mtx_t mtx;
+    Uint samples;
+    SampleStat_t n[ERTS_ALC_N_MAX+1];
+    Sample_t ring[ERTS_INSTR_SAMPLE_RING];
+} SampleSlot_t;
+
 static erts_mtx_t instr_mutex;
 static erts_mtx_t instr_x_mutex;
 
 int erts_instr_memory_map;
 int erts_instr_stat;
+Uint erts_instr_sample_period;
+
+static ErtsAllocatorFunctions_t sample_real_allctrs[ERTS_ALC_A_MAX+1];
+static SampleSlot_t **sample_slots;
+static int no_sample_slots;
 
 static ErtsAllocatorFunctions_t real_allctrs[ERTS_ALC_A_MAX+1];
 
@@ -491,6 +542,174 @@ map_stat_free(ErtsAlcType_t n, void *extra, void *ptr)
 
 }
 
+/*
+ * sample instrumentation callback functions
+ */
+
+#ifdef __GNUC__
+#define SAMPLE_CALLER_PC() __builtin_return_address(0)
+#else
+#define SAMPLE_CALLER_PC() NULL
+#endif
+
+static ERTS_INLINE SampleSlot_t *
+sample_slot(void)
+{
+#ifdef USE_THREADS
+    int ix = erts_alc_get_thr_ix();
+    if (ix < no_sample_slots)
+	return sample_slots[ix];
+#endif
+    return sample_slots[0];
+}
+
+static ERTS_INLINE Uint
+sample_time(void)
+{
+    Uint t;
+#ifdef HAVE_GETHRTIME
+    t = (Uint) (sys_gethrtime() / 1000);
+#else
+    SysTimeval tv;
+    sys_gettimeofday(&tv);
+    t = ((Uint) tv.tv_sec)*1000000 + (Uint) tv.tv_usec;
+#endif
+    return t ? t : 1;
+}
+
+static ERTS_INLINE int
+sample_bucket(Uint value)
+{
+    int b = 0;
+    while (value > 1 && b < ERTS_INSTR_SAMPLE_BUCKETS - 1) {
+	value >>= 1;
+	b++;
+    }
+    return b;
+}
+
+static ERTS_INLINE void
+sample_new_block(SampleBlock_t *sb, ErtsAlcType_t n, Uint size, void *pc)
+{
+    SampleSlot_t *slot = sample_slot();
+    SampleStat_t *st;
+    Sample_t *smpl;
+    Process *p;
+
+    sb->size = size;
+    if (--slot->countdown > 0) {
+	sb->time = 0;
+	return;
+    }
+    slot->countdown = (Sint) erts_instr_sample_period;
+    sb->time = sample_time();
+
+    p = erts_get_current_process();
+
+    erts_mtx_lock(&slot->mtx);
+
+    st = &slot->n[n];
+    st->allocs++;
+    st->live += (Sint) size;
+    st->size[sample_bucket(size)]++;
+
+    smpl = &slot->ring[slot->samples++ % ERTS_INSTR_SAMPLE_RING];
+    smpl->type_no = n;
+    smpl->size = size;
+    smpl->pc = pc;
+    if (p && p->current) {
+	smpl->mfa[0] = p->current[0];
+	smpl->mfa[1] = p->current[1];
+	smpl->mfa[2] = p->current[2];
+    }
+    else
+	smpl->mfa[0] = THE_NON_VALUE;
+
+    erts_mtx_unlock(&slot->mtx);
+}
+
+static ERTS_INLINE void
+sample_free_block(SampleBlock_t *sb, ErtsAlcType_t n)
+{
+    SampleSlot_t *slot = sample_slot();
+    SampleStat_t *st;
+    Uint lifetime = sample_time() - sb->time;
+
+    erts_mtx_lock(&slot->mtx);
+    st = &slot->n[n];
+    st->frees++;
+    st->live -= (Sint) sb->size;
+    st->lifetime[sample_bucket(lifetime)]++;
+    erts_mtx_unlock(&slot->mtx);
+}
+
+static void *
+sample_alloc(ErtsAlcType_t n, void *extra, Uint size)
+{
+    ErtsAllocatorFunctions_t *real_af = (ErtsAllocatorFunctions_t *) extra;
+    SampleBlock_t *sb;
+
+    sb = (SampleBlock_t *) (*real_af->alloc)(n, real_af->extra,
+					      size + SAMPLE_BLOCK_HEADER_SIZE);
+    if (!sb)
+	return NULL;
+    sample_new_block(sb, n, size, SAMPLE_CALLER_PC());
+    return (void *) sb->mem;
+}
+
+static void *
+sample_realloc(ErtsAlcType_t n, void *extra, void *ptr, Uint size)
+{
+    ErtsAllocatorFunctions_t *real_af = (ErtsAllocatorFunctions_t *) extra;
+    SampleBlock_t *sb;
+    Uint old_size;
+
+    if (ptr) {
+	sb = (SampleBlock_t *) (((char *) ptr) - SAMPLE_BLOCK_HEADER_SIZE);
+	old_size = sb->size;
+    }
+    else {
+	sb = NULL;
+	old_size = 0;
+    }
+
+    sb = (SampleBlock_t *) (*real_af->realloc)(n, real_af->extra, (void *) sb,
+					        size + SAMPLE_BLOCK_HEADER_SIZE);
+    if (!sb)
+	return NULL;
+
+    if (!ptr)
+	sample_new_block(sb, n, size, SAMPLE_CALLER_PC());
+    else {
+	sb->size = size;
+	if (sb->time) {
+	    SampleSlot_t *slot = sample_slot();
+	    erts_mtx_lock(&slot->mtx);
+	    slot->n[n].live += (Sint) size - (Sint) old_size;
+	    erts_mtx_unlock(&slot->mtx);
+	}
+    }
+    return (void *) sb->mem;
+}
+
+static void
+sample_free(ErtsAlcType_t n, void *extra, void *ptr)
+{
+    ErtsAllocatorFunctions_t *real_af = (ErtsAllocatorFunctions_t *) extra;
+    SampleBlock_t *sb;
+
+    if (ptr) {
+	sb = (SampleBlock_t *) (((char *) ptr) - SAMPLE_BLOCK_HEADER_SIZE);
+	if (sb->time)
+	    sample_free_block(sb, n);
+    }
+    else {
+	sb = NULL;
+    }
+
+    (*real_af->free)(n, real_af->extra, (void *) sb);
+}
+
 static void dump_memory_map_to_stream(FILE *fp)
 {
     ErtsAlcType_t n;
@@ -819,6 +1038,7 @@ update_max_ever_values(Stat_t *stat, int min, int max)
 #define bld_list	erts_bld_list
 #define bld_2tup_list	erts_bld_2tup_list
 #define bld_uint	erts_bld_uint
+#define bld_cons	erts_bld_cons
 
 Eterm
 erts_instr_get_stat(Process *proc, Eterm what, int begin_max_period)
@@ -1152,8 +1372,208 @@ erts_instr_get_type_info(Process *proc)
     return res;
 }
 
-Uint
-erts_instr_init(int stat, int map_stat)
+static Eterm
+bld_sample_hist(Uint **hpp, Uint *szp, Uint *hist)
+{
+    Eterm res = NIL;
+    int b;
+
+    for (b = ERTS_INSTR_SAMPLE_BUCKETS - 1; b >= 0; b--) {
+	if (hist[b])
+	    res = bld_cons(hpp, szp,
+			   bld_tuple(hpp, szp, 2,
+				     make_small(b),
+				     bld_uint(hpp, szp, hist[b])),
+			   res);
+    }
+    return res;
+}
+
+/*
+ * Returns [{Type, Allocs, Frees, LiveBytes, SizeHist, LifetimeHist}]
+ * summed over all slots, for all types that have been sampled. The
+ * histograms are lists of {Log2Bucket, Count}; sizes are in bytes
+ * and lifetimes in micro seconds.
+ */
+Eterm
+erts_instr_get_sample_stat(Process *proc)
+{
+    SampleStat_t *stat;
+    Eterm res;
+    Uint hsz, *hszp, *hp, **hpp;
+    ErtsAlcType_t n;
+    int i, b;
+
+    if (!erts_instr_sample_period)
+	return am_false;
+
+    if (!am_n)
+	init_am_n();
+
+    stat = (SampleStat_t *) erts_alloc(ERTS_ALC_T_TMP,
+				       (ERTS_ALC_N_MAX+1)*sizeof(SampleStat_t));
+    sys_memzero((void *) stat, (ERTS_ALC_N_MAX+1)*sizeof(SampleStat_t));
+
+    for (i = 0; i < no_sample_slots; i++) {
+	SampleSlot_t *slot = sample_slots[i];
+	erts_mtx_lock(&slot->mtx);
+	for (n = ERTS_ALC_N_MIN; n <= ERTS_ALC_N_MAX; n++) {
+	    SampleStat_t *from = &slot->n[n];
+	    SampleStat_t *to = &stat[n];
+	    to->allocs += from->allocs;
+	    to->frees += from->frees;
+	    to->live += from->live;
+	    for (b = 0; b < ERTS_INSTR_SAMPLE_BUCKETS; b++) {
+		to->size[b] += from->size[b];
+		to->lifetime[b] += from->lifetime[b];
+	    }
+	}
+	erts_mtx_unlock(&slot->mtx);
+    }
+
+    hsz = 0;
+    hszp = &hsz;
+    hpp = NULL;
+
+ restart_bld:
+
+    res = NIL;
+    for (n = ERTS_ALC_N_MAX; n >= ERTS_ALC_N_MIN; n--) {
+	SampleStat_t *st = &stat[n];
+	if (!st->allocs && !st->frees)
+	    continue;
+	res = bld_cons(hpp, hszp,
+		       bld_tuple(hpp, hszp, 6,
+				 am_n[n],
+				 bld_uint(hpp, hszp, st->allocs),
+				 bld_uint(hpp, hszp, st->frees),
+				 bld_uint(hpp, hszp,
+					  st->live > 0 ? (Uint) st->live : 0),
+				 bld_sample_hist(hpp, hszp, st->size),
+				 bld_sample_hist(hpp, hszp, st->lifetime)),
+		       res);
+    }
+
+    if (!hpp) {
+	hp = HAlloc(proc, hsz);
+	hszp = NULL;
+	hpp = &hp;
+	goto restart_bld;
+    }
+
+    erts_free(ERTS_ALC_T_TMP, (void *) stat);
+
+    return res;
+}
+
+/*
+ * Returns the most recent samples of each slot as
+ * [{Type, Size, {Module, Function, Arity} | undefined, CallerAddress}].
+ */
+Eterm
+erts_instr_get_samples(Process *proc)
+{
+    Sample_t *smpls;
+    Eterm res;
+    Uint hsz, *hszp, *hp, **hpp;
+    int i, len;
+
+    if (!erts_instr_sample_period)
+	return am_false;
+
+    if (!am_n)
+	init_am_n();
+
+    smpls = (Sample_t *) erts_alloc(ERTS_ALC_T_TMP,
+				    (no_sample_slots
+				     * ERTS_INSTR_SAMPLE_RING
+				     * sizeof(Sample_t)));
+    len = 0;
+    for (i = 0; i < no_sample_slots; i++) {
+	SampleSlot_t *slot = sample_slots[i];
+	Uint ix, end;
+	erts_mtx_lock(&slot->mtx);
+	end = slot->samples;
+	ix = end > ERTS_INSTR_SAMPLE_RING ? end - ERTS_INSTR_SAMPLE_RING : 0;
+	for (; ix < end; ix++)
+	    smpls[len++] = slot->ring[ix % ERTS_INSTR_SAMPLE_RING];
+	erts_mtx_unlock(&slot->mtx);
+    }
+
+    hsz = 0;
+    hszp = &hsz;
+    hpp = NULL;
+
+ restart_bld:
+
+    res = NIL;
+    for (i = len - 1; i >= 0; i--) {
+	Sample_t *smpl = &smpls[i];
+	Eterm mfa;
+	if (is_value(smpl->mfa[0]))
+	    mfa = bld_tuple(hpp, hszp, 3,
+			    smpl->mfa[0],
+			    smpl->mfa[1],
+			    make_small((Uint) smpl->mfa[2]));
+	else
+	    mfa = am_undefined;
+	res = bld_cons(hpp, hszp,
+		       bld_tuple(hpp, hszp, 4,
+				 am_n[smpl->type_no],
+				 bld_uint(hpp, hszp, smpl->size),
+				 mfa,
+				 bld_uint(hpp, hszp, (Uint) smpl->pc)),
+		       res);
+    }
+
+    if (!hpp) {
+	hp = HAlloc(proc, hsz);
+	hszp = NULL;
+	hpp = &hp;
+	goto restart_bld;
+    }
+
+    erts_free(ERTS_ALC_T_TMP, (void *) smpls);
+
+    return res;
+}
+
+static Uint
+init_sampling(Uint period)
+{
+    int i;
+
+    no_sample_slots = (int) erts_no_schedulers + 1;
+    sample_slots = (SampleSlot_t **)
+	erts_alloc(ERTS_ALC_T_INSTR_INFO,
+		   no_sample_slots*sizeof(SampleSlot_t *));
+    for (i = 0; i < no_sample_slots; i++) {
+	SampleSlot_t *slot = (SampleSlot_t *)
+	    erts_alloc(ERTS_ALC_T_INSTR_INFO, sizeof(SampleSlot_t));
+	sys_memzero((void *) slot, sizeof(SampleSlot_t));
+	slot->countdown = (Sint) period;
+	erts_mtx_init(&slot->mtx, "instr_sample");
+	sample_slots[i] = slot;
+    }
+
+    /* Install sampling functions on top of whatever is installed */
+    sys_memcpy((void *) sample_real_allctrs,
+	       (void *) erts_allctrs,
+	       sizeof(erts_allctrs));
+
+    for (i = ERTS_ALC_A_MIN; i <= ERTS_ALC_A_MAX; i++) {
+	erts_allctrs[i].alloc	= sample_alloc;
+	erts_allctrs[i].realloc	= sample_realloc;
+	erts_allctrs[i].free	= sample_free;
+	erts_allctrs[i].extra	= (void *) &sample_real_allctrs[i];
+    }
+
+    erts_instr_sample_period = period;
+    return SAMPLE_BLOCK_HEADER_SIZE;
+}
+
+static Uint
+init_stat(int stat, int map_stat)
 {
     int i;
 
@@ -1219,3 +1639,15 @@ erts_instr_init(int stat, int map_stat)
 
 }
 
+Uint
+erts_instr_init(int stat, int map_stat, Uint sample_period)
+{
+    Uint extra_block_size;
+
+    erts_instr_sample_period = 0;
+
+    extra_block_size = init_stat(stat, map_stat);
+    if (sample_period)
+	extra_block_size += init_sampling(sample_period);
+    return extra_block_size;
+}
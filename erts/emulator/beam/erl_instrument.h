@@ -26,8 +26,9 @@
 
 extern int erts_instr_memory_map;
 extern int erts_instr_stat;
+extern Uint erts_instr_sample_period;
 
-Uint  erts_instr_init(int stat, int map_stat);
+Uint  erts_instr_init(int stat, int map_stat, Uint sample_period);
 int   erts_instr_dump_memory_map_to_fd(int fd);
 int   erts_instr_dump_memory_map(const char *name);
 Eterm erts_instr_get_memory_map(Process *process);
@@ -37,5 +38,7 @@ Eterm erts_instr_get_stat(Process *proc, Eterm what, int begin_max_period);
 Eterm erts_instr_get_type_info(Process *proc);
 Uint  erts_instr_get_total(void);
 Uint  erts_instr_get_max_total(void);
+Eterm erts_instr_get_sample_stat(Process *proc);
+Eterm erts_instr_get_samples(Process *proc);
 
 #endif
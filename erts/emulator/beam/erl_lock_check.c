@@ -89,6 +89,7 @@ static erts_lc_lock_order_t erts_lock_order[] = {
     {	"proc_link",				"pid"			},
     {	"proc_msgq",				"pid"			},
     {	"dist_entry",				"address"		},
+    {	"dist_lane",				"address"		},
     {	"dist_entry_links",			"address"		},
     {	"proc_status",				"pid"			},
     {	"proc_tab",				NULL			},
@@ -106,6 +107,8 @@ static erts_lc_lock_order_t erts_lock_order[] = {
     {	"module_tab",				NULL			},
     {	"export_tab",				NULL			},
     {	"fun_tab",				NULL			},
+    {	"spawn_site_tab",			NULL			},
+    {	"shared_term_tab",			NULL			},
     {	"environ",				NULL			},
 #endif
     {	"asyncq",				"address"		},
@@ -149,6 +152,7 @@ static erts_lc_lock_order_t erts_lock_order[] = {
     {	"mtrace_op",				NULL			},
     {	"instr_x",				NULL			},
     {	"instr",				NULL			},
+    {	"instr_sample",				NULL			},
     {	"fix_alloc",				"index"			},
     {	"alcu_allocator",			"index"			},
     {	"mseg",					NULL			},
@@ -0,0 +1,312 @@
+/*
+ * %CopyrightBegin%
+ *
+ * Copyright Ericsson AB 2009. All Rights Reserved.
+ *
+ * The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved online at http://www.erlang.org/.
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * %CopyrightEnd%
+ */
+
+/*
+ * A fast LZ77 compressor producing the LZ4 block format, used for the
+ * LZ compressed external term format.
+ *
+ * The compressed data is a sequence of sequences, each one a token
+ * byte, literals, a 2 byte little endian offset and a match:
+ *
+ *   token:    high 4 bits literal count, low 4 bits match length - 4.
+ *             15 means that more length bytes follow, each one added
+ *             to the count; a byte less than 255 ends them.
+ *   literals: literal count bytes copied as is.
+ *   offset:   how far back from the output position the match starts.
+ *   match:    the extra match length bytes, if any.
+ *
+ * The last sequence has only literals. As in LZ4, the last match
+ * starts at least 12 bytes before the end and the last 5 bytes are
+ * literals.
+ *
+ * The compressor keeps a hash table of the latest positions of 4 byte
+ * sequences, and greedily takes the match found there. It skips ahead
+ * faster the longer it goes without finding a match, so incompressible
+ * data passes quickly.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "erl_lz.h"
+
+#define LZ_HASH_LOG		12
+#define LZ_HASH_SIZE		(1 << LZ_HASH_LOG)
+#define LZ_MIN_MATCH		4
+#define LZ_MAX_OFFSET		65535
+#define LZ_LAST_LITERALS	5
+#define LZ_MF_LIMIT		12
+#define LZ_SKIP_TRIGGER		6
+
+#define LZ_RUN_MASK		15
+
+static ERTS_INLINE Uint32
+lz_read32(byte *p)
+{
+    Uint32 v;
+    sys_memcpy((void *) &v, (void *) p, sizeof(Uint32));
+    return v;
+}
+
+static ERTS_INLINE Uint
+lz_read_word(byte *p)
+{
+    Uint v;
+    sys_memcpy((void *) &v, (void *) p, sizeof(Uint));
+    return v;
+}
+
+/*
+ * Copies len bytes a word at a time; may write up to a word past
+ * dst + len, so the caller makes sure there is room for it.
+ */
+static ERTS_INLINE void
+lz_wild_copy(byte *dst, byte *src, Uint len)
+{
+    byte *end = dst + len;
+    do {
+	sys_memcpy((void *) dst, (void *) src, sizeof(Uint));
+	dst += sizeof(Uint);
+	src += sizeof(Uint);
+    } while (dst < end);
+}
+
+static ERTS_INLINE Uint
+lz_hash(Uint32 v)
+{
+    return (Uint) ((v * 2654435761U) >> (32 - LZ_HASH_LOG));
+}
+
+/* Length of a token field; returns NULL if it does not fit */
+static ERTS_INLINE byte *
+lz_put_length(byte *op, byte *oend, Uint len)
+{
+    while (len >= 255) {
+	if (op >= oend)
+	    return NULL;
+	*op++ = 255;
+	len -= 255;
+    }
+    if (op >= oend)
+	return NULL;
+    *op++ = (byte) len;
+    return op;
+}
+
+Uint
+erts_lz_compress(byte *dst, Uint dst_size, byte *src, Uint src_size)
+{
+    Uint32 table[LZ_HASH_SIZE];
+    byte *ip = src;
+    byte *anchor = src;
+    byte *iend = src + src_size;
+    byte *op = dst;
+    byte *oend = dst + dst_size;
+    byte *token;
+    Uint lit;
+
+    if (src_size >= ERTS_LZ_MIN_INPUT) {
+	byte *mf_limit = iend - LZ_MF_LIMIT;
+	byte *match_limit = iend - LZ_LAST_LITERALS;
+	Uint misses = 1 << LZ_SKIP_TRIGGER;
+
+	sys_memzero((void *) table, sizeof(table));
+	ip++;
+	while (ip < mf_limit) {
+	    Uint32 seq = lz_read32(ip);
+	    Uint h = lz_hash(seq);
+	    byte *ref = src + table[h];
+	    byte *mp, *rp;
+	    Uint mlen;
+
+	    table[h] = (Uint32) (ip - src);
+	    if (ref >= ip
+		|| ip - ref > LZ_MAX_OFFSET
+		|| lz_read32(ref) != seq) {
+		ip += misses++ >> LZ_SKIP_TRIGGER;
+		continue;
+	    }
+	    misses = 1 << LZ_SKIP_TRIGGER;
+
+	    /* Extend the match backwards over pending literals */
+	    while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+		ip--;
+		ref--;
+	    }
+
+	    /* ... and forwards */
+	    mp = ip + LZ_MIN_MATCH;
+	    rp = ref + LZ_MIN_MATCH;
+	    while (mp + sizeof(Uint) <= match_limit
+		   && lz_read_word(mp) == lz_read_word(rp)) {
+		mp += sizeof(Uint);
+		rp += sizeof(Uint);
+	    }
+	    while (mp < match_limit && *mp == *rp) {
+		mp++;
+		rp++;
+	    }
+
+	    lit = ip - anchor;
+	    mlen = (mp - ip) - LZ_MIN_MATCH;
+	    if ((Uint) (oend - op) < 1 + lit + 2)
+		return 0;
+	    token = op++;
+	    if (lit >= LZ_RUN_MASK) {
+		*token = LZ_RUN_MASK << 4;
+		op = lz_put_length(op, oend, lit - LZ_RUN_MASK);
+		if (!op || (Uint) (oend - op) < lit + 2)
+		    return 0;
+	    }
+	    else
+		*token = (byte) (lit << 4);
+	    sys_memcpy((void *) op, (void *) anchor, lit);
+	    op += lit;
+	    op[0] = (byte) (ip - ref);
+	    op[1] = (byte) ((ip - ref) >> 8);
+	    op += 2;
+	    if (mlen >= LZ_RUN_MASK) {
+		*token |= LZ_RUN_MASK;
+		op = lz_put_length(op, oend, mlen - LZ_RUN_MASK);
+		if (!op)
+		    return 0;
+	    }
+	    else
+		*token |= (byte) mlen;
+
+	    ip = anchor = mp;
+	    if (ip < mf_limit) {
+		/* Remember a position inside the match as well */
+		table[lz_hash(lz_read32(ip - 2))] = (Uint32) (ip - 2 - src);
+	    }
+	}
+    }
+
+    /* Last literals */
+    lit = iend - anchor;
+    if (op >= oend)
+	return 0;
+    token = op++;
+    if (lit >= LZ_RUN_MASK) {
+	*token = LZ_RUN_MASK << 4;
+	op = lz_put_length(op, oend, lit - LZ_RUN_MASK);
+	if (!op)
+	    return 0;
+    }
+    else
+	*token = (byte) (lit << 4);
+    if ((Uint) (oend - op) < lit)
+	return 0;
+    sys_memcpy((void *) op, (void *) anchor, lit);
+    op += lit;
+    return op - dst;
+}
+
+/* Reads a length continuation; returns NULL on bad input */
+static ERTS_INLINE byte *
+lz_get_length(byte *ip, byte *iend, Uint *lenp, Uint max)
+{
+    Uint len = *lenp;
+    byte b;
+    do {
+	if (ip >= iend)
+	    return NULL;
+	b = *ip++;
+	len += b;
+	if (len > max)
+	    return NULL;
+    } while (b == 255);
+    *lenp = len;
+    return ip;
+}
+
+int
+erts_lz_uncompress(byte *dst, Uint dst_size, byte *src, Uint src_size)
+{
+    byte *ip = src;
+    byte *iend = src + src_size;
+    byte *op = dst;
+    byte *oend = dst + dst_size;
+
+    while (1) {
+	Uint len, offset;
+	byte token;
+	byte *ref;
+
+	if (ip >= iend)
+	    return -1;
+	token = *ip++;
+
+	len = token >> 4;
+	if (len == LZ_RUN_MASK) {
+	    ip = lz_get_length(ip, iend, &len, dst_size);
+	    if (!ip)
+		return -1;
+	}
+	if (len > (Uint) (iend - ip) || len > (Uint) (oend - op))
+	    return -1;
+	if (len + sizeof(Uint) <= (Uint) (iend - ip)
+	    && len + sizeof(Uint) <= (Uint) (oend - op))
+	    lz_wild_copy(op, ip, len);
+	else
+	    sys_memcpy((void *) op, (void *) ip, len);
+	op += len;
+	ip += len;
+
+	if (ip == iend)
+	    break; /* Last sequence */
+
+	if (iend - ip < 2)
+	    return -1;
+	offset = ip[0] | (ip[1] << 8);
+	ip += 2;
+	if (offset == 0 || offset > (Uint) (op - dst))
+	    return -1;
+
+	len = token & LZ_RUN_MASK;
+	if (len == LZ_RUN_MASK) {
+	    ip = lz_get_length(ip, iend, &len, dst_size);
+	    if (!ip)
+		return -1;
+	}
+	len += LZ_MIN_MATCH;
+	if (len > (Uint) (oend - op))
+	    return -1;
+
+	ref = op - offset;
+	if (offset >= sizeof(Uint)
+	    && len + sizeof(Uint) <= (Uint) (oend - op)) {
+	    lz_wild_copy(op, ref, len);
+	    op += len;
+	}
+	else if (offset >= len) {
+	    sys_memcpy((void *) op, (void *) ref, len);
+	    op += len;
+	}
+	else {
+	    /* Overlapping; repeats the last offset bytes */
+	    byte *end = op + len;
+	    while (op < end)
+		*op++ = *ref++;
+	}
+    }
+
+    return op == oend ? 0 : -1;
+}
@@ -0,0 +1,40 @@
+/*
+ * %CopyrightBegin%
+ *
+ * Copyright Ericsson AB 2009. All Rights Reserved.
+ *
+ * The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved online at http://www.erlang.org/.
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * %CopyrightEnd%
+ */
+
+/* A fast LZ77 compressor producing the LZ4 block format.
+*/
+
+#ifndef ERL_LZ_H__
+#define ERL_LZ_H__
+
+#include "sys.h"
+
+/* Inputs shorter than this are never compressed */
+#define ERTS_LZ_MIN_INPUT 13
+
+/* Max size of the data that n compressed bytes can uncompress to */
+#define ERTS_LZ_MAX_UNCOMPRESSED(N) ((N) * 255)
+
+/* Returns the compressed size, or 0 if it would exceed dst_size */
+Uint erts_lz_compress(byte *dst, Uint dst_size, byte *src, Uint src_size);
+
+/* Returns 0 if src uncompresses to exactly dst_size bytes, else -1 */
+int erts_lz_uncompress(byte *dst, Uint dst_size, byte *src, Uint src_size);
+
+#endif
@@ -243,6 +243,11 @@ erts_msg_distext2heap(Process *pp,
     Sint sz;
 
     *bpp = NULL;
+    if (is_nil(*tokenp)) {
+	dist_extp = erts_uncompress_dist_ext_copy(dist_extp);
+	if (!dist_extp)
+	    return THE_NON_VALUE;
+    }
     sz = erts_decode_dist_ext_size(dist_extp, 0);
     if (sz < 0)
 	goto decode_error;
@@ -363,7 +368,7 @@ erts_queue_dist_message(Process *rcvr,
 	/* Drop message if receiver is exiting or has a pending exit ... */
 	if (is_not_nil(token)) {
 	    ErlHeapFragment *heap_frag;
-	    heap_frag = erts_dist_ext_trailer(mp->data.dist_ext);
+	    heap_frag = erts_dist_ext_trailer(dist_ext);
 	    erts_cleanup_offheap(&heap_frag->off_heap);
 	}
 	erts_free_dist_ext_copy(dist_ext);
@@ -778,6 +783,11 @@ erts_msg_attached_data_size_aux(ErlMessage *msg)
     ASSERT(msg->data.dist_ext);
     ASSERT(msg->data.dist_ext->heap_size < 0);
 
+    if (is_nil(ERL_MESSAGE_TOKEN(msg))) {
+	msg->data.dist_ext = erts_uncompress_dist_ext_copy(msg->data.dist_ext);
+	if (!msg->data.dist_ext)
+	    return 0;
+    }
     sz = erts_decode_dist_ext_size(msg->data.dist_ext, 0);
     if (sz < 0) {
 	/* Bad external; remove it */
@@ -825,6 +835,65 @@ erts_move_msg_attached_data_to_heap(Eterm **hpp, ErlOffHeap *ohp, ErlMessage *ms
     /* else: bad external detected when calculating size */
 }
 
+#ifndef HYBRID
+/*
+ * Copy a message of msize words to the receiver and queue it.
+ */
+static void
+send_copied_message(Process* receiver,
+		    ErtsProcLocks *receiver_locks,
+		    Eterm message,
+		    Uint msize)
+{
+#ifdef ERTS_SMP
+    ErlOffHeap *ohp;
+    ErlHeapFragment* bp = NULL;
+    Eterm *hp;
+    hp = erts_alloc_message_heap(msize,&bp,&ohp,receiver,receiver_locks);
+    BM_SWAP_TIMER(send,copy);
+    message = copy_struct_shared(message, msize, &hp, ohp);
+    BM_MESSAGE_COPIED(msize);
+    BM_SWAP_TIMER(copy,send);
+    erts_queue_message(receiver, receiver_locks, bp, message, NIL);
+#else
+    ErlMessage* mp = message_alloc();
+    Eterm *hp;
+
+    if (FLAGS(receiver) & F_DISABLE_GC) {
+	/* Receiver heap may not be collected now; use a fragment */
+	hp = HAlloc(receiver, msize);
+    }
+    else {
+	if (receiver->stop - receiver->htop <= msize) {
+	    BM_SWAP_TIMER(send,system);
+	    erts_garbage_collect(receiver, msize, receiver->arg_reg, receiver->arity);
+	    BM_SWAP_TIMER(system,send);
+	}
+	hp = receiver->htop;
+	receiver->htop = hp + msize;
+    }
+    BM_SWAP_TIMER(send,copy);
+    message = copy_struct_shared(message, msize, &hp, &receiver->off_heap);
+    BM_MESSAGE_COPIED(msize);
+    BM_SWAP_TIMER(copy,send);
+    ERL_MESSAGE_TERM(mp) = message;
+    ERL_MESSAGE_TOKEN(mp) = NIL;
+    mp->next = NULL;
+    mp->data.attached = NULL;
+    LINK_MESSAGE(receiver, mp);
+
+    if (receiver->status == P_WAITING) {
+	erts_add_to_runq(receiver);
+    } else if (receiver->status == P_SUSPENDED) {
+	receiver->rstatus = P_RUNABLE;
+    }
+    if (IS_TRACED_FL(receiver, F_TRACE_RECEIVE)) {
+	trace_receive(receiver, message);
+    }
+#endif /* #ifndef ERTS_SMP */
+}
+#endif /* HYBRID */
+
 /*
  * Send a local message when sender & receiver processes are known.
  */
@@ -962,58 +1031,40 @@ erts_send_message(Process* sender,
         BM_SWAP_TIMER(send,system);
 	return;
     } else {
-#ifdef ERTS_SMP
-	ErlOffHeap *ohp;
-        Eterm *hp;
 	BM_SWAP_TIMER(send,size);
-	msize = size_object(message);
+	msize = size_object_shared(message);
 	BM_SWAP_TIMER(size,send);
-	hp = erts_alloc_message_heap(msize,&bp,&ohp,receiver,receiver_locks);
-	BM_SWAP_TIMER(send,copy);
-	message = copy_struct(message, msize, &hp, ohp);
-	BM_MESSAGE_COPIED(msz);
-	BM_SWAP_TIMER(copy,send);
-	erts_queue_message(receiver, receiver_locks, bp, message, token);
-        BM_SWAP_TIMER(send,system);
-#else
-	ErlMessage* mp = message_alloc();
-        Eterm *hp;
-        BM_SWAP_TIMER(send,size);
-	msize = size_object(message);
-        BM_SWAP_TIMER(size,send);
-	
-	if (receiver->stop - receiver->htop <= msize) {
-            BM_SWAP_TIMER(send,system);
-	    erts_garbage_collect(receiver, msize, receiver->arg_reg, receiver->arity);
-            BM_SWAP_TIMER(system,send);
-	}
-	hp = receiver->htop;
-	receiver->htop = hp + msize;
-        BM_SWAP_TIMER(send,copy);
-	message = copy_struct(message, msize, &hp, &receiver->off_heap);
-	BM_MESSAGE_COPIED(msize);
-        BM_SWAP_TIMER(copy,send);
-	ERL_MESSAGE_TERM(mp) = message;
-	ERL_MESSAGE_TOKEN(mp) = NIL;
-	mp->next = NULL;
-	mp->data.attached = NULL;
-	LINK_MESSAGE(receiver, mp);
-
-	if (receiver->status == P_WAITING) {
-	    erts_add_to_runq(receiver);
-	} else if (receiver->status == P_SUSPENDED) {
-	    receiver->rstatus = P_RUNABLE;
-	}
-	if (IS_TRACED_FL(receiver, F_TRACE_RECEIVE)) {
-	    trace_receive(receiver, message);
-	}
+	send_copied_message(receiver, receiver_locks, message, msize);
         BM_SWAP_TIMER(send,system);
-#endif /* #ifndef ERTS_SMP */
 	return;
 #endif /* HYBRID */
     }
 }
 
+/*
+ * Send a local message whose size, as given by size_object_shared(),
+ * the caller already knows. The sender must not have a sequential
+ * trace token, and must not be the receiver. Used when the same
+ * message is sent to many processes.
+ */
+
+void
+erts_send_message_sized(Process* sender,
+			Process* receiver,
+			ErtsProcLocks *receiver_locks,
+			Eterm message,
+			Uint msize)
+{
+    ASSERT(SEQ_TRACE_TOKEN(sender) == NIL);
+    ASSERT(sender != receiver);
+#ifdef HYBRID
+    erts_send_message(sender, receiver, receiver_locks, message, 0);
+#else
+    BM_MESSAGE(message,sender,receiver);
+    send_copied_message(receiver, receiver_locks, message, msize);
+#endif
+}
+
 /*
  * This function delivers an EXIT message to a process
  * which is trapping EXITs.
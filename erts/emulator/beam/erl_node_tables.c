@@ -74,31 +74,21 @@ dist_table_cmp(void *dep1, void *dep2)
 	    ? 0 : 1);
 }
 
-static void*
-dist_table_alloc(void *dep_tmpl)
+static void
+init_dist_entry(DistEntry *dep, Eterm sysname, char *lock_name)
 {
-    Eterm chnl_nr;
-    Eterm sysname;
-    DistEntry *dep;
-
-    if(((DistEntry *) dep_tmpl) == erts_this_dist_entry)
-	return dep_tmpl;
-
-    sysname = ((DistEntry *) dep_tmpl)->sysname;
-    chnl_nr = make_small((Uint) atom_val(sysname));
-    dep = (DistEntry *) erts_alloc(ERTS_ALC_T_DIST_ENTRY, sizeof(DistEntry));
-
-    dist_entries++;
+    Eterm chnl_nr = make_small((Uint) atom_val(sysname));
 
     dep->prev				= NULL;
-    erts_refc_init(&dep->refc, -1);
-    erts_smp_rwmtx_init_x(&dep->rwmtx, "dist_entry", chnl_nr);
+    erts_smp_rwmtx_init_x(&dep->rwmtx, lock_name, chnl_nr);
     dep->sysname			= sysname;
     dep->cid				= NIL;
     dep->connection_id			= 0;
     dep->status				= 0;
     dep->flags				= 0;
     dep->version			= 0;
+    dep->no_lanes			= 0;
+    dep->lanes				= NULL;
 
     erts_smp_mtx_init_x(&dep->lnk_mtx, "dist_entry_links", chnl_nr);
     dep->node_links			= NULL;
@@ -120,6 +110,41 @@ dist_table_alloc(void *dep_tmpl)
     erts_port_task_handle_init(&dep->dist_cmd);
     dep->send				= NULL;
     dep->cache				= NULL;
+    dep->frag_asm			= NULL;
+    dep->primary			= NULL;
+    sys_memzero((void *) &dep->stats, sizeof(ErtsDistStats));
+}
+
+static void
+destroy_dist_entry(DistEntry *dep)
+{
+    ASSERT(!dep->cache);
+    ASSERT(!dep->frag_asm);
+    ASSERT(!dep->lanes);
+    erts_smp_rwmtx_destroy(&dep->rwmtx);
+    erts_smp_mtx_destroy(&dep->lnk_mtx);
+    erts_smp_spinlock_destroy(&dep->qlock);
+
+#ifdef DEBUG
+    sys_memset((void *) dep, 0x77, sizeof(DistEntry));
+#endif
+    erts_free(ERTS_ALC_T_DIST_ENTRY, (void *) dep);
+}
+
+static void*
+dist_table_alloc(void *dep_tmpl)
+{
+    DistEntry *dep;
+
+    if(((DistEntry *) dep_tmpl) == erts_this_dist_entry)
+	return dep_tmpl;
+
+    dep = (DistEntry *) erts_alloc(ERTS_ALC_T_DIST_ENTRY, sizeof(DistEntry));
+
+    dist_entries++;
+
+    erts_refc_init(&dep->refc, -1);
+    init_dist_entry(dep, ((DistEntry *) dep_tmpl)->sysname, "dist_entry");
 
     /* Link in */
 
@@ -167,15 +192,7 @@ dist_table_free(void *vdep)
     ASSERT(erts_no_of_not_connected_dist_entries > 0);
     erts_no_of_not_connected_dist_entries--;
 
-    ASSERT(!dep->cache);
-    erts_smp_rwmtx_destroy(&dep->rwmtx);
-    erts_smp_mtx_destroy(&dep->lnk_mtx);
-    erts_smp_spinlock_destroy(&dep->qlock);
-
-#ifdef DEBUG
-    sys_memset(vdep, 0x77, sizeof(DistEntry));
-#endif
-    erts_free(ERTS_ALC_T_DIST_ENTRY, (void *) dep);
+    destroy_dist_entry(dep);
 
     ASSERT(dist_entries > 1);
     dist_entries--;
@@ -285,10 +302,40 @@ DistEntry *erts_find_dist_entry(Eterm sysname)
     return res;
 }
 
+/*
+ * A lane is an extra connection to the node of a dist entry (see
+ * dist.c). It is a dist entry of its own so that output queues, the
+ * atom cache, and port scheduling work as for ordinary connections,
+ * but it is not inserted in the dist table. It refers to the primary
+ * dist entry during its whole lifetime. The new lane has two references;
+ * one for its port and one for the lane array of the primary.
+ */
+DistEntry *
+erts_create_dist_lane(DistEntry *primary)
+{
+    DistEntry *dep;
+
+    ASSERT(primary != erts_this_dist_entry && !primary->primary);
+
+    dep = (DistEntry *) erts_alloc(ERTS_ALC_T_DIST_ENTRY, sizeof(DistEntry));
+    erts_refc_init(&dep->refc, 2);
+    init_dist_entry(dep, primary->sysname, "dist_lane");
+    erts_refc_inc(&primary->refc, 1);
+    dep->primary = primary;
+    dep->next = NULL;
+    return dep;
+}
+
 void erts_delete_dist_entry(DistEntry *dep)
 {
     ASSERT(dep != erts_this_dist_entry);
-    if(dep != erts_this_dist_entry) {
+    if (dep->primary) {
+	DistEntry *primary = dep->primary;
+	ASSERT(is_nil(dep->cid));
+	destroy_dist_entry(dep);
+	erts_deref_dist_entry(primary);
+    }
+    else if(dep != erts_this_dist_entry) {
 	erts_smp_rwmtx_rwlock(&erts_dist_table_rwmtx);
 	/*
 	 * Another thread might have looked up this dist entry after
@@ -432,6 +479,7 @@ erts_set_dist_entry_connected(DistEntry *dep, Eterm cid, Uint flags)
     dep->connection_id++;
     dep->connection_id &= ERTS_DIST_EXT_CON_ID_MASK;
     dep->prev = NULL;
+    sys_memzero((void *) &dep->stats, sizeof(ErtsDistStats));
 
     if(flags & DFLAG_PUBLISHED) {
 	dep->next = erts_visible_dist_entries;
@@ -728,6 +776,8 @@ void erts_init_node_tables(void)
     erts_this_dist_entry->status			= 0;
     erts_this_dist_entry->flags				= 0;
     erts_this_dist_entry->version			= 0;
+    erts_this_dist_entry->no_lanes			= 0;
+    erts_this_dist_entry->lanes				= NULL;
 
     erts_smp_mtx_init_x(&erts_this_dist_entry->lnk_mtx,
 			"dist_entry_links",
@@ -752,6 +802,9 @@ void erts_init_node_tables(void)
     erts_port_task_handle_init(&erts_this_dist_entry->dist_cmd);
     erts_this_dist_entry->send				= NULL;
     erts_this_dist_entry->cache				= NULL;
+    erts_this_dist_entry->frag_asm			= NULL;
+    erts_this_dist_entry->primary			= NULL;
+    sys_memzero((void *) &erts_this_dist_entry->stats, sizeof(ErtsDistStats));
 
     (void) hash_put(&erts_dist_table, (void *) erts_this_dist_entry);
 
@@ -1343,11 +1396,14 @@ setup_reference_table(void)
 	for(hfp = erts_port[i].bp; hfp; hfp = hfp->next)
 	    insert_offheap(&(hfp->off_heap), HEAP_REF, erts_port[i].id);
 	/* Insert controller */
-	if (erts_port[i].dist_entry)
-	    insert_dist_entry(erts_port[i].dist_entry,
+	if (erts_port[i].dist_entry) {
+	    DistEntry *dep = erts_port[i].dist_entry;
+	    /* A lane refers to its primary dist entry */
+	    insert_dist_entry(dep->primary ? dep->primary : dep,
 			      CTRL_REF,
 			      erts_port[i].id,
 			      0);
+	}
     }
 
     { /* Add binaries stored elsewhere ... */
@@ -67,6 +67,18 @@
 #define ERTS_DIST_OUTPUT_BUF_DBG_PATTERN ((Uint) 0xf713f713)
 #endif
 
+/*
+ * A large binary that a dist output buffer refers to instead of
+ * holding a copy of it. Its size bytes at bytes are written after the
+ * buffer's own data up to pos; the buffer holds a reference to bin.
+ */
+typedef struct {
+    byte *pos;
+    struct binary *bin;
+    byte *bytes;
+    Uint size;
+} ErtsDistOutputRef;
+
 typedef struct ErtsDistOutputBuf_ ErtsDistOutputBuf;
 struct ErtsDistOutputBuf_ {
 #ifdef DEBUG
@@ -75,6 +87,10 @@ struct ErtsDistOutputBuf_ {
     ErtsDistOutputBuf *next;
     byte *extp;
     byte *ext_endp;
+    ErtsDistOutputRef *refs;	/* Referred binaries, in data order */
+    Uint no_refs;
+    Uint refs_size;		/* Total size of referred binaries */
+    Uint64 enq_time;		/* When enqueued, in microseconds */
     byte data[1];
 };
 
@@ -89,6 +105,31 @@ typedef struct {
     struct ErtsProcList_ *last;
 } ErtsDistSuspended;
 
+/*
+ * Send latency histogram slot i counts signals written to the port
+ * less than 2^i microseconds after they were enqueued; the last slot
+ * counts the rest.
+ */
+#define ERTS_DIST_LATENCY_SLOTS 18
+
+/*
+ * Statistics of a connection; cleared when it is set up. They are
+ * read without locks.
+ */
+typedef struct {
+    /* Protected by qlock */
+    Uint64 encode_time;		/* Microseconds spent encoding signals */
+    Uint64 busy;		/* Times the connection became busy */
+    Sint max_qsize;
+    /* Protected by the port lock */
+    Uint64 out_msgs;
+    Uint64 out_bytes;
+    Uint64 in_msgs;
+    Uint64 in_bytes;
+    Uint64 decode_time;		/* Microseconds spent decoding signals */
+    Uint64 latency[ERTS_DIST_LATENCY_SLOTS];
+} ErtsDistStats;
+
 /*
  * Lock order:
  *   1. dist_entry->rwmtx
@@ -117,6 +158,8 @@ typedef struct dist_entry_ {
     Uint32 flags;		/* Distribution flags, like hidden, 
 				   atom cache etc. */
     unsigned long version;	/* Protocol version */
+    int no_lanes;		/* Number of extra connections */
+    struct dist_entry_ **lanes;	/* Extra connections, see dist.c */
 
 
     erts_smp_mtx_t lnk_mtx;     /* Protects node_links, nlinks, and
@@ -144,6 +187,13 @@ typedef struct dist_entry_ {
     Uint (*send)(struct port *prt, ErtsDistOutputBuf *obuf);
 
     struct cache* cache;	/* The atom cache */
+    struct ErtsDistFragAsm_ *frag_asm; /* Fragmented messages being
+					  reassembled; protected by
+					  the port lock */
+    struct dist_entry_ *primary; /* Dist entry of the node if this is an
+				    extra connection (lane) to it; lanes
+				    are not in the dist table */
+    ErtsDistStats stats;
 } DistEntry;
 
 typedef struct erl_node_ {
@@ -174,6 +224,7 @@ DistEntry *erts_channel_no_to_dist_entry(Uint);
 DistEntry *erts_sysname_to_connected_dist_entry(Eterm);
 DistEntry *erts_find_or_insert_dist_entry(Eterm);
 DistEntry *erts_find_dist_entry(Eterm);
+DistEntry *erts_create_dist_lane(DistEntry *);
 void erts_delete_dist_entry(DistEntry *);
 Uint erts_dist_table_size(void);
 void erts_dist_table_info(int, void *);
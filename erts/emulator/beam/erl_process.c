@@ -38,6 +38,7 @@
 #include "erl_instrument.h"
 #include "erl_threads.h"
 #include "erl_binary.h"
+#include "erl_spawn_site.h"
 
 #define ERTS_RUNQ_CHECK_BALANCE_REDS_PER_SCHED (2000*CONTEXT_REDS)
 #define ERTS_RUNQ_CALL_CHECK_BALANCE_REDS \
@@ -390,6 +391,16 @@ erts_pre_init_process(void)
      erts_psd_required_locks[ERTS_PSD_DIST_ENTRY].set_locks
 	 = ERTS_PSD_DIST_ENTRY_GET_LOCKS;
 
+     erts_psd_required_locks[ERTS_PSD_LITERAL_AREAS].get_locks
+	 = ERTS_PSD_LITERAL_AREAS_GET_LOCKS;
+     erts_psd_required_locks[ERTS_PSD_LITERAL_AREAS].set_locks
+	 = ERTS_PSD_LITERAL_AREAS_SET_LOCKS;
+
+     erts_psd_required_locks[ERTS_PSD_DIST_FRAG_SEND].get_locks
+	 = ERTS_PSD_DIST_FRAG_SEND_GET_LOCKS;
+     erts_psd_required_locks[ERTS_PSD_DIST_FRAG_SEND].set_locks
+	 = ERTS_PSD_DIST_FRAG_SEND_SET_LOCKS;
+
      /* Check that we have locks for all entries */
      for (ix = 0; ix < ERTS_PSD_SIZE; ix++) {
 	 ERTS_SMP_LC_ASSERT(erts_psd_required_locks[ix].get_locks);
@@ -6697,6 +6708,9 @@ erl_create_process(Process* parent, /* Parent of process (default group leader).
     p->initial[INITIAL_MOD] = mod;
     p->initial[INITIAL_FUN] = func;
     p->initial[INITIAL_ARI] = (Uint) arity;
+    p->spawn_site = (erts_spawn_site_heap_sizing
+		     ? erts_get_spawn_site(mod, func, args, (Uint) arity)
+		     : NULL);
 
     /*
      * Must initialize binary lists here before copying binaries to process.
@@ -6717,6 +6731,17 @@ erl_create_process(Process* parent, /* Parent of process (default group leader).
 	sz = erts_next_heap_size(heap_need, 0);
     }
 
+    /*
+     * Start out with the heap size that processes spawned here
+     * typically end up using.
+     */
+    if (p->spawn_site) {
+	Uint learned_sz = erts_spawn_site_heap_size(p->spawn_site);
+	if (learned_sz > sz) {
+	    sz = learned_sz;
+	}
+    }
+
 #ifdef HIPE
     hipe_init_process(&p->hipe);
 #ifdef ERTS_SMP
@@ -7029,6 +7054,7 @@ void erts_init_empty_process(Process *p)
     p->initial[0] = 0;
     p->initial[1] = 0;
     p->initial[2] = 0;
+    p->spawn_site = NULL;
     p->catches = 0;
     p->cp = NULL;
     p->i = NULL;
@@ -7199,6 +7225,14 @@ delete_process(Process* p)
 
     VERBOSE(DEBUG_PROCESSES, ("Removing process: %T\n",p->id));
 
+    if (p->spawn_site) {
+	Uint used = ((p->htop - p->heap)
+		     + (p->hend - p->stop)
+		     + (p->old_htop - p->old_heap)
+		     + MBUF_SIZE(p));
+	erts_spawn_site_sample(p->spawn_site, used);
+    }
+
     /* Cleanup psd */
 
     if (p->psd)
@@ -7264,7 +7298,7 @@ delete_process(Process* p)
 	    else {
 		if (is_not_nil(mp->m[1])) {
 		    ErlHeapFragment *heap_frag;
-		    heap_frag = (ErlHeapFragment *) mp->data.dist_ext->ext_endp;
+		    heap_frag = erts_dist_ext_trailer(mp->data.dist_ext);
 		    erts_cleanup_offheap(&heap_frag->off_heap);
 		}
 		erts_free_dist_ext_copy(mp->data.dist_ext);
@@ -7797,7 +7831,8 @@ static void doit_exit_monitor(ErtsMonitor *mon, void *vpcontext)
 						      ? rmon->name
 						      : rmon->pid),
 						     mon->ref,
-						     pcontext->reason);
+						     pcontext->reason,
+						     rmon->pid);
 			ASSERT(code == ERTS_DSIG_SEND_OK);
 		    }
 		    erts_destroy_monitor(rmon);
@@ -8061,6 +8096,7 @@ continue_exit_process(Process *p
     Eterm reason = p->fvalue;
     DistEntry *dep;
     struct saved_calls *scb;
+    ErtsLiteralAreaRef *lit_areas;
 #ifdef DEBUG
     int yield_allowed = 1;
 #endif
@@ -8073,6 +8109,15 @@ continue_exit_process(Process *p
     erts_smp_proc_unlock(p, ERTS_PROC_LOCK_STATUS);
 #endif
 
+    /*
+     * Fragments of a message that the process was sending have to be
+     * enqueued before its exit signals are sent on the connection.
+     */
+    if (ERTS_PROC_GET_DIST_FRAG_SEND(p)) {
+	if (!erts_dsig_send_frag_exiting(p))
+	    goto yield;
+    }
+
     if (p->flags & F_USING_DB) {
 	if (erts_db_process_exiting(p, ERTS_PROC_LOCK_MAIN))
 	    goto yield;
@@ -8179,6 +8224,7 @@ continue_exit_process(Process *p
 	   ? ERTS_PROC_SET_DIST_ENTRY(p, ERTS_PROC_LOCKS_ALL, NULL)
 	   : NULL);
     scb = ERTS_PROC_SET_SAVED_CALLS_BUF(p, ERTS_PROC_LOCKS_ALL, NULL);
+    lit_areas = ERTS_PROC_SET_LITERAL_AREAS(p, ERTS_PROC_LOCKS_ALL, NULL);
 
     erts_smp_proc_unlock(p, ERTS_PROC_LOCKS_ALL);
     processes_busy--;
@@ -8220,6 +8266,10 @@ continue_exit_process(Process *p
 
     delete_process(p);
 
+    /* Not until now is the heap gone; it may refer to the literals. */
+    if (lit_areas)
+	erts_release_literal_area_refs(lit_areas);
+
     erts_smp_proc_lock(p, ERTS_PROC_LOCK_MAIN);
     ERTS_SMP_CHK_HAVE_ONLY_MAIN_PROC_LOCK(p);
 
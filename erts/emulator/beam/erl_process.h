@@ -381,8 +381,10 @@ extern ErtsSchedulerData *erts_scheduler_data;
 #define ERTS_PSD_SAVED_CALLS_BUF		1
 #define ERTS_PSD_SCHED_ID			2
 #define ERTS_PSD_DIST_ENTRY			3
+#define ERTS_PSD_LITERAL_AREAS			4
+#define ERTS_PSD_DIST_FRAG_SEND			5
 
-#define ERTS_PSD_SIZE				4
+#define ERTS_PSD_SIZE				6
 
 typedef struct {
     void *data[ERTS_PSD_SIZE];
@@ -403,6 +405,12 @@ typedef struct {
 #define ERTS_PSD_DIST_ENTRY_GET_LOCKS ERTS_PROC_LOCK_MAIN
 #define ERTS_PSD_DIST_ENTRY_SET_LOCKS ERTS_PROC_LOCK_MAIN
 
+#define ERTS_PSD_LITERAL_AREAS_GET_LOCKS ERTS_PROC_LOCK_MAIN
+#define ERTS_PSD_LITERAL_AREAS_SET_LOCKS ERTS_PROC_LOCK_MAIN
+
+#define ERTS_PSD_DIST_FRAG_SEND_GET_LOCKS ERTS_PROC_LOCK_MAIN
+#define ERTS_PSD_DIST_FRAG_SEND_SET_LOCKS ERTS_PROC_LOCK_MAIN
+
 typedef struct {
     ErtsProcLocks get_locks;
     ErtsProcLocks set_locks;
@@ -560,6 +568,8 @@ struct process {
     Eterm seq_trace_token;	/* Sequential trace token (tuple size 5 see below) */
 
     Eterm initial[3];		/* Initial module(0), function(1), arity(2) */
+    struct ErtsSpawnSite_ *spawn_site; /* Spawn site for heap size
+					  learning (or NULL). */
     Eterm* current;		/* Current Erlang function:
 				 * module(0), function(1), arity(2)
 				 * (module and functions are tagged atoms;
@@ -794,6 +804,7 @@ extern struct erts_system_profile_flags_t erts_system_profile_flags;
 #define F_HAVE_BLCKD_MSCHED  (1 <<  8) /* Process has blocked multi-scheduling */
 #define F_P2PNR_RESCHED      (1 <<  9) /* Process has been rescheduled via erts_pid2proc_not_running() */
 #define F_FORCE_GC           (1 << 10) /* Force gc at process in-scheduling */
+#define F_DISABLE_GC         (1 << 11) /* A trapping BIF keeps pointers into the heap */
 
 /* process trace_flags */
 #define F_SENSITIVE          (1 << 0)
@@ -1171,6 +1182,16 @@ erts_psd_set(Process *p, ErtsProcLocks plocks, int ix, void *data)
 #define ERTS_PROC_SET_SAVED_CALLS_BUF(P, L, SCB) \
   ((struct saved_calls *) erts_psd_set((P), (L), ERTS_PSD_SAVED_CALLS_BUF, (void *) (SCB)))
 
+#define ERTS_PROC_GET_LITERAL_AREAS(P) \
+  ((struct ErtsLiteralAreaRef_ *) erts_psd_get((P), ERTS_PSD_LITERAL_AREAS))
+#define ERTS_PROC_SET_LITERAL_AREAS(P, L, R) \
+  ((struct ErtsLiteralAreaRef_ *) erts_psd_set((P), (L), ERTS_PSD_LITERAL_AREAS, (void *) (R)))
+
+#define ERTS_PROC_GET_DIST_FRAG_SEND(P) \
+  ((Binary *) erts_psd_get((P), ERTS_PSD_DIST_FRAG_SEND))
+#define ERTS_PROC_SET_DIST_FRAG_SEND(P, L, B) \
+  ((Binary *) erts_psd_set((P), (L), ERTS_PSD_DIST_FRAG_SEND, (void *) (B)))
+
 ERTS_GLB_INLINE Eterm erts_proc_get_error_handler(Process *p);
 ERTS_GLB_INLINE Eterm erts_proc_set_error_handler(Process *p,
 						  ErtsProcLocks plocks,
@@ -0,0 +1,360 @@
+/*
+ * %CopyrightBegin%
+ *
+ * Copyright Ericsson AB 2009. All Rights Reserved.
+ *
+ * The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved online at http://www.erlang.org/.
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * %CopyrightEnd%
+ */
+
+/*
+ * Description:	Published terms (see erl_shared_term.h).
+ *
+ *		The address ranges of all published terms are kept in
+ *		a table sorted on address, so that the message copying
+ *		code can tell whether a pointer points into a published
+ *		term. A term is removed from the table when it is
+ *		unpublished; this is done with the system blocked, so
+ *		that no message copying is in progress, and all
+ *		processes are then scanned for references to the term.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "sys.h"
+#include "erl_vm.h"
+#include "global.h"
+#include "erl_process.h"
+#include "error.h"
+#include "bif.h"
+#include "beam_load.h"
+#include "erl_gc.h"
+#include "erl_shared_term.h"
+
+typedef struct {
+    Eterm* start;		/* Start of the area. */
+    Eterm* end;			/* End of the area. */
+    Eterm term;			/* The published term. */
+    ErtsLiteralArea* area;
+} SharedTermRange;
+
+erts_smp_atomic_t erts_shared_terms;
+
+static SharedTermRange* shared_terms;
+static int allocated_shared_terms;
+static erts_smp_atomic_t shared_terms_size; /* Bytes in published terms. */
+static erts_smp_rwmtx_t shared_term_table_lock;
+
+void
+erts_init_shared_terms(void)
+{
+    erts_smp_rwmtx_init(&shared_term_table_lock, "shared_term_tab");
+    erts_smp_atomic_init(&erts_shared_terms, 0);
+    erts_smp_atomic_init(&shared_terms_size, 0);
+    allocated_shared_terms = 0;
+    shared_terms = NULL;
+}
+
+void
+erts_shared_terms_rlock(void)
+{
+    erts_smp_rwmtx_rlock(&shared_term_table_lock);
+}
+
+void
+erts_shared_terms_runlock(void)
+{
+    erts_smp_rwmtx_runlock(&shared_term_table_lock);
+}
+
+/*
+ * Find the published term that ptr points into. Returns its index
+ * in the table, or -1. The table lock must be held.
+ */
+static int
+lookup_shared_term(Eterm* ptr)
+{
+    int n = (int) erts_smp_atomic_read(&erts_shared_terms);
+    SharedTermRange* low = shared_terms;
+    SharedTermRange* high = low + n;
+
+    if (n == 0 || ptr < low->start || ptr >= high[-1].end) {
+	return -1;
+    }
+    while (low < high) {
+	SharedTermRange* mid = low + (high-low) / 2;
+	if (ptr < mid->start) {
+	    high = mid;
+	} else if (ptr >= mid->end) {
+	    low = mid + 1;
+	} else {
+	    return mid - shared_terms;
+	}
+    }
+    return -1;
+}
+
+/*
+ * Check whether ptr points into a published term. The table lock
+ * must be held (see erts_shared_terms_rlock()).
+ */
+int
+erts_is_shared_term_ptr(Eterm* ptr)
+{
+    return lookup_shared_term(ptr) >= 0;
+}
+
+Uint
+erts_shared_terms_size(void)
+{
+    return (Uint) erts_smp_atomic_read(&shared_terms_size);
+}
+
+/*
+ * Called when the last reference to the literal area of a published
+ * term is dropped (see erts_release_literal_area()).
+ */
+void
+erts_free_shared_term_area(ErtsLiteralArea* area)
+{
+    ASSERT(area->shared);
+    erts_cleanup_offheap(&area->off_heap);
+    erts_smp_atomic_add(&shared_terms_size,
+			-((long) ERTS_LITERAL_AREA_ALLOC_SIZE(area->size)));
+    erts_free(ERTS_ALC_T_SHARED_TERM, (void *) area);
+}
+
+static void
+insert_shared_term(ErtsLiteralArea* area, Eterm term)
+{
+    int n;
+    int i;
+
+    erts_smp_rwmtx_rwlock(&shared_term_table_lock);
+    n = (int) erts_smp_atomic_read(&erts_shared_terms);
+    if (n == allocated_shared_terms) {
+	if (!shared_terms) {
+	    allocated_shared_terms = 16;
+	    shared_terms = (SharedTermRange *)
+		erts_alloc(ERTS_ALC_T_SHARED_TERM_TAB,
+			   allocated_shared_terms*sizeof(SharedTermRange));
+	}
+	else {
+	    allocated_shared_terms *= 2;
+	    shared_terms = (SharedTermRange *)
+		erts_realloc(ERTS_ALC_T_SHARED_TERM_TAB,
+			     (void *) shared_terms,
+			     allocated_shared_terms*sizeof(SharedTermRange));
+	}
+    }
+    for (i = n; i > 0 && shared_terms[i-1].start > area->start; i--) {
+	shared_terms[i] = shared_terms[i-1];
+    }
+    shared_terms[i].start = area->start;
+    shared_terms[i].end = area->start + area->size;
+    shared_terms[i].term = term;
+    shared_terms[i].area = area;
+    erts_smp_atomic_inc(&erts_shared_terms);
+    erts_smp_rwmtx_rwunlock(&shared_term_table_lock);
+}
+
+static int
+any_ptrs_in_area(Eterm* start, Eterm* end, char* area, Uint area_size)
+{
+    Eterm* p;
+
+    for (p = start; p < end; p++) {
+	switch (primary_tag(*p)) {
+	case TAG_PRIMARY_BOXED:
+	case TAG_PRIMARY_LIST:
+	    if (in_area(ptr_val(*p), area, area_size)) {
+		return 1;
+	    }
+	    break;
+	}
+    }
+    return 0;
+}
+
+static int
+any_refs_in_area(Eterm* start, Eterm* end, char* area, Uint area_size)
+{
+    Eterm* p;
+    Eterm val;
+
+    for (p = start; p < end; p++) {
+	val = *p;
+	switch (primary_tag(val)) {
+	case TAG_PRIMARY_BOXED:
+	case TAG_PRIMARY_LIST:
+	    if (in_area(ptr_val(val), area, area_size)) {
+		return 1;
+	    }
+	    break;
+	case TAG_PRIMARY_HEADER:
+	    if (!header_is_transparent(val)) {
+		p += thing_arityval(val);
+	    }
+	    break;
+	}
+    }
+    return 0;
+}
+
+/*
+ * Check whether the process refers to the area anywhere. The system
+ * must be blocked.
+ */
+static int
+refers_to_area(Process* rp, char* area, Uint area_size)
+{
+    ErlHeapFragment* bp;
+    ErlMessage* mp;
+
+    if (any_ptrs_in_area(&rp->fvalue, &rp->fvalue+1, area, area_size)
+	|| any_ptrs_in_area(&rp->ftrace, &rp->ftrace+1, area, area_size)
+	|| any_ptrs_in_area(&rp->seq_trace_token, &rp->seq_trace_token+1,
+			    area, area_size)
+	|| any_ptrs_in_area(rp->arg_reg, rp->arg_reg+rp->arity,
+			    area, area_size)
+	|| any_ptrs_in_area(rp->stop, rp->hend, area, area_size)
+	|| any_refs_in_area(rp->heap, rp->htop, area, area_size)
+	|| any_refs_in_area(rp->old_heap, rp->old_htop, area, area_size)) {
+	return 1;
+    }
+    if (rp->dictionary != NULL) {
+	Eterm* start = rp->dictionary->data;
+	Eterm* end = start + rp->dictionary->used;
+
+	if (any_ptrs_in_area(start, end, area, area_size)) {
+	    return 1;
+	}
+    }
+    for (bp = rp->mbuf; bp != NULL; bp = bp->next) {
+	if (any_refs_in_area(bp->mem, bp->mem+bp->size, area, area_size)) {
+	    return 1;
+	}
+    }
+
+    /*
+     * The in queue is only moved to the private queue by the process
+     * itself; move it here so that the garbage collection that copies
+     * the term will see all messages.
+     */
+    ERTS_SMP_MSGQ_MV_INQ2PRIVQ(rp);
+    for (mp = rp->msg.first; mp != NULL; mp = mp->next) {
+	if (any_ptrs_in_area(mp->m, mp->m+2, area, area_size)) {
+	    return 1;
+	}
+	if (mp->data.attached && is_value(ERL_MESSAGE_TERM(mp))) {
+	    bp = mp->data.heap_frag;
+	    if (any_refs_in_area(bp->mem, bp->mem+bp->size, area, area_size)) {
+		return 1;
+	    }
+	}
+    }
+    return 0;
+}
+
+BIF_RETTYPE publish_term_1(BIF_ALIST_1)
+{
+    ErtsLiteralArea* area;
+    Uint sz;
+    Eterm* hp;
+    Eterm res;
+
+    if (IS_CONST(BIF_ARG_1)) {
+	BIF_RET(BIF_ARG_1);
+    }
+
+    /*
+     * Always make a full copy, also of published terms within the term,
+     * so that the new area does not depend on any other area.
+     */
+    sz = size_object(BIF_ARG_1);
+    area = (ErtsLiteralArea *) erts_alloc(ERTS_ALC_T_SHARED_TERM,
+					  ERTS_LITERAL_AREA_ALLOC_SIZE(sz));
+    erts_refc_init(&area->refc, 1);
+    area->shared = 1;
+    area->off_heap.mso = NULL;
+#ifndef HYBRID /* FIND ME! */
+    area->off_heap.funs = NULL;
+#endif
+    area->off_heap.externals = NULL;
+    area->off_heap.overhead = 0;
+    area->size = sz;
+    erts_smp_atomic_add(&shared_terms_size, ERTS_LITERAL_AREA_ALLOC_SIZE(sz));
+
+    hp = area->start;
+    res = copy_struct(BIF_ARG_1, sz, &hp, &area->off_heap);
+    insert_shared_term(area, res);
+    BIF_RET(res);
+}
+
+BIF_RETTYPE unpublish_term_1(BIF_ALIST_1)
+{
+    ErtsLiteralArea* area = NULL;
+    char* area_start;
+    Uint area_size;
+    Uint i;
+    int ix;
+    int n;
+
+    if (IS_CONST(BIF_ARG_1)) {
+	BIF_ERROR(BIF_P, BADARG);
+    }
+
+    /*
+     * With the system blocked no process can be in the middle of
+     * copying a message, so no copy can have been sized with the term
+     * treated as shared and then copied with it treated as not shared.
+     */
+    erts_smp_proc_unlock(BIF_P, ERTS_PROC_LOCK_MAIN);
+    erts_smp_block_system(0);
+
+    erts_smp_rwmtx_rwlock(&shared_term_table_lock);
+    ix = lookup_shared_term(ptr_val(BIF_ARG_1));
+    if (ix >= 0 && shared_terms[ix].term == BIF_ARG_1) {
+	area = shared_terms[ix].area;
+	n = (int) erts_smp_atomic_read(&erts_shared_terms);
+	for ( ; ix < n - 1; ix++) {
+	    shared_terms[ix] = shared_terms[ix+1];
+	}
+	erts_smp_atomic_dec(&erts_shared_terms);
+    }
+    erts_smp_rwmtx_rwunlock(&shared_term_table_lock);
+
+    if (area != NULL) {
+	area_start = (char *) area->start;
+	area_size = area->size * sizeof(Eterm);
+	for (i = 0; i < erts_max_processes; i++) {
+	    Process* rp = process_tab[i];
+	    if (rp != NULL && refers_to_area(rp, area_start, area_size)) {
+		erts_smp_proc_lock(rp, ERTS_PROC_LOCK_MAIN);
+		erts_proc_ref_literal_area(rp, area);
+		erts_smp_proc_unlock(rp, ERTS_PROC_LOCK_MAIN);
+	    }
+	}
+    }
+
+    erts_smp_release_system();
+    erts_smp_proc_lock(BIF_P, ERTS_PROC_LOCK_MAIN);
+
+    if (area == NULL) {
+	BIF_ERROR(BIF_P, BADARG);
+    }
+    erts_release_literal_area(area);
+    BIF_RET(am_true);
+}
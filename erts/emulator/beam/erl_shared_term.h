@@ -0,0 +1,49 @@
+/*
+ * %CopyrightBegin%
+ *
+ * Copyright Ericsson AB 2009. All Rights Reserved.
+ *
+ * The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved online at http://www.erlang.org/.
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * %CopyrightEnd%
+ */
+
+/*
+ * Published terms.
+ *
+ * erlang:publish_term/1 copies a term into a reference counted literal
+ * area of its own. The term can then be sent to any number of local
+ * processes without being copied; the receivers read it in place, and
+ * the garbage collector treats it like module literals. When the term
+ * is unpublished, processes still referring to it take a reference to
+ * the area and copy what they use into their heaps at their next
+ * garbage collection (like literals of a purged module).
+ */
+
+#ifndef ERL_SHARED_TERM_H__
+#define ERL_SHARED_TERM_H__
+
+#include "sys.h"
+#include "erl_smp.h"
+
+extern erts_smp_atomic_t erts_shared_terms; /* Number of published terms. */
+
+#define erts_have_shared_terms() \
+  (erts_smp_atomic_read(&erts_shared_terms) != 0)
+
+void erts_init_shared_terms(void);
+void erts_shared_terms_rlock(void);
+void erts_shared_terms_runlock(void);
+int erts_is_shared_term_ptr(Eterm* ptr);
+Uint erts_shared_terms_size(void);
+
+#endif /* ERL_SHARED_TERM_H__ */
@@ -0,0 +1,362 @@
+/*
+ * %CopyrightBegin%
+ *
+ * Copyright Ericsson AB 2009. All Rights Reserved.
+ *
+ * The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved online at http://www.erlang.org/.
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * %CopyrightEnd%
+ */
+
+/*
+ * Description:	Heap sizes learned per spawn site (see erl_spawn_site.h).
+ *
+ *		A spawn site is identified by the function that the
+ *		process is spawned to run. Processes spawned through
+ *		erlang:apply/2 with a fun, or through proc_lib, are
+ *		identified by the function they eventually run, not by
+ *		the trampoline.
+ *
+ *		Entries are never removed (there is a bounded number of
+ *		spawn sites in the loaded code), so processes can keep
+ *		pointers to them without any locking. The averages are
+ *		updated with atomic operations only; the table lock is
+ *		only needed when looking up or creating entries.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "sys.h"
+#include "erl_vm.h"
+#include "global.h"
+#include "erl_process.h"
+#include "erl_fun.h"
+#include "erl_spawn_site.h"
+
+/* Max number of spawn sites to keep track of. */
+#define ERTS_SPAWN_SITE_MAX_ENTRIES	4096
+
+/* The learned heap size never exceeds this number of words. */
+#define ERTS_SPAWN_SITE_MAX_HEAP_SIZE	(1 << 20)
+
+/* Weight of a new sample in the decaying average is 1/N. */
+#define ERTS_SPAWN_SITE_DECAY		8
+
+int erts_spawn_site_heap_sizing;
+
+static Hash spawn_site_table;
+static int spawn_site_entries;
+static erts_smp_rwmtx_t spawn_site_table_lock;
+
+#define spawn_site_read_lock()	  erts_smp_rwmtx_rlock(&spawn_site_table_lock)
+#define spawn_site_read_unlock()  erts_smp_rwmtx_runlock(&spawn_site_table_lock)
+#define spawn_site_write_lock()	  erts_smp_rwmtx_rwlock(&spawn_site_table_lock)
+#define spawn_site_write_unlock() erts_smp_rwmtx_rwunlock(&spawn_site_table_lock)
+
+static HashValue
+spawn_site_hash(ErtsSpawnSite* obj)
+{
+    return (HashValue) ((atom_val(obj->module) * 31
+			 + atom_val(obj->function)) * 31
+			+ obj->arity);
+}
+
+static int
+spawn_site_cmp(ErtsSpawnSite* obj1, ErtsSpawnSite* obj2)
+{
+    return !(obj1->module == obj2->module
+	     && obj1->function == obj2->function
+	     && obj1->arity == obj2->arity);
+}
+
+static ErtsSpawnSite*
+spawn_site_alloc(ErtsSpawnSite* template)
+{
+    ErtsSpawnSite* obj = (ErtsSpawnSite *)
+	erts_alloc(ERTS_ALC_T_SPAWN_SITE, sizeof(ErtsSpawnSite));
+
+    obj->module = template->module;
+    obj->function = template->function;
+    obj->arity = template->arity;
+    erts_smp_atomic_init(&obj->heap_size, 0);
+    erts_smp_atomic_init(&obj->samples, 0);
+    spawn_site_entries++;
+    return obj;
+}
+
+static void
+spawn_site_free(ErtsSpawnSite* obj)
+{
+    erts_free(ERTS_ALC_T_SPAWN_SITE, (void *) obj);
+}
+
+void
+erts_init_spawn_sites(void)
+{
+    HashFunctions f;
+
+    erts_smp_rwmtx_init(&spawn_site_table_lock, "spawn_site_tab");
+    f.hash = (H_FUN) spawn_site_hash;
+    f.cmp  = (HCMP_FUN) spawn_site_cmp;
+    f.alloc = (HALLOC_FUN) spawn_site_alloc;
+    f.free = (HFREE_FUN) spawn_site_free;
+
+    hash_init(ERTS_ALC_T_SPAWN_SITE_TABLE, &spawn_site_table,
+	      "spawn_site_table", 64, f);
+    spawn_site_entries = 0;
+}
+
+/*
+ * Find the function that a fun will run. Returns 0 if it is unknown
+ * (e.g. the code for a local fun is not loaded).
+ */
+static int
+fun_mfa(Eterm fun, ErtsSpawnSite* template)
+{
+    Eterm* mfa;
+
+    if (is_export(fun)) {
+	Export* ep = (Export *) (export_val(fun))[1];
+	mfa = ep->code;
+    } else if (is_fun(fun)) {
+	ErlFunThing* funp = (ErlFunThing *) fun_val(fun);
+	mfa = find_function_from_pc(funp->fe->address);
+	if (mfa == NULL) {
+	    return 0;
+	}
+    } else {
+	return 0;
+    }
+    template->module = mfa[0];
+    template->function = mfa[1];
+    template->arity = (Uint) mfa[2];
+    return 1;
+}
+
+/*
+ * Look through the trampolines that processes commonly are spawned
+ * through, and pick up the function that will actually be run.
+ */
+static void
+spawn_site_mfa(Eterm mod, Eterm func, Eterm args, Uint arity,
+	       ErtsSpawnSite* template)
+{
+    Eterm* argv[5];
+    Uint i;
+
+    template->module = mod;
+    template->function = func;
+    template->arity = arity;
+
+    if (arity > 5) {
+	return;
+    }
+    for (i = 0; i < arity; i++) {
+	argv[i] = list_val(args);
+	args = CDR(argv[i]);
+    }
+
+#define ARG(N) CAR(argv[(N)])
+
+    if (mod == am_erlang && func == am_apply && arity == 2) {
+	/* spawn(Fun) and friends */
+	(void) fun_mfa(ARG(0), template);
+    } else if (mod == am_proc_lib && func == am_init_p) {
+	if (arity == 3) {
+	    /* proc_lib:init_p(Parent, Ancestors, Fun) */
+	    (void) fun_mfa(ARG(2), template);
+	} else if (arity == 5
+		   && is_atom(ARG(2))
+		   && is_atom(ARG(3))) {
+	    /* proc_lib:init_p(Parent, Ancestors, M, F, A) */
+	    Sint len = list_length(ARG(4));
+	    if (len >= 0) {
+		template->module = ARG(2);
+		template->function = ARG(3);
+		template->arity = (Uint) len;
+	    }
+	}
+    }
+
+#undef ARG
+}
+
+/*
+ * Get the spawn site entry for a process about to be spawned. A new
+ * entry is created unless the table is full, in which case NULL is
+ * returned.
+ */
+ErtsSpawnSite*
+erts_get_spawn_site(Eterm mod, Eterm func, Eterm args, Uint arity)
+{
+    ErtsSpawnSite template;
+    ErtsSpawnSite* ssp;
+
+    spawn_site_mfa(mod, func, args, arity, &template);
+
+    spawn_site_read_lock();
+    ssp = (ErtsSpawnSite *) hash_get(&spawn_site_table, (void *) &template);
+    spawn_site_read_unlock();
+
+    if (ssp == NULL) {
+	spawn_site_write_lock();
+	if (spawn_site_entries < ERTS_SPAWN_SITE_MAX_ENTRIES) {
+	    ssp = (ErtsSpawnSite *) hash_put(&spawn_site_table,
+					     (void *) &template);
+	} else {
+	    ssp = (ErtsSpawnSite *) hash_get(&spawn_site_table,
+					     (void *) &template);
+	}
+	spawn_site_write_unlock();
+    }
+    return ssp;
+}
+
+/*
+ * Initial heap size (in words) to use for a process spawned at the
+ * spawn site, or 0 if nothing has been learned yet.
+ */
+Uint
+erts_spawn_site_heap_size(ErtsSpawnSite* ssp)
+{
+    Uint sz = (Uint) erts_smp_atomic_read(&ssp->heap_size);
+
+    if (sz == 0) {
+	return 0;
+    }
+    /* Leave some room so that an average process never has to GC. */
+    return erts_next_heap_size(sz + sz/8, 0);
+}
+
+/*
+ * Fold the number of words used by an exiting process into the
+ * average of its spawn site. Concurrent updates may occasionally lose
+ * a sample, which is of no consequence for an average.
+ */
+void
+erts_spawn_site_sample(ErtsSpawnSite* ssp, Uint words)
+{
+    long old;
+    long new;
+
+    if (words > ERTS_SPAWN_SITE_MAX_HEAP_SIZE) {
+	words = ERTS_SPAWN_SITE_MAX_HEAP_SIZE;
+    }
+    old = erts_smp_atomic_read(&ssp->heap_size);
+    if (erts_smp_atomic_inctest(&ssp->samples) == 1) {
+	new = (long) words;
+    } else {
+	new = old + ((long) words - old) / ERTS_SPAWN_SITE_DECAY;
+    }
+    (void) erts_smp_atomic_cmpxchg(&ssp->heap_size, new, old);
+}
+
+static void
+reset_spawn_site(void* obj, void* unused)
+{
+    ErtsSpawnSite* ssp = (ErtsSpawnSite *) obj;
+    erts_smp_atomic_set(&ssp->heap_size, 0);
+    erts_smp_atomic_set(&ssp->samples, 0);
+}
+
+void
+erts_reset_spawn_sites(void)
+{
+    spawn_site_read_lock();
+    hash_foreach(&spawn_site_table, reset_spawn_site, NULL);
+    spawn_site_read_unlock();
+}
+
+typedef struct {
+    Eterm module;
+    Eterm function;
+    Uint arity;
+    Uint heap_size;
+    Uint samples;
+} SpawnSiteSnapshot;
+
+typedef struct {
+    SpawnSiteSnapshot* vec;
+    int ix;
+} SpawnSiteSnapshotCtx;
+
+static void
+snapshot_spawn_site(void* obj, void* vctx)
+{
+    ErtsSpawnSite* ssp = (ErtsSpawnSite *) obj;
+    SpawnSiteSnapshotCtx* ctx = (SpawnSiteSnapshotCtx *) vctx;
+    SpawnSiteSnapshot* snap;
+
+    if (erts_smp_atomic_read(&ssp->samples) == 0) {
+	return;
+    }
+    snap = &ctx->vec[ctx->ix++];
+    snap->module = ssp->module;
+    snap->function = ssp->function;
+    snap->arity = ssp->arity;
+    snap->heap_size = (Uint) erts_smp_atomic_read(&ssp->heap_size);
+    snap->samples = (Uint) erts_smp_atomic_read(&ssp->samples);
+}
+
+/*
+ * Build [{{Module, Function, Arity}, HeapSize, Samples}] for all
+ * spawn sites that have learned something.
+ */
+Eterm
+erts_spawn_site_info(Process* c_p)
+{
+    SpawnSiteSnapshotCtx ctx;
+    Eterm res = NIL;
+    Uint sz;
+    Uint* hp;
+    Uint** hpp;
+    Uint* szp;
+    int i;
+
+    spawn_site_read_lock();
+    ctx.ix = 0;
+    ctx.vec = (SpawnSiteSnapshot *)
+	erts_alloc(ERTS_ALC_T_TMP,
+		   (spawn_site_entries + 1)*sizeof(SpawnSiteSnapshot));
+    hash_foreach(&spawn_site_table, snapshot_spawn_site, (void *) &ctx);
+    spawn_site_read_unlock();
+
+    sz = 0;
+    szp = &sz;
+    hpp = NULL;
+    while (1) {
+	res = NIL;
+	for (i = ctx.ix - 1; i >= 0; i--) {
+	    SpawnSiteSnapshot* snap = &ctx.vec[i];
+	    Eterm mfa = erts_bld_tuple(hpp, szp, 3,
+				       snap->module,
+				       snap->function,
+				       make_small(snap->arity));
+	    Eterm tpl = erts_bld_tuple(hpp, szp, 3,
+				       mfa,
+				       erts_bld_uint(hpp, szp, snap->heap_size),
+				       erts_bld_uint(hpp, szp, snap->samples));
+	    res = erts_bld_cons(hpp, szp, tpl, res);
+	}
+	if (hpp) {
+	    break;
+	}
+	hp = HAlloc(c_p, sz);
+	szp = NULL;
+	hpp = &hp;
+    }
+
+    erts_free(ERTS_ALC_T_TMP, (void *) ctx.vec);
+    return res;
+}
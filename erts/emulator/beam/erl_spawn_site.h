@@ -0,0 +1,59 @@
+/*
+ * %CopyrightBegin%
+ *
+ * Copyright Ericsson AB 2009. All Rights Reserved.
+ *
+ * The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved online at http://www.erlang.org/.
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * %CopyrightEnd%
+ */
+
+/*
+ * Heap sizes learned per spawn site.
+ *
+ * When enabled (+hss true or erlang:system_flag(spawn_site_heap_sizing,
+ * true)), the amount of heap used by each process when it exits is
+ * folded into a decaying average kept for the function the process was
+ * spawned to run. New processes spawned to run the same function get an
+ * initial heap large enough to hold that average, so that processes
+ * that die young do not have to garbage collect their way up to their
+ * typical size.
+ */
+
+#ifndef ERL_SPAWN_SITE_H__
+#define ERL_SPAWN_SITE_H__
+
+#include "sys.h"
+#include "hash.h"
+#include "erl_smp.h"
+#include "erl_process.h"
+
+typedef struct ErtsSpawnSite_ {
+    HashBucket bucket;		/* MUST BE LOCATED AT TOP OF STRUCT!!! */
+    Eterm module;		/* Tagged atom for module. */
+    Eterm function;		/* Tagged atom for function. */
+    Uint arity;			/* Arity of function. */
+    erts_smp_atomic_t heap_size; /* Decaying average of words used. */
+    erts_smp_atomic_t samples;	/* Number of exited processes seen. */
+} ErtsSpawnSite;
+
+extern int erts_spawn_site_heap_sizing;
+
+void erts_init_spawn_sites(void);
+ErtsSpawnSite *erts_get_spawn_site(Eterm mod, Eterm func, Eterm args,
+				   Uint arity);
+Uint erts_spawn_site_heap_size(ErtsSpawnSite *ssp);
+void erts_spawn_site_sample(ErtsSpawnSite *ssp, Uint words);
+void erts_reset_spawn_sites(void);
+Eterm erts_spawn_site_info(Process *c_p);
+
+#endif /* ERL_SPAWN_SITE_H__ */
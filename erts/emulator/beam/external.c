@@ -42,6 +42,7 @@
 #include "erl_binary.h"
 #include "erl_bits.h"
 #include "erl_zlib.h"
+#include "erl_lz.h"
 
 #ifdef HIPE
 #include "hipe_mode_switch.h"
@@ -85,17 +86,46 @@
  *
  */
 
+/* Copying this many bytes counts as one loop */
+#define ERTS_EXT_BYTES_PER_LOOP 64
+
+/* State of a yielding decoded_size() */
+typedef struct {
+    byte *ep;
+    Sint heap_size;
+    int terms;
+    int atom_extra_skip;
+    Sint reds;
+} B2TSizeContext;
+
+/* State of a yielding dec_term(); next is non-NULL when it has yielded */
+typedef struct {
+    byte *ep;
+    Eterm *next;
+    Sint reds;
+} B2TDecodeContext;
+
+#define B2T_YIELD ((Sint) -2)
+
 static byte* enc_term(ErtsAtomCacheMap *, Eterm, byte*, Uint32);
+static int enc_term_int(ErtsExtEncodeContext *, ErtsAtomCacheMap *, Eterm,
+			byte*, Uint32, ErtsExtBinRefs *, Sint *, byte **);
 static Uint is_external_string(Eterm obj, int* p_is_string);
 static byte* enc_atom(ErtsAtomCacheMap *, Eterm, byte*, Uint32);
 static byte* enc_pid(ErtsAtomCacheMap *, Eterm, byte*, Uint32);
-static byte* dec_term(ErtsDistExternal *, Eterm**, byte*, ErlOffHeap*, Eterm*);
+static byte* dec_term(ErtsDistExternal *, Eterm**, byte*, ErlOffHeap*, Eterm*,
+		      B2TDecodeContext *);
 static byte* dec_atom(ErtsDistExternal *, byte*, Eterm*);
 static byte* dec_pid(ErtsDistExternal *, Eterm**, byte*, ErlOffHeap*, Eterm*);
-static Sint decoded_size(byte *ep, byte* endp, int only_heap_bins);
+static Sint decoded_size(byte *ep, byte* endp, int only_heap_bins,
+			 B2TSizeContext *);
+static void bad_dist_ext(ErtsDistExternal *);
 
 
 static Uint encode_size_struct2(ErtsAtomCacheMap *, Eterm, unsigned);
+static int encode_size_struct_int(ErtsExtSizeContext *, ErtsAtomCacheMap *,
+				  Eterm, unsigned, ErtsExtBinRefs *,
+				  Sint *, Uint *);
 
 #define ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES 255
 
@@ -108,37 +138,28 @@ static Uint encode_size_struct2(ErtsAtomCacheMap *, Eterm, unsigned);
 
 #define ERTS_DIST_HDR_LONG_ATOMS_FLG (1 << 0)
 
-/* #define ERTS_ATOM_CACHE_HASH */
-#define ERTS_USE_ATOM_CACHE_SIZE 2039
-#if ERTS_ATOM_CACHE_SIZE < ERTS_USE_ATOM_CACHE_SIZE
-#error "ERTS_USE_ATOM_CACHE_SIZE too large"
+#if (ERTS_ATOM_CACHE_SETS & (ERTS_ATOM_CACHE_SETS-1)) != 0
+#error "ERTS_ATOM_CACHE_SETS not a power of two"
 #endif
 
 static ERTS_INLINE int
-atom2cix(Eterm atom)
+atom2set(Eterm atom)
 {
-    Uint val;
     ASSERT(is_atom(atom));
-    val = atom_val(atom);
-#ifdef ERTS_ATOM_CACHE_HASH
-    val = atom_tab(val)->slot.bucket.hvalue;
-#endif
-#if ERTS_USE_ATOM_CACHE_SIZE == 256
-    return (int) (val & ((Uint) 0xff));
-#else
-    return (int) (val % ERTS_USE_ATOM_CACHE_SIZE);
-#endif
+    return (int) (atom_val(atom) & (ERTS_ATOM_CACHE_SETS-1));
 }
 
+/* The "out cache index" of an atom is the set it is placed in */
+
 int erts_debug_max_atom_out_cache_index(void)
 {
-    return ERTS_USE_ATOM_CACHE_SIZE-1;
+    return ERTS_ATOM_CACHE_SETS-1;
 }
 
 int
 erts_debug_atom_to_out_cache_index(Eterm atom)
 {
-    return atom2cix(atom);
+    return atom2set(atom);
 }
 
 void
@@ -178,13 +199,29 @@ erts_destroy_atom_cache_map(ErtsAtomCacheMap *acmp)
 
 }
 
+/*
+ * The map is an open addressed hash table; it never holds more than
+ * ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES of its ERTS_ATOM_CACHE_SIZE slots,
+ * so probe sequences stay short.
+ */
+static ERTS_INLINE int
+acache_map_ix(ErtsAtomCacheMap *acmp, Eterm atom)
+{
+    int ix;
+    ASSERT(is_atom(atom));
+    ix = (int) (atom_val(atom) & (ERTS_ATOM_CACHE_SIZE-1));
+    while (acmp->cache[ix].iix >= 0 && acmp->cache[ix].atom != atom)
+	ix = (ix + 1) & (ERTS_ATOM_CACHE_SIZE-1);
+    return ix;
+}
+
 static ERTS_INLINE void
 insert_acache_map(ErtsAtomCacheMap *acmp, Eterm atom)
 {
     if (acmp && acmp->sz < ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES) {
 	int ix;
 	ASSERT(acmp->hdr_sz < 0);
-	ix = atom2cix(atom);
+	ix = acache_map_ix(acmp, atom);
 	if (acmp->cache[ix].iix < 0) {
 	    acmp->cache[ix].iix = acmp->sz;
 	    acmp->cix[acmp->sz++] = ix;
@@ -199,20 +236,66 @@ get_iix_acache_map(ErtsAtomCacheMap *acmp, Eterm atom)
     if (!acmp)
 	return -1;
     else {
-	int ix;
-	ASSERT(is_atom(atom));
-	ix = atom2cix(atom);
+	int ix = acache_map_ix(acmp, atom);
 	if (acmp->cache[ix].iix < 0) {
 	    ASSERT(acmp->sz == ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES);
 	    return -1;
 	}
 	else {
-	    ASSERT(acmp->cache[ix].iix < ERTS_ATOM_CACHE_SIZE);
-	    return acmp->cache[ix].atom == atom ? acmp->cache[ix].iix : -1;
+	    ASSERT(acmp->cache[ix].iix < ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES);
+	    ASSERT(acmp->cache[ix].atom == atom);
+	    return acmp->cache[ix].iix;
 	}
     }
 }
 
+/*
+ * Returns the output cache index to use for an atom in the dist header
+ * being written, and whether the receiver already has the atom there.
+ * On a miss the least recently used entry of the atom's set is replaced.
+ * Entries already used by the header (out_used == clock) are never
+ * replaced, since each atom of a header needs an index of its own; if
+ * all entries of the set are taken, an entry of a following set is used.
+ */
+static ERTS_INLINE int
+get_out_cache_ix(ErtsAtomCache *cache, Eterm atom, Uint32 clock, int *hitp)
+{
+    int base = atom2set(atom)*ERTS_ATOM_CACHE_WAYS;
+    int ix, victim = -1;
+    Uint32 victim_age = 0;
+
+    for (ix = base; ix < base + ERTS_ATOM_CACHE_WAYS; ix++) {
+	Uint32 age;
+	if (cache->out_arr[ix] == atom) {
+	    cache->out_used[ix] = clock;
+	    cache->out_hits++;
+	    *hitp = 1;
+	    return ix;
+	}
+	age = clock - cache->out_used[ix];
+	if (age != 0 && age >= victim_age) {
+	    victim = ix;
+	    victim_age = age;
+	}
+    }
+
+    while (victim < 0) {
+	base = (base + ERTS_ATOM_CACHE_WAYS) & (ERTS_ATOM_CACHE_SIZE-1);
+	for (ix = base; ix < base + ERTS_ATOM_CACHE_WAYS; ix++) {
+	    if (cache->out_used[ix] != clock) {
+		victim = ix;
+		break;
+	    }
+	}
+    }
+
+    cache->out_arr[victim] = atom;
+    cache->out_used[victim] = clock;
+    cache->out_misses++;
+    *hitp = 0;
+    return victim;
+}
+
 void
 erts_finalize_atom_cache_map(ErtsAtomCacheMap *acmp)
 {
@@ -231,7 +314,7 @@ erts_finalize_atom_cache_map(ErtsAtomCacheMap *acmp)
 	int min_sz;
 	ASSERT(acmp->hdr_sz < 0);
 	/* Make sure cache update instructions fit */
-	min_sz = fix_sz+(2+4)*acmp->sz;
+	min_sz = fix_sz+4*acmp->sz;
 	sz = fix_sz;
 	for (i = 0; i < acmp->sz; i++) {
 	    Eterm atom;
@@ -298,8 +381,6 @@ byte *erts_encode_ext_dist_header_setup(byte *ctl_ext, ErtsAtomCacheMap *acmp)
 	    aval = (Uint32) atom_val(acmp->cache[acmp->cix[i]].atom);
 	    ep -= 4;
 	    put_int32(aval, ep);
-	    ep -= 2;
-	    put_int16(acmp->cix[i], ep);
 	}
 	--ep;
 	put_int8(acmp->sz, ep);
@@ -309,14 +390,57 @@ byte *erts_encode_ext_dist_header_setup(byte *ctl_ext, ErtsAtomCacheMap *acmp)
     }
 }
 
+/*
+ * The first fragment of a fragmented message carries a sequence id and
+ * a fragment id between the tag and the ordinary dist header. Both ids
+ * are opaque 8 byte big endian integers which are kept as is by
+ * erts_encode_ext_dist_header_finalize().
+ */
+byte *erts_encode_ext_dist_frag_header_setup(byte *ctl_ext,
+					     ErtsAtomCacheMap *acmp,
+					     Uint64 seq_id,
+					     Uint64 frag_id)
+{
+    byte *ep;
+    if (acmp) {
+	ep = erts_encode_ext_dist_header_setup(ctl_ext, acmp);
+	ASSERT(ep[0] == VERSION_MAGIC && ep[1] == DIST_HEADER);
+	ep += 2;
+    }
+    else {
+	/* No atom cache references */
+	ep = ctl_ext;
+	*--ep = 0;
+    }
+    ep -= 4;
+    put_int32((Uint32) frag_id, ep);
+    ep -= 4;
+    put_int32((Uint32) (frag_id >> 32), ep);
+    ep -= 4;
+    put_int32((Uint32) seq_id, ep);
+    ep -= 4;
+    put_int32((Uint32) (seq_id >> 32), ep);
+    *--ep = DIST_FRAG_HEADER;
+    *--ep = VERSION_MAGIC;
+    return ep;
+}
+
 byte *erts_encode_ext_dist_header_finalize(byte *ext, ErtsAtomCache *cache)
 {
-    byte *ip;
-    byte instr_buf[(2+4)*ERTS_ATOM_CACHE_SIZE];
+    Eterm atoms[ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES];
+    int cixs[ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES];
+    byte hits[ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES];
+    byte frag_ids[ERTS_DIST_FRAG_IDS_SIZE] = {0};
+    int frag = 0;
     int ci, sz;
     register byte *ep = ext;
     ASSERT(ep[0] == VERSION_MAGIC);
-    if (ep[1] != DIST_HEADER)
+    if (ep[1] == DIST_FRAG_HEADER) {
+	frag = 1;
+	sys_memcpy((void *) frag_ids, (void *) &ep[2], sizeof(frag_ids));
+	ep += sizeof(frag_ids);
+    }
+    else if (ep[1] != DIST_HEADER)
 	return ext;
 
     /*
@@ -326,12 +450,23 @@ byte *erts_encode_ext_dist_header_finalize(byte *ext, ErtsAtomCache *cache)
      */
     ep += 2;
     ci = (int) get_int8(ep);
-    ASSERT(0 <= ci && ci < ERTS_ATOM_CACHE_SIZE);
+    ASSERT(0 <= ci && ci <= ERTS_MAX_INTERNAL_ATOM_CACHE_ENTRIES);
     ep += 1;
-    sz = (2+4)*ci;
-    ip = &instr_buf[0];
-    sys_memcpy((void *) ip, (void *) ep, sz);
-    ep += sz;
+    if (ci > 0) {
+	/*
+	 * Choose cache indices in the order the receiver will update
+	 * its cache in.
+	 */
+	Uint32 clock = ++cache->out_clock;
+	int iix;
+	for (iix = 0; iix < ci; iix++) {
+	    int hit;
+	    atoms[iix] = make_atom((Uint) get_int32(ep));
+	    ep += 4;
+	    cixs[iix] = get_out_cache_ix(cache, atoms[iix], clock, &hit);
+	    hits[iix] = (byte) hit;
+	}
+    }
     /* ep now points to the beginning of the control message term */
 #ifdef ERTS_DEBUG_USE_DIST_SEP
     ASSERT(*ep == VERSION_MAGIC);
@@ -376,18 +511,16 @@ byte *erts_encode_ext_dist_header_finalize(byte *ext, ErtsAtomCache *cache)
 		used_half_bytes = 0;
 	    }
 
-	    ip = &instr_buf[0] + (2+4)*iix;
-	    cix = (int) get_int16(&ip[0]);
+	    cix = cixs[iix];
 	    ASSERT(0 <= cix && cix < ERTS_ATOM_CACHE_SIZE);
-	    atom = make_atom((Uint) get_int32(&ip[2]));
-	    if (cache->out_arr[cix] == atom) {
+	    atom = atoms[iix];
+	    if (hits[iix]) {
 		--ep;
 		put_int8(cix, ep);
 		flgs |= ((cix >> 8) & 7);
 	    }
 	    else {
 		Atom *a;
-		cache->out_arr[cix] = atom;
 		a = atom_tab(atom_val(atom));
 		sz = a->len;
 		ep -= sz;
@@ -444,19 +577,26 @@ byte *erts_encode_ext_dist_header_finalize(byte *ext, ErtsAtomCache *cache)
     }
     --ep;
     put_int8(ci, ep);
-    *--ep = DIST_HEADER;
+    if (!frag)
+	*--ep = DIST_HEADER;
+    else {
+	ep -= sizeof(frag_ids);
+	sys_memcpy((void *) ep, (void *) frag_ids, sizeof(frag_ids));
+	*--ep = DIST_FRAG_HEADER;
+    }
     *--ep = VERSION_MAGIC;
     return ep;
 }
 
-Uint erts_encode_dist_ext_size(Eterm term, Uint32 flags, ErtsAtomCacheMap *acmp)
+Uint erts_encode_dist_ext_size(Eterm term, Uint32 flags, ErtsAtomCacheMap *acmp,
+			       ErtsExtBinRefs *brefs)
 {
-    Uint sz = 0;
+    Uint sz;
+    (void) encode_size_struct_int(NULL, acmp, term, flags, brefs, NULL, &sz);
 #ifndef ERTS_DEBUG_USE_DIST_SEP
     if (!(flags & DFLAG_DIST_HDR_ATOM_CACHE))
 #endif
 	sz++ /* VERSION_MAGIC */;
-    sz += encode_size_struct2(acmp, term, flags);
     return sz;
 }
 
@@ -466,14 +606,15 @@ Uint erts_encode_ext_size(Eterm term)
 	+ 1 /* VERSION_MAGIC */;
 }
 
-void erts_encode_dist_ext(Eterm term, byte **ext, Uint32 flags, ErtsAtomCacheMap *acmp)
+void erts_encode_dist_ext(Eterm term, byte **ext, Uint32 flags, ErtsAtomCacheMap *acmp,
+			  ErtsExtBinRefs *brefs)
 {
     byte *ep = *ext;
 #ifndef ERTS_DEBUG_USE_DIST_SEP
     if (!(flags & DFLAG_DIST_HDR_ATOM_CACHE))
 #endif
 	*ep++ = VERSION_MAGIC;
-    ep = enc_term(acmp, term, ep, flags);
+    (void) enc_term_int(NULL, acmp, term, ep, flags, brefs, NULL, &ep);
     if (!ep)
 	erl_exit(ERTS_ABORT_EXIT,
 		 "%s:%d:erts_encode_dist_ext(): Internal data structure error\n",
@@ -481,6 +622,177 @@ void erts_encode_dist_ext(Eterm term, byte **ext, Uint32 flags, ErtsAtomCacheMap
     *ext = ep;
 }
 
+/*
+ * Yielding variants of erts_encode_dist_ext_size() and
+ * erts_encode_dist_ext(); see encode_size_struct_int() and enc_term_int().
+ */
+int erts_encode_dist_ext_size_int(Eterm term, Uint32 flags,
+				  ErtsAtomCacheMap *acmp, ErtsExtBinRefs *brefs,
+				  ErtsExtSizeContext *ctx, Sint *reds, Uint *res)
+{
+    Uint sz;
+    if (!encode_size_struct_int(ctx, acmp, term, flags, brefs, reds, &sz))
+	return 0;
+#ifndef ERTS_DEBUG_USE_DIST_SEP
+    if (!(flags & DFLAG_DIST_HDR_ATOM_CACHE))
+#endif
+	sz++ /* VERSION_MAGIC */;
+    *res = sz;
+    return 1;
+}
+
+int erts_encode_dist_ext_int(Eterm term, byte **ext, Uint32 flags,
+			     ErtsAtomCacheMap *acmp, ErtsExtBinRefs *brefs,
+			     ErtsExtEncodeContext *ctx, Sint *reds)
+{
+    byte *ep = *ext;
+    if (!ctx->estack.start) {
+#ifndef ERTS_DEBUG_USE_DIST_SEP
+	if (!(flags & DFLAG_DIST_HDR_ATOM_CACHE))
+#endif
+	    *ep++ = VERSION_MAGIC;
+    }
+    if (!enc_term_int(ctx, acmp, term, ep, flags, brefs, reds, &ep))
+	return 0;
+    *ext = ep;
+    return 1;
+}
+
+/*
+ * LZ compress an encoded dist message at ext, ending at *ext_endp, in
+ * place if it gets smaller. The term is replaced by COMPRESSED_LZ, the
+ * uncompressed size and the compressed data.
+ */
+void erts_encode_dist_ext_compress(byte *ext, byte **ext_endp, Uint32 flags)
+{
+    byte *ep = ext;
+    byte *buf;
+    Uint size, csize;
+
+#ifndef ERTS_DEBUG_USE_DIST_SEP
+    if (!(flags & DFLAG_DIST_HDR_ATOM_CACHE))
+#endif
+	ep++ /* VERSION_MAGIC */;
+    size = *ext_endp - ep;
+    if (size < ERTS_DIST_LZ_MIN_SIZE)
+	return;
+    buf = erts_alloc(ERTS_ALC_T_TMP, size);
+    csize = erts_lz_compress(buf, size - 5, ep, size);
+    if (csize) {
+	*ep++ = COMPRESSED_LZ;
+	put_int32(size, ep);
+	ep += 4;
+	sys_memcpy((void *) ep, (void *) buf, csize);
+	*ext_endp = ep + csize;
+    }
+    erts_free(ERTS_ALC_T_TMP, (void *) buf);
+}
+
+/*
+ * Checks if the dist message at edep->extp is LZ compressed. Returns 1
+ * and its header size (the VERSION_MAGIC, if any), uncompressed size,
+ * and compressed size if it is, 0 if it is not, and -1 on bad data.
+ */
+static int
+dist_ext_lz_info(ErtsDistExternal *edep, Uint *hdrp, Uint *sizep, Uint *csizep)
+{
+    byte *ep = edep->extp;
+    Uint hdr;
+
+#ifndef ERTS_DEBUG_USE_DIST_SEP
+    if (edep->flags & ERTS_DIST_EXT_DFLAG_HDR)
+	hdr = 0;
+    else
+#endif
+	hdr = 1 /* VERSION_MAGIC */;
+    if ((Uint) (edep->ext_endp - ep) < hdr + 5 || ep[hdr] != COMPRESSED_LZ)
+	return 0;
+    *hdrp = hdr;
+    *sizep = get_int32(ep + hdr + 1);
+    *csizep = (edep->ext_endp - ep) - (hdr + 5);
+    if (*sizep > ERTS_LZ_MAX_UNCOMPRESSED(*csizep))
+	return -1;
+    return 1;
+}
+
+/*
+ * If the dist message at edep->extp is LZ compressed, uncompress it to
+ * a buffer returned in *bufp which the caller frees with
+ * erts_free(ERTS_ALC_T_TMP, ...), and make edep refer to it. Returns -1
+ * on bad data.
+ */
+int erts_dist_ext_uncompress(ErtsDistExternal *edep, byte **bufp)
+{
+    byte *ep = edep->extp;
+    byte *buf;
+    Uint hdr, size, csize;
+    int res;
+
+    *bufp = NULL;
+    res = dist_ext_lz_info(edep, &hdr, &size, &csize);
+    if (res <= 0)
+	return res;
+    buf = erts_alloc(ERTS_ALC_T_TMP, hdr + size);
+    if (erts_lz_uncompress(buf + hdr, size, ep + hdr + 5, csize) != 0) {
+	erts_free(ERTS_ALC_T_TMP, (void *) buf);
+	return -1;
+    }
+    if (hdr)
+	buf[0] = VERSION_MAGIC;
+    edep->extp = buf;
+    edep->ext_endp = buf + hdr + size;
+    edep->bin = NULL;
+    *bufp = buf;
+    return 0;
+}
+
+/*
+ * Uncompresses the message of a dist ext copy without trailer, made by
+ * erts_make_dist_ext_copy(), in the context of the receiver. Returns a
+ * new copy and frees edep if the message was LZ compressed, edep if it
+ * was not, and NULL after freeing edep if the data is bad.
+ */
+ErtsDistExternal *
+erts_uncompress_dist_ext_copy(ErtsDistExternal *edep)
+{
+    ErtsDistExternal *new_edep;
+    size_t dist_ext_sz;
+    byte *ep;
+    Uint hdr, size, csize;
+    int res;
+
+    ASSERT(edep->heap_size < 0);
+    res = dist_ext_lz_info(edep, &hdr, &size, &csize);
+    if (res == 0)
+	return edep;
+    if (res < 0)
+	goto fail;
+
+    dist_ext_sz = ERTS_DIST_EXT_SIZE(edep);
+    new_edep = erts_alloc(ERTS_ALC_T_EXT_TERM_DATA, dist_ext_sz + hdr + size);
+    ep = ((byte *) new_edep) + dist_ext_sz;
+    if (erts_lz_uncompress(ep + hdr, size, edep->extp + hdr + 5, csize) != 0) {
+	erts_free(ERTS_ALC_T_EXT_TERM_DATA, (void *) new_edep);
+	goto fail;
+    }
+    if (hdr)
+	ep[0] = VERSION_MAGIC;
+    /* The reference to the dist entry moves to the new copy */
+    sys_memcpy((void *) new_edep, (void *) edep, dist_ext_sz);
+    new_edep->extp = ep;
+    new_edep->ext_endp = ep + hdr + size;
+    new_edep->bin = NULL;
+    if (edep->bin && erts_refc_dectest(&edep->bin->refc, 0) == 0)
+	erts_bin_free(edep->bin);
+    erts_free(ERTS_ALC_T_EXT_TERM_DATA, (void *) edep);
+    return new_edep;
+
+ fail:
+    bad_dist_ext(edep);
+    erts_free_dist_ext_copy(edep);
+    return NULL;
+}
+
 void erts_encode_ext(Eterm term, byte **ext)
 {
     byte *ep = *ext;
@@ -493,6 +805,10 @@ void erts_encode_ext(Eterm term, byte **ext)
     *ext = ep;
 }
 
+/*
+ * The copy refers to the data instead of copying it if it is in a
+ * binary; see erts_dist_ext_trailer().
+ */
 ErtsDistExternal *
 erts_make_dist_ext_copy(ErtsDistExternal *edep, Uint xsize)
 {
@@ -505,7 +821,7 @@ erts_make_dist_ext_copy(ErtsDistExternal *edep, Uint xsize)
     dist_ext_sz = ERTS_DIST_EXT_SIZE(edep);
     ASSERT(edep->ext_endp && edep->extp);
     ASSERT(edep->ext_endp >= edep->extp);
-    ext_sz = edep->ext_endp - edep->extp;
+    ext_sz = edep->bin ? 0 : edep->ext_endp - edep->extp;
 
     align_sz = ERTS_WORD_ALIGN_PAD_SZ(dist_ext_sz + ext_sz);
 
@@ -517,13 +833,27 @@ erts_make_dist_ext_copy(ErtsDistExternal *edep, Uint xsize)
     ep += dist_ext_sz;
     if (new_edep->dep)
 	erts_refc_inc(&new_edep->dep->refc, 1);
-    new_edep->extp = ep;
-    new_edep->ext_endp = ep + ext_sz;
     new_edep->heap_size = -1;
-    sys_memcpy((void *) ep, (void *) edep->extp, ext_sz);
+    if (edep->bin)
+	erts_refc_inc(&edep->bin->refc, 2);
+    else {
+	new_edep->extp = ep;
+	new_edep->ext_endp = ep + ext_sz;
+	sys_memcpy((void *) ep, (void *) edep->extp, ext_sz);
+    }
     return new_edep;
 }
 
+void
+erts_free_dist_ext_copy(ErtsDistExternal *edep)
+{
+    if (edep->dep)
+	erts_deref_dist_entry(edep->dep);
+    if (edep->bin && erts_refc_dectest(&edep->bin->refc, 0) == 0)
+	erts_bin_free(edep->bin);
+    erts_free(ERTS_ALC_T_EXT_TERM_DATA, edep);
+}
+
 int
 erts_prepare_dist_ext(ErtsDistExternal *edep,
 		      byte *ext,
@@ -545,6 +875,7 @@ erts_prepare_dist_ext(ErtsDistExternal *edep,
 
     edep->heap_size = -1;
     edep->ext_endp = ext+size;
+    edep->bin = NULL;
 
     if (size < 2)
 	ERTS_EXT_FAIL;
@@ -576,7 +907,7 @@ erts_prepare_dist_ext(ErtsDistExternal *edep,
 	erts_smp_de_runlock(dep);
     }
 
-    if (ep[1] != DIST_HEADER) {
+    if (ep[1] != DIST_HEADER && ep[1] != DIST_FRAG_HEADER) {
 	if (edep->flags & ERTS_DIST_EXT_DFLAG_HDR)
 	    ERTS_EXT_HDR_FAIL;
 	edep->attab.size = 0;
@@ -593,6 +924,11 @@ erts_prepare_dist_ext(ErtsDistExternal *edep,
 #define CHKSIZE(SZ) \
 	do { if ((SZ) > edep->ext_endp - ep) ERTS_EXT_HDR_FAIL; } while(0)
 
+	if (ep[1] == DIST_FRAG_HEADER) {
+	    /* Fragment ids are handled by the caller; skip them */
+	    CHKSIZE(1+1+ERTS_DIST_FRAG_IDS_SIZE);
+	    ep += ERTS_DIST_FRAG_IDS_SIZE;
+	}
 	CHKSIZE(1+1+1);
 	ep += 2;
 	no_atoms = (int) get_int8(ep);
@@ -818,7 +1154,7 @@ erts_decode_dist_ext_size(ErtsDistExternal *edep, int no_refc_bins)
 	    goto fail;
 	ep = edep->extp+1;
     }
-    res = decoded_size(ep, edep->ext_endp, no_refc_bins);
+    res = decoded_size(ep, edep->ext_endp, no_refc_bins, NULL);
     if (res >= 0)
 	return res;
  fail:
@@ -830,7 +1166,7 @@ Sint erts_decode_ext_size(byte *ext, Uint size, int no_refc_bins)
 {
     if (size == 0 || *ext != VERSION_MAGIC)
 	return -1;
-    return decoded_size(ext+1, ext+size, no_refc_bins);
+    return decoded_size(ext+1, ext+size, no_refc_bins, NULL);
 }
 
 /*
@@ -860,7 +1196,7 @@ erts_decode_dist_ext(Eterm** hpp,
 	    goto error;
 	ep++;
     }
-    ep = dec_term(edep, hpp, ep, off_heap, &obj);
+    ep = dec_term(edep, hpp, ep, off_heap, &obj, NULL);
     if (!ep)
 	goto error;
 
@@ -881,7 +1217,7 @@ Eterm erts_decode_ext(Eterm **hpp, ErlOffHeap *off_heap, byte **ext)
     byte *ep = *ext;
     if (*ep++ != VERSION_MAGIC)
 	return THE_NON_VALUE;
-    ep = dec_term(NULL, hpp, ep, off_heap, &obj);
+    ep = dec_term(NULL, hpp, ep, off_heap, &obj, NULL);
     if (!ep) {
 #ifdef DEBUG
 	bin_write(ERTS_PRINT_STDERR,NULL,*ext,500);
@@ -915,6 +1251,7 @@ BIF_RETTYPE erts_debug_dist_ext_to_term_2(BIF_ALIST_2)
     ede.flags = ERTS_DIST_EXT_ATOM_TRANS_TAB;
     ede.dep = NULL;
     ede.heap_size = -1;
+    ede.bin = NULL;
     
     if (is_not_tuple(BIF_ARG_1))
 	goto badarg;
@@ -963,10 +1300,217 @@ BIF_RETTYPE erts_debug_dist_ext_to_term_2(BIF_ALIST_2)
 }
 
 
+/*
+ * term_to_binary/1,2 and binary_to_term/1 yield when the term is large.
+ * The state of the operation is then kept in a magic binary passed to
+ * the trap function, and the process is not garbage collected until the
+ * operation is done, as the state refers to the heap.
+ */
+
+static Export term_to_binary_trap_export;
+static Export binary_to_term_trap_export;
+
+static BIF_RETTYPE term_to_binary_trap_2(BIF_ALIST_2);
+static BIF_RETTYPE binary_to_term_trap_2(BIF_ALIST_2);
+
+static void
+init_trap_export(Export *ep, char *name, BIF_RETTYPE (*func)(BIF_ALIST_2))
+{
+    memset(ep, 0, sizeof(Export));
+    ep->address = &ep->code[3];
+    ep->code[0] = am_erlang;
+    ep->code[1] = am_atom_put(name, sys_strlen(name));
+    ep->code[2] = 2;
+    ep->code[3] = (Eterm) em_apply_bif;
+    ep->code[4] = (Eterm) func;
+}
+
+void
+erts_init_external(void)
+{
+    init_trap_export(&term_to_binary_trap_export,
+		     "term_to_binary_trap", &term_to_binary_trap_2);
+    init_trap_export(&binary_to_term_trap_export,
+		     "binary_to_term_trap", &binary_to_term_trap_2);
+}
+
+static ERTS_INLINE Sint
+ext_loops_left(Process *p)
+{
+    return (ERTS_BIF_REDS_LEFT(p) + 1) * ERTS_EXT_LOOP_FACTOR;
+}
+
+typedef struct {
+    int state;
+    int level;
+    Uint flags;
+    Uint size;
+    Eterm bin;			/* Result binary when not compressing */
+    byte *bytes;		/* Encoding buffer when compressing */
+    ErtsExtSizeContext sc;
+    ErtsExtEncodeContext ec;
+} TTBContext;
+
+#define TTB_SIZE	0
+#define TTB_ENCODE	1
+
+/* Compression level selecting LZ compression instead of zlib */
+#define TTB_COMPRESS_LZ	100
+
+static void
+ttb_context_destructor(Binary *context_b)
+{
+    TTBContext *ctx = ERTS_MAGIC_BIN_DATA(context_b);
+    DESTROY_SAVED_ESTACK(&ctx->sc.estack);
+    DESTROY_SAVED_ESTACK(&ctx->ec.estack);
+    if (ctx->bytes)
+	erts_free(ERTS_ALC_T_TMP, ctx->bytes);
+}
+
+static Eterm
+ttb_compress(Process *p, byte *bytes, size_t real_size, int level)
+{
+    Eterm bin;
+    byte* out_bytes;
+    uLongf dest_len;
+    int ok;
+
+    /*
+     * We don't want to compress if compression actually increases the size.
+     * Therefore, don't give the compressor more out buffer than the size of
+     * the uncompressed external format (minus the 5 bytes needed for the
+     * COMPRESSED tag). If it returns any error, we'll revert to using
+     * the original uncompressed external term format.
+     */
+
+    if (real_size < 5) {
+	dest_len = 0;
+    } else {
+	dest_len = real_size - 5;
+    }
+    bin = new_binary(p, NULL, real_size+1);
+    out_bytes = binary_bytes(bin);
+    out_bytes[0] = VERSION_MAGIC;
+    if (level == TTB_COMPRESS_LZ) {
+	dest_len = erts_lz_compress(out_bytes+6, dest_len, bytes, real_size);
+	ok = dest_len != 0;
+	out_bytes[1] = COMPRESSED_LZ;
+    } else {
+	ok = (erl_zlib_compress2(out_bytes+6, &dest_len, bytes, real_size,
+				 level) == Z_OK);
+	out_bytes[1] = COMPRESSED;
+    }
+    if (!ok) {
+	sys_memcpy(out_bytes+1, bytes, real_size);
+	bin = erts_realloc_binary(bin, real_size+1);
+    } else {
+	put_int32(real_size, out_bytes+2);
+	bin = erts_realloc_binary(bin, dest_len+6);
+    }
+    return bin;
+}
+
+static BIF_RETTYPE
+term_to_binary_int(Process* p, Eterm Term, int level, Uint flags,
+		   Eterm context)
+{
+    TTBContext c_buff;
+    TTBContext *ctx;
+    Binary *context_b = NULL;
+    Sint loops, reds;
+    byte *bytes;
+    byte *endp;
+    size_t real_size;
+    Eterm bin;
+
+    if (is_value(context)) {
+	context_b = ((ProcBin *) binary_val(context))->val;
+	ASSERT(ERTS_MAGIC_BIN_DESTRUCTOR(context_b) == ttb_context_destructor);
+	ctx = ERTS_MAGIC_BIN_DATA(context_b);
+    } else {
+	ctx = &c_buff;
+	ctx->state = TTB_SIZE;
+	ctx->level = level;
+	ctx->flags = flags;
+	ctx->bin = NIL;
+	ctx->bytes = NULL;
+	ctx->sc.estack.start = NULL;
+	ctx->ec.estack.start = NULL;
+    }
+    loops = reds = ext_loops_left(p);
+
+    switch (ctx->state) {
+    case TTB_SIZE:
+	if (!encode_size_struct_int(&ctx->sc, NULL, Term, ctx->flags, NULL,
+				    &reds, &ctx->size))
+	    goto yield;
+	ctx->size++;		/* VERSION_MAGIC */
+	if (ctx->level != 0) {
+	    ctx->bytes = erts_alloc(ERTS_ALC_T_TMP, ctx->size);
+	} else {
+	    ctx->bin = new_binary(p, NULL, ctx->size);
+	    binary_bytes(ctx->bin)[0] = VERSION_MAGIC;
+	}
+	ctx->state = TTB_ENCODE;
+	/* Fall through */
+    case TTB_ENCODE:
+	bytes = ctx->level != 0 ? ctx->bytes : binary_bytes(ctx->bin) + 1;
+	if (!enc_term_int(&ctx->ec, NULL, Term, bytes, ctx->flags, NULL,
+			  &reds, &endp))
+	    goto yield;
+	if (ctx->level != 0) {
+	    real_size = endp - ctx->bytes;
+	    if (real_size > ctx->size) {
+		erl_exit(1, "%s, line %d: buffer overflow: %d word(s)\n",
+			 __FILE__, __LINE__, real_size - ctx->size);
+	    }
+	    bin = ttb_compress(p, ctx->bytes, real_size, ctx->level);
+	    erts_free(ERTS_ALC_T_TMP, ctx->bytes);
+	    ctx->bytes = NULL;
+	} else {
+	    bytes = binary_bytes(ctx->bin);
+	    real_size = endp - bytes;
+	    if (real_size > ctx->size) {
+		erl_exit(1, "%s, line %d: buffer overflow: %d word(s)\n",
+			 __FILE__, __LINE__, real_size - ctx->size);
+	    }
+	    bin = erts_realloc_binary(ctx->bin, real_size);
+	}
+	break;
+    default:
+	ASSERT(0);
+	bin = THE_NON_VALUE;
+	break;
+    }
+    if (context_b)
+	FLAGS(p) &= ~F_DISABLE_GC;
+    BUMP_REDS(p, (loops - reds) / ERTS_EXT_LOOP_FACTOR);
+    return bin;
+
+ yield:
+    if (!context_b) {
+	Eterm *hp;
+	context_b = erts_create_magic_binary(sizeof(TTBContext),
+					     ttb_context_destructor);
+	sys_memcpy(ERTS_MAGIC_BIN_DATA(context_b), ctx, sizeof(TTBContext));
+	hp = HAlloc(p, PROC_BIN_SIZE);
+	context = erts_mk_magic_binary_term(&hp, &MSO(p), context_b);
+	FLAGS(p) |= F_DISABLE_GC;
+    }
+    ERTS_BIF_YIELD2(&term_to_binary_trap_export, p, context, Term);
+}
+
+static BIF_RETTYPE
+term_to_binary_trap_2(BIF_ALIST_2)
+{
+    return term_to_binary_int(BIF_P, BIF_ARG_2, 0, 0, BIF_ARG_1);
+}
+
 Eterm
 term_to_binary_1(Process* p, Eterm Term)
 {
-    return erts_term_to_binary(p, Term, 0, TERM_TO_BINARY_DFLAGS);
+    return term_to_binary_int(p, Term, 0, TERM_TO_BINARY_DFLAGS,
+			      THE_NON_VALUE);
 }
 
 Eterm
@@ -992,6 +1536,8 @@ term_to_binary_2(Process* p, Eterm Term, Eterm Flags)
 		default:
 		    goto error;
 		}
+	    } else if (tp[1] == am_compressed && tp[2] == am_lz) {
+		level = TTB_COMPRESS_LZ;
 	    } else if (tp[1] == am_compressed && is_small(tp[2])) {
 		level = signed_val(tp[2]);
 		if (!(0 <= level && level < 10)) {
@@ -1010,13 +1556,16 @@ term_to_binary_2(Process* p, Eterm Term, Eterm Flags)
 	goto error;
     }
 
-    return erts_term_to_binary(p, Term, level, flags);
+    return term_to_binary_int(p, Term, level, flags, THE_NON_VALUE);
 }
 
-static ERTS_INLINE Sint
-binary2term_prepare(ErtsBinary2TermState *state, byte *data, Sint data_size)
+/*
+ * Checks the version and uncompresses a compressed term. Returns the
+ * size of the external format at state->extp, or -1 on error.
+ */
+static Sint
+binary2term_uncompress(ErtsBinary2TermState *state, byte *data, Sint data_size)
 {
-    Sint res;
     byte *bytes = data;
     Sint size = data_size;
 
@@ -1032,9 +1581,19 @@ binary2term_prepare(ErtsBinary2TermState *state, byte *data, Sint data_size)
     }
     bytes++;
     size--;
-    if (size < 5 || *bytes != COMPRESSED) {
+    if (size < 5 || (*bytes != COMPRESSED && *bytes != COMPRESSED_LZ)) {
 	state->extp = bytes;
     }
+    else if (*bytes == COMPRESSED_LZ) {
+	Uint dest_len = get_int32(bytes+1);
+	if (dest_len > ERTS_LZ_MAX_UNCOMPRESSED(size-5))
+	    goto error;
+	state->extp = erts_alloc(ERTS_ALC_T_TMP, dest_len);
+	state->exttmp = 1;
+	if (erts_lz_uncompress(state->extp, dest_len, bytes+5, size-5) != 0)
+	    goto error;
+	size = (Sint) dest_len;
+    }
     else  {
 	uLongf dest_len = get_int32(bytes+1);
 	state->extp = erts_alloc(ERTS_ALC_T_TMP, dest_len);
@@ -1043,10 +1602,7 @@ binary2term_prepare(ErtsBinary2TermState *state, byte *data, Sint data_size)
 	    goto error;
 	size = (Sint) dest_len;
     }
-    res = decoded_size(state->extp, state->extp + size, 0);
-    if (res < 0)
-	goto error;
-    return res;
+    return size;
 }
 
 static ERTS_INLINE void
@@ -1058,11 +1614,26 @@ binary2term_abort(ErtsBinary2TermState *state)
     }
 }
 
+static ERTS_INLINE Sint
+binary2term_prepare(ErtsBinary2TermState *state, byte *data, Sint data_size)
+{
+    Sint res;
+    Sint size = binary2term_uncompress(state, data, data_size);
+    if (size < 0)
+	return -1;
+    res = decoded_size(state->extp, state->extp + size, 0, NULL);
+    if (res < 0) {
+	binary2term_abort(state);
+	return -1;
+    }
+    return res;
+}
+
 static ERTS_INLINE Eterm
 binary2term_create(ErtsBinary2TermState *state, Eterm **hpp, ErlOffHeap *ohp)
 {
     Eterm res;
-    if (!dec_term(NULL, hpp, state->extp, ohp, &res))
+    if (!dec_term(NULL, hpp, state->extp, ohp, &res, NULL))
 	res = THE_NON_VALUE;
     if (state->exttmp) {
 	state->exttmp = 0;
@@ -1089,46 +1660,186 @@ erts_binary2term_create(ErtsBinary2TermState *state, Eterm **hpp, ErlOffHeap *oh
     return binary2term_create(state, hpp, ohp);
 }
 
-BIF_RETTYPE binary_to_term_1(BIF_ALIST_1)
+typedef struct {
+    int state;
+    byte *temp_alloc;
+    ErtsBinary2TermState b2ts;
+    byte *ext_endp;
+    Eterm *hp;
+    Eterm *hp_end;
+    Eterm res;
+    B2TSizeContext sc;
+    B2TDecodeContext dc;
+} B2TContext;
+
+#define B2T_SIZE	0
+#define B2T_DECODE	1
+
+static void
+b2t_context_destructor(Binary *context_b)
+{
+    B2TContext *ctx = ERTS_MAGIC_BIN_DATA(context_b);
+    binary2term_abort(&ctx->b2ts);
+    erts_free_aligned_binary_bytes(ctx->temp_alloc);
+    ctx->temp_alloc = NULL;
+}
+
+/*
+ * Gives back the unused end of the heap area allocated for the term, or
+ * fills it if other things have been allocated after it meanwhile.
+ */
+static void
+b2t_release_heap(Process *p, B2TContext *ctx)
 {
+    if (ctx->hp > ctx->hp_end) {
+	erl_exit(1, ":%s, line %d: heap overrun by %d words(s)\n",
+		 __FILE__, __LINE__, ctx->hp - ctx->hp_end);
+    }
+    if (ctx->hp == ctx->hp_end)
+	return;
+    if (ctx->hp_end == HEAP_TOP(p)) {
+	HRelease(p, ctx->hp_end, ctx->hp);
+    } else {
+	*ctx->hp = make_pos_bignum_header(ctx->hp_end - ctx->hp - 1);
+    }
+    ctx->hp_end = ctx->hp;
+}
+
+static BIF_RETTYPE
+binary_to_term_int(Process* p, Eterm bin, Eterm context)
+{
+    Binary *context_b;
+    B2TContext *ctx;
+    Sint loops = ext_loops_left(p);
     Sint heap_size;
     Eterm res;
-    Eterm* hp;
-    Eterm* endp;
-    Sint size;
-    byte* bytes;
-    byte* temp_alloc = NULL;
-    ErtsBinary2TermState b2ts;
 
-    if ((bytes = erts_get_aligned_binary_bytes(BIF_ARG_1, &temp_alloc)) == NULL) {
-    error:
-	erts_free_aligned_binary_bytes(temp_alloc);
-	BIF_ERROR(BIF_P, BADARG);
-    }
-    size = binary_size(BIF_ARG_1);
+    if (is_value(context)) {
+	context_b = ((ProcBin *) binary_val(context))->val;
+	ASSERT(ERTS_MAGIC_BIN_DESTRUCTOR(context_b) == b2t_context_destructor);
+	ctx = ERTS_MAGIC_BIN_DATA(context_b);
+    } else {
+	Eterm* hp;
+	Eterm* endp;
+	Sint size;
+	byte* bytes;
+	byte* temp_alloc = NULL;
+	ErtsBinary2TermState b2ts;
 
-    heap_size = binary2term_prepare(&b2ts, bytes, size);
-    if (heap_size < 0)
-	goto error;
+	if ((bytes = erts_get_aligned_binary_bytes(bin, &temp_alloc)) == NULL) {
+	    erts_free_aligned_binary_bytes(temp_alloc);
+	    BIF_ERROR(p, BADARG);
+	}
+	size = binary2term_uncompress(&b2ts, bytes, binary_size(bin));
+	if (size < 0) {
+	    erts_free_aligned_binary_bytes(temp_alloc);
+	    BIF_ERROR(p, BADARG);
+	}
+
+	if (size > loops) {
+	    /*
+	     * Large term; the decode may yield. dec_term() writes the
+	     * result through a pointer to ctx->res, so the context must
+	     * be in place from the start.
+	     */
+	    context_b = erts_create_magic_binary(sizeof(B2TContext),
+						 b2t_context_destructor);
+	    ctx = ERTS_MAGIC_BIN_DATA(context_b);
+	    ctx->state = B2T_SIZE;
+	    ctx->temp_alloc = temp_alloc;
+	    ctx->b2ts = b2ts;
+	    ctx->ext_endp = b2ts.extp + size;
+	    ctx->sc.ep = b2ts.extp;
+	    ctx->sc.heap_size = 0;
+	    ctx->sc.terms = 1;
+	    ctx->sc.atom_extra_skip = 0;
+	    ctx->dc.next = NULL;
+	    hp = HAlloc(p, PROC_BIN_SIZE);
+	    context = erts_mk_magic_binary_term(&hp, &MSO(p), context_b);
+	    FLAGS(p) |= F_DISABLE_GC;
+	    goto resume;
+	}
 
-    hp = HAlloc(BIF_P, heap_size);
-    endp = hp + heap_size;
+	heap_size = decoded_size(b2ts.extp, b2ts.extp + size, 0, NULL);
+	if (heap_size < 0) {
+	    binary2term_abort(&b2ts);
+	    erts_free_aligned_binary_bytes(temp_alloc);
+	    BIF_ERROR(p, BADARG);
+	}
 
-    res = binary2term_create(&b2ts, &hp, &MSO(BIF_P));
+	hp = HAlloc(p, heap_size);
+	endp = hp + heap_size;
 
-    erts_free_aligned_binary_bytes(temp_alloc);
+	res = binary2term_create(&b2ts, &hp, &MSO(p));
 
-    if (hp > endp) {
-	erl_exit(1, ":%s, line %d: heap overrun by %d words(s)\n",
-		 __FILE__, __LINE__, hp-endp);
-    }
+	erts_free_aligned_binary_bytes(temp_alloc);
+
+	if (hp > endp) {
+	    erl_exit(1, ":%s, line %d: heap overrun by %d words(s)\n",
+		     __FILE__, __LINE__, hp-endp);
+	}
+
+	HRelease(p, endp, hp);
 
-    HRelease(BIF_P, endp, hp);
+	if (res == THE_NON_VALUE)
+	    BIF_ERROR(p, BADARG);
+
+	return res;
+    }
 
-    if (res == THE_NON_VALUE)
+ resume:
+    ctx->sc.reds = ctx->dc.reds = loops;
+    switch (ctx->state) {
+    case B2T_SIZE:
+	heap_size = decoded_size(NULL, ctx->ext_endp, 0, &ctx->sc);
+	if (heap_size == B2T_YIELD)
+	    goto yield;
+	if (heap_size < 0)
+	    goto error;
+	ctx->hp = HAlloc(p, heap_size);
+	ctx->hp_end = ctx->hp + heap_size;
+	ctx->dc.reds = ctx->sc.reds;
+	ctx->state = B2T_DECODE;
+	/* Fall through */
+    case B2T_DECODE:
+	if (!dec_term(NULL, &ctx->hp, ctx->b2ts.extp, &MSO(p), &ctx->res,
+		      &ctx->dc)) {
+	    b2t_release_heap(p, ctx);
+	    goto error;
+	}
+	if (ctx->dc.next)
+	    goto yield;
+	b2t_release_heap(p, ctx);
+	break;
+    default:
+	ASSERT(0);
 	goto error;
+    }
 
+    res = ctx->res;
+    b2t_context_destructor(context_b);
+    FLAGS(p) &= ~F_DISABLE_GC;
+    BUMP_REDS(p, (loops - ctx->dc.reds) / ERTS_EXT_LOOP_FACTOR);
     return res;
+
+ error:
+    b2t_context_destructor(context_b);
+    FLAGS(p) &= ~F_DISABLE_GC;
+    BIF_ERROR(p, BADARG);
+
+ yield:
+    ERTS_BIF_YIELD2(&binary_to_term_trap_export, p, context, bin);
+}
+
+static BIF_RETTYPE
+binary_to_term_trap_2(BIF_ALIST_2)
+{
+    return binary_to_term_int(BIF_P, BIF_ARG_2, BIF_ARG_1);
+}
+
+BIF_RETTYPE binary_to_term_1(BIF_ALIST_1)
+{
+    return binary_to_term_int(BIF_P, BIF_ARG_1, THE_NON_VALUE);
 }
 
 Eterm
@@ -1156,8 +1867,6 @@ erts_term_to_binary(Process* p, Eterm Term, int level, Uint flags)
     if (level != 0) {
 	byte buf[256];
 	byte* bytes = buf;
-	byte* out_bytes;
-	uLongf dest_len;
 
 	if (sizeof(buf) < size) {
 	    bytes = erts_alloc(ERTS_ALC_T_TMP, size);
@@ -1173,31 +1882,7 @@ erts_term_to_binary(Process* p, Eterm Term, int level, Uint flags)
 	    erl_exit(1, "%s, line %d: buffer overflow: %d word(s)\n",
 		     __FILE__, __LINE__, real_size - size);
 	}
-
-	/*
-	 * We don't want to compress if compression actually increases the size.
-	 * Therefore, don't give zlib more out buffer than the size of the
-	 * uncompressed external format (minus the 5 bytes needed for the
-	 * COMPRESSED tag). If zlib returns any error, we'll revert to using
-	 * the original uncompressed external term format.
-	 */
-
-	if (real_size < 5) {
-	    dest_len = 0;
-	} else {
-	    dest_len = real_size - 5;
-	}
-	bin = new_binary(p, NULL, real_size+1);
-	out_bytes = binary_bytes(bin);
-	out_bytes[0] = VERSION_MAGIC;
-	if (erl_zlib_compress2(out_bytes+6, &dest_len, bytes, real_size, level) != Z_OK) {
-	    sys_memcpy(out_bytes+1, bytes, real_size);
-	    bin = erts_realloc_binary(bin, real_size+1);
-	} else {
-	    out_bytes[1] = COMPRESSED;
-	    put_int32(real_size, out_bytes+2);
-	    bin = erts_realloc_binary(bin, dest_len+6);
-	}
+	bin = ttb_compress(p, bytes, real_size, level);
 	if (bytes != buf) {
 	    erts_free(ERTS_ALC_T_TMP, bytes);
 	}
@@ -1387,8 +2072,46 @@ dec_pid(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Ete
 #define ENC_PATCH_FUN_SIZE ((Eterm) 2)
 #define ENC_LAST_ARRAY_ELEMENT ((Eterm) 3)
 
+/*
+ * Returns the ProcBin of a binary that a dist output buffer may refer
+ * to (see ErtsExtBinRefs), and its byte offset in *offsp; else NULL.
+ */
+static ERTS_INLINE ProcBin *
+ext_ref_binary(Eterm obj, Uint *offsp)
+{
+    Eterm real_bin;
+    Uint offset, bitoffs, bitsize;
+    ProcBin *pb;
+
+    if (binary_size(obj) < ERTS_EXT_BIN_REF_MIN)
+	return NULL;
+    ERTS_GET_REAL_BIN(obj, real_bin, offset, bitoffs, bitsize);
+    pb = (ProcBin *) binary_val(real_bin);
+    if (pb->thing_word != HEADER_PROC_BIN || bitoffs != 0 || bitsize != 0)
+	return NULL;
+    *offsp = offset;
+    return pb;
+}
+
 static byte*
 enc_term(ErtsAtomCacheMap *acmp, Eterm obj, byte* ep, Uint32 dflags)
+{
+    byte *res;
+    (void) enc_term_int(NULL, acmp, obj, ep, dflags, NULL, NULL, &res);
+    return res;
+}
+
+/*
+ * When ctx is given, the encoding yields by saving its state in ctx and
+ * returning 0 once *reds loops have been done. It continues when called
+ * again with the same ctx; the buffer being written must stay in place
+ * meanwhile. ctx->estack.start must be NULL on the first call. Returns
+ * 1 with the end of the encoded data in *res when done.
+ */
+static int
+enc_term_int(ErtsExtEncodeContext *ctx, ErtsAtomCacheMap *acmp, Eterm obj,
+	     byte* ep, Uint32 dflags, ErtsExtBinRefs *brefs, Sint *reds,
+	     byte **res)
 {
     DECLARE_ESTACK(s);
     Uint n;
@@ -1397,11 +2120,27 @@ enc_term(ErtsAtomCacheMap *acmp, Eterm obj, byte* ep, Uint32 dflags)
     Uint* ptr;
     Eterm val;
     FloatDef f;
+    Sint r = 0;
+
+    if (ctx) {
+	r = *reds;
+	if (ctx->estack.start) {
+	    ESTACK_RESTORE(s, &ctx->estack);
+	    ep = ctx->ep;
+	    goto outer_loop;
+	}
+    }
 
     goto L_jump_start;
 
  outer_loop:
     while (!ESTACK_ISEMPTY(s)) {
+	if (ctx && --r <= 0) {
+	    ctx->ep = ep;
+	    ESTACK_SAVE(s, &ctx->estack);
+	    *reds = 0;
+	    return 0;
+	}
 	obj = ESTACK_POP(s);
 	switch (val = ESTACK_POP(s)) {
 	case ENC_TERM:
@@ -1601,8 +2340,25 @@ enc_term(ErtsAtomCacheMap *acmp, Eterm obj, byte* ep, Uint32 dflags)
 		Uint bitoffs;
 		Uint bitsize;
 		byte* bytes;
-
+		ProcBin *pb;
+
+		if (brefs && (pb = ext_ref_binary(obj, &j)) != NULL) {
+		    ErtsDistOutputRef *ref = brefs->refs++;
+		    if (pb->flags)
+			erts_emasculate_writable_binary(pb);
+		    erts_refc_inc(&pb->val->refc, 2);
+		    ref->bin = pb->val;
+		    ref->bytes = pb->bytes + j;
+		    ref->size = binary_size(obj);
+		    *ep++ = BINARY_EXT;
+		    put_int32(ref->size, ep);
+		    ep += 4;
+		    ref->pos = ep;
+		    break;
+		}
 		ERTS_GET_BINARY_BYTES(obj, bytes, bitoffs, bitsize);
+		if (ctx)
+		    r -= binary_size(obj) / ERTS_EXT_BYTES_PER_LOOP;
 		if (bitsize == 0) {
 		    /* Plain old byte-sized binary. */
 		    *ep++ = BINARY_EXT;
@@ -1734,7 +2490,10 @@ enc_term(ErtsAtomCacheMap *acmp, Eterm obj, byte* ep, Uint32 dflags)
 	}
     }
     DESTROY_ESTACK(s);
-    return ep;
+    if (ctx)
+	*reds = r;
+    *res = ep;
+    return 1;
 }
 
 static Uint
@@ -1775,16 +2534,39 @@ is_external_string(Eterm list, int* p_is_string)
     return len;
 }
 
+/*
+ * Terms not yet decoded are linked through the words they are to be
+ * written to; next points to the first one. When ctx is given, the
+ * decode yields by saving ep and next in ctx once ctx->reds loops have
+ * been done, and continues from there when called again with the same
+ * ctx. The heap words between *hpp and the end of the area allocated
+ * for the term are then not initialized.
+ */
 static byte*
-dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Eterm* objp)
+dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap,
+	 Eterm* objp, B2TDecodeContext *ctx)
 {
     int n;
     register Eterm* hp = *hpp;	/* Please don't take the address of hp */
-    Eterm* next = objp;
+    Eterm* next;
 
-    *next = (Eterm) NULL;
+    if (ctx && ctx->next) {
+	ep = ctx->ep;
+	next = ctx->next;
+	ctx->next = NULL;
+    }
+    else {
+	next = objp;
+	*next = (Eterm) NULL;
+    }
 
     while (next != NULL) {
+	if (ctx && --ctx->reds <= 0) {
+	    ctx->ep = ep;
+	    ctx->next = next;
+	    *hpp = hp;
+	    return ep;
+	}
 	objp = next;
 	next = (Eterm *) (*objp);
 
@@ -2114,14 +2896,34 @@ dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Et
 		if (n <= ERL_ONHEAP_BIN_LIMIT || off_heap == NULL) {
 		    ErlHeapBin* hb = (ErlHeapBin *) hp;
 
+		    if (ctx)
+			ctx->reds -= n / ERTS_EXT_BYTES_PER_LOOP;
 		    hb->thing_word = header_heap_bin(n);
 		    hb->size = n;
 		    hp += heap_bin_size(n);
 		    sys_memcpy(hb->data, ep, n);
 		    *objp = make_binary(hb);
+		} else if (edep && edep->bin
+			   && n >= ERTS_EXT_BIN_REF_MIN
+			   && 4*((long) n) >= edep->bin->orig_size) {
+		    /* Refer to the data in the binary it arrived in */
+		    ProcBin* pb;
+		    erts_refc_inc(&edep->bin->refc, 2);
+		    pb = (ProcBin *) hp;
+		    hp += PROC_BIN_SIZE;
+		    pb->thing_word = HEADER_PROC_BIN;
+		    pb->size = n;
+		    pb->next = off_heap->mso;
+		    off_heap->mso = pb;
+		    pb->val = edep->bin;
+		    pb->bytes = ep;
+		    pb->flags = 0;
+		    *objp = make_binary(pb);
 		} else {
 		    Binary* dbin = erts_bin_nrml_alloc(n);
 		    ProcBin* pb;
+		    if (ctx)
+			ctx->reds -= n / ERTS_EXT_BYTES_PER_LOOP;
 		    dbin->flags = 0;
 		    dbin->orig_size = n;
 		    erts_refc_init(&dbin->refc, 1);
@@ -2206,7 +3008,7 @@ dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Et
 		    goto error;
 		}
 		*hpp = hp;
-		ep = dec_term(edep, hpp, ep, off_heap, &temp);
+		ep = dec_term(edep, hpp, ep, off_heap, &temp, NULL);
 		hp = *hpp;
 		if (ep == NULL) {
 		    return NULL;
@@ -2266,7 +3068,7 @@ dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Et
 		module = temp;
 
 		/* Index */
-		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp)) == NULL) {
+		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp, NULL)) == NULL) {
 		    goto error;
 		}
 		if (!is_small(temp)) {
@@ -2275,7 +3077,7 @@ dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Et
 		old_index = unsigned_val(temp);
 
 		/* Uniq */
-		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp)) == NULL) {
+		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp, NULL)) == NULL) {
 		    goto error;
 		}
 		if (!is_small(temp)) {
@@ -2358,7 +3160,7 @@ dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Et
 		module = temp;
 
 		/* Index */
-		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp)) == NULL) {
+		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp, NULL)) == NULL) {
 		    goto error;
 		}
 		if (!is_small(temp)) {
@@ -2367,7 +3169,7 @@ dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Et
 		old_index = unsigned_val(temp);
 
 		/* Uniq */
-		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp)) == NULL) {
+		if ((ep = dec_term(edep, hpp, ep, off_heap, &temp, NULL)) == NULL) {
 		    goto error;
 		}
 		if (!is_small(temp)) {
@@ -2421,15 +3223,47 @@ dec_term(ErtsDistExternal *edep, Eterm** hpp, byte* ep, ErlOffHeap* off_heap, Et
 
 static Uint
 encode_size_struct2(ErtsAtomCacheMap *acmp, Eterm obj, unsigned dflags)
+{
+    Uint res;
+    (void) encode_size_struct_int(NULL, acmp, obj, dflags, NULL, NULL, &res);
+    return res;
+}
+
+/*
+ * When ctx is given, the calculation yields by saving its state in ctx
+ * and returning 0 once *reds loops have been done. It continues when
+ * called again with the same ctx. ctx->estack.start must be NULL on the
+ * first call. Returns 1 with the size in *res when done.
+ */
+static int
+encode_size_struct_int(ErtsExtSizeContext *ctx, ErtsAtomCacheMap *acmp,
+		       Eterm obj, unsigned dflags, ErtsExtBinRefs *brefs,
+		       Sint *reds, Uint *res)
 {
     DECLARE_ESTACK(s);
     Uint m, i, arity;
     Uint result = 0;
+    Sint r = 0;
+
+    if (ctx) {
+	r = *reds;
+	if (ctx->estack.start) {
+	    ESTACK_RESTORE(s, &ctx->estack);
+	    result = ctx->result;
+	    goto outer_loop;
+	}
+    }
 
     goto L_jump_start;
 
  outer_loop:
     while (!ESTACK_ISEMPTY(s)) {
+	if (ctx && --r <= 0) {
+	    ctx->result = result;
+	    ESTACK_SAVE(s, &ctx->estack);
+	    *reds = 0;
+	    return 0;
+	}
 	obj = ESTACK_POP(s);
 
     handle_popped_obj:
@@ -2552,8 +3386,14 @@ encode_size_struct2(ErtsAtomCacheMap *acmp, Eterm obj, unsigned dflags)
 	    }
 	    break;
 	case BINARY_DEF:
-	    result += 1 + 4 + binary_size(obj) +
-		5;			/* For unaligned binary */
+	    if (brefs && ext_ref_binary(obj, &m)) {
+		brefs->no++;
+		brefs->size += binary_size(obj);
+		result += 1 + 4;
+	    }
+	    else
+		result += 1 + 4 + binary_size(obj) +
+		    5;			/* For unaligned binary */
 	    break;
 	case FUN_DEF:
 	    {
@@ -2617,14 +3457,22 @@ encode_size_struct2(ErtsAtomCacheMap *acmp, Eterm obj, unsigned dflags)
     }
 
     DESTROY_ESTACK(s);
-    return result;
+    if (ctx)
+	*reds = r;
+    *res = result;
+    return 1;
 }
 
+/*
+ * When ctx is given, the scan starts at ctx->ep in the state saved in
+ * ctx, and returns B2T_YIELD with the state saved in ctx once ctx->reds
+ * loops have been done.
+ */
 static Sint
-decoded_size(byte *ep, byte* endp, int no_refc_bins)
+decoded_size(byte *ep, byte* endp, int no_refc_bins, B2TSizeContext *ctx)
 {
-    int heap_size = 0;
-    int terms;
+    Sint heap_size = 0;
+    int terms = 1;
     int atom_extra_skip = 0;
     Uint n;
 
@@ -2656,9 +3504,23 @@ decoded_size(byte *ep, byte* endp, int no_refc_bins)
     } while (0)
 
 
-    for (terms=1; terms > 0; terms--) {
+    if (ctx) {
+	ep = ctx->ep;
+	heap_size = ctx->heap_size;
+	terms = ctx->terms;
+	atom_extra_skip = ctx->atom_extra_skip;
+    }
+
+    for (; terms > 0; terms--) {
 	int tag;
 
+	if (ctx && --ctx->reds <= 0) {
+	    ctx->ep = ep;
+	    ctx->heap_size = heap_size;
+	    ctx->terms = terms;
+	    ctx->atom_extra_skip = atom_extra_skip;
+	    return B2T_YIELD;
+	}
 	CHKSIZE(1);
 	tag = ep++[0];
 	switch (tag) {
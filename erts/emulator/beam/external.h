@@ -53,8 +53,17 @@
 #define FUN_EXT           'u'
 
 #define DIST_HEADER       'D'
+#define DIST_FRAG_HEADER  'E'
+#define DIST_FRAG_CONT    'F'
+
+/* Size of sequence id and fragment id in fragment headers */
+#define ERTS_DIST_FRAG_IDS_SIZE (8+8)
 #define ATOM_CACHE_REF    'R'
 #define COMPRESSED        'P'
+#define COMPRESSED_LZ     'L'
+
+/* Dist messages smaller than this are not LZ compressed */
+#define ERTS_DIST_LZ_MIN_SIZE 1024
 
 #if 0
 /* Not used anymore */
@@ -78,9 +87,21 @@
 
 #define ERTS_ATOM_CACHE_SIZE 2048
 
+/*
+ * The output cache is set associative; an atom may be placed in any
+ * of the ERTS_ATOM_CACHE_WAYS entries of its set. The receiver does not
+ * care about how cache indices are chosen.
+ */
+#define ERTS_ATOM_CACHE_WAYS 4
+#define ERTS_ATOM_CACHE_SETS (ERTS_ATOM_CACHE_SIZE/ERTS_ATOM_CACHE_WAYS)
+
 typedef struct cache {
     Eterm in_arr[ERTS_ATOM_CACHE_SIZE];
     Eterm out_arr[ERTS_ATOM_CACHE_SIZE];
+    Uint32 out_used[ERTS_ATOM_CACHE_SIZE]; /* out_clock at last use */
+    Uint32 out_clock;			   /* Incremented per header */
+    Uint out_hits;
+    Uint out_misses;
 } ErtsAtomCache;
 
 typedef struct {
@@ -110,6 +131,7 @@ typedef struct {
     byte *ext_endp;
     Sint heap_size;
     Uint32 flags;
+    struct binary *bin;		/* Binary holding the data, if any */
     ErtsAtomTranslationTable attab;
 } ErtsDistExternal;
 
@@ -131,6 +153,42 @@ typedef struct {
     int exttmp;
 } ErtsBinary2TermState;
 
+/*
+ * Encoding and decoding of large terms yield. The work done is counted
+ * in loops, roughly one per term; a BIF is allowed
+ * ERTS_EXT_LOOP_FACTOR loops per reduction it has left.
+ */
+#define ERTS_EXT_LOOP_FACTOR 16
+
+/* Saved state of a yielding external size calculation */
+typedef struct {
+    ErtsEStack estack;
+    Uint result;
+} ErtsExtSizeContext;
+
+/* Saved state of a yielding encode */
+typedef struct {
+    ErtsEStack estack;
+    byte *ep;
+} ErtsExtEncodeContext;
+
+/*
+ * Byte sized refc binaries of at least ERTS_EXT_BIN_REF_MIN bytes are
+ * not copied into a dist output buffer when the dist encoding functions
+ * are passed an ErtsExtBinRefs. Sizing counts them in no, and their
+ * bytes in size instead of in the returned size. Encoding writes only
+ * their BINARY_EXT headers and records them at refs, which is advanced.
+ * Received binaries of that size are decoded into references to the
+ * binary that the dist message arrived in, if it is not much larger.
+ */
+#define ERTS_EXT_BIN_REF_MIN (4*1024)
+
+typedef struct {
+    Uint no;
+    Uint size;
+    ErtsDistOutputRef *refs;
+} ErtsExtBinRefs;
+
 /* -------------------------------------------------------------------------- */
 
 void erts_init_atom_cache_map(ErtsAtomCacheMap *);
@@ -141,9 +199,22 @@ Uint erts_encode_ext_dist_header_size(ErtsAtomCacheMap *);
 
 Uint erts_encode_ext_dist_header_size(ErtsAtomCacheMap *);
 byte *erts_encode_ext_dist_header_setup(byte *, ErtsAtomCacheMap *);
+byte *erts_encode_ext_dist_frag_header_setup(byte *, ErtsAtomCacheMap *,
+					     Uint64, Uint64);
 byte *erts_encode_ext_dist_header_finalize(byte *, ErtsAtomCache *);
-Uint erts_encode_dist_ext_size(Eterm, Uint32, ErtsAtomCacheMap *);
-void erts_encode_dist_ext(Eterm, byte **, Uint32, ErtsAtomCacheMap *);
+Uint erts_encode_dist_ext_size(Eterm, Uint32, ErtsAtomCacheMap *,
+			       ErtsExtBinRefs *);
+void erts_encode_dist_ext(Eterm, byte **, Uint32, ErtsAtomCacheMap *,
+			  ErtsExtBinRefs *);
+int erts_encode_dist_ext_size_int(Eterm, Uint32, ErtsAtomCacheMap *,
+				  ErtsExtBinRefs *, ErtsExtSizeContext *,
+				  Sint *, Uint *);
+int erts_encode_dist_ext_int(Eterm, byte **, Uint32, ErtsAtomCacheMap *,
+			     ErtsExtBinRefs *, ErtsExtEncodeContext *,
+			     Sint *);
+void erts_encode_dist_ext_compress(byte *, byte **, Uint32);
+int erts_dist_ext_uncompress(ErtsDistExternal *, byte **);
+ErtsDistExternal *erts_uncompress_dist_ext_copy(ErtsDistExternal *);
 
 Uint erts_encode_ext_size(Eterm);
 void erts_encode_ext(Eterm, byte **);
@@ -151,10 +222,9 @@ void erts_encode_ext(Eterm, byte **);
 #ifdef ERTS_WANT_EXTERNAL_TAGS
 ERTS_GLB_INLINE void erts_peek_dist_header(ErtsDistHeaderPeek *, byte *, Uint);
 #endif
-ERTS_GLB_INLINE void erts_free_dist_ext_copy(ErtsDistExternal *);
 ERTS_GLB_INLINE void *erts_dist_ext_trailer(ErtsDistExternal *);
 ErtsDistExternal *erts_make_dist_ext_copy(ErtsDistExternal *, Uint);
-void *erts_dist_ext_trailer(ErtsDistExternal *);
+void erts_free_dist_ext_copy(ErtsDistExternal *);
 void erts_destroy_dist_ext_copy(ErtsDistExternal *);
 int erts_prepare_dist_ext(ErtsDistExternal *, byte *, Uint,
 			  DistEntry *, ErtsAtomCache *);
@@ -164,6 +234,7 @@ Eterm erts_decode_dist_ext(Eterm **, ErlOffHeap *, ErtsDistExternal *);
 Sint erts_decode_ext_size(byte*, Uint, int);
 Eterm erts_decode_ext(Eterm **, ErlOffHeap *, byte**);
 
+void erts_init_external(void);
 Eterm erts_term_to_binary(Process* p, Eterm Term, int level, Uint flags);
 
 Sint erts_binary2term_prepare(ErtsBinary2TermState *, byte *, Sint);
@@ -189,19 +260,14 @@ erts_peek_dist_header(ErtsDistHeaderPeek *dhpp, byte *ext, Uint sz)
 }
 #endif
 
-ERTS_GLB_INLINE void
-erts_free_dist_ext_copy(ErtsDistExternal *edep)
-{
-    if (edep->dep)
-	erts_deref_dist_entry(edep->dep);
-    erts_free(ERTS_ALC_T_EXT_TERM_DATA, edep);
-}
-
+/* A copy that refers to a binary has its trailer right after itself */
 ERTS_GLB_INLINE void *
 erts_dist_ext_trailer(ErtsDistExternal *edep)
 {
-    void *res = (void *) (edep->ext_endp
-			  + ERTS_WORD_ALIGN_PAD_SZ(edep->ext_endp));
+    byte *endp = (edep->bin
+		  ? ((byte *) edep) + ERTS_DIST_EXT_SIZE(edep)
+		  : edep->ext_endp);
+    void *res = (void *) (endp + ERTS_WORD_ALIGN_PAD_SZ(endp));
     ASSERT((((Uint) res) % sizeof(Uint)) == 0);
     return res;
 }
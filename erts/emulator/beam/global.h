@@ -684,6 +684,48 @@ do {									\
 #define ESTACK_ISEMPTY(s) (ESTK_CONCAT(s,_sp) == ESTK_CONCAT(s,_start))
 #define ESTACK_POP(s) (*(--ESTK_CONCAT(s,_sp)))
 
+/*
+ * An ESTACK can be saved in an ErtsEStack (see sys.h) when an operation
+ * using it yields, and be restored into a stack declared in the C
+ * function continuing the operation. A saved stack is always allocated
+ * on the heap; DESTROY_SAVED_ESTACK() frees it.
+ */
+
+#define ESTACK_SAVE(s, dst)						\
+do {									\
+    if (ESTK_CONCAT(s,_start) == ESTK_CONCAT(s,_default_stack)) {	\
+	Uint _sz = ESTK_CONCAT(s,_sp) - ESTK_CONCAT(s,_start);		\
+	(dst)->start = erts_alloc(ERTS_ALC_T_ESTACK,			\
+				  2*DEF_ESTACK_SIZE*sizeof(Eterm));	\
+	sys_memcpy((dst)->start, ESTK_CONCAT(s,_start),			\
+		   _sz*sizeof(Eterm));					\
+	(dst)->sp = (dst)->start + _sz;					\
+	(dst)->end = (dst)->start + 2*DEF_ESTACK_SIZE;			\
+    }									\
+    else {								\
+	(dst)->start = ESTK_CONCAT(s,_start);				\
+	(dst)->sp = ESTK_CONCAT(s,_sp);					\
+	(dst)->end = ESTK_CONCAT(s,_end);				\
+    }									\
+} while(0)
+
+#define ESTACK_RESTORE(s, src)						\
+do {									\
+    ASSERT(ESTK_CONCAT(s,_start) == ESTK_CONCAT(s,_default_stack));	\
+    ESTK_CONCAT(s,_start) = (src)->start;				\
+    ESTK_CONCAT(s,_sp) = (src)->sp;					\
+    ESTK_CONCAT(s,_end) = (src)->end;					\
+    (src)->start = NULL;						\
+} while(0)
+
+#define DESTROY_SAVED_ESTACK(src)					\
+do {									\
+    if ((src)->start) {							\
+	erts_free(ERTS_ALC_T_ESTACK, (src)->start);			\
+	(src)->start = NULL;						\
+    }									\
+} while(0)
+
 
 /* port status flags */
 
@@ -795,6 +837,8 @@ Eterm copy_object(Eterm, Process*);
 Uint size_object(Eterm);
 Eterm copy_struct(Eterm, Uint, Eterm**, ErlOffHeap*);
 Eterm copy_shallow(Eterm*, Uint, Eterm**, ErlOffHeap*);
+Uint size_object_shared(Eterm);
+Eterm copy_struct_shared(Eterm, Uint, Eterm**, ErlOffHeap*);
 
 #ifdef HYBRID
 #define RRMA_DEFAULT_SIZE 256
@@ -914,7 +958,8 @@ extern int erts_do_net_exits(DistEntry*, Eterm);
 extern int distribution_info(int, void *);
 extern int is_node_name_atom(Eterm a);
 
-extern int erts_net_message(Port *, DistEntry *, byte *, int, byte *, int);
+extern int erts_net_message(Port *, DistEntry *, byte *, int, Binary *,
+			    byte *, int);
 
 extern void init_dist(void);
 extern int stop_dist(void);
@@ -985,7 +1030,10 @@ void erts_init_gc(void);
 int erts_garbage_collect(Process*, int, Eterm*, int);
 void erts_garbage_collect_hibernate(Process* p);
 Eterm erts_gc_after_bif_call(Process* p, Eterm result, Eterm* regs, Uint arity);
-void erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size);
+void erts_garbage_collect_literals(Process* p, Eterm* literals, Uint lit_size,
+				   Eterm* objv, int nobj);
+void erts_proc_ref_literal_area(Process* p, ErtsLiteralArea* area);
+void erts_release_literal_area_refs(ErtsLiteralAreaRef* refs);
 Uint erts_next_heap_size(Uint, Uint);
 Eterm erts_heap_sizes(Process* p);
 
@@ -997,6 +1045,9 @@ void erts_offset_heap(Eterm*, Uint, Sint, Eterm*, Eterm*);
 int erts_global_garbage_collect(Process*, int, Eterm*, int);
 #endif
 
+/* erl_shared_term.c */
+void erts_free_shared_term_area(ErtsLiteralArea* area);
+
 /* io.c */
 
 struct erl_drv_port_data_lock {
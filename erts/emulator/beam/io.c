@@ -3184,6 +3184,7 @@ int driver_output_binary(ErlDrvPort ix, char* hbuf, int hlen,
 	return erts_net_message(prt,
 				prt->dist_entry,
 				(byte*) hbuf, hlen,
+				ErlDrvBinary2Binary(bin),
 				(byte*) (bin->orig_bytes+offs), len);
     }
     else
@@ -3219,12 +3220,12 @@ int driver_output2(ErlDrvPort ix, char* hbuf, int hlen, char* buf, int len)
 	if (len == 0)
 	    return erts_net_message(prt,
 				    prt->dist_entry,
-				    NULL, 0,
+				    NULL, 0, NULL,
 				    (byte*) hbuf, hlen);
 	else
 	    return erts_net_message(prt,
 				    prt->dist_entry,
-				    (byte*) hbuf, hlen,
+				    (byte*) hbuf, hlen, NULL,
 				    (byte*) buf, len);
     }
     else if(prt->status & ERTS_PORT_SFLG_LINEBUF_IO)
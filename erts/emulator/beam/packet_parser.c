@@ -74,7 +74,10 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define HTTP_METH_HASH_SIZE 13
 #define HTTP_MAX_NAME_LEN 20
 
-static char tspecial[128];
+/* Indexed by any byte value, set up by http_init() */
+static char tspecial[256];
+static unsigned char http_upper[256];
+static unsigned char http_lower[256];
 
 static const char* http_hdr_strings[] = {
     "Cache-Control",
@@ -153,15 +156,12 @@ static http_atom_t* http_meth_hash[HTTP_METH_HASH_SIZE];
 #define CRNL(ptr) (((ptr)[0] == '\r') && ((ptr)[1] == '\n'))
 #define NL(ptr)   ((ptr)[0] == '\n')
 #define SP(ptr)   (((ptr)[0] == ' ') || ((ptr)[0] == '\t'))
-#define is_tspecial(x) ((((x) > 32) && ((x) < 128)) ? tspecial[(x)] : 1)
+#define is_tspecial(x) (tspecial[(unsigned char)(x)])
 
+/* Header names are short and the tables small, so a multiply and an
+ * add per character is enough; no need to fold the high bits. */
 #define hash_update(h,c) do { \
-        unsigned long __g; \
-        (h) = ((h) << 4) + (c); \
-        if ((__g = (h) & 0xf0000000)) { \
-            (h) ^= (__g >> 24); \
-            (h) ^= __g; \
-        } \
+        (h) = (h) * 31 + (c); \
     } while(0)
 
 static void http_hash_insert(const char* name, http_atom_t* entry,
@@ -194,10 +194,11 @@ static int http_init(void)
     int i;
     unsigned char* ptr;
 
-    for (i = 0; i < 33; i++)
-        tspecial[i] = 1;
-    for (i = 33; i < 127; i++)
-        tspecial[i] = 0;
+    for (i = 0; i < 256; i++) {
+        tspecial[i] = (i < 33 || i > 127);
+        http_upper[i] = (i >= 'a' && i <= 'z') ? i - 'a' + 'A' : i;
+        http_lower[i] = (i >= 'A' && i <= 'Z') ? i - 'A' + 'a' : i;
+    }
     for (ptr = (unsigned char*)"()<>@,;:\\\"/[]?={} \t"; *ptr != '\0'; ptr++)
         tspecial[*ptr] = 1;
 
@@ -496,13 +497,26 @@ static http_atom_t* http_hash_lookup(const char* name, int len,
 
     while (ap != NULL) {
         if ((ap->h == h) && (ap->len == len) && 
-            (strncmp(ap->name, name, len) == 0))
+            (sys_memcmp(ap->name, name, len) == 0))
             return ap;
         ap = ap->next;
     }
     return NULL;
 }
 
+/* First space or tab in ptr[0..n), or ptr+n if there is none. The two
+ * memchr calls are cheaper than a byte loop on anything but very short
+ * strings, and tabs are rare enough that the second one is usually
+ * over the same range as the first. */
+static const char* http_find_sp(const char* ptr, int n)
+{
+    const char* sp = memchr(ptr, ' ', n);
+    const char* tab = memchr(ptr, '\t', (sp == NULL) ? n : (sp - ptr));
+    if (tab != NULL)
+        return tab;
+    return (sp == NULL) ? ptr + n : sp;
+}
+
 static void
 http_parse_absoluteURI(PacketHttpURI* uri, const char* uri_ptr, int uri_len)
 {
@@ -699,7 +713,7 @@ int packet_parse_http(const char* buf, int len, int* statep,
             int minor  = 0;
             unsigned long h = 0;
 
-            while (n && !is_tspecial((unsigned char)*ptr)) {
+            while (n && !is_tspecial(*ptr)) {
                 hash_update(h, (int)*ptr);
                 ptr++;
                 n--;
@@ -714,9 +728,9 @@ int packet_parse_http(const char* buf, int len, int* statep,
                 ptr++; n--;
             }
             uri_ptr = ptr;
-            while (n && !SP(ptr)) {
-                ptr++; n--;
-            }
+            p0 = http_find_sp(ptr, n);
+            n -= p0 - ptr;
+            ptr = p0;
             if ((uri_len = (ptr - uri_ptr)) == 0)
                 return -1;
             while (n && SP(ptr)) {
@@ -760,11 +774,14 @@ int packet_parse_http(const char* buf, int len, int* statep,
         }
     }
     else {
-        int up = 1;      /* make next char uppercase */
+        int up;          /* make next char uppercase */
         http_atom_t* name;
         char name_buf[HTTP_MAX_NAME_LEN];
         const char* name_ptr = name_buf;
+        const char* colon;
         int  name_len;
+        int  fold_len;
+        int  i;
         unsigned long h;
 
         if (n == 0) {
@@ -772,36 +789,40 @@ int packet_parse_http(const char* buf, int len, int* statep,
             *statep = 0;  /* reset state (for next request) */
             return pcb->http_eoh(arg);
         }
+        /* Header = Name SP* ':' Value. The name is known to end at the
+         * first ':', so it is checked and case adjusted in a loop with
+         * no end of buffer test. */
+        if ((colon = memchr(ptr, ':', n)) == NULL)
+            return -1;
+        name_len = colon - ptr;
+        while (name_len && SP(ptr + name_len - 1)) { /* Space before ':' */
+            name_len--;
+        }
+        fold_len = (name_len < HTTP_MAX_NAME_LEN) ? name_len
+                                                  : HTTP_MAX_NAME_LEN;
+        for (i = fold_len; i < name_len; i++) {
+            if (is_tspecial(ptr[i]))
+                return -1;
+        }
         h = 0;
-        name_len = 0;
-        while (!is_tspecial((unsigned char)*ptr)) {
-            if (name_len < HTTP_MAX_NAME_LEN) {
-                int c = *ptr;
-                if (up) {
-                    if (islower(c)) {
-                        c = toupper(c);
-                    }
-                    up = 0;
-                }
-                else {
-                    if (isupper(c))
-                        c = tolower(c);
-                    else if (c == '-')
-                        up = 1;
-                }                            
-                name_buf[name_len] = c;
-                hash_update(h, c);
+        up = 1;
+        for (i = 0; i < fold_len; i++) {
+            int c = (unsigned char) ptr[i];
+            if (is_tspecial(c))
+                return -1;
+            if (up) {
+                c = http_upper[c];
+                up = 0;
             }
-            name_len++;
-            ptr++;
-            if (--n == 0) return -1;
-        }
-        while (n && SP(ptr)) { /* Skip white space before ':' */
-            ptr++; n--;
-        } 
-        if (*ptr != ':') {
-            return -1;
+            else {
+                c = http_lower[c];
+                up = (c == '-');
+            }
+            name_buf[i] = c;
+            hash_update(h, c);
         }
+        n -= colon - ptr;
+        ptr = colon;
         if (name_len <= HTTP_MAX_NAME_LEN) {
             name = http_hash_lookup(name_buf, name_len, h,
                                     http_hdr_hash, HTTP_HDR_HASH_SIZE);
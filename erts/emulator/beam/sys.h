@@ -307,6 +307,13 @@ typedef unsigned char byte;
 #error Found no appropriate type to use for 'byte'
 #endif
 
+/* A saved ESTACK (see global.h) */
+typedef struct {
+    Eterm* start;
+    Eterm* sp;
+    Eterm* end;
+} ErtsEStack;
+
 #if defined(ARCH_64) && !HAVE_INT64
 #error 64-bit architecture, but no appropriate type to use for Uint64 and Sint64 found 
 #endif
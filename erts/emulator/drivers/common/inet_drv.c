@@ -48,6 +48,10 @@
 #ifdef HAVE_SYS_UIO_H
 #include <sys/uio.h>
 #endif
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#define HAVE_INET_SENDFILE
+#endif
 #endif
 
 
@@ -189,6 +193,14 @@ static unsigned long one_value = 1;
 #ifndef _OSE_
 #include <sys/socket.h>
 #include <netinet/in.h>
+#ifdef HAVE_SYS_UN_H
+#include <stddef.h>
+#include <sys/un.h>
+#define HAVE_INET_LOCAL
+#ifdef SCM_RIGHTS
+#define HAVE_INET_FDPASS /* descriptors passed over local sockets */
+#endif
+#endif
 #else
 /* datatypes and macros from Solaris socket.h */
 struct  linger {
@@ -397,6 +409,15 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define sock_recvfrom(s,buf,blen,flag,addr,alen) \
                 recvfrom((s),(buf),(blen),(flag),(addr),(alen))
 #define sock_recvmsg(s,msghdr,flag) recvmsg((s),(msghdr),(flag))
+#ifdef HAVE_RECVMMSG
+#define sock_recvmmsg(s,vec,vlen,flag) recvmmsg((s),(vec),(vlen),(flag),NULL)
+#endif
+#ifdef HAVE_SENDMMSG
+#define sock_sendmmsg(s,vec,vlen,flag) sendmmsg((s),(vec),(vlen),(flag))
+#endif
+#ifdef HAVE_INET_SENDFILE
+#define sock_sendfile(s,fd,offp,len) sendfile((s),(fd),(offp),(len))
+#endif
 
 #define sock_errno()                errno
 #define sock_create_event(d)        ((d)->s) /* return file descriptor */
@@ -444,6 +465,7 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define INET_AF_INET6       2
 #define INET_AF_ANY         3 /* INADDR_ANY or IN6ADDR_ANY_INIT */
 #define INET_AF_LOOPBACK    4 /* INADDR_LOOPBACK or IN6ADDR_LOOPBACK_INIT */
+#define INET_AF_LOCAL       5 /* AF_UNIX */
 
 /* INET_REQ_GETTYPE enumeration */
 #define INET_TYPE_STREAM    1
@@ -462,6 +484,9 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define INET_PASSIVE        0  /* false */
 #define INET_ACTIVE         1  /* true */
 #define INET_ONCE           2  /* true; active once then passive */
+#define INET_MULTI          3  /* true; active N then passive */
+
+#define INET_MAX_ACTIVE_COUNT 32767 /* max N in {active, N} */
 
 /* INET_REQ_GETSTATUS enumeration */
 #define INET_F_OPEN         0x0001
@@ -501,6 +526,7 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define INET_REQ_IFGET         22
 #define INET_REQ_IFSET         23
 #define INET_REQ_SUBSCRIBE     24
+#define INET_REQ_GETBUFSTAT    25
 /* TCP requests */
 #define TCP_REQ_ACCEPT         40
 #define TCP_REQ_LISTEN         41
@@ -508,10 +534,14 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define TCP_REQ_UNRECV         43
 #define TCP_REQ_SHUTDOWN       44
 #define TCP_REQ_MULTI_OP       45
+#define TCP_REQ_SENDFILE       46
+#define TCP_REQ_SENDFD         47
+#define TCP_REQ_RECVFD         48
 /* UDP and SCTP requests */
 #define PACKET_REQ_RECV        60 /* Common for UDP and SCTP         */
 #define SCTP_REQ_LISTEN	       61 /* Different from TCP; not for UDP */
 #define SCTP_REQ_BINDX	       62 /* Multi-home SCTP bind            */
+#define UDP_REQ_SENDMULTI      63 /* Send a list of datagrams (UDP)  */
 
 /* INET_REQ_SUBSCRIBE sub-requests */
 #define INET_SUBS_EMPTY_OUT_Q  1
@@ -561,6 +591,8 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define INET_LOPT_UDP_READ_PACKETS 33  /* Number of packets to read */
 #define INET_OPT_RAW               34  /* Raw socket options */
 #define INET_LOPT_TCP_SEND_TIMEOUT_CLOSE 35  /* auto-close on send timeout or not */
+#define INET_LOPT_TCP_DELAY_SEND_THRESHOLD 36 /* Write delayed sends at this size */
+#define INET_OPT_REUSEPORT         37  /* enable/disable local port sharing */
 /* SCTP options: a separate range, from 100: */
 #define SCTP_OPT_RTOINFO		100
 #define SCTP_OPT_ASSOCINFO		101
@@ -669,6 +701,8 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 #define INET_DEF_BUFFER     1460        /* default buffer size */
 #define INET_MIN_BUFFER     1           /* internal min buffer */
 #define INET_MAX_BUFFER     (1024*64)   /* internal max buffer */
+#define INET_SHRINK_READS   4           /* small reads before a TCP input
+					   buffer shrinks */
 
 /* Note: INET_HIGH_WATERMARK MUST be less than 2*INET_MAX_BUFFER */
 #define INET_HIGH_WATERMARK (1024*8) /* 8k pending high => busy  */
@@ -683,6 +717,10 @@ static int my_strncasecmp(const char *s1, const char *s2, size_t n)
 
 /* INET_LOPT_UDP_PACKETS */
 #define INET_PACKET_POLL     5   /* maximum number of packets to poll */
+#define INET_MMSG_LEN        64  /* max datagrams per recvmmsg/sendmmsg */
+
+/* Max received descriptors kept per local socket (TCP_REQ_RECVFD) */
+#define INET_MAX_FDS         16
 
 /* Max interface name */
 #define INET_IFNAMSIZ          16
@@ -704,8 +742,15 @@ typedef union {
 #ifdef HAVE_IN6
     struct sockaddr_in6 sai6;
 #endif
+#ifdef HAVE_INET_LOCAL
+    struct sockaddr_un sal;
+#endif
 } inet_address;
 
+/* Room for an address as encoded by inet_get_address, [F,P1,P0,...];
+ * a local address is [F,0,0,Len,Path...] */
+#define INET_ADDRESS_BUFSZ  (sizeof(inet_address) + 4)
+
 
 /* for AF_INET & AF_INET6 */
 #define inet_address_port(x) ((x)->sai.sin_port)
@@ -795,7 +840,9 @@ typedef struct {
     inet_async_op* opt;          /* queue tail or NULL */
     inet_async_op  op_queue[INET_MAX_ASYNC];  /* call queue */
 
-    int   active;               /* 0 = passive, 1 = active, 2 = active once */
+    int   active;               /* 0 = passive, 1 = active, 2 = active once,
+				   3 = active n */
+    int   active_count;         /* n in {active, n} */
     int   stype;                /* socket type:
 				    SOCK_STREAM/SOCK_DGRAM/SOCK_SEQPACKET   */
     int   sprotocol;            /* socket protocol:
@@ -842,9 +889,14 @@ typedef struct {
 
 #define TCP_MAX_PACKET_SIZE 0x4000000  /* 64 M */
 
-#define MAX_VSIZE 16		/* Max number of entries allowed in an I/O
-				 * vector sock_sendv().
-				 */
+/* Max number of entries allowed in an I/O vector sock_sendv(); large
+ * enough to write many queued packets (header and data) in one call.
+ */
+#if defined(IOV_MAX) && IOV_MAX < 64
+#define MAX_VSIZE IOV_MAX
+#else
+#define MAX_VSIZE 64
+#endif
 
 static int tcp_inet_init(void);
 static void tcp_inet_stop(ErlDrvData);
@@ -987,6 +1039,23 @@ static struct erl_drv_entry sctp_inet_driver_entry =
 };
 #endif
 
+/*
+** A file being sent to a TCP socket. It is written after the data
+** queued before the request, and data sent after the request is
+** queued behind it.
+*/
+typedef struct {
+    int            active;      /* a sendfile is in progress */
+    int            fd;          /* file to send from */
+    ErlDrvSInt64   offset;      /* current position in the file */
+    ErlDrvUInt64   left;        /* bytes left to send; 0 = until eof */
+    int            eof;         /* send until end of file */
+    ErlDrvUInt64   sent;        /* bytes sent so far */
+    int            before;      /* queued bytes to write first */
+    int            id;          /* async id of the reply */
+    ErlDrvTermData caller;      /* process to reply to */
+} tcp_sendfile_op;
+
 typedef struct {
     inet_descriptor inet;       /* common data structure (DON'T MOVE) */
     int   high;                 /* high watermark */
@@ -995,20 +1064,35 @@ typedef struct {
     int   send_timeout_close;   /* auto-close socket on send_timeout */
     int   busy_on_send;         /* busy on send with timeout! */
     int   i_bufsz;              /* current input buffer size (<= bufsz) */
+    int   i_autosz;             /* size of the next input buffer, follows
+				   the reads (>= bufsz) */
+    int   i_small;              /* reads in a row much smaller than that */
     ErlDrvBinary* i_buf;        /* current binary buffer */
     char*         i_ptr;        /* current pos in buf */
     char*         i_ptr_start;  /* packet start pos in buf */
     int           i_remain;     /* remaining chars to read */
     int           tcp_add_flags;/* Additional TCP descriptor flags */
+    int           delay_send_threshold; /* With delay_send, write queued
+					   data when this much is queued;
+					   0 means wait for the next poll */
     int           http_state;   /* 0 = response|request  1=headers fields */
     inet_async_multi_op *multi_first;/* NULL == no multi-accept-queue, op is in ordinary queue */
     inet_async_multi_op *multi_last;
     MultiTimerData *mtd;        /* Timer structures for multiple accept */
+    tcp_sendfile_op sendfile;   /* file being sent, if any */
+#ifdef HAVE_INET_FDPASS
+    int           fd_count;     /* received descriptors not yet fetched */
+    int           fds[INET_MAX_FDS];
+#endif
 } tcp_descriptor;
 
 /* send function */
 static int tcp_send(tcp_descriptor* desc, char* ptr, int len);
 static int tcp_sendv(tcp_descriptor* desc, ErlIOVec* ev);
+static int tcp_sendfile_reply(tcp_descriptor* desc, ErlDrvTermData reason);
+#ifdef HAVE_INET_FDPASS
+static int tcp_send_fd(tcp_descriptor* desc, int fd, char* ptr, int len);
+#endif
 static int tcp_recv(tcp_descriptor* desc, int request_len);
 static int tcp_deliver(tcp_descriptor* desc, int len);
 
@@ -1042,11 +1126,17 @@ static ErlDrvTermData am_closed;
 static ErlDrvTermData am_tcp_closed;
 static ErlDrvTermData am_tcp_error;
 static ErlDrvTermData am_udp_error;
+static ErlDrvTermData am_tcp_passive;
+static ErlDrvTermData am_udp_passive;
 static ErlDrvTermData am_empty_out_q;
 static ErlDrvTermData am_ssl_tls;
+#ifdef HAVE_INET_LOCAL
+static ErlDrvTermData am_local;
+#endif
 #ifdef HAVE_SCTP
 static ErlDrvTermData am_sctp;
 static ErlDrvTermData am_sctp_error;
+static ErlDrvTermData am_sctp_passive;
 static ErlDrvTermData am_true;
 static ErlDrvTermData am_false;
 static ErlDrvTermData am_buffer;
@@ -1237,6 +1327,18 @@ static int load_ip_address(ErlDrvTermData* spec, int i, int family, char* buf)
 	spec[i++] = ERL_DRV_TUPLE;
 	spec[i++] = 8;
     }
+#endif
+#ifdef HAVE_INET_LOCAL
+    else if (family == AF_UNIX) {
+	/* buf = [Len,Path...] => {local, Path} */
+	spec[i++] = ERL_DRV_ATOM;
+	spec[i++] = am_local;
+	spec[i++] = ERL_DRV_BUF2BINARY;
+	spec[i++] = (ErlDrvTermData) (buf+1);
+	spec[i++] = (ErlDrvTermData) ((unsigned char)buf[0]);
+	spec[i++] = ERL_DRV_TUPLE;
+	spec[i++] = 2;
+    }
 #endif
     else {
 	spec[i++] = ERL_DRV_TUPLE;
@@ -1287,13 +1389,30 @@ static int load_ip_and_port
 
 /*
 ** Binary Buffer Managment
-** We keep a stack of usable buffers 
+** Each thread keeps its own cache of usable buffers, so that reading
+** a socket takes no lock. The buffers are kept in size classes of
+** powers of two, from 2k up to INET_MAX_BUFFER.
 */
-#define BUFFER_STACK_SIZE 16
+#define BUFFER_CLASS_SHIFT 11   /* 2k */
+#define BUFFER_CLASSES     6    /* 2k .. 64k */
+#define BUFFER_CLASS_SIZE(C) (1L << (BUFFER_CLASS_SHIFT + (C)))
+#define BUFFER_STACK_SIZE  16   /* max buffers cached per class */
+#define BUFFER_CACHE_HIGH  (1024*1024) /* max bytes cached per thread */
+
+typedef struct inet_buffer_cache {
+    struct inet_buffer_cache* next;  /* all caches, for statistics */
+    ErlDrvBinary* stack[BUFFER_CLASSES][BUFFER_STACK_SIZE];
+    int pos[BUFFER_CLASSES];
+    long bytes;               /* memory in the stacks */
+    /* Only updated by the owning thread; read by anyone */
+    unsigned long hits;       /* allocations served from the cache */
+    unsigned long misses;     /* allocations that found it empty */
+    unsigned long trims;      /* releases freed above the high water */
+} inet_buffer_cache;
 
 static erts_smp_spinlock_t inet_buffer_stack_lock;
-static ErlDrvBinary* buffer_stack[BUFFER_STACK_SIZE];
-static int buffer_stack_pos = 0;
+static ErlDrvTSDKey buffer_cache_key;
+static inet_buffer_cache* buffer_caches = NULL;
 
 
 /*
@@ -1338,51 +1457,78 @@ static int max_buf_allocated = 0; /* max allocated */
 
 #endif
 
-static ErlDrvBinary* alloc_buffer(long minsz)
+/* The cache of the calling thread, created on first use */
+static inet_buffer_cache* get_buffer_cache(void)
 {
-    ErlDrvBinary* buf = NULL;
+    inet_buffer_cache* bc = erl_drv_tsd_get(buffer_cache_key);
 
-    BUFSTK_LOCK;
+    if (bc == NULL) {
+	if ((bc = ALLOC(sizeof(inet_buffer_cache))) == NULL)
+	    return NULL;
+	sys_memzero((char*) bc, sizeof(inet_buffer_cache));
+	erl_drv_tsd_set(buffer_cache_key, bc);
+	BUFSTK_LOCK;
+	bc->next = buffer_caches;
+	buffer_caches = bc;
+	BUFSTK_UNLOCK;
+    }
+    return bc;
+}
+
+static ErlDrvBinary* alloc_buffer(long minsz)
+{
+    ErlDrvBinary* buf;
+    inet_buffer_cache* bc;
+    int c = 0;
 
     DEBUGF(("alloc_buffer: sz = %ld, tot = %d, max = %d\r\n", 
 	    minsz, tot_buf_allocated, max_buf_allocated));
 
-    if (buffer_stack_pos > 0) {
-	int origsz;
-
-	buf = buffer_stack[--buffer_stack_pos];
-	origsz = buf->orig_size;
-	BUFSTK_UNLOCK;
-	COUNT_BUF_STACK(-origsz);
-	if (origsz < minsz) {
-	    if ((buf = driver_realloc_binary(buf, minsz)) == NULL)
-		return NULL;
-	    COUNT_BUF_ALLOC(buf->orig_size - origsz);
-	}
-    }
-    else {
-	BUFSTK_UNLOCK;
-	if ((buf = driver_alloc_binary(minsz)) == NULL)
-	    return NULL;
-	COUNT_BUF_ALLOC(buf->orig_size);
-    }
+    if (minsz <= INET_MAX_BUFFER && (bc = get_buffer_cache()) != NULL) {
+	while (BUFFER_CLASS_SIZE(c) < minsz)
+	    c++;
+	if (bc->pos[c] > 0) {
+	    buf = bc->stack[c][--bc->pos[c]];
+	    bc->bytes -= buf->orig_size;
+	    bc->hits++;
+	    COUNT_BUF_STACK(-buf->orig_size);
+	    return buf;
+	}
+	bc->misses++;
+	/* Round up, so that the buffer can be reused for its class */
+	minsz = BUFFER_CLASS_SIZE(c);
+    }
+    if ((buf = driver_alloc_binary(minsz)) == NULL)
+	return NULL;
+    COUNT_BUF_ALLOC(buf->orig_size);
     return buf;
 }
 
 /*
-** Max buffer memory "cached" BUFFER_STACK_SIZE * INET_MAX_BUFFER
-** (16 * 64k ~ 1M)
+** Max buffer memory "cached" BUFFER_CACHE_HIGH per thread
 */
 /*#define CHECK_DOUBLE_RELEASE 1*/
 static void release_buffer(ErlDrvBinary* buf)
 {
+    inet_buffer_cache* bc;
+    int c = BUFFER_CLASSES-1;
+
     DEBUGF(("release_buffer: %ld\r\n", (buf==NULL) ? 0 : buf->orig_size));
     if (buf == NULL)
 	return;
-    BUFSTK_LOCK;
-    if ((buf->orig_size > INET_MAX_BUFFER) || 
-	(buffer_stack_pos >= BUFFER_STACK_SIZE)) {
-	BUFSTK_UNLOCK;
+    if ((buf->orig_size > INET_MAX_BUFFER) ||
+	(buf->orig_size < BUFFER_CLASS_SIZE(0)) ||
+	((bc = get_buffer_cache()) == NULL)) {
+	COUNT_BUF_FREE(buf->orig_size);
+	driver_free_binary(buf);
+	return;
+    }
+    /* A buffer shrunk by realloc_buffer goes to the class below */
+    while (BUFFER_CLASS_SIZE(c) > buf->orig_size)
+	c--;
+    if ((bc->pos[c] >= BUFFER_STACK_SIZE) ||
+	(bc->bytes + buf->orig_size > BUFFER_CACHE_HIGH)) {
+	bc->trims++;
 	COUNT_BUF_FREE(buf->orig_size);
 	driver_free_binary(buf);
     }
@@ -1392,20 +1538,50 @@ static void release_buffer(ErlDrvBinary* buf)
 #warning CHECK_DOUBLE_RELEASE is enabled, this is a custom build emulator
 #endif
 	int i;
-	for (i = 0; i < buffer_stack_pos; ++i) {
-	    if (buffer_stack[i] == buf) {
+	for (i = 0; i < bc->pos[c]; ++i) {
+	    if (bc->stack[c][i] == buf) {
 		erl_exit(1,"Multiple buffer release in inet_drv, this is a "
 			 "bug, save the core and send it to "
 			 "support@erlang.ericsson.se!");
 	    }
 	}
 #endif
-	buffer_stack[buffer_stack_pos++] = buf;
-	BUFSTK_UNLOCK;
+	bc->stack[c][bc->pos[c]++] = buf;
+	bc->bytes += buf->orig_size;
 	COUNT_BUF_STACK(buf->orig_size);
     }
 }
 
+/* Fills in the buffer cache statistics of all threads */
+static int inet_fill_bufstat(char* dst)
+{
+    inet_buffer_cache* bc;
+    unsigned long val[5];
+    char* dst_start = dst;
+    int i;
+
+    for (i = 0; i < 5; i++)
+	val[i] = 0;
+    BUFSTK_LOCK;
+    for (bc = buffer_caches; bc != NULL; bc = bc->next) {
+	val[0] += bc->hits;
+	val[1] += bc->misses;
+	val[2] += bc->trims;
+	for (i = 0; i < BUFFER_CLASSES; i++)
+	    val[3] += bc->pos[i];
+	val[4] += bc->bytes;
+    }
+    BUFSTK_UNLOCK;
+
+    *dst++ = INET_REP_OK;
+    for (i = 0; i < 5; i++) {
+	put_int32((val[i] >> 16) >> 16, dst);  /* write high 32bit */
+	put_int32(val[i], dst+4);              /* write low 32bit */
+	dst += 8;
+    }
+    return dst - dst_start;
+}
+
 static ErlDrvBinary* realloc_buffer(ErlDrvBinary* buf, long newsz)
 {
     ErlDrvBinary* bin;
@@ -3080,7 +3256,12 @@ static int packet_binary_message
 #   endif
     i = LOAD_PORT(spec, i, desc->dport);   		      /* S	  */
     
-    alen = addrlen(desc->sfamily);
+#ifdef HAVE_INET_LOCAL
+    if (desc->sfamily == AF_UNIX)  /* [Len,Path...] */
+	alen = 1 + (unsigned char) bin->orig_bytes[offs+3];
+    else
+#endif
+	alen = addrlen(desc->sfamily);
     i = load_ip_address(spec, i, desc->sfamily, bin->orig_bytes+offs+3);
     i = load_ip_port(spec, i, bin->orig_bytes+offs+1);	      /* IP, Port */
     
@@ -3173,6 +3354,46 @@ static int packet_error_message(udp_descriptor* udesc, int err)
     return driver_output_term(desc->port, spec, i);
 }
 
+/*
+** send active message {tcp_passive|udp_passive|sctp_passive, S}
+*/
+static int inet_passive_message(inet_descriptor* desc)
+{
+    ErlDrvTermData spec[LOAD_ATOM_CNT + LOAD_PORT_CNT + LOAD_TUPLE_CNT];
+    int i = 0;
+
+    DEBUGF(("inet_passive_message(%ld):\r\n", (long)desc->port));
+
+#   ifdef HAVE_SCTP
+    if (IS_SCTP(desc))
+	i = LOAD_ATOM(spec, i, am_sctp_passive);
+    else
+#   endif
+    if (desc->stype == SOCK_STREAM)
+	i = LOAD_ATOM(spec, i, am_tcp_passive);
+    else
+	i = LOAD_ATOM(spec, i, am_udp_passive);
+
+    i = LOAD_PORT(spec, i, desc->dport);
+    i = LOAD_TUPLE(spec, i, 2);
+    ASSERT(i == sizeof(spec)/sizeof(*spec));
+    return driver_output_term(desc->port, spec, i);
+}
+
+/*
+** A packet has been delivered in active mode: {active, once}, and
+** {active, N} when N is counted down to 0, turn the socket passive.
+*/
+static void inet_active_delivered(inet_descriptor* desc)
+{
+    if (desc->active == INET_ONCE)
+	desc->active = INET_PASSIVE;
+    else if (desc->active == INET_MULTI && --desc->active_count == 0) {
+	desc->active = INET_PASSIVE;
+	inet_passive_message(desc);
+    }
+}
+
 
 /* scan buffer for bit 7 */
 static void scanbit8(inet_descriptor* desc, const char* buf, int len)
@@ -3219,8 +3440,7 @@ static int tcp_reply_data(tcp_descriptor* desc, char* buf, int len)
 
     if (code < 0)
 	return code;
-    if (desc->inet.active == INET_ONCE)
-	desc->inet.active = INET_PASSIVE;
+    inet_active_delivered(INETP(desc));
     return code;
 }
 
@@ -3249,8 +3469,7 @@ tcp_reply_binary_data(tcp_descriptor* desc, ErlDrvBinary* bin, int offs, int len
     }
     if (code < 0)
 	return code;
-    if (desc->inet.active == INET_ONCE)
-	desc->inet.active = INET_PASSIVE;
+    inet_active_delivered(INETP(desc));
     return code;
 }
 
@@ -3268,15 +3487,14 @@ packet_reply_binary_data(inet_descriptor* desc, unsigned  int hsz,
 	/* "inet" is actually for both UDP and SCTP, as well as TCP! */
 	return inet_async_binary_data(desc, hsz, bin, offs, len, extra);
     else
-    {	/* INET_ACTIVE or INET_ONCE: */
+    {	/* INET_ACTIVE, INET_ONCE or INET_MULTI: */
 	if (desc->deliver == INET_DELIVER_PORT)
 	    code = inet_port_binary_data(desc, bin, offs, len);
 	else
 	    code = packet_binary_message(desc, bin, offs, len, extra);
 	if (code < 0)
 	    return code;
-	if (desc->active == INET_ONCE)
-	    desc->active = INET_PASSIVE;
+	inet_active_delivered(desc);
 	return code;
     }
 }
@@ -3322,6 +3540,7 @@ sock_init(void) /* May be called multiple times. */
 static void inet_init_sctp(void) {
     INIT_ATOM(sctp);
     INIT_ATOM(sctp_error);
+    INIT_ATOM(sctp_passive);
     INIT_ATOM(true);
     INIT_ATOM(false);
     INIT_ATOM(buffer);
@@ -3438,7 +3657,8 @@ static int inet_init()
     if (!sock_init())
 	goto error;
 
-    buffer_stack_pos = 0;
+    if (erl_drv_tsd_key_create("inet_buffer_cache", &buffer_cache_key) != 0)
+	goto error;
 
     erts_smp_spinlock_init(&inet_buffer_stack_lock, "inet_buffer_stack_lock");
 
@@ -3463,8 +3683,13 @@ static int inet_init()
     INIT_ATOM(tcp_closed);
     INIT_ATOM(tcp_error);
     INIT_ATOM(udp_error);
+    INIT_ATOM(tcp_passive);
+    INIT_ATOM(udp_passive);
     INIT_ATOM(empty_out_q);
     INIT_ATOM(ssl_tls);
+#ifdef HAVE_INET_LOCAL
+    INIT_ATOM(local);
+#endif
 
     INIT_ATOM(http_eoh);
     INIT_ATOM(http_header);
@@ -3546,6 +3771,22 @@ static char* inet_set_address(int family, inet_address* dst, char* src, int* len
 	*len = sizeof(struct sockaddr_in6); 
 	return src + 2+16;
     }
+#endif
+#ifdef HAVE_INET_LOCAL
+    else if ((family == AF_UNIX) && (*len >= 2+1)) {
+	/* [P1,P0,Len,Path...], the port is not used. A path that
+	   starts with a 0 byte is a name in the abstract namespace. */
+	int n = (unsigned char) src[2];
+	if ((n > (int) sizeof(dst->sal.sun_path)) || (*len < 2+1+n))
+	    return NULL;
+	sys_memzero((char*)dst, sizeof(struct sockaddr_un));
+	dst->sal.sun_family = family;
+	sys_memcpy(dst->sal.sun_path, src+3, n);
+	*len = offsetof(struct sockaddr_un, sun_path) + n;
+	if ((n > 0) && (src[3] != 0) && (n < (int) sizeof(dst->sal.sun_path)))
+	    *len += 1;  /* include the terminating 0 of a file name */
+	return src + 2+1+n;
+    }
 #endif
     return NULL;
 }
@@ -3660,6 +3901,37 @@ static int inet_get_address(int family, char* dst, inet_address* src, unsigned i
 	*len = 3 + sizeof(struct in6_addr);
 	return 0;
     }
+#endif
+#ifdef HAVE_INET_LOCAL
+    else if (family == AF_UNIX) {
+	/* dst = [F,0,0,Len,Path...], Len is 0 for an unnamed socket,
+	 * whose address may come back shorter than sun_path's offset */
+	char* path = src->sal.sun_path;
+	int n = (int) *len - (int) offsetof(struct sockaddr_un, sun_path);
+
+	if (n < 0)
+	    n = 0;
+	else if (n > (int) sizeof(src->sal.sun_path))
+	    n = sizeof(src->sal.sun_path);
+	if ((n > 0) && (path[0] != 0)) {
+	    /* A file name ends at the first 0 */
+	    int m = 0;
+	    while ((m < n) && (path[m] != 0))
+		m++;
+	    n = m;
+	}
+	else if (*len >= sizeof(struct sockaddr_un)) {
+	    /* An abstract name of unknown length ends at the last non 0 */
+	    while ((n > 0) && (path[n-1] == 0))
+		n--;
+	}
+	dst[0] = INET_AF_LOCAL;
+	put_int16(0, dst+1);
+	dst[3] = n;
+	sys_memcpy(dst+4, path, n);
+	*len = 4 + n;
+	return 0;
+    }
 #endif
     return -1;
 }
@@ -3719,9 +3991,15 @@ static int erl_inet_close(inet_descriptor* desc)
 static int inet_ctl_open(inet_descriptor* desc, int domain, int type, 
 			 char** rbuf, int rsize)
 {
+    int protocol = desc->sprotocol;
+
     if (desc->state != INET_STATE_CLOSED)
 	return ctl_xerror(EXBADSEQ, rbuf, rsize);
-    if ((desc->s = sock_open(domain, type, desc->sprotocol)) == INVALID_SOCKET)
+#ifdef HAVE_INET_LOCAL
+    if (domain == AF_UNIX)
+	protocol = 0;
+#endif
+    if ((desc->s = sock_open(domain, type, protocol)) == INVALID_SOCKET)
 	return ctl_error(sock_errno(), rbuf, rsize);
     if ((desc->event = sock_create_event(desc)) == INVALID_EVENT)
 	return ctl_error(sock_errno(), rbuf, rsize);
@@ -3764,6 +4042,11 @@ static int inet_ctl_fdopen(inet_descriptor* desc, int domain, int type,
 			 * the fd probably comes from an 
 			 * external wrapper program, so it is
 			 * not certain that we can open it again */
+#ifdef HAVE_INET_LOCAL
+    if (domain == AF_UNIX)
+	desc->prebound = 0; /* typically passed to us with SCM_RIGHTS,
+			     * the port owns it and closes it */
+#endif
     desc->stype = type;
     desc->sfamily = domain;
     return ctl_reply(INET_REP_OK, NULL, 0, rbuf, rsize);
@@ -4523,6 +4806,30 @@ static int setopt_prio_tos_trick
 }
 #endif
 
+/*
+** {active, N}: adds N to the count of packets left to deliver in
+** active mode. When the count reaches 0 the socket turns passive and
+** the owner is told so. Returns -1 if the count would overflow.
+*/
+static int inet_set_active_count(inet_descriptor* desc, int n)
+{
+    int count = (desc->active == INET_MULTI) ? desc->active_count : 0;
+
+    count += n;
+    if (count > INET_MAX_ACTIVE_COUNT)
+	return -1;
+    if (count <= 0) {
+	desc->active = INET_PASSIVE;
+	desc->active_count = 0;
+	inet_passive_message(desc);
+    }
+    else {
+	desc->active = INET_MULTI;
+	desc->active_count = count;
+    }
+    return 0;
+}
+
 /* set socket options:
 ** return -1 on error
 **         0 if ok
@@ -4596,7 +4903,19 @@ static int inet_set_opts(inet_descriptor* desc, char* ptr, int len)
 	case INET_LOPT_ACTIVE:
 	    DEBUGF(("inet_set_opts(%ld): s=%d, ACTIVE=%d\r\n",
 		    (long)desc->port, desc->s,ival));
-	    desc->active = ival;
+	    if (ival == INET_MULTI) {
+		if (len < 2)
+		    return -1;
+		ival = get_int16(ptr);
+		ptr += 2;
+		len -= 2;
+		if (inet_set_active_count(desc, (short) ival) < 0)
+		    return -1;
+	    }
+	    else {
+		desc->active = ival;
+		desc->active_count = 0;
+	    }
 	    if ((desc->stype == SOCK_STREAM) && (desc->active != INET_PASSIVE) && 
 		(desc->state == INET_STATE_CLOSED)) {
 		tcp_closed_message((tcp_descriptor *) desc);
@@ -4697,6 +5016,14 @@ static int inet_set_opts(inet_descriptor* desc, char* ptr, int len)
 	    }
 	    continue;
 
+	case INET_LOPT_TCP_DELAY_SEND_THRESHOLD:
+	    if (desc->stype == SOCK_STREAM) {
+		tcp_descriptor* tdesc = (tcp_descriptor*) desc;
+		if (ival < 0) return -1;
+		tdesc->delay_send_threshold = ival;
+	    }
+	    continue;
+
 	case INET_LOPT_UDP_READ_PACKETS:
 	    if (desc->stype == SOCK_DGRAM) {
 		udp_descriptor* udesc = (udp_descriptor*) desc;
@@ -4713,6 +5040,16 @@ static int inet_set_opts(inet_descriptor* desc, char* ptr, int len)
 	    DEBUGF(("inet_set_opts(%ld): s=%d, SO_REUSEADDR=%d\r\n",
 		    (long)desc->port, desc->s,ival));
 	    break;
+#endif
+	case INET_OPT_REUSEPORT:
+#ifdef SO_REUSEPORT
+	    type = SO_REUSEPORT;
+	    propagate = 1; /* Binding would fail later on anyway */
+	    DEBUGF(("inet_set_opts(%ld): s=%d, SO_REUSEPORT=%d\r\n",
+		    (long)desc->port, desc->s,ival));
+	    break;
+#else
+	    return -1;
 #endif
 	case INET_OPT_KEEPALIVE: type = SO_KEEPALIVE;
 	    DEBUGF(("inet_set_opts(%ld): s=%d, SO_KEEPALIVE=%d\r\n",
@@ -4862,6 +5199,11 @@ static int inet_set_opts(inet_descriptor* desc, char* ptr, int len)
 	    return -1;
 	}
 #if  defined(IP_TOS) && defined(SOL_IP) && defined(SO_PRIORITY)
+#ifdef HAVE_INET_LOCAL
+	if (desc->sfamily == AF_UNIX)  /* no IP_TOS to preserve */
+	    res = sock_setopt	    (desc->s, proto, type, arg_ptr, arg_sz);
+	else
+#endif
 	res = setopt_prio_tos_trick (desc->s, proto, type, arg_ptr, arg_sz);
 #else
 	res = sock_setopt	    (desc->s, proto, type, arg_ptr, arg_sz);
@@ -5025,7 +5367,17 @@ static int sctp_set_opts(inet_descriptor* desc, char* ptr, int len)
 	    continue;
 
 	case INET_LOPT_ACTIVE:
-	    desc->active = get_int32(curr);		curr += 4;
+	    arg.ival = get_int32(curr);			curr += 4;
+	    if (arg.ival == INET_MULTI) {
+		CHKLEN(curr, 2);
+		arg.ival = (short) get_int16(curr);	curr += 2;
+		if (inet_set_active_count(desc, arg.ival) < 0)
+		    return -1;
+	    }
+	    else {
+		desc->active = arg.ival;
+		desc->active_count = 0;
+	    }
 	    res = 0;
 	    continue;
 
@@ -5509,6 +5861,10 @@ static int inet_fill_opts(inet_descriptor* desc,
 	case INET_LOPT_ACTIVE:
 	    *ptr++ = opt;
 	    put_int32(desc->active, ptr);
+	    if (desc->active == INET_MULTI) {
+		PLACE_FOR(4,ptr);
+		put_int32(desc->active_count, ptr);
+	    }
 	    continue;
 	case INET_LOPT_PACKET:
 	    *ptr++ = opt;
@@ -5582,6 +5938,16 @@ static int inet_fill_opts(inet_descriptor* desc,
 	    }
 	    continue;
 
+	case INET_LOPT_TCP_DELAY_SEND_THRESHOLD:
+	    if (desc->stype == SOCK_STREAM) {
+		*ptr++ = opt;
+		ival = ((tcp_descriptor*)desc)->delay_send_threshold;
+		put_int32(ival, ptr);
+	    } else {
+		TRUNCATE_TO(0,ptr);
+	    }
+	    continue;
+
 	case INET_LOPT_UDP_READ_PACKETS:
 	    if (desc->stype == SOCK_DGRAM) {
 		*ptr++ = opt;
@@ -5614,6 +5980,15 @@ static int inet_fill_opts(inet_descriptor* desc,
 	case INET_OPT_REUSEADDR: 
 	    type = SO_REUSEADDR; 
 	    break;
+	case INET_OPT_REUSEPORT:
+#ifdef SO_REUSEPORT
+	    type = SO_REUSEPORT;
+	    break;
+#else
+	    *ptr++ = opt;
+	    put_int32(0, ptr);
+	    continue;
+#endif
 	case INET_OPT_KEEPALIVE: 
 	    type = SO_KEEPALIVE; 
 	    break;
@@ -5839,7 +6214,7 @@ static int sctp_fill_opts(inet_descriptor* desc, char* buf, int buflen,
 	}
 	case INET_LOPT_ACTIVE:
 	{
-	    PLACE_FOR(spec, i, 2*LOAD_ATOM_CNT + LOAD_TUPLE_CNT);
+	    PLACE_FOR(spec, i, LOAD_ATOM_CNT + LOAD_INT_CNT + LOAD_TUPLE_CNT);
 	    i = LOAD_ATOM (spec, i, am_active);
 	    switch (desc->active)
 	    {
@@ -5852,6 +6227,9 @@ static int sctp_fill_opts(inet_descriptor* desc, char* buf, int buflen,
 		case INET_ONCE   :
 		{ i = LOAD_ATOM (spec, i, am_once);  break; }
 
+		case INET_MULTI  :
+		{ i = LOAD_INT  (spec, i, desc->active_count); break; }
+
 		default: ASSERT (0);
 	    }
 	    i = LOAD_TUPLE (spec, i, 2);
@@ -6584,6 +6962,7 @@ static ErlDrvData inet_start(ErlDrvPort port, int size, int protocol)
     desc->bit8    = 0;
     desc->deliver = INET_DELIVER_TERM; /* standard term format */
     desc->active  = INET_PASSIVE;      /* start passive */
+    desc->active_count = 0;
     desc->oph = NULL;
     desc->opt = NULL;
 
@@ -6645,6 +7024,21 @@ static int inet_ctl(inet_descriptor* desc, int cmd, char* buf, int len,
 	  return inet_fill_stat(desc, buf, len, dst);
       }
 
+    case INET_REQ_GETBUFSTAT: {
+	  char* dst;
+	  int dstlen = 1 + 5*8;  /* Reply code and five counters */
+
+	  DEBUGF(("inet_ctl(%ld): GETBUFSTAT\r\n", (long) desc->port)); 
+	  if (dstlen > rsize) {
+	      if ((dst = (char*) ALLOC(dstlen)) == NULL)
+		  return 0;
+	      *rbuf = dst;  /* call will free this buffer */
+	  }
+	  else
+	      dst = *rbuf;  /* ok we fit in buffer given */
+	  return inet_fill_bufstat(dst);
+      }
+
     case INET_REQ_SUBSCRIBE: {
 	  char* dst;
 	  int dstlen = 1 /* Reply code */ + len*5;
@@ -6733,6 +7127,11 @@ static int inet_ctl(inet_descriptor* desc, int cmd, char* buf, int len,
         else if (desc->sfamily == AF_INET6) {
 	    put_int32(INET_AF_INET6, &tbuf[0]);
 	}
+#endif
+#ifdef HAVE_INET_LOCAL
+	else if (desc->sfamily == AF_UNIX) {
+	    put_int32(INET_AF_LOCAL, &tbuf[0]);
+	}
 #endif
 	else
 	    return ctl_error(EINVAL, rbuf, rsize);
@@ -6777,7 +7176,7 @@ static int inet_ctl(inet_descriptor* desc, int cmd, char* buf, int len,
     }
 
     case INET_REQ_PEER:  {      /* get peername */
-	char tbuf[sizeof(inet_address)];
+	char tbuf[INET_ADDRESS_BUFSZ];
 	inet_address peer;
 	inet_address* ptr;
 	unsigned int sz = sizeof(peer);
@@ -6813,7 +7212,7 @@ static int inet_ctl(inet_descriptor* desc, int cmd, char* buf, int len,
     }
 
     case INET_REQ_NAME:  {      /* get sockname */
-	char tbuf[sizeof(inet_address)];
+	char tbuf[INET_ADDRESS_BUFSZ];
 	inet_address name;
 	inet_address* ptr;
 	unsigned int sz = sizeof(name);
@@ -6864,6 +7263,20 @@ static int inet_ctl(inet_descriptor* desc, int cmd, char* buf, int len,
 	if (inet_set_address(desc->sfamily, &local, buf, &len) == NULL)
 	    return ctl_error(EINVAL, rbuf, rsize);
 
+#ifdef HAVE_INET_LOCAL
+	if (desc->sfamily == AF_UNIX) {
+	    /* A local socket without a name is left unbound; it can
+	       still connect and send */
+	    if ((len > offsetof(struct sockaddr_un, sun_path)) &&
+		(sock_bind(desc->s,(struct sockaddr*) &local, len)
+		 == SOCKET_ERROR))
+		return ctl_error(sock_errno(), rbuf, rsize);
+	    desc->state = INET_STATE_BOUND;
+	    put_int16(0, tbuf);
+	    return ctl_reply(INET_REP_OK, tbuf, 2, rbuf, rsize);
+	}
+#endif
+
 	if (sock_bind(desc->s,(struct sockaddr*) &local, len) == SOCKET_ERROR)
 	    return ctl_error(sock_errno(), rbuf, rsize);
 
@@ -7019,6 +7432,20 @@ static int tcp_expand_buffer(tcp_descriptor* desc, int len)
     offs1 = desc->i_ptr_start - desc->i_buf->orig_bytes;
     offs2 = desc->i_ptr - desc->i_ptr_start;
 
+    if (driver_binary_get_refc(desc->i_buf) > 1) {
+	/* Delivered packets refer to the buffer, so it can not be moved;
+	 * copy what is left of it to a new one */
+	if ((bin = alloc_buffer(len)) == NULL)
+	    return -1;
+	sys_memcpy(bin->orig_bytes, desc->i_ptr_start, offs2);
+	free_buffer(desc->i_buf);
+	desc->i_buf = bin;
+	desc->i_ptr_start = bin->orig_bytes;
+	desc->i_ptr       = desc->i_ptr_start + offs2;
+	desc->i_bufsz     = len;
+	return 0;
+    }
+
     if ((bin = driver_realloc_binary(desc->i_buf, ulen)) == NULL)
 	return -1;
 
@@ -7085,21 +7512,92 @@ static void tcp_clear_output(tcp_descriptor* desc)
     int qsz = driver_sizeq(ix);
 
     driver_deq(ix, qsz);
+    tcp_sendfile_reply(desc, am_closed);
     send_empty_out_q_msgs(INETP(desc));
 }
 
 
-/* Move data so that ptr_start point at buf->orig_bytes */
-static void tcp_restart_input(tcp_descriptor* desc)
+/* Line and http packets are truncated to the buffer size, so their
+ * buffers keep the size that was set. For the other packet types the
+ * size of new input buffers follows the reads. */
+#define TCP_AUTO_BUFFER(desc) \
+    ((desc)->inet.htype != TCP_PB_LINE_LF && \
+     (desc)->inet.htype != TCP_PB_HTTP && \
+     (desc)->inet.htype != TCP_PB_HTTPH && \
+     (desc)->inet.htype != TCP_PB_HTTP_BIN && \
+     (desc)->inet.htype != TCP_PB_HTTPH_BIN)
+
+/* Size of a new input buffer for data of unknown length */
+static int tcp_input_size(tcp_descriptor* desc)
 {
-    if (desc->i_ptr_start != desc->i_buf->orig_bytes) {
-	int n = desc->i_ptr - desc->i_ptr_start;
+    if (TCP_AUTO_BUFFER(desc) && desc->i_autosz > desc->inet.bufsz)
+	return desc->i_autosz;
+    return desc->inet.bufsz;
+}
 
-	DEBUGF(("tcp_restart_input: move %d bytes\r\n", n));
-	sys_memmove(desc->i_buf->orig_bytes, desc->i_ptr_start, n);
-	desc->i_ptr_start = desc->i_buf->orig_bytes;
-	desc->i_ptr = desc->i_ptr_start + n;
+/*
+** Update the input buffer size after a read of n bytes into nread bytes
+** of space. A read that fills the space has probably left more in the
+** socket, so the size doubles, up to INET_MAX_BUFFER. After
+** INET_SHRINK_READS reads in a row of less than a quarter of the size,
+** it is halved, down to bufsz.
+*/
+static void tcp_adapt_input(tcp_descriptor* desc, int nread, int n)
+{
+    int sz = tcp_input_size(desc);
+
+    if (!TCP_AUTO_BUFFER(desc))
+	return;
+    if (n >= nread) {
+	desc->i_small = 0;
+	if (sz < INET_MAX_BUFFER/2)
+	    sz *= 2;
+	else if (sz < INET_MAX_BUFFER)
+	    sz = INET_MAX_BUFFER;
+    }
+    else if (n*4 < sz) {
+	if (++desc->i_small >= INET_SHRINK_READS) {
+	    desc->i_small = 0;
+	    sz /= 2;
+	}
+    }
+    else
+	desc->i_small = 0;
+    desc->i_autosz = sz;
+}
+
+/* Move data so that ptr_start point at buf->orig_bytes, and make room
+ * for the next read. Returns -1, with the input left as it was, if a
+ * new buffer can not be allocated */
+static int tcp_restart_input(tcp_descriptor* desc)
+{
+    int n = desc->i_ptr - desc->i_ptr_start;
+    int sz = tcp_input_size(desc);
+
+    if (sz <= desc->i_bufsz) {
+	if (desc->i_ptr_start == desc->i_buf->orig_bytes)
+	    return 0;
+	sz = desc->i_bufsz;
     }
+
+    DEBUGF(("tcp_restart_input: move %d bytes\r\n", n));
+    if (driver_binary_get_refc(desc->i_buf) > 1 ||
+	desc->i_buf->orig_size < sz) {
+	/* Delivered packets refer to the buffer, or the reads have
+	   outgrown it; start a new one */
+	ErlDrvBinary* bin;
+	if ((bin = alloc_buffer(sz)) == NULL)
+	    return -1;
+	sys_memcpy(bin->orig_bytes, desc->i_ptr_start, n);
+	free_buffer(desc->i_buf);
+	desc->i_buf = bin;
+    }
+    else if (desc->i_ptr_start != desc->i_buf->orig_bytes)
+	sys_memmove(desc->i_buf->orig_bytes, desc->i_ptr_start, n);
+    desc->i_bufsz = sz;
+    desc->i_ptr_start = desc->i_buf->orig_bytes;
+    desc->i_ptr = desc->i_ptr_start + n;
+    return 0;
 }
 
 
@@ -7130,10 +7628,17 @@ static ErlDrvData tcp_inet_start(ErlDrvPort port, char* args)
     desc->i_ptr_start = NULL;
     desc->i_remain = 0;
     desc->i_bufsz = 0;
+    desc->i_autosz = 0;
+    desc->i_small = 0;
     desc->tcp_add_flags = 0;
+    desc->delay_send_threshold = 0;
     desc->http_state = 0;
     desc->mtd = NULL;
     desc->multi_first = desc->multi_last = NULL;
+    desc->sendfile.active = 0;
+#ifdef HAVE_INET_FDPASS
+    desc->fd_count = 0;
+#endif
     DEBUGF(("tcp_inet_start(%ld) }\r\n", (long)port));
     return (ErlDrvData) desc;
 }
@@ -7237,9 +7742,15 @@ static void tcp_inet_stop(ErlDrvData e)
     DEBUGF(("tcp_inet_stop(%ld) {s=%d\r\n", 
 	    (long)desc->inet.port, desc->inet.s));
     tcp_close_check(desc);
+    tcp_sendfile_reply(desc, am_closed);
+#ifdef HAVE_INET_FDPASS
+    /* close received descriptors that nobody fetched */
+    while (desc->fd_count > 0)
+	close(desc->fds[--desc->fd_count]);
+#endif
     /* free input buffer & output buffer */
     if (desc->i_buf != NULL)
-	release_buffer(desc->i_buf);
+	free_buffer(desc->i_buf);
     desc->i_buf = NULL; /* net_mess2 may call this function recursively when 
 			   faulty messages arrive on dist ports*/
     DEBUGF(("tcp_inet_stop(%ld) }\r\n", (long)desc->inet.port));
@@ -7267,6 +7778,14 @@ static int tcp_inet_ctl(ErlDrvData e, unsigned int cmd, char* buf, int len,
 #else
 	else if ((len == 1) && (buf[0] == INET_AF_INET6))
 	    return ctl_xerror("eafnosupport",rbuf,rsize);
+#endif
+#ifdef HAVE_INET_LOCAL
+	else if ((len == 1) && (buf[0] == INET_AF_LOCAL))
+	    return
+		inet_ctl_open(INETP(desc), AF_UNIX, SOCK_STREAM, rbuf, rsize);
+#else
+	else if ((len == 1) && (buf[0] == INET_AF_LOCAL))
+	    return ctl_xerror("eafnosupport",rbuf,rsize);
 #endif
 	else
 	    return ctl_error(EINVAL, rbuf, rsize);
@@ -7280,6 +7799,11 @@ static int tcp_inet_ctl(ErlDrvData e, unsigned int cmd, char* buf, int len,
         else if ((len == 5) && (buf[0] == INET_AF_INET6))
 	    return inet_ctl_fdopen(INETP(desc), AF_INET6, SOCK_STREAM,
 				   (SOCKET) get_int32(buf+1), rbuf, rsize);
+#endif
+#ifdef HAVE_INET_LOCAL
+        else if ((len == 5) && (buf[0] == INET_AF_LOCAL))
+	    return inet_ctl_fdopen(INETP(desc), AF_UNIX, SOCK_STREAM,
+				   (SOCKET) get_int32(buf+1), rbuf, rsize);
 #endif
 	else
 	    return ctl_error(EINVAL, rbuf, rsize);
@@ -7509,6 +8033,86 @@ static int tcp_inet_ctl(ErlDrvData e, unsigned int cmd, char* buf, int len,
 	return ctl_reply(INET_REP_OK, tbuf, 2, rbuf, rsize);
     }
 
+    case TCP_REQ_SENDFILE: {
+	tcp_sendfile_op* sf = &desc->sendfile;
+	char tbuf[2];
+
+	DEBUGF(("tcp_inet_ctl(%ld): SENDFILE\r\n", (long)desc->inet.port)); 
+	/* INPUT: Fd(4), Offset(8), Length(8) */
+	if (!IS_CONNECTED(INETP(desc)))
+	    return ctl_error(ENOTCONN, rbuf, rsize);
+	if (len != 20)
+	    return ctl_error(EINVAL, rbuf, rsize);
+#ifndef HAVE_INET_SENDFILE
+	return ctl_error(ENOTSUP, rbuf, rsize);
+#else
+	if (sf->active)
+	    return ctl_error(EALREADY, rbuf, rsize);
+	sf->fd = get_int32(buf);
+	sf->offset = (ErlDrvSInt64)
+	    ((((ErlDrvUInt64) (Uint32) get_int32(buf+4)) << 32) |
+	     (Uint32) get_int32(buf+8));
+	sf->left = ((((ErlDrvUInt64) (Uint32) get_int32(buf+12)) << 32) |
+		    (Uint32) get_int32(buf+16));
+	if (sf->fd < 0 || sf->offset < 0)
+	    return ctl_error(EINVAL, rbuf, rsize);
+	sf->eof = (sf->left == 0);
+	sf->sent = 0;
+	sf->before = driver_sizeq(desc->inet.port);
+	sf->id = NEW_ASYNC_ID();
+	sf->caller = driver_caller(desc->inet.port);
+	sf->active = 1;
+	put_int16(sf->id, tbuf);
+	/* With data queued, the file is sent when it has been written */
+	if (sf->before == 0)
+	    tcp_inet_output(desc, (HANDLE) desc->inet.event);
+	return ctl_reply(INET_REP_OK, tbuf, 2, rbuf, rsize);
+#endif
+    }
+
+    case TCP_REQ_SENDFD: {
+	DEBUGF(("tcp_inet_ctl(%ld): SENDFD\r\n", (long)desc->inet.port)); 
+	/* INPUT: Fd(4), Data(N) */
+	if (!IS_CONNECTED(INETP(desc)))
+	    return ctl_error(ENOTCONN, rbuf, rsize);
+	if (len < 4)
+	    return ctl_error(EINVAL, rbuf, rsize);
+#ifndef HAVE_INET_FDPASS
+	return ctl_error(ENOTSUP, rbuf, rsize);
+#else
+	{
+	    int err;
+	    if (desc->inet.sfamily != AF_UNIX)
+		return ctl_error(EINVAL, rbuf, rsize);
+	    /* The descriptor goes with the first byte written, so it can
+	       not wait in the queue behind earlier output */
+	    if ((driver_sizeq(desc->inet.port) > 0) || desc->sendfile.active)
+		return ctl_error(EAGAIN, rbuf, rsize);
+	    if ((err = tcp_send_fd(desc, get_int32(buf), buf+4, len-4)) != 0)
+		return ctl_error(err, rbuf, rsize);
+	    return ctl_reply(INET_REP_OK, NULL, 0, rbuf, rsize);
+	}
+#endif
+    }
+
+    case TCP_REQ_RECVFD: {
+	DEBUGF(("tcp_inet_ctl(%ld): RECVFD\r\n", (long)desc->inet.port)); 
+	/* OUTPUT: Fd(4)* */
+#ifndef HAVE_INET_FDPASS
+	return ctl_reply(INET_REP_OK, NULL, 0, rbuf, rsize);
+#else
+	{
+	    char tbuf[4*INET_MAX_FDS];
+	    int i, n = desc->fd_count;
+	    /* The caller owns the descriptors from now on */
+	    for (i = 0; i < n; i++)
+		put_int32(desc->fds[i], tbuf+4*i);
+	    desc->fd_count = 0;
+	    return ctl_reply(INET_REP_OK, tbuf, 4*n, rbuf, rsize);
+	}
+#endif
+    }
+
     case TCP_REQ_UNRECV: {
 	DEBUGF(("tcp_inet_ctl(%ld): UNRECV\r\n", (long)desc->inet.port)); 
 	if (!IS_CONNECTED(INETP(desc)))
@@ -7923,7 +8527,16 @@ static int tcp_deliver(tcp_descriptor* desc, int len)
 	    }
 	}
 	else {
-	    code = tcp_reply_data(desc, desc->i_ptr_start, len);
+	    if (desc->inet.active && desc->inet.deliver == INET_DELIVER_TERM)
+		/* All the packets of a read are delivered now, so let
+		 * them refer to the buffer instead of copying each one;
+		 * tcp_restart_input moves the rest to a new buffer */
+		code = tcp_reply_binary_data(desc, desc->i_buf,
+					     (desc->i_ptr_start -
+					      desc->i_buf->orig_bytes),
+					     len);
+	    else
+		code = tcp_reply_data(desc, desc->i_ptr_start, len);
 	    /* XXX The buffer gets thrown away on error  (code < 0)    */
 	    /* Windows needs workaround for this in tcp_inet_event...  */
 	    desc->i_ptr_start += len;
@@ -7943,14 +8556,15 @@ static int tcp_deliver(tcp_descriptor* desc, int len)
 	if (!desc->inet.active) {
 	    driver_cancel_timer(desc->inet.port);
 	    sock_select(INETP(desc),(FD_READ|FD_CLOSE),0);
-	    if (desc->i_buf != NULL)
-		tcp_restart_input(desc);
+	    if ((desc->i_buf != NULL) && (tcp_restart_input(desc) < 0))
+		return -1;
 	}
 	else if (desc->i_buf != NULL) {
 	    if ((n = tcp_remain(desc, &len)) != 0) {
 		if (n < 0) /* packet error */
 		    return n;
-		tcp_restart_input(desc);
+		if (tcp_restart_input(desc) < 0)
+		    return -1;
 		if (len > 0)
 		    desc->i_remain = len;
 		len = 0;
@@ -7961,6 +8575,56 @@ static int tcp_deliver(tcp_descriptor* desc, int len)
 }
 
 
+#ifdef HAVE_INET_FDPASS
+/*
+** Read from a local socket, keeping the descriptors passed with the
+** data until they are fetched with TCP_REQ_RECVFD. Descriptors beyond
+** INET_MAX_FDS are closed.
+*/
+static int tcp_recv_fds(tcp_descriptor* desc, char* ptr, int len)
+{
+    struct msghdr mhdr;
+    struct iovec iov;
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int)*INET_MAX_FDS)];
+    } ctl;
+    struct cmsghdr* cmsg;
+    int flags = 0;
+    int n;
+
+    iov.iov_base = ptr;
+    iov.iov_len  = len;
+    sys_memzero((char*)&mhdr, sizeof(mhdr));
+    mhdr.msg_iov        = &iov;
+    mhdr.msg_iovlen     = 1;
+    mhdr.msg_control    = ctl.buf;
+    mhdr.msg_controllen = sizeof(ctl.buf);
+#ifdef MSG_CMSG_CLOEXEC
+    flags = MSG_CMSG_CLOEXEC;
+#endif
+    if ((n = sock_recvmsg(desc->inet.s, &mhdr, flags)) <= 0)
+	return n;
+    for (cmsg = CMSG_FIRSTHDR(&mhdr); cmsg != NULL;
+	 cmsg = CMSG_NXTHDR(&mhdr, cmsg)) {
+	if ((cmsg->cmsg_level == SOL_SOCKET) &&
+	    (cmsg->cmsg_type == SCM_RIGHTS)) {
+	    int nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+	    int i, fd;
+
+	    for (i = 0; i < nfds; i++) {
+		sys_memcpy(&fd, CMSG_DATA(cmsg) + i*sizeof(int), sizeof(int));
+		if (desc->fd_count < INET_MAX_FDS)
+		    desc->fds[desc->fd_count++] = fd;
+		else
+		    close(fd);
+	    }
+	}
+    }
+    return n;
+}
+#endif
+
 static int tcp_recv(tcp_descriptor* desc, int request_len)
 {
     int n;
@@ -7968,7 +8632,7 @@ static int tcp_recv(tcp_descriptor* desc, int request_len)
     int nread;
 
     if (desc->i_buf == NULL) {  /* allocte a read buffer */
-	int sz = (request_len > 0) ? request_len : desc->inet.bufsz;
+	int sz = (request_len > 0) ? request_len : tcp_input_size(desc);
 
 	if ((desc->i_buf = alloc_buffer(sz)) == NULL)
 	    return -1;
@@ -8007,7 +8671,12 @@ static int tcp_recv(tcp_descriptor* desc, int request_len)
     DEBUGF(("tcp_recv(%ld): s=%d about to read %d bytes...\r\n",  
 	    (long)desc->inet.port, desc->inet.s, nread));
 
-    n = sock_recv(desc->inet.s, desc->i_ptr, nread, 0);
+#ifdef HAVE_INET_FDPASS
+    if (desc->inet.sfamily == AF_UNIX)
+	n = tcp_recv_fds(desc, desc->i_ptr, nread);
+    else
+#endif
+	n = sock_recv(desc->inet.s, desc->i_ptr, nread, 0);
 
     if (n == SOCKET_ERROR) {
 	int err = sock_errno();
@@ -8037,6 +8706,7 @@ static int tcp_recv(tcp_descriptor* desc, int request_len)
 	    return tcp_deliver(desc, desc->i_ptr - desc->i_ptr_start);
     }
     else {
+	tcp_adapt_input(desc, nread, n);
 	if ((nread = tcp_remain(desc, &len)) < 0)
 	    return tcp_recv_error(desc, EMSGSIZE);
 	else if (nread == 0)
@@ -8449,6 +9119,117 @@ static int tcp_send_error(tcp_descriptor* desc, int err)
     return -1;
 }
 
+/* send message:
+**      {inet_async, Port, Ref, {ok,Sent}} or
+**      {inet_async, Port, Ref, {error,Reason}}
+** to the caller of the sendfile in progress, which ends it
+*/
+static int tcp_sendfile_reply(tcp_descriptor* desc, ErlDrvTermData reason)
+{
+    tcp_sendfile_op* sf = &desc->sendfile;
+    ErlDrvTermData spec[3*LOAD_ATOM_CNT + LOAD_PORT_CNT + 
+			LOAD_INT_CNT + 2*LOAD_TUPLE_CNT];
+    int i = 0;
+
+    if (!sf->active)
+	return 0;
+    sf->active = 0;
+    i = LOAD_ATOM(spec, i, am_inet_async);
+    i = LOAD_PORT(spec, i, desc->inet.dport);
+    i = LOAD_INT(spec, i, sf->id);
+    if (reason == 0) {
+	i = LOAD_ATOM(spec, i, am_ok);
+	spec[i++] = ERL_DRV_UINT64;
+	spec[i++] = (ErlDrvTermData) &sf->sent;
+    }
+    else {
+	i = LOAD_ATOM(spec, i, am_error);
+	i = LOAD_ATOM(spec, i, reason);
+    }
+    i = LOAD_TUPLE(spec, i, 2);
+    i = LOAD_TUPLE(spec, i, 4);
+    ASSERT(i == sizeof(spec)/sizeof(*spec));
+    return driver_send_term(desc->inet.port, sf->caller, spec, i);
+}
+
+#ifdef HAVE_INET_SENDFILE
+
+#define TCP_SENDFILE_CHUNK  (1024*1024)   /* max bytes per sendfile() */
+#define TCP_SENDFILE_BUDGET (16*TCP_SENDFILE_CHUNK) /* max per output event */
+
+/*
+** Write from the file being sent, until the socket would block.
+** Returns 1 when the file is done and has been replied to, 0 when the
+** socket would block, and -1 if the socket has failed.
+*/
+static int tcp_sendfile_step(tcp_descriptor* desc)
+{
+    tcp_sendfile_op* sf = &desc->sendfile;
+    ErlDrvUInt64 budget = TCP_SENDFILE_BUDGET;
+
+    while (budget > 0) {
+	size_t chunk = TCP_SENDFILE_CHUNK;
+	off_t offset = (off_t) sf->offset;
+	ssize_t n;
+
+	if (!sf->eof && sf->left < chunk)
+	    chunk = (size_t) sf->left;
+	n = sock_sendfile(desc->inet.s, sf->fd, &offset, chunk);
+	if (n < 0) {
+	    int err = sock_errno();
+
+	    if ((err == ERRNO_BLOCK) || (err == EINTR)) {
+		sock_select(INETP(desc),(FD_WRITE|FD_CLOSE),1);
+		return 0;
+	    }
+	    DEBUGF(("tcp_sendfile_step(%ld): s=%d, errno = %d\r\n",
+		    (long)desc->inet.port, desc->inet.s, err));
+	    tcp_sendfile_reply(desc, error_atom(err));
+	    /* Nothing is lost if the file could not be read at all */
+	    if ((sf->sent == 0) &&
+		((err == EBADF) || (err == EINVAL) || (err == EIO) ||
+		 (err == EOVERFLOW) || (err == ESPIPE)))
+		return 1;
+	    return tcp_send_error(desc, err);
+	}
+	if (n == 0) { /* end of file */
+	    tcp_sendfile_reply(desc, 0);
+	    return 1;
+	}
+	inet_output_count(INETP(desc), (int) n);
+	sf->offset += n;
+	sf->sent += n;
+	budget -= n;
+	if (!sf->eof && (sf->left -= n) == 0) {
+	    tcp_sendfile_reply(desc, 0);
+	    return 1;
+	}
+    }
+    /* Let other ports run; the poller calls us again */
+    sock_select(INETP(desc),(FD_WRITE|FD_CLOSE),1);
+    return 0;
+}
+
+#endif /* HAVE_INET_SENDFILE */
+
+/*
+** With delay_send, data is queued and written when the socket is next
+** polled, so that many sends are written with one sock_sendv(). If a
+** delay_send_threshold is set, the queue is written as soon as it grows
+** past the threshold; if the socket is not writable then, the rest is
+** written when it is polled as usual.
+*/
+#define DELAY_SEND(desc, size)						\
+    (((desc)->tcp_add_flags & TCP_ADDF_DELAY_SEND)			\
+     && ((desc)->delay_send_threshold == 0				\
+	 || (size) < (desc)->delay_send_threshold))
+
+#define DELAY_SEND_FLUSH(desc, old_qsize, qsize)			\
+    (((desc)->tcp_add_flags & TCP_ADDF_DELAY_SEND)			\
+     && (desc)->delay_send_threshold > 0				\
+     && (old_qsize) < (desc)->delay_send_threshold			\
+     && (qsize) >= (desc)->delay_send_threshold)
+
 /*
 ** Send non-blocking vector data
 */
@@ -8489,9 +9270,17 @@ static int tcp_sendv(tcp_descriptor* desc, ErlIOVec* ev)
 	ev->size += h_len;
     }
 
-    if ((sz = driver_sizeq(ix)) > 0) {
+    /* Data sent while a file is being sent is queued behind it */
+    if ((sz = driver_sizeq(ix)) > 0 || desc->sendfile.active) {
 	driver_enqv(ix, ev, 0);
-	if (sz+ev->size >= desc->high) {
+	if (DELAY_SEND_FLUSH(desc, sz, sz+ev->size)) {
+	    if (tcp_inet_output(desc, (HANDLE) desc->inet.event) < 0)
+		return -1;
+	    sz = driver_sizeq(ix);
+	}
+	else
+	    sz += ev->size;
+	if (sz >= desc->high) {
 	    DEBUGF(("tcp_sendv(%ld): s=%d, sender forced busy\r\n",
 		    (long)desc->inet.port, desc->inet.s));
 	    desc->inet.state |= INET_F_BUSY;  /* mark for low-watermark */
@@ -8509,7 +9298,7 @@ static int tcp_sendv(tcp_descriptor* desc, ErlIOVec* ev)
 	
 	DEBUGF(("tcp_sendv(%ld): s=%d, about to send %d,%d bytes\r\n",
 		(long)desc->inet.port, desc->inet.s, h_len, len));
-	if (desc->tcp_add_flags & TCP_ADDF_DELAY_SEND) {
+	if (DELAY_SEND(desc, ev->size)) {
 	    n = 0;
 	} else if (sock_sendv(desc->inet.s, ev->iov, vsize, &n, 0) 
 		   == SOCKET_ERROR) {
@@ -8577,11 +9366,18 @@ static int tcp_send(tcp_descriptor* desc, char* ptr, int len)
     inet_output_count(INETP(desc), len+h_len);
 
 
-    if ((sz = driver_sizeq(ix)) > 0) {
+    if ((sz = driver_sizeq(ix)) > 0 || desc->sendfile.active) {
 	if (h_len > 0)
 	    driver_enq(ix, buf, h_len);
 	driver_enq(ix, ptr, len);
-	if (sz+h_len+len >= desc->high) {
+	if (DELAY_SEND_FLUSH(desc, sz, sz+h_len+len)) {
+	    if (tcp_inet_output(desc, (HANDLE) desc->inet.event) < 0)
+		return -1;
+	    sz = driver_sizeq(ix);
+	}
+	else
+	    sz += h_len+len;
+	if (sz >= desc->high) {
 	    DEBUGF(("tcp_send(%ld): s=%d, sender forced busy\r\n",
 		    (long)desc->inet.port, desc->inet.s));
 	    desc->inet.state |= INET_F_BUSY;  /* mark for low-watermark */
@@ -8602,7 +9398,7 @@ static int tcp_send(tcp_descriptor* desc, char* ptr, int len)
 
 	DEBUGF(("tcp_send(%ld): s=%d, about to send %d,%d bytes\r\n",
 		(long)desc->inet.port, desc->inet.s, h_len, len));
-	if (desc->tcp_add_flags & TCP_ADDF_DELAY_SEND) {
+	if (DELAY_SEND(desc, h_len+len)) {
 	    sock_send(desc->inet.s, buf, 0, 0);
 	    n = 0;
 	} else 	if (sock_sendv(desc->inet.s,iov,2,&n,0) == SOCKET_ERROR) {
@@ -8638,6 +9434,82 @@ static int tcp_send(tcp_descriptor* desc, char* ptr, int len)
     return 0;
 }
 
+#ifdef HAVE_INET_FDPASS
+/*
+** Send a packet on a local socket with the descriptor fd attached to
+** its first byte. What can not be written at once is queued; the
+** descriptor went with the first write. Returns 0 or an errno.
+*/
+static int tcp_send_fd(tcp_descriptor* desc, int fd, char* ptr, int len)
+{
+    ErlDrvPort ix = desc->inet.port;
+    char buf[4];
+    int h_len;
+    int n;
+    struct msghdr mhdr;
+    struct iovec iov[2];
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct cmsghdr* cmsg;
+
+    switch(desc->inet.htype) {
+    case TCP_PB_1: 
+	put_int8(len, buf);
+	h_len = 1;
+	break;
+    case TCP_PB_2: 
+	put_int16(len, buf);
+	h_len = 2; 
+	break;
+    case TCP_PB_4: 
+	put_int32(len, buf);
+	h_len = 4; 
+	break;
+    default:
+	if (len == 0)
+	    return EINVAL;  /* no byte to carry the descriptor */
+	h_len = 0;
+	break;
+    }
+
+    iov[0].iov_base = buf;
+    iov[0].iov_len  = h_len;
+    iov[1].iov_base = ptr;
+    iov[1].iov_len  = len;
+    sys_memzero((char*)&mhdr, sizeof(mhdr));
+    mhdr.msg_iov        = iov;
+    mhdr.msg_iovlen     = 2;
+    mhdr.msg_control    = ctl.buf;
+    mhdr.msg_controllen = sizeof(ctl.buf);
+    cmsg = CMSG_FIRSTHDR(&mhdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+    sys_memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    DEBUGF(("tcp_send_fd(%ld): s=%d, about to send fd %d with %d,%d bytes\r\n",
+	    (long)desc->inet.port, desc->inet.s, fd, h_len, len));
+    if ((n = sock_sendmsg(desc->inet.s, &mhdr, 0)) == SOCKET_ERROR)
+	return sock_errno();
+    inet_output_count(INETP(desc), len+h_len);
+    if (n == len+h_len)
+	return 0;
+
+    if (n < h_len) {
+	driver_enq(ix, buf+n, h_len-n);
+	driver_enq(ix, ptr, len);
+    }
+    else {
+	n -= h_len;
+	driver_enq(ix, ptr+n, len-n);
+    }
+    sock_select(INETP(desc),(FD_WRITE|FD_CLOSE), 1);
+    return 0;
+}
+#endif
+
 static void tcp_inet_drv_output(ErlDrvData data, ErlDrvEvent event)
 {
     (void)tcp_inet_output((tcp_descriptor*)data, (HANDLE)event);
@@ -8710,13 +9582,38 @@ static int tcp_inet_output(tcp_descriptor* desc, HANDLE event)
 	    int vsize;
 	    int n;
 	    SysIOVec* iov;
+	    SysIOVec part;
 
+#ifdef HAVE_INET_SENDFILE
+	    if (desc->sendfile.active && desc->sendfile.before == 0) {
+		if ((n = tcp_sendfile_step(desc)) <= 0) {
+		    ret = n;
+		    goto done;
+		}
+		continue;
+	    }
+#endif
 	    if ((iov = driver_peekq(ix, &vsize)) == NULL) {
 		sock_select(INETP(desc), FD_WRITE, 0);
 		send_empty_out_q_msgs(INETP(desc));
 		goto done;
 	    }
 	    vsize = vsize > MAX_VSIZE ? MAX_VSIZE : vsize;
+	    if (desc->sendfile.active) {
+		/* Only write the data queued ahead of the file */
+		int i, left = desc->sendfile.before;
+
+		for (i = 0; i < vsize && (int) iov[i].iov_len <= left; i++)
+		    left -= iov[i].iov_len;
+		if (i > 0)
+		    vsize = i;
+		else {
+		    part.iov_base = iov[0].iov_base;
+		    part.iov_len = left;
+		    iov = &part;
+		    vsize = 1;
+		}
+	    }
 	    DEBUGF(("tcp_inet_output(%ld): s=%d, About to send %d items\r\n", 
 		    (long)desc->inet.port, desc->inet.s, vsize));
 	    if (sock_sendv(desc->inet.s, iov, vsize, &n, 0)==SOCKET_ERROR) {
@@ -8731,6 +9628,8 @@ static int tcp_inet_output(tcp_descriptor* desc, HANDLE event)
 #endif
 		goto done;
 	    }
+	    if (desc->sendfile.active)
+		desc->sendfile.before -= n;
 	    if (driver_deq(ix, n) <= desc->low) {
 		if (IS_BUSY(INETP(desc))) {
 		    desc->inet.caller = desc->inet.busy_caller;
@@ -8856,6 +9755,98 @@ static int packet_error(udp_descriptor* udesc, int err)
     return -1;
 }
 
+/*
+** Sends the datagrams [P1, P0, Address, Length(4), Data]* in buf, with
+** sendmmsg() INET_MMSG_LEN at a time where it is available. The whole
+** buffer is checked before anything is sent. Returns 0 or an errno;
+** the datagrams before a failing one have been sent.
+*/
+static int packet_send_multi(inet_descriptor* desc, char* buf, int len)
+{
+    char* ptr = buf;
+    int   left = len;
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[INET_MMSG_LEN];
+    struct iovec   iov[INET_MMSG_LEN];
+    inet_address   other[INET_MMSG_LEN];
+    int n = 0;
+#else
+    inet_address other[1];
+#endif
+
+    while (left > 0) {
+	int sz = left;
+	int dlen;
+	char* qtr = inet_set_address(desc->sfamily, &other[0], ptr, &sz);
+	if (qtr == NULL || (buf + len) - qtr < 4)
+	    return EINVAL;
+	dlen = get_int32(qtr);
+	qtr += 4;
+	if (dlen < 0 || (buf + len) - qtr < dlen)
+	    return EINVAL;
+	left -= (qtr + dlen) - ptr;
+	ptr = qtr + dlen;
+    }
+
+    ptr = buf;
+    left = len;
+    while (left > 0) {
+	int sz = left;
+	int dlen;
+	char* qtr;
+#ifdef HAVE_SENDMMSG
+	qtr = inet_set_address(desc->sfamily, &other[n], ptr, &sz);
+	dlen = get_int32(qtr);
+	qtr += 4;
+	inet_output_count(desc, dlen);
+	iov[n].iov_base = qtr;
+	iov[n].iov_len  = dlen;
+	if (desc->state & INET_F_ACTIVE) { /* connected (ignore address) */
+	    msgs[n].msg_hdr.msg_name    = NULL;
+	    msgs[n].msg_hdr.msg_namelen = 0;
+	}
+	else {
+	    msgs[n].msg_hdr.msg_name    = &other[n].sa;
+	    msgs[n].msg_hdr.msg_namelen = sz;
+	}
+	msgs[n].msg_hdr.msg_iov        = &iov[n];
+	msgs[n].msg_hdr.msg_iovlen     = 1;
+	msgs[n].msg_hdr.msg_control    = NULL;
+	msgs[n].msg_hdr.msg_controllen = 0;
+	msgs[n].msg_hdr.msg_flags      = 0;
+	n++;
+	left -= (qtr + dlen) - ptr;
+	ptr = qtr + dlen;
+
+	if (n == INET_MMSG_LEN || left == 0) {
+	    int sent = 0;
+	    while (sent < n) {
+		int code = sock_sendmmsg(desc->s, msgs + sent, n - sent, 0);
+		if (code == SOCKET_ERROR)
+		    return sock_errno();
+		sent += code;
+	    }
+	    n = 0;
+	}
+#else
+	int code;
+	qtr = inet_set_address(desc->sfamily, &other[0], ptr, &sz);
+	dlen = get_int32(qtr);
+	qtr += 4;
+	inet_output_count(desc, dlen);
+	if (desc->state & INET_F_ACTIVE) /* connected (ignore address) */
+	    code = sock_send(desc->s, qtr, dlen, 0);
+	else
+	    code = sock_sendto(desc->s, qtr, dlen, 0, &other[0].sa, sz);
+	if (code == SOCKET_ERROR)
+	    return sock_errno();
+	left -= (qtr + dlen) - ptr;
+	ptr = qtr + dlen;
+#endif
+    }
+    return 0;
+}
+
 /*
 ** Various functions accessible via "port_control" on the Erlang side:
 */
@@ -8881,6 +9872,13 @@ static int packet_inet_ctl(ErlDrvData e, unsigned int cmd, char* buf, int len,
 	case INET_AF_INET:  af = AF_INET; break;
 #if defined(HAVE_IN6) && defined(AF_INET6)
 	case INET_AF_INET6: af = AF_INET6; break; 
+#endif
+#ifdef HAVE_INET_LOCAL
+	case INET_AF_LOCAL:
+	    if (type != SOCK_DGRAM)
+		return ctl_error(EINVAL, rbuf, rsize);
+	    af = AF_UNIX;
+	    break;
 #endif
 	default:
 	    return ctl_error(EINVAL, rbuf, rsize);
@@ -8916,6 +9914,12 @@ static int packet_inet_ctl(ErlDrvData e, unsigned int cmd, char* buf, int len,
 	else if ((len == 5) && (buf[0] == INET_AF_INET6))
 	    replen = inet_ctl_fdopen(desc, AF_INET6, SOCK_DGRAM,
 				     (SOCKET)get_int32(buf+1),rbuf,rsize);
+#endif
+#ifdef HAVE_INET_LOCAL
+	else if ((len == 5) && (buf[0] == INET_AF_LOCAL) &&
+		 (type == SOCK_DGRAM))
+	    replen = inet_ctl_fdopen(desc, AF_UNIX, SOCK_DGRAM,
+				     (SOCKET)get_int32(buf+1),rbuf,rsize);
 #endif
 	else
 	    return ctl_error(EINVAL, rbuf, rsize);
@@ -9113,6 +10117,25 @@ static int packet_inet_ctl(ErlDrvData e, unsigned int cmd, char* buf, int len,
 	}
 #endif  /* HAVE_SCTP */
 
+    case UDP_REQ_SENDMULTI:
+	{
+	    int err;
+
+	    DEBUGF(("packet_inet_ctl(%ld): SENDMULTI\r\n", (long)desc->port));
+	    /* INPUT: [P1, P0, Address, Length(4), Data]* */
+	    if (!IS_OPEN(desc))
+		return ctl_xerror(EXBADPORT, rbuf, rsize);
+	    if (!IS_BOUND(desc))
+		return ctl_error(EINVAL, rbuf, rsize);
+#ifdef HAVE_SCTP
+	    if (IS_SCTP(desc))
+		return ctl_error(EINVAL, rbuf, rsize);
+#endif
+	    if ((err = packet_send_multi(desc, buf, len)) != 0)
+		return ctl_error(err, rbuf, rsize);
+	    return ctl_reply(INET_REP_OK, NULL, 0, rbuf, rsize);
+	}
+
     case PACKET_REQ_RECV:
 	{	/* THIS IS A FRONT-END for "recv*" requests. It only enqueues the
 		   request  and possibly returns the data  immediately available.
@@ -9301,6 +10324,105 @@ static void packet_inet_drv_input(ErlDrvData e, ErlDrvEvent event)
     (void)  packet_inet_input((udp_descriptor*)e, (HANDLE)event);
 }
 
+#ifdef HAVE_RECVMMSG
+/*
+** Active UDP socket: reads up to packet_count datagrams with
+** recvmmsg(), INET_MMSG_LEN at a time, into one binary which the
+** delivered packets share. Never reads more datagrams than the socket
+** may deliver before it turns passive.
+*/
+static int packet_inet_input_mmsg(udp_descriptor* udesc, int packet_count)
+{
+    inet_descriptor* desc = INETP(udesc);
+    struct mmsghdr msgs[INET_MMSG_LEN];
+    struct iovec   iov[INET_MMSG_LEN];
+    inet_address   other[INET_MMSG_LEN];
+    int            offs[INET_MMSG_LEN];
+    unsigned int   alen[INET_MMSG_LEN];
+    char abuf[INET_ADDRESS_BUFSZ];
+    int count = 0;
+
+    while(packet_count > 0) {
+	/* Each datagram gets room for its formatted address + data */
+	int slot = INET_ADDRESS_BUFSZ + desc->bufsz;
+	int vlen = packet_count;
+	ErlDrvBinary* buf;
+	int i, n, used;
+
+	if (vlen > INET_MMSG_LEN)
+	    vlen = INET_MMSG_LEN;
+	if (desc->active == INET_MULTI && vlen > desc->active_count)
+	    vlen = desc->active_count;
+
+	if ((buf = alloc_buffer(vlen*slot)) == NULL)
+	    return packet_error(udesc, ENOMEM);
+	for (i = 0; i < vlen; i++) {
+	    iov[i].iov_base = buf->orig_bytes + i*slot + INET_ADDRESS_BUFSZ;
+	    iov[i].iov_len  = desc->bufsz;
+	    msgs[i].msg_hdr.msg_name       = &other[i];
+	    msgs[i].msg_hdr.msg_namelen    = sizeof(other[i]);
+	    msgs[i].msg_hdr.msg_iov        = &iov[i];
+	    msgs[i].msg_hdr.msg_iovlen     = 1;
+	    msgs[i].msg_hdr.msg_control    = NULL;
+	    msgs[i].msg_hdr.msg_controllen = 0;
+	    msgs[i].msg_hdr.msg_flags      = 0;
+	}
+
+	n = sock_recvmmsg(desc->s, msgs, vlen, 0);
+	if (n == SOCKET_ERROR) {
+	    int err = sock_errno();
+	    release_buffer(buf);
+	    if (err != ERRNO_BLOCK)
+		packet_error_message(udesc, err);
+	    return count;
+	}
+
+	/* Pack address + data of the datagrams together at the start
+	   of the buffer, so that the slack can be given back: */
+	used = 0;
+	for (i = 0; i < n; i++) {
+	    int len = msgs[i].msg_len;
+
+	    inet_input_count(desc, len);
+	    if (desc->state & INET_F_ACTIVE)
+		other[i] = desc->remote;
+	    alen[i] = (desc->state & INET_F_ACTIVE) ? sizeof(other[i])
+		: msgs[i].msg_hdr.msg_namelen;
+	    inet_get_address(desc->sfamily, abuf, &other[i], &alen[i]);
+	    offs[i] = used;
+	    sys_memcpy(buf->orig_bytes + used, abuf, alen[i]);
+	    sys_memmove(buf->orig_bytes + used + alen[i],
+			iov[i].iov_base, len);
+	    used += alen[i] + len;
+	}
+	if (used < BIN_REALLOC_LIMIT(vlen*slot)) {
+	    ErlDrvBinary* tmp;
+	    if ((tmp = realloc_buffer(buf, used)) != NULL)
+		buf = tmp;
+	}
+
+	for (i = 0; i < n; i++) {
+	    int nsz = ((i+1 < n) ? offs[i+1] : used) - offs[i];
+	    if (packet_reply_binary_data(desc, alen[i], buf, offs[i], nsz,
+					 NULL) < 0)
+		break;
+	    count++;
+	}
+	free_buffer(buf);
+
+	if (!desc->active) {
+	    driver_cancel_timer(desc->port); /* possibly cancel */
+	    sock_select(desc,FD_READ,0);
+	    return count;
+	}
+	if (n < vlen)
+	    return count;  /* socket drained */
+	packet_count -= n;
+    }
+    return count;
+}
+#endif
+
 /*
 ** THIS IS A BACK-END FOR "recv*" REQUEST, which actually receives the
 **	data requested, and delivers them to the caller:
@@ -9311,7 +10433,7 @@ static int packet_inet_input(udp_descriptor* udesc, HANDLE event)
     int n;
     unsigned int len;
     inet_address other;
-    char abuf[sizeof(inet_address)];  /* buffer address; enough??? */
+    char abuf[INET_ADDRESS_BUFSZ];  /* buffer address */
     int  sz;
     char* ptr;
     ErlDrvBinary* buf; /* binary */
@@ -9324,15 +10446,25 @@ static int packet_inet_input(udp_descriptor* udesc, HANDLE event)
     int short_recv = 0;
 #endif
 
+#ifdef HAVE_RECVMMSG
+    if (packet_count > 1
+	&& (desc->active == INET_ACTIVE || desc->active == INET_MULTI)
+#ifdef HAVE_SCTP
+	&& !IS_SCTP(desc)
+#endif
+	)
+	return packet_inet_input_mmsg(udesc, packet_count);
+#endif
+
     while(packet_count--) {
 	len = sizeof(other);
 	sz = desc->bufsz;
 	/* Allocate space for message and address. NB: "bufsz" is in "desc",
 	   but the "buf" itself is allocated separately:
 	*/
-	if ((buf = alloc_buffer(sz+len)) == NULL)
+	if ((buf = alloc_buffer(sz+INET_ADDRESS_BUFSZ)) == NULL)
 	    return packet_error(udesc, ENOMEM);
-	ptr = buf->orig_bytes + len;  /* pointer to message part */
+	ptr = buf->orig_bytes + INET_ADDRESS_BUFSZ; /* message part */
 
 	/* Note: On Windows NT, recvfrom() fails if the socket is connected. */
 #ifdef HAVE_SCTP
@@ -9407,12 +10539,12 @@ static int packet_inet_input(udp_descriptor* udesc, HANDLE event)
 	    inet_input_count(desc, n);
 	    inet_get_address(desc->sfamily, abuf, &other, &alen);
 	    /* Copy formatted address to the buffer allocated; "alen" is the
-	       actual length which must be <= than the original reserved "len".
-	       This means that the addr + data in the buffer are contiguous,
-	       but they may start not at the "orig_bytes", but with some "offs"
-	       from them:
+	       actual length which must be <= than the reserved
+	       INET_ADDRESS_BUFSZ. This means that the addr + data in the
+	       buffer are contiguous, but they may start not at the
+	       "orig_bytes", but with some "offs" from them:
 	    */
-	    ASSERT (alen <= len);
+	    ASSERT (alen <= INET_ADDRESS_BUFSZ);
 	    sys_memcpy(ptr - alen, abuf, alen); 
 	    ptr -= alen;
 	    nsz  = n + alen;              /* nsz = data + address */
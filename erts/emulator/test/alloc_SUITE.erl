@@ -27,6 +27,7 @@
 	 bucket_index/1,
 	 bucket_mask/1,
 	 rbtree/1,
+	 aoffcbf/1,
 	 mseg_clear_cache/1]).
 
 -export([init_per_testcase/2, fin_per_testcase/2]).
@@ -43,6 +44,7 @@ all(suite) -> [basic,
 	       bucket_index,
 	       bucket_mask,
 	       rbtree,
+	       aoffcbf,
 	       mseg_clear_cache].
 
 
@@ -88,6 +90,10 @@ rbtree(suite) -> [];
 rbtree(doc) ->   [];
 rbtree(Cfg) -> ?line drv_case(Cfg).
 
+aoffcbf(suite) -> [];
+aoffcbf(doc) ->   [];
+aoffcbf(Cfg) -> ?line drv_case(Cfg).
+
 mseg_clear_cache(suite) -> [];
 mseg_clear_cache(doc) ->   [];
 mseg_clear_cache(Cfg) -> ?line drv_case(Cfg).
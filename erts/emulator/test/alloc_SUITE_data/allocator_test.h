@@ -102,6 +102,15 @@ typedef void* erts_cond;
 #define MSEG_NO()		((Ulong)	ALC_TEST0(0x405))
 #define MSEG_CACHE_SIZE()	((Ulong)	ALC_TEST0(0x406))
 
+/* From erl_ao_firstfit_alloc.c */
+#define AOFF_ROOT(A)		((RBT_t *)	ALC_TEST1(0x500, (A)))
+#define AOFF_PARENT(T)		((RBT_t *)	ALC_TEST1(0x501, (T)))
+#define AOFF_LEFT(T)		((RBT_t *)	ALC_TEST1(0x502, (T)))
+#define AOFF_RIGHT(T)		((RBT_t *)	ALC_TEST1(0x503, (T)))
+#define AOFF_IS_BLACK(T)	((Ulong)	ALC_TEST1(0x504, (T)))
+#define AOFF_MAX_SZ(T)		((Ulong)	ALC_TEST1(0x505, (T)))
+#define AOFF_CRR_ROOT(A)	((RBT_t *)	ALC_TEST1(0x506, (A)))
+
 /* From erl_alloc.c */
 
 #undef  ALLOC
@@ -0,0 +1,301 @@
+/* ``The contents of this file are subject to the Erlang Public License,
+ * Version 1.1, (the "License"); you may not use this file except in
+ * compliance with the License. You should have received a copy of the
+ * Erlang Public License along with this software. If not, it can be
+ * retrieved via the world wide web at http://www.erlang.org/.
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Initial Developer of the Original Code is Ericsson Utvecklings AB.
+ * Portions created by Ericsson are Copyright 1999, Ericsson Utvecklings
+ * AB. All Rights Reserved.''
+ * 
+ *     $Id$
+ */
+
+
+/*
+ * Tests the "address order first fit, carrier best fit" strategy. Each
+ * allocation should be placed in the carrier with the lowest address
+ * that has a large enough free block, using the best fitting block in
+ * that carrier.
+ */
+
+#include "testcase_driver.h"
+#include "allocator_test.h"
+
+#define NO_BLOCKS 4000
+#define MAX_CARRIERS 1000
+
+#define RIGHT_VISITED (1 << 0)
+#define LEFT_VISITED (1 << 1)
+
+typedef struct {
+    Allctr_t *allocator;
+    void **blk;
+} aoffcbf_test_data;
+
+static void
+check_tree(TestCaseState_t *tcs, Allctr_t *alc)
+{
+    int i;
+    char stk[128];
+    RBT_t *root, *x, *y;
+    Ulong max_sz;
+    long blacks, curr_blacks;
+
+    root = AOFF_ROOT(alc);
+
+    i = -1;
+    curr_blacks = 0;
+    blacks = -1;
+
+    if (!root)
+	goto done;
+
+    stk[++i] = 0;
+
+    ASSERT(tcs, AOFF_IS_BLACK(root));
+    ASSERT(tcs, !AOFF_PARENT(root));
+    x = root;
+    curr_blacks++;
+
+    while (x) {
+
+	ASSERT(tcs, i < 128);
+
+	if (!(stk[i] & LEFT_VISITED)) {
+	    stk[i] |= LEFT_VISITED;
+	    y = AOFF_LEFT(x);
+	    if (AOFF_IS_BLACK(y))
+		curr_blacks++;
+	    if (y) {
+		x = y;
+		stk[++i] = 0;
+		continue;
+	    }
+	    else {
+		if (blacks < 0)
+		    blacks = curr_blacks;
+		ASSERT(tcs, blacks == curr_blacks);
+		curr_blacks--;
+	    }
+	}
+
+	if (!(stk[i] & RIGHT_VISITED)) {
+	    stk[i] |= RIGHT_VISITED;
+	    y = AOFF_RIGHT(x);
+	    if (AOFF_IS_BLACK(y))
+		curr_blacks++;
+	    if (y) {
+		x = y;
+		stk[++i] = 0;
+		continue;
+	    }
+	    else {
+		if (blacks < 0)
+		    blacks = curr_blacks;
+		ASSERT(tcs, blacks == curr_blacks);
+		curr_blacks--;
+	    }
+	}
+
+	/* Check x ... */
+
+	if (!AOFF_IS_BLACK(x)) {
+	    ASSERT(tcs, AOFF_IS_BLACK(AOFF_RIGHT(x)));
+	    ASSERT(tcs, AOFF_IS_BLACK(AOFF_LEFT(x)));
+	}
+
+	max_sz = BLK_SZ(x);
+	y = AOFF_LEFT(x);
+	if (y) {
+	    ASSERT(tcs, AOFF_PARENT(y) == x);
+	    if (AOFF_MAX_SZ(y) > max_sz)
+		max_sz = AOFF_MAX_SZ(y);
+	}
+	y = AOFF_RIGHT(x);
+	if (y) {
+	    ASSERT(tcs, AOFF_PARENT(y) == x);
+	    if (AOFF_MAX_SZ(y) > max_sz)
+		max_sz = AOFF_MAX_SZ(y);
+	}
+	ASSERT(tcs, AOFF_MAX_SZ(x) == max_sz);
+
+	if (AOFF_IS_BLACK(x))
+	    curr_blacks--;
+	x = AOFF_PARENT(x);
+	i--;
+    }
+
+ done:
+    ASSERT(tcs, curr_blacks == 0);
+    ASSERT(tcs, i == -1);
+}
+
+/*
+ * Find the block that should be chosen by scanning all carriers
+ */
+static Block_t *
+expected_block(TestCaseState_t *tcs, Allctr_t *a, Ulong size)
+{
+    Carrier_t *c, *crr = NULL;
+    Block_t *b, *res = NULL;
+
+    for (c = FIRST_MBC(a); c; c = NEXT_C(c)) {
+	Block_t *c_res = NULL;
+	if (crr && crr < c)
+	    continue;
+	for (b = MBC2FBLK(a, c); ; b = NXT_BLK(b)) {
+	    if (IS_FREE_BLK(b) && BLK_SZ(b) >= size) {
+		if (!c_res
+		    || BLK_SZ(b) < BLK_SZ(c_res)
+		    || (BLK_SZ(b) == BLK_SZ(c_res) && b < c_res))
+		    c_res = b;
+	    }
+	    if (IS_LAST_BLK(b))
+		break;
+	}
+	if (c_res) {
+	    crr = c;
+	    res = c_res;
+	}
+    }
+
+    return res;
+}
+
+static void
+do_check(TestCaseState_t *tcs, Allctr_t *a, Ulong size)
+{
+    Ulong sz = ((size + 7) / 8)*8;
+    void *tmp;
+    Block_t *x;
+
+    check_tree(tcs, a);
+    x = expected_block(tcs, a, sz);
+    tmp = ALLOC(a, sz - ABLK_HDR_SZ);
+    ASSERT(tcs, tmp);
+    if (x)
+	ASSERT(tcs, UMEM2BLK(tmp) == x);
+    FREE(a, tmp);
+    check_tree(tcs, a);
+}
+
+static void
+test_it(TestCaseState_t *tcs)
+{
+    int i, j;
+    Allctr_t a = ((aoffcbf_test_data *) tcs->extra)->allocator;
+    void **blk = ((aoffcbf_test_data *) tcs->extra)->blk;
+    int no_crrs;
+    Carrier_t *c;
+
+    for (i = 0; i < NO_BLOCKS; i++) {
+	blk[i] = ALLOC(a, 100 + (i*37) % 1000);
+	ASSERT(tcs, blk[i]);
+    }
+
+    for (no_crrs = 0, c = FIRST_MBC(a); c; c = NEXT_C(c))
+	no_crrs++;
+    testcase_printf(tcs, "%d blocks placed in %d carriers\n",
+		    NO_BLOCKS, no_crrs);
+    ASSERT(tcs, no_crrs > 1);
+
+    for (j = 2; j < 8; j++) {
+	for (i = 0; i < NO_BLOCKS; i++) {
+	    if (blk[i] && (i*7) % j == 0) {
+		FREE(a, blk[i]);
+		blk[i] = NULL;
+	    }
+	}
+	do_check(tcs, a, 100);
+	do_check(tcs, a, 300);
+	do_check(tcs, a, 700);
+	do_check(tcs, a, 1200);
+	do_check(tcs, a, 4000);
+
+	/* Refill some of the holes; these should end up in the low
+	   carriers */
+	for (i = 0; i < NO_BLOCKS; i += j) {
+	    if (!blk[i]) {
+		Ulong sz = ((100 + (i*13) % 500 + 7) / 8)*8;
+		Block_t *x = expected_block(tcs, a, sz);
+		blk[i] = ALLOC(a, sz - ABLK_HDR_SZ);
+		ASSERT(tcs, blk[i]);
+		if (x)
+		    ASSERT(tcs, UMEM2BLK(blk[i]) == x);
+	    }
+	}
+	check_tree(tcs, a);
+    }
+
+    for (i = 0; i < NO_BLOCKS; i++) {
+	if (blk[i]) {
+	    FREE(a, blk[i]);
+	    blk[i] = NULL;
+	}
+	if (i % (NO_BLOCKS/4) == 0)
+	    do_check(tcs, a, 200);
+    }
+
+    /* All carriers should have been released */
+    ASSERT(tcs, !FIRST_MBC(a));
+    ASSERT(tcs, !AOFF_ROOT(a));
+    ASSERT(tcs, !AOFF_CRR_ROOT(a));
+}
+
+
+char *
+testcase_name(void)
+{
+    return "aoffcbf";
+}
+
+void
+testcase_cleanup(TestCaseState_t *tcs)
+{
+    if (tcs->extra) {
+	aoffcbf_test_data *td = tcs->extra;
+	tcs->extra = NULL;
+	if (td->allocator)
+	    STOP_ALC(td->allocator);
+	if (td->blk)
+	    testcase_free((void *) td->blk);
+	testcase_free((void *) td);
+    }
+}
+
+void
+testcase_run(TestCaseState_t *tcs)
+{
+    char *argv[] = {"-tasaoffcbf", "-tmmbcs0", "-tsmbcs64", "-tlmbcs64",
+		    "-tsbct8", NULL};
+    Allctr_t *a;
+    aoffcbf_test_data *td;
+
+    testcase_printf(tcs, "Setup...\n");
+
+    td = (aoffcbf_test_data *) testcase_alloc(sizeof(aoffcbf_test_data));
+    ASSERT(tcs, td);
+    tcs->extra = (void *) td;
+    td->allocator = NULL;
+    td->blk = (void **) testcase_alloc(sizeof(void *)*NO_BLOCKS);
+    ASSERT(tcs, td->blk);
+
+    testcase_printf(tcs, "Starting test of aoffcbf...\n");
+
+    td->allocator = a = START_ALC("aoffcbf_", 0, argv);
+
+    ASSERT(tcs, a);
+
+    test_it(tcs);
+
+    STOP_ALC(a);
+    td->allocator = NULL;
+
+    testcase_printf(tcs, "aoffcbf test succeeded!\n");
+}
@@ -56,11 +56,12 @@
 	 bit_sized_binary_sizes/1,
 	 bitlevel_roundtrip/1,
 	 otp_6817/1,deep/1,obsolete_funs/1,robustness/1,otp_8117/1,
-	 otp_8180/1]).
+	 otp_8180/1,trapping/1,lz_compression/1,compression_speed/1]).
 
 %% Internal exports.
 -export([sleeper/0]).
 
+%% compression_speed/1 is a benchmark; it is not run by default.
 all(suite) ->
     [copy_terms,conversions,deep_lists,deep_bitstr_lists,
      t_split_binary, bad_split, t_concat_binary,
@@ -70,7 +71,7 @@ all(suite) ->
      bad_binary_to_term, bad_terms, t_hash, bad_size, bad_term_to_binary,
      more_bad_terms, otp_5484, otp_5933, ordering, unaligned_order,
      gc_test, bit_sized_binary_sizes, bitlevel_roundtrip, otp_6817, otp_8117,
-     deep,obsolete_funs,robustness,otp_8180].
+     deep,obsolete_funs,robustness,otp_8180,trapping,lz_compression].
 
 init_per_testcase(Func, Config) when is_atom(Func), is_list(Config) ->
     Dog=?t:timetrap(?t:minutes(2)),
@@ -446,7 +447,11 @@ terms(Config) when is_list(Config) ->
 		      Bin = term_to_binary(Term, [{compressed,0}]),
 		      terms_compression_levels(Term, size(Bin), 1),
 		      UnalignedC = make_unaligned_sub_binary(BinC),
-		      Term = binary_to_term(UnalignedC)
+		      Term = binary_to_term(UnalignedC),
+		      BinL = erlang:term_to_binary(Term, [{compressed,lz}]),
+		      Term = binary_to_term(BinL),
+		      true = size(BinL) =< size(Bin),
+		      Term = binary_to_term(make_unaligned_sub_binary(BinL))
 	      end,
     ?line test_terms(TestFun),
     ok.
@@ -556,7 +561,9 @@ corrupter(Term) ->
     ?line Bin = term_to_binary(Term),
     ?line corrupter(Bin, size(Bin)-1),
     ?line CompressedBin = term_to_binary(Term, [compressed]),
-    ?line corrupter(CompressedBin, size(CompressedBin)-1).
+    ?line corrupter(CompressedBin, size(CompressedBin)-1),
+    ?line LzBin = term_to_binary(Term, [{compressed,lz}]),
+    ?line corrupter(LzBin, size(LzBin)-1).
 
 corrupter(Bin, Pos) when Pos >= 0 ->
     ?line {ShorterBin, _} = split_binary(Bin, Pos),
@@ -1271,6 +1278,152 @@ run_otp_8180(Name) ->
      end || Bin <- Bins],
     ok.
 
+trapping(doc) -> "Conversion of large terms yields.";
+trapping(Config) when is_list(Config) ->
+    ?line T = {lists:seq(1, 200000),
+	       [{a,<<"bin">>,1.5,"str",make_ref(),self()} ||
+		   _ <- lists:seq(1, 50000)],
+	       list_to_binary(lists:duplicate(100000, $x))},
+    ?line B = term_to_binary(T),
+    ?line T = binary_to_term(B),
+    ?line T = binary_to_term(make_unaligned_sub_binary(B)),
+    ?line T = binary_to_term(term_to_binary(T, [compressed])),
+    ?line {Truncated,_} = split_binary(B, size(B)-1),
+    ?line {'EXIT',{badarg,_}} = (catch binary_to_term(Truncated)),
+
+    %% The conversions are seen trapping.
+    ?line true = trap_seen(fun() -> term_to_binary(T) end,
+			   {erlang,term_to_binary_trap,2}),
+    ?line true = trap_seen(fun() -> binary_to_term(B) end,
+			   {erlang,binary_to_term_trap,2}),
+
+    %% Kill processes in the middle of conversions.
+    ?line Ps = [spawn(fun() -> trapping_loop(T, B) end) ||
+		   _ <- lists:seq(1, 10)],
+    ?line receive after 100 -> ok end,
+    ?line [exit(P, kill) || P <- Ps],
+    ?line T = binary_to_term(term_to_binary(T)),
+    ok.
+
+trap_seen(Fun, MFA) ->
+    Self = self(),
+    P = spawn(fun() -> trap_seen_loop(Self, Fun) end),
+    Res = trap_seen_sample(P, MFA, 100000),
+    exit(P, kill),
+    Res.
+
+trap_seen_loop(Parent, Fun) ->
+    Fun(),
+    Parent ! {self(), converted},
+    trap_seen_loop(Parent, Fun).
+
+trap_seen_sample(_, _, 0) ->
+    false;
+trap_seen_sample(P, MFA, N) ->
+    case process_info(P, current_function) of
+	{current_function, MFA} ->
+	    true;
+	_ ->
+	    erlang:yield(),
+	    trap_seen_sample(P, MFA, N-1)
+    end.
+
+trapping_loop(T, B) ->
+    T = binary_to_term(B),
+    B = term_to_binary(T),
+    trapping_loop(T, B).
+
+lz_compression(doc) -> "LZ compressed external term format.";
+lz_compression(Config) when is_list(Config) ->
+    ?line T = {lists:seq(1, 10000), lists:duplicate(1000, {a,"str",1.5}),
+	       list_to_binary(lists:duplicate(10000, $x))},
+    ?line B = term_to_binary(T),
+    ?line <<131,$L,USz:32,Data/binary>> = BL = term_to_binary(T, [{compressed,lz}]),
+    ?line USz = size(B) - 1,
+    ?line true = size(BL) < size(B) div 2,
+    ?line T = binary_to_term(BL),
+
+    %% Incompressible data is left uncompressed.
+    ?line R = list_to_binary([random:uniform(256)-1 ||
+				 _ <- lists:seq(1, 10000)]),
+    ?line RB = term_to_binary(R),
+    ?line RB = term_to_binary(R, [{compressed,lz}]),
+
+    %% Small terms and repeated bytes.
+    ?line [X = binary_to_term(term_to_binary(X, [{compressed,lz}])) ||
+	      X <- [a, [], 42, "abcabcabcabcabcabc", lists:duplicate(100, 0),
+		    list_to_binary(lists:duplicate(100000, 7))]],
+
+    %% Bad uncompressed sizes.
+    ?line {'EXIT',{badarg,_}} =
+	(catch binary_to_term(<<131,$L,(USz+1):32,Data/binary>>)),
+    ?line {'EXIT',{badarg,_}} =
+	(catch binary_to_term(<<131,$L,(USz-1):32,Data/binary>>)),
+    ?line {'EXIT',{badarg,_}} =
+	(catch binary_to_term(<<131,$L,16#7fffffff:32,Data/binary>>)),
+
+    %% Corrupted data must not crash the emulator.
+    ?line Sz = size(Data),
+    ?line [catch binary_to_term(<<131,$L,USz:32,
+				 (lz_corrupt(Data, I, Sz))/binary>>) ||
+	      I <- lists:seq(0, Sz-1, 7)],
+    ok.
+
+lz_corrupt(Data, I, Sz) ->
+    Len = Sz - I - 1,
+    <<Pre:I/binary,B,Post:Len/binary>> = Data,
+    <<Pre/binary,(B bxor 16#5a),Post/binary>>.
+
+compression_speed(doc) -> "Compare the speed of zlib and LZ compression.";
+compression_speed(Config) when is_list(Config) ->
+    ?line Terms = [{tuples,[{I,"hello world",atom_x,1.5} ||
+			       I <- lists:seq(1, 20000)]},
+		   {integers,lists:seq(1, 50000)},
+		   {records,[{record,I,[a,b,c],<<"binary data">>,self()} ||
+				I <- lists:seq(1, 10000)]},
+		   {text,list_to_binary(
+			   lists:flatten(
+			     [io_lib:format("line ~w of some log text~n", [I]) ||
+				 I <- lists:seq(1, 10000)]))}],
+    ?line Res = [compression_speed(Name, T) || {Name,T} <- Terms],
+    ?line [io:format("~w: size ~w, zlib ~w in ~w/~w us, "
+		     "lz ~w in ~w/~w us\n", [Name,Sz,Zsz,Zc,Zu,Lsz,Lc,Lu]) ||
+	      {Name,Sz,{Zsz,Zc,Zu},{Lsz,Lc,Lu}} <- Res],
+    ?line {Zt,Lt} = lists:foldl(fun({_,_,{_,Z1,Z2},{_,L1,L2}}, {Za,La}) ->
+					{Za+Z1+Z2,La+L1+L2}
+				end, {0,0}, Res),
+    {comment,
+     lists:flatten(io_lib:format("lz ~.1fx faster than zlib",
+				 [Zt/erlang:max(Lt, 1)]))}.
+
+compression_speed(Name, T) ->
+    Sz = size(term_to_binary(T)),
+    {Zsz,Zc,Zu} = compression_time(T, [compressed]),
+    {Lsz,Lc,Lu} = compression_time(T, [{compressed,lz}]),
+    {Name,Sz,{Zsz,Zc,Zu},{Lsz,Lc,Lu}}.
+
+%% Returns the compressed size and the times in microseconds to
+%% compress and uncompress.
+compression_time(T, Opts) ->
+    N = 10,
+    B = term_to_binary(T, Opts),
+    T = binary_to_term(B),
+    T0 = now(),
+    compression_loop(term_to_binary, T, Opts, N),
+    T1 = now(),
+    compression_loop(binary_to_term, B, Opts, N),
+    T2 = now(),
+    {size(B),timer:now_diff(T1, T0) div N,timer:now_diff(T2, T1) div N}.
+
+compression_loop(_, _, _, 0) ->
+    ok;
+compression_loop(term_to_binary, T, Opts, N) ->
+    term_to_binary(T, Opts),
+    compression_loop(term_to_binary, T, Opts, N-1);
+compression_loop(binary_to_term, B, Opts, N) ->
+    binary_to_term(B),
+    compression_loop(binary_to_term, B, Opts, N-1).
+
 %% Utilities.
 
 make_sub_binary(Bin) when is_binary(Bin) ->
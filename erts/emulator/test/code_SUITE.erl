@@ -392,7 +392,39 @@ constant_pools(Config) when is_list(Config) ->
     receive
 	{'EXIT',OldHeap,{A,B,C,[1,2,3|_]=Seq}} when length(Seq) =:= 16 ->
 	    ok
-    end.
+    end,
+    ?line Mem0 = erlang:memory(code),
+    ?line {module,literals} = erlang:load_module(literals, Code),
+
+    %% Have a process that garbage collects after the purge, copying
+    %% the literals from the (released) literal area.
+    ?line Lazy = spawn_link(fun() -> no_old_heap(Self) end),
+    receive go -> ok end,
+    GcInfo = [heap_size,total_heap_size,garbage_collection],
+    ?line Heap = process_info(Lazy, GcInfo),
+    ?line true = erlang:delete_module(literals),
+    ?line false = erlang:check_process_code(Lazy, literals),
+    ?line erlang:check_process_code(self(), literals),
+    ?line true = erlang:purge_module(literals),
+
+    %% The purge must not have collected Lazy, so the literal area
+    %% is still there.
+    ?line Heap = process_info(Lazy, GcInfo),
+    ?line true = erlang:memory(code) > Mem0,
+
+    %% The next collection of Lazy copies the literals and releases
+    %% the last reference to the literal area.
+    ?line true = erlang:garbage_collect(Lazy),
+    ?line Mem0 = erlang:memory(code),
+    ?line Lazy ! done,
+    ?line receive
+	      {'EXIT',Lazy,{A,B,C}} ->
+		  ok;
+	      Other2 ->
+		  ?line ?t:fail({unexpected,Other2})
+	  end,
+    ?line Mem0 = erlang:memory(code),
+    ok.
 
 no_old_heap(Parent) ->
     A = literals:a(),
@@ -37,6 +37,16 @@
 	 atom_roundtrip/1,
 	 atom_roundtrip_r12b/1,
 	 contended_atom_cache_entry/1,
+	 fragmented_messages/1,
+	 fragmented_sender_killed/1,
+	 dist_lanes/1,
+	 dist_compression/1,
+	 dist_lazy_decode/1,
+	 dist_large_binaries/1,
+	 send_multi/1,
+	 atom_cache_ways/1,
+	 dist_delay_send/1,
+	 dist_stats/1,
 	 bad_dist_ext/1,
 	 bad_dist_ext_receive/1,
 	 bad_dist_ext_process_info/1,
@@ -49,7 +59,8 @@
 -export([sender/3, receiver2/2, dummy_waiter/0, dead_process/0,
 	 roundtrip/1, bounce/1, do_dist_auto_connect/1, inet_rpc_server/1,
 	 dist_parallel_sender/3, dist_parallel_receiver/0,
-	 dist_evil_parallel_receiver/0]).
+	 dist_evil_parallel_receiver/0,
+	 dist_lane_ports/1, dist_lanes_kill/2]).
 
 all(suite) -> [
 	       ping, bulk_send, local_send, link_to_busy, exit_to_busy,
@@ -58,6 +69,16 @@ all(suite) -> [
 	       stop_dist, trap_bif, dist_auto_connect, dist_parallel_send,
 	       atom_roundtrip, atom_roundtrip_r12b,
 	       contended_atom_cache_entry,
+	       fragmented_messages,
+	       fragmented_sender_killed,
+	       dist_lanes,
+	       dist_compression,
+	       dist_lazy_decode,
+	       dist_large_binaries,
+	       send_multi,
+	       atom_cache_ways,
+	       dist_delay_send,
+	       dist_stats,
 	       bad_dist_ext
 	      ].
 
@@ -1167,6 +1188,546 @@ get_conflicting_atoms(CIX, N) ->
     end.
 
 
+fragmented_messages(doc) ->
+    ["Tests that large messages, which are sent in fragments, arrive",
+     "intact also when fragments from several senders are interleaved",
+     "and when a sender is killed while sending."];
+fragmented_messages(suite) ->
+    [];
+fragmented_messages(Config) when is_list(Config) ->
+    ?line {ok, Node} = start_node(Config),
+    ?line Echo = spawn_link(Node, fun frag_echo/0),
+    ?line Bin = list_to_binary(lists:duplicate(1024*1024, 17)),
+    ?line Atoms = [list_to_atom("frag_atom_" ++ integer_to_list(I))
+		   || I <- lists:seq(1, 100)],
+    ?line Terms = [{I, Bin, Atoms, lists:seq(1, 50000*I)}
+		   || I <- lists:seq(1, 8)],
+    ?line Parent = self(),
+    ?line Pids = [spawn_link(fun () ->
+				     Echo ! {self(), T},
+				     receive {Echo, T} -> ok end,
+				     Parent ! {self(), ok}
+			     end) || T <- Terms],
+    ?line lists:foreach(fun (P) -> receive {P, ok} -> ok end end, Pids),
+
+    %% A sender killed before all fragments have been enqueued
+    ?line [Term|_] = Terms,
+    ?line Killed = spawn(fun () -> Echo ! {Parent, Term} end),
+    ?line exit(Killed, kill),
+    ?line Echo ! {Parent, small},
+    ?line receive {Echo, small} -> ok end,
+    ?line receive {Echo, Term1} -> Term = Term1 after 2000 -> ok end,
+    ?line Echo ! {Parent, small},
+    ?line receive {Echo, small} -> ok end,
+    ?line true = lists:member(Node, nodes()),
+
+    ?line unlink(Echo),
+    ?line stop_node(Node),
+    ?line ok.
+
+frag_echo() ->
+    receive
+	{From, Term} ->
+	    From ! {self(), Term},
+	    frag_echo()
+    end.
+
+fragmented_sender_killed(doc) ->
+    ["Tests that the rest of a message from a sender that is killed while",
+     "its fragments are enqueued arrives before the 'DOWN' from the",
+     "sender."];
+fragmented_sender_killed(suite) ->
+    [];
+fragmented_sender_killed(Config) when is_list(Config) ->
+    ?line {ok, Node} = start_node(Config),
+    ?line Bin = list_to_binary(lists:duplicate(8*1024*1024, 17)),
+    ?line ok = frag_kill_sender(Node, Bin, 10),
+    ?line stop_node(Node),
+    ?line ok.
+
+%% The sender is killed while it is suspended on the busy connection,
+%% which it only is in the middle of the message. If it was never
+%% seen suspended, the message may also have been sent in whole or
+%% not at all; try again.
+frag_kill_sender(_Node, _Bin, 0) ->
+    ?t:fail(sender_never_suspended);
+frag_kill_sender(Node, Bin, N) ->
+    Parent = self(),
+    Size = size(Bin),
+    Receiver = spawn(Node, fun () -> frag_kill_receiver(Parent) end),
+    Sender = spawn(fun () -> receive go -> Receiver ! {big, Bin} end end),
+    Receiver ! {monitor, Sender},
+    receive {Receiver, monitoring} -> ok end,
+    Sender ! go,
+    Suspended = frag_wait_suspended(Sender, 2000),
+    exit(Sender, kill),
+    receive
+	{Receiver, Msgs} ->
+	    case {Suspended, Msgs} of
+		{true, [{big, Size}, 'DOWN']} ->
+		    ok;
+		{false, [{big, Size}, 'DOWN']} ->
+		    frag_kill_sender(Node, Bin, N-1);
+		{false, ['DOWN']} ->
+		    frag_kill_sender(Node, Bin, N-1);
+		_ ->
+		    ?t:fail({bad_order, Suspended, Msgs})
+	    end
+    end.
+
+frag_wait_suspended(_Pid, 0) ->
+    false;
+frag_wait_suspended(Pid, N) ->
+    case process_info(Pid, status) of
+	{status, suspended} ->
+	    true;
+	{status, _} ->
+	    erlang:yield(),
+	    frag_wait_suspended(Pid, N-1);
+	undefined ->
+	    false
+    end.
+
+frag_kill_receiver(Parent) ->
+    receive
+	{monitor, Pid} ->
+	    erlang:monitor(process, Pid),
+	    Parent ! {self(), monitoring},
+	    Parent ! {self(), frag_kill_receive([])}
+    end.
+
+%% Anything arriving after the 'DOWN' is collected for a while too.
+frag_kill_receive(Acc) ->
+    receive
+	{big, Bin} ->
+	    frag_kill_receive([{big, size(Bin)} | Acc]);
+	{'DOWN', _, process, _, killed} ->
+	    receive
+		{big, Bin} ->
+		    lists:reverse(Acc, ['DOWN', {big, size(Bin)}])
+	    after 1000 ->
+		    lists:reverse(Acc, ['DOWN'])
+	    end
+    end.
+
+dist_lanes(doc) ->
+    ["Tests that nodes with dist_connections set use several connections,",
+     "that signals from each sender arrive in order, and that the node",
+     "goes down when one of the connections is lost."];
+dist_lanes(suite) ->
+    [];
+dist_lanes(Config) when is_list(Config) ->
+    ?line Args = "-kernel dist_connections 4",
+    ?line {ok, Node1} = start_node(dist_lanes_1, Args),
+    ?line {ok, Node2} = start_node(dist_lanes_2, Args),
+    ?line pong = rpc:call(Node1, net_adm, ping, [Node2]),
+    ?line [_,_,_] = Lanes = rpc:call(Node1, ?MODULE, dist_lane_ports, [Node2]),
+
+    ?line Parent = self(),
+    ?line Echo = spawn(Node2, fun lane_echo/0),
+    ?line Senders = [spawn(Node1,
+			   fun () ->
+				   Seq = lists:seq(1, 1000),
+				   lists:foreach(fun (I) ->
+							 Echo ! {self(), I}
+						 end, Seq),
+				   Seq = [receive {Echo, I} -> I end
+					  || _ <- Seq],
+				   Parent ! {self(), ok}
+			   end) || _ <- lists:seq(1, 16)],
+    ?line lists:foreach(fun (S) -> receive {S, ok} -> ok end end, Senders),
+    %% The senders have been spread over all connections
+    ?line lists:foreach(fun (Lane) ->
+				{ok, [{send_cnt, N}]}
+				    = rpc:call(Node1, inet, getstat,
+					       [Lane, [send_cnt]]),
+				true = N > 0
+			end, Lanes),
+
+    ?line [Lane|_] = Lanes,
+    ?line ok = rpc:call(Node1, ?MODULE, dist_lanes_kill, [Node2, Lane]),
+    ?line false = lists:member(Node2, rpc:call(Node1, erlang, nodes, [])),
+
+    ?line stop_node(Node1),
+    ?line stop_node(Node2),
+    ?line ok.
+
+dist_lane_ports(Node) ->
+    {ok, NodeInfo} = net_kernel:node_info(Node),
+    {value, {owner, Owner}} = lists:keysearch(owner, 1, NodeInfo),
+    {links, Links} = process_info(Owner, links),
+    [Port || Pid <- Links,
+	     is_pid(Pid),
+	     process_info(Pid, current_function)
+		 =:= {current_function, {dist_util, lane_loop, 2}},
+	     Port <- erlang:ports(),
+	     erlang:port_info(Port, connected) =:= {connected, Pid}].
+
+dist_lanes_kill(Node, Lane) ->
+    monitor_node(Node, true),
+    {connected, Owner} = erlang:port_info(Lane, connected),
+    exit(Owner, kill),
+    receive {nodedown, Node} -> ok end.
+
+lane_echo() ->
+    receive
+	{From, Msg} ->
+	    From ! {self(), Msg},
+	    lane_echo()
+    end.
+
+dist_compression(doc) ->
+    ["Tests that a node with dist_compression set to lz compresses large",
+     "messages, also when they are sent in fragments, and that a node",
+     "without it does not."];
+dist_compression(suite) ->
+    [];
+dist_compression(Config) when is_list(Config) ->
+    ?line {ok, Node1} = start_node(dist_compression_1,
+				   "-kernel dist_compression lz"),
+    ?line {ok, Node2} = start_node(dist_compression_2),
+    ?line pong = rpc:call(Node1, net_adm, ping, [Node2]),
+    ?line {value, {_, Port}} =
+	lists:keysearch(Node2, 1,
+			rpc:call(Node1, erlang, system_info, [dist_ctrl])),
+
+    ?line Parent = self(),
+    ?line Echo = spawn(Node2, fun lane_echo/0),
+    ?line Small = lists:seq(1, 100),
+    ?line Big = lists:duplicate(10000, {"some text", 4711, Small}),
+    ?line Random = list_to_binary([random:uniform(256)-1 ||
+				      _ <- lists:seq(1, 200000)]),
+    ?line Echoed = fun (Term) ->
+			   {ok, [{send_oct, S0}, {recv_oct, R0}]} =
+			       rpc:call(Node1, inet, getstat,
+					[Port, [send_oct, recv_oct]]),
+			   Sender = spawn(Node1,
+					  fun () ->
+						  Echo ! {self(), Term},
+						  receive {Echo, Term} -> ok end,
+						  Parent ! {self(), ok}
+					  end),
+			   receive {Sender, ok} -> ok end,
+			   {ok, [{send_oct, S1}, {recv_oct, R1}]} =
+			       rpc:call(Node1, inet, getstat,
+					[Port, [send_oct, recv_oct]]),
+			   {S1 - S0, R1 - R0}
+		   end,
+    %% Compressed from Node1 but not from Node2, also when large
+    %% binaries are a minor part of the message
+    ?line lists:foreach(
+	    fun (Term) ->
+		    Size = size(term_to_binary(Term)),
+		    {Sent, Received} = Echoed(Term),
+		    true = Received > Size,
+		    true = Sent < Size - size(Random) div 2
+	    end, [Big, {Big, Random}, {Random, Big, Random}]),
+    %% Mostly large binaries, which are sent as they are
+    ?line MostlyRandom = {Random, Small, Random},
+    ?line MostlyRandomSize = size(term_to_binary(MostlyRandom)),
+    ?line {MostlyRandomSent, _} = Echoed(MostlyRandom),
+    ?line true = MostlyRandomSent > MostlyRandomSize,
+
+    ?line stop_node(Node1),
+    ?line stop_node(Node2),
+    ?line ok.
+
+dist_lazy_decode(doc) ->
+    ["Tests that compressed messages, which are uncompressed by the",
+     "receiver, arrive intact also when inspected while queued, sent",
+     "with a trace token, or sent to a traced process."];
+dist_lazy_decode(suite) ->
+    [];
+dist_lazy_decode(Config) when is_list(Config) ->
+    ?line {ok, Node1} = start_node(dist_lazy_decode_1,
+				   "-kernel dist_compression lz"),
+    ?line {ok, Node2} = start_node(dist_lazy_decode_2),
+    ?line pong = rpc:call(Node1, net_adm, ping, [Node2]),
+    ?line Parent = self(),
+    ?line Big = lists:duplicate(1000, {"some text", 4711, lists:seq(1, 100)}),
+    ?line Msgs = [{I, Big} || I <- lists:seq(1, 3)],
+
+    ?line Receiver = spawn(Node2,
+			   fun () ->
+				   receive go -> ok end,
+				   Parent ! {self(), [receive M -> M end
+						      || _ <- Msgs]}
+			   end),
+    ?line true = rpc:call(Node2, erlang, register,
+			  [lazy_decode_receiver, Receiver]),
+    ?line Traced = spawn(Node2, fun () -> receive M -> Parent ! {self(), M} end end),
+    ?line Tracer = spawn(Node2, fun () -> receive T -> Parent ! {self(), T} end end),
+    ?line 1 = rpc:call(Node2, erlang, trace, [Traced, true, ['receive',
+							    {tracer, Tracer}]]),
+
+    ?line Sender =
+	spawn(Node1,
+	      fun () ->
+		      [M1, M2, M3] = Msgs,
+		      Receiver ! M1,
+		      {lazy_decode_receiver, Node2} ! M2,
+		      seq_trace:set_token(label, 17),
+		      Receiver ! M3,
+		      seq_trace:set_token([]),
+		      Queued = rpc:call(Node2, erlang, process_info,
+					[Receiver, messages]),
+		      Receiver ! go,
+		      Traced ! {traced, Big},
+		      Parent ! {self(), Queued}
+	      end),
+    ?line receive {Sender, Queued} -> {messages, Msgs} = Queued end,
+    ?line receive {Receiver, Received} -> Msgs = Received end,
+    ?line receive {Traced, TracedMsg} -> {traced, Big} = TracedMsg end,
+    ?line receive
+	      {Tracer, Trace} ->
+		  {trace, Traced, 'receive', {traced, Big}} = Trace
+	  end,
+
+    ?line stop_node(Node1),
+    ?line stop_node(Node2),
+    ?line ok.
+
+dist_large_binaries(doc) ->
+    ["Tests that large binaries, which are sent without being copied into",
+     "the output buffer and may be received without being copied, arrive",
+     "intact: sub binaries, bit strings, several binaries in a message,",
+     "and binaries sent in fragments, to many receivers, to a node that",
+     "compresses messages, and inspected while queued."];
+dist_large_binaries(suite) ->
+    [];
+dist_large_binaries(Config) when is_list(Config) ->
+    ?line {ok, Node1} = start_node(dist_large_binaries_1,
+				   "-kernel dist_compression lz"),
+    ?line {ok, Node2} = start_node(dist_large_binaries_2),
+    ?line Big = list_to_binary([I band 255 || I <- lists:seq(1, 300000)]),
+    ?line <<_:3/binary, Sub:100000/binary, _/binary>> = Big,
+    ?line <<_:3, Bits:50000/binary, _/bits>> = Big,
+    ?line <<BitStr:40003/bits, _/bits>> = Big,
+    ?line Small = list_to_binary(lists:duplicate(4095, 17)),
+    ?line Writable0 = <<Sub/binary, 1>>,
+    ?line Writable = <<Writable0/binary, 2>>,
+    ?line Terms = [Big, Sub, Bits, BitStr, Small, Writable,
+		   {Big, Sub, [Small, Big], Bits},
+		   [list_to_binary(lists:duplicate(5000, I)) ||
+		       I <- lists:seq(1, 30)]],
+    ?line Check = fun (Echo) ->
+			  [begin
+			       Echo ! {self(), T},
+			       receive {Echo, R} -> T = R end
+			   end || T <- Terms]
+		  end,
+    ?line [Check(spawn(N, fun lane_echo/0)) || N <- [Node1, Node2]],
+    %% The writable binary can still be appended to
+    ?line <<Sub:100000/binary, 1, 2, 3>> = <<Writable/binary, 3>>,
+
+    %% Queued messages, also referring to the data they arrived in
+    ?line Parent = self(),
+    ?line Receiver = spawn(Node2,
+			   fun () ->
+				   receive go -> ok end,
+				   Parent ! {self(), [receive M -> M end
+						      || _ <- Terms]}
+			   end),
+    ?line [Receiver ! T || T <- Terms],
+    ?line {messages, Terms} = rpc:call(Node2, erlang, process_info,
+				       [Receiver, messages]),
+    ?line Receiver ! go,
+    ?line receive {Receiver, Received} -> Terms = Received end,
+
+    %% Between other nodes, and to many receivers
+    ?line Echos = [spawn(Node2, fun lane_echo/0) || _ <- lists:seq(1, 10)],
+    ?line Results = rpc:call(Node1, erlang, apply,
+			     [fun () ->
+				      Msg = {self(), {Big, Sub}},
+				      Msg = erlang:send_multi(Echos, Msg),
+				      [receive {E, R} -> R end || E <- Echos]
+			      end, []]),
+    ?line Results = lists:duplicate(length(Echos), {Big, Sub}),
+
+    ?line stop_node(Node1),
+    ?line stop_node(Node2),
+    ?line ok.
+
+send_multi(doc) ->
+    ["Tests erlang:send_multi/2 with receivers on several nodes, also",
+     "when a node has to be connected first and when the message is",
+     "large enough to be fragmented."];
+send_multi(suite) ->
+    [];
+send_multi(Config) when is_list(Config) ->
+    %% Not connected to each other unless a message makes them.
+    ?line {ok, Node1} = start_node(send_multi_1, "-connect_all false"),
+    ?line {ok, Node2} = start_node(send_multi_2, "-connect_all false"),
+    ?line Parent = self(),
+    ?line Echo = fun () -> receive M -> Parent ! {self(), M} end end,
+    ?line Msg = {lists:seq(1, 1000), make_ref(), self(), send_multi_atom,
+		 list_to_binary(lists:duplicate(10000, 17))},
+    ?line Pids = lists:append([[spawn(Echo), spawn(Node1, Echo),
+				spawn(Node2, Echo)] || _ <- lists:seq(1, 300)]),
+    ?line Msg = erlang:send_multi(Pids, Msg),
+    ?line [receive {P, M} -> Msg = M end || P <- Pids],
+
+    %% Sent in fragments to one receiver at a time.
+    ?line Large = {lists:seq(1, 50000),
+		   list_to_binary(lists:duplicate(200000, 42))},
+    ?line LargePids = [spawn(Node1, Echo) || _ <- lists:seq(1, 5)],
+    ?line Large = erlang:send_multi(LargePids, Large),
+    ?line [receive {P, M} -> Large = M end || P <- LargePids],
+
+    %% Node2 is connected again by the send.
+    ?line monitor_node(Node2, true),
+    ?line true = erlang:disconnect_node(Node2),
+    ?line receive {nodedown, Node2} -> ok end,
+    ?line Pids2 = [spawn(Node1, Echo) || _ <- lists:seq(1, 10)],
+    ?line Pids3 = rpc:call(Node1, erlang, apply,
+			   [fun () -> [spawn(Node2, Echo) ||
+					  _ <- lists:seq(1, 10)]
+			    end, []]),
+    ?line false = lists:member(Node2, nodes()),
+    ?line Msg = erlang:send_multi(Pids2 ++ Pids3, Msg),
+    ?line [receive {P, M} -> Msg = M end || P <- Pids2 ++ Pids3],
+    ?line true = lists:member(Node2, nodes()),
+
+    ?line stop_node(Node1),
+    ?line stop_node(Node2),
+    ?line ok.
+
+atom_cache_ways(doc) ->
+    ["Tests that atoms sharing a set in the output atom cache are all kept",
+     "cached, and that more such atoms than the set holds arrive intact,",
+     "also when sent in one message."];
+atom_cache_ways(suite) ->
+    [];
+atom_cache_ways(Config) when is_list(Config) ->
+    ?line {ok, Node} = start_node(Config),
+    ?line Echo = spawn(Node, fun lane_echo/0),
+    ?line Echo ! {self(), hello},
+    ?line receive {Echo, hello} -> ok end,
+    ?line undefined = erlang:system_info({dist_atom_cache, node()}),
+    ?line [{size, _}, {ways, Ways}, {hits, _}, {misses, _}] =
+	erlang:system_info({dist_atom_cache, Node}),
+
+    %% Atoms of the same set as atoms in every message ('' for the
+    %% cookie, and the node names) are avoided.
+    ?line erts_debug:set_internal_state(available_internal_state, true),
+    ?line Unwanted = [erts_debug:get_internal_state({atom_out_cache_index, A})
+		      || A <- ['', node(), Node]],
+    ?line [CIX|_] = [C || C <- lists:seq(0, erts_debug:get_internal_state(
+					       max_atom_out_cache_index)),
+			  not lists:member(C, Unwanted)],
+    ?line Atoms = get_conflicting_atoms(CIX, 3*Ways),
+    ?line SetAtoms = lists:sublist(Atoms, Ways),
+
+    ?line atom_cache_echo(Echo, SetAtoms),
+    ?line Misses0 = atom_cache_misses(Node),
+    ?line lists:foreach(fun (_) -> atom_cache_echo(Echo, SetAtoms) end,
+			lists:seq(1, 100)),
+    ?line Misses1 = atom_cache_misses(Node),
+    ?line io:format("~p misses sending ~p atoms of one set 100 times~n",
+		    [Misses1 - Misses0, Ways]),
+    ?line true = Misses1 - Misses0 < 10,
+
+    ?line lists:foreach(fun (_) ->
+				atom_cache_echo(Echo, Atoms),
+				atom_cache_echo(Echo, [Atoms, {Atoms}])
+			end,
+			lists:seq(1, 10)),
+    ?line stop_node(Node),
+    ?line ok.
+
+dist_delay_send(doc) ->
+    ["Tests that the dist_delay_send kernel parameter is applied to the",
+     "connection, and that many small messages arrive in order."];
+dist_delay_send(suite) ->
+    [];
+dist_delay_send(Config) when is_list(Config) ->
+    ?line {ok, Node1} = start_node(dist_delay_send_1,
+				   "-kernel dist_delay_send 4096"),
+    ?line {ok, Node2} = start_node(dist_delay_send_2),
+    ?line pong = rpc:call(Node1, net_adm, ping, [Node2]),
+    ?line {value, {_, Port}} =
+	lists:keysearch(Node2, 1,
+			rpc:call(Node1, erlang, system_info, [dist_ctrl])),
+    ?line {ok, [{delay_send, true}, {delay_send_threshold, 4096}]} =
+	rpc:call(Node1, inet, getopts,
+		 [Port, [delay_send, delay_send_threshold]]),
+
+    ?line Parent = self(),
+    ?line Echo = spawn(Node2, fun lane_echo/0),
+    ?line Sender = spawn(Node1,
+			 fun () ->
+				 Msgs = [{I, lists:seq(1, I rem 100)}
+					 || I <- lists:seq(1, 10000)],
+				 lists:foreach(fun (M) -> Echo ! {self(), M} end,
+					       Msgs),
+				 lists:foreach(fun (M) ->
+						       receive {Echo, M} -> ok end
+					       end,
+					       Msgs),
+				 Parent ! {self(), ok}
+			 end),
+    ?line receive {Sender, ok} -> ok end,
+
+    ?line stop_node(Node1),
+    ?line stop_node(Node2),
+    ?line ok.
+
+dist_stats(doc) ->
+    ["Tests the statistics of a connection."];
+dist_stats(suite) ->
+    [];
+dist_stats(Config) when is_list(Config) ->
+    ?line undefined = erlang:system_info({dist_stats, node()}),
+    ?line undefined = erlang:system_info({dist_stats, 'not_connected@nohost'}),
+    ?line {'EXIT', {badarg, _}} =
+	(catch erlang:system_info({dist_stats, "node"})),
+    ?line {ok, Node} = start_node(Config),
+    ?line Echo = spawn(Node, fun lane_echo/0),
+    ?line Stats0 = dist_stats_counters(Node),
+    ?line Big = lists:duplicate(1000, dist_stats),
+    ?line atom_cache_echo(Echo, lists:duplicate(100, Big)),
+    ?line Stats1 = dist_stats_counters(Node),
+    ?line io:format("~p~n", [Stats1]),
+    ?line [OutMsgs, OutBytes, InMsgs, InBytes, _, _, Hits, _] =
+	[V1 - V0 || {{K, V0}, {K, V1}} <- lists:zip(lists:sublist(Stats0, 8),
+						    lists:sublist(Stats1, 8))],
+    ?line true = OutMsgs >= 100,
+    ?line true = OutBytes > 100*1000,
+    ?line true = InMsgs >= 100,
+    ?line true = InBytes > 100*1000,
+    ?line true = Hits >= 100,
+
+    ?line {value, {send_latency, Hist}} =
+	lists:keysearch(send_latency, 1, Stats1),
+    ?line {infinity, _} = lists:last(Hist),
+    ?line [1, 2, 4 | _] = [L || {L, _} <- Hist],
+    ?line true = lists:sum([N || {_, N} <- Hist]) >= OutMsgs,
+    ?line {value, {max_queue_size, MaxQ}} =
+	lists:keysearch(max_queue_size, 1, Stats1),
+    ?line true = MaxQ > 1000,
+    ?line stop_node(Node),
+    ?line ok.
+
+dist_stats_counters(Node) ->
+    [{out_msgs, _}, {out_bytes, _}, {in_msgs, _}, {in_bytes, _},
+     {encode_time, _}, {decode_time, _},
+     {atom_cache_hits, _}, {atom_cache_misses, _},
+     {busy_dist_port, _}, {queue_size, _}, {max_queue_size, _},
+     {send_latency, _}] = erlang:system_info({dist_stats, Node}).
+
+atom_cache_echo(Echo, Terms) ->
+    lists:foreach(fun (T) ->
+			  Echo ! {self(), T},
+			  receive {Echo, T} -> ok end
+		  end,
+		  Terms).
+
+atom_cache_misses(Node) ->
+    {value, {misses, Misses}} =
+	lists:keysearch(misses, 1,
+			erlang:system_info({dist_atom_cache, Node})),
+    Misses.
+
 bad_dist_ext(doc) -> [];
 bad_dist_ext(suite) ->
     [bad_dist_ext_receive,
@@ -47,13 +47,14 @@
 	 processes_last_call_trap/1, processes_gc_trap/1,
 	 processes_term_proc_list/1, processes_bif/1,
 	 otp_7738/1, otp_7738_waiting/1, otp_7738_suspended/1,
-	 otp_7738_resume/1]).
+	 otp_7738_resume/1, spawn_site_heap_sizing/1, published_terms/1,
+	 send_multi/1]).
 -export([prio_server/2, prio_client/2]).
 
 -export([init_per_testcase/2, fin_per_testcase/2, end_per_suite/1]).
 
 -export([hangaround/2, processes_bif_test/0, do_processes/1,
-	 processes_term_proc_list_test/1]).
+	 processes_term_proc_list_test/1, spawn_site_grow/2]).
 
 all(suite) ->
     [spawn_with_binaries, t_exit_1, t_exit_2,
@@ -65,7 +66,7 @@ all(suite) ->
      bump_reductions, low_prio, yield, yield2, otp_4725, bad_register,
      garbage_collect, process_info_messages, process_flag_badarg, otp_6237,
      processes_bif,
-     otp_7738].
+     otp_7738, spawn_site_heap_sizing, published_terms, send_multi].
 
 init_per_testcase(Func, Config) when is_atom(Func), is_list(Config) ->
     Dog=?t:timetrap(?t:minutes(10)),
@@ -2022,6 +2023,171 @@ otp_7738_test(Type) ->
 	  end,
     ?line ok.
 
+spawn_site_heap_sizing(doc) ->
+    ["Tests that initial heap sizes are learned per spawn site."];
+spawn_site_heap_sizing(suite) ->
+    [];
+spawn_site_heap_sizing(Config) when is_list(Config) ->
+    ?line Old = erlang:system_flag(spawn_site_heap_sizing, true),
+    ?line true = erlang:system_info(spawn_site_heap_sizing),
+    ?line true = erlang:system_flag(spawn_site_heap_sizing, reset),
+    ?line [] = erlang:system_info(spawn_site_heap_sizes),
+    Words = 50000,
+    ?line Go = fun (_) ->
+		       Pid = spawn(?MODULE, spawn_site_grow, [self(), Words]),
+		       Pid ! go,
+		       receive {grown, Pid} -> ok end,
+		       Mon = erlang:monitor(process, Pid),
+		       receive {'DOWN', Mon, _, _, _} -> ok end
+	       end,
+    ?line lists:foreach(Go, lists:seq(1, 20)),
+    ?line [{{?MODULE, spawn_site_grow, 2}, Avg, Samples}]
+	= erlang:system_info(spawn_site_heap_sizes),
+    ?line true = Samples >= 20,
+    ?line true = Avg >= Words,
+    ?line Learned = spawn(?MODULE, spawn_site_grow, [self(), Words]),
+    ?line {heap_size, LearnedSz} = process_info(Learned, heap_size),
+    ?line true = LearnedSz >= Avg,
+    ?line spawn_site_kill(Learned),
+
+    %% Processes spawned from funs are accounted to the fun.
+    ?line true = erlang:system_flag(spawn_site_heap_sizing, reset),
+    ?line [] = erlang:system_info(spawn_site_heap_sizes),
+    ?line Self = self(),
+    ?line Fun = spawn(fun () -> spawn_site_grow(Self, Words) end),
+    ?line Fun ! go,
+    ?line receive {grown, Fun} -> ok end,
+    ?line FunMon = erlang:monitor(process, Fun),
+    ?line receive {'DOWN', FunMon, _, _, _} -> ok end,
+    ?line [{{?MODULE, F, _}, _, 1}] = erlang:system_info(spawn_site_heap_sizes),
+    ?line false = (F == apply),
+
+    %% Nothing is learned when turned off.
+    ?line true = erlang:system_flag(spawn_site_heap_sizing, false),
+    ?line false = erlang:system_info(spawn_site_heap_sizing),
+    ?line false = erlang:system_flag(spawn_site_heap_sizing, reset),
+    ?line lists:foreach(Go, lists:seq(1, 5)),
+    ?line [] = erlang:system_info(spawn_site_heap_sizes),
+    ?line Unlearned = spawn(?MODULE, spawn_site_grow, [self(), Words]),
+    ?line {heap_size, UnlearnedSz} = process_info(Unlearned, heap_size),
+    ?line true = UnlearnedSz < Words,
+    ?line spawn_site_kill(Unlearned),
+
+    ?line {'EXIT', {badarg, _}} =
+	(catch erlang:system_flag(spawn_site_heap_sizing, bad)),
+    ?line false = erlang:system_flag(spawn_site_heap_sizing, Old),
+    ?line ok.
+
+published_terms(doc) ->
+    ["Tests that published terms are sent without copying, and are "
+     "kept by receivers after being unpublished."];
+published_terms(suite) ->
+    [];
+published_terms(Config) when is_list(Config) ->
+    ?line {N0, _} = erlang:system_info(published_terms),
+    ?line Term = [{I, list_to_binary(lists:duplicate(100, I rem 256)),
+		   integer_to_list(I)} || I <- lists:seq(1, 2000)],
+    ?line Pub = erlang:publish_term(Term),
+    ?line true = (Pub =:= Term),
+    ?line {N1, Bytes} = erlang:system_info(published_terms),
+    ?line N1 = N0 + 1,
+    ?line true = Bytes > 0,
+    ?line hello = erlang:publish_term(hello),
+    ?line {N1, _} = erlang:system_info(published_terms),
+
+    ?line Self = self(),
+    ?line Hash = erlang:phash2(Term),
+    ?line Receiver = fun () ->
+			     receive {term, T} -> ok end,
+			     {heap_size, Sz} = process_info(self(), heap_size),
+			     Self ! {received, self(), Sz},
+			     receive check -> ok end,
+			     erlang:garbage_collect(),
+			     Self ! {checked, self(), erlang:phash2(T) =:= Hash}
+		     end,
+    ?line Pids = [spawn(Receiver) || _ <- lists:seq(1, 10)],
+    ?line [P ! {term, Pub} || P <- Pids],
+    ?line Size = erts_debug:flat_size(Term),
+    ?line [receive {received, P, Sz} -> true = Sz < Size end || P <- Pids],
+
+    ?line true = erlang:unpublish_term(Pub),
+    ?line {N0, _} = erlang:system_info(published_terms),
+    ?line {'EXIT', {badarg, _}} = (catch erlang:unpublish_term(Pub)),
+    ?line {'EXIT', {badarg, _}} = (catch erlang:unpublish_term(Term)),
+    ?line {'EXIT', {badarg, _}} = (catch erlang:unpublish_term(hello)),
+
+    ?line [P ! check || P <- Pids],
+    ?line [receive {checked, P, Res} -> true = Res end || P <- Pids],
+    ?line ok.
+
+send_multi(doc) ->
+    ["Tests erlang:send_multi/2 with local receivers."];
+send_multi(suite) ->
+    [];
+send_multi(Config) when is_list(Config) ->
+    ?line Self = self(),
+    ?line Msg = {hello, lists:seq(1, 100), <<"binary">>,
+		 list_to_binary(lists:duplicate(1000, $x))},
+    ?line Echo = fun () -> receive M -> Self ! {self(), M} end end,
+
+    %% More receivers than are handled in one chunk, and self().
+    ?line Pids = [spawn(Echo) || _ <- lists:seq(1, 1200)],
+    ?line Msg = erlang:send_multi([Self|Pids], Msg),
+    ?line receive Msg -> ok end,
+    ?line [receive {P, M} -> Msg = M end || P <- Pids],
+
+    %% Dead receivers are ignored.
+    ?line Dead = spawn(fun () -> ok end),
+    ?line Mon = erlang:monitor(process, Dead),
+    ?line receive {'DOWN', Mon, _, _, _} -> ok end,
+    ?line Alive = spawn(Echo),
+    ?line Msg = erlang:send_multi([Dead, Alive, Dead], Msg),
+    ?line receive {Alive, M1} -> Msg = M1 end,
+    ?line [] = erlang:send_multi([], []),
+
+    %% Nothing is sent if the list is bad.
+    ?line P1 = spawn(Echo),
+    ?line {'EXIT', {badarg, _}} = (catch erlang:send_multi([P1, name], Msg)),
+    ?line {'EXIT', {badarg, _}} = (catch erlang:send_multi([P1 | P1], Msg)),
+    ?line {'EXIT', {badarg, _}} = (catch erlang:send_multi(P1, Msg)),
+    ?line receive {P1, _} -> ?t:fail(got_message) after 100 -> ok end,
+
+    %% Traced senders use ordinary sends.
+    ?line Tracer = spawn(fun () -> send_multi_tracer(Self, []) end),
+    ?line Sender = spawn(fun () ->
+				 receive go -> ok end,
+				 erlang:send_multi([P1], Msg),
+				 Self ! {self(), sent}
+			 end),
+    ?line 1 = erlang:trace(Sender, true, [send, {tracer, Tracer}]),
+    ?line Sender ! go,
+    ?line receive {Sender, sent} -> ok end,
+    ?line receive {P1, M2} -> Msg = M2 end,
+    ?line Tracer ! {Self, get},
+    ?line receive {Tracer, Traces} -> ok end,
+    ?line true = lists:member({trace, Sender, send, Msg, P1}, Traces),
+    ?line ok.
+
+send_multi_tracer(Parent, Acc) ->
+    receive
+	{Parent, get} ->
+	    Parent ! {self(), lists:reverse(Acc)};
+	Trace ->
+	    send_multi_tracer(Parent, [Trace|Acc])
+    end.
+
+spawn_site_grow(Parent, Words) ->
+    receive go -> ok end,
+    L = lists:seq(1, Words div 2),
+    Parent ! {grown, self()},
+    receive after 100 -> ok end,
+    length(L).
+
+spawn_site_kill(Pid) ->
+    Mon = erlang:monitor(process, Pid),
+    exit(Pid, kill),
+    receive {'DOWN', Mon, _, _, _} -> ok end.
+
 %% Internal functions
 
 wait_until(Fun) ->
@@ -35,12 +35,14 @@
 %-compile(export_all).
 -export([all/1, init_per_testcase/2, fin_per_testcase/2]).
 
--export([process_count/1, system_version/1, misc_smoke_tests/1]).
+-export([process_count/1, system_version/1, misc_smoke_tests/1,
+	 allocation_sampling/1]).
 
 -define(DEFAULT_TIMEOUT, ?t:minutes(2)).
 
 all(doc) -> [];
-all(suite) -> [process_count, system_version, misc_smoke_tests].
+all(suite) -> [process_count, system_version, misc_smoke_tests,
+	       allocation_sampling].
 
 init_per_testcase(_Case, Config) when is_list(Config) ->
     Dog = ?t:timetrap(?DEFAULT_TIMEOUT),
@@ -133,6 +135,46 @@ misc_smoke_tests(Config) when is_list(Config) ->
     ?line true = is_binary(erlang:system_info(loaded)),
     ?line true = is_binary(erlang:system_info(dist)),
     ?line ok.
+
+allocation_sampling(doc) -> ["Test of the +Mip allocation sampling."];
+allocation_sampling(suite) -> [];
+allocation_sampling(Config) when is_list(Config) ->
+    ?line {ok, Node} = ?t:start_node(allocation_sampling, slave,
+				     [{args, "+Mip 10"}]),
+    ?line {_, _, _, Settings} = rpc:call(Node, erlang, system_info,
+					 [allocator]),
+    ?line {instr, Opts} = lists:keyfind(instr, 1, Settings),
+    ?line {p, 10} = lists:keyfind(p, 1, Opts),
+    ?line Bins = rpc:call(Node, lists, map,
+			  [fun (N) ->
+				   list_to_binary(lists:duplicate(N, $a))
+			   end,
+			   lists:seq(100, 3000)]),
+    ?line 2901 = length(Bins),
+    ?line Hists = rpc:call(Node, erlang, system_info,
+			   [allocation_histograms]),
+    ?line true = is_list(Hists),
+    ?line {binary, Allocs, Frees, Live, SizeHist, LifetimeHist}
+	= lists:keyfind(binary, 1, Hists),
+    ?line true = Allocs >= 2901 div 20,
+    ?line true = Frees =< Allocs,
+    ?line true = Live > 0,
+    ?line true = lists:all(fun ({B, C}) ->
+				   is_integer(B) and is_integer(C)
+			   end,
+			   SizeHist ++ LifetimeHist),
+    ?line true = lists:keymember(11, 1, SizeHist), % 2048-4095 bytes
+    ?line Samples = rpc:call(Node, erlang, system_info,
+			     [allocation_samples]),
+    ?line true = is_list(Samples),
+    ?line true = lists:any(fun ({binary, Sz, {_, _, _}, Addr}) ->
+				   is_integer(Sz) and is_integer(Addr);
+			       (_) ->
+				   false
+			   end,
+			   Samples),
+    ?line ?t:stop_node(Node),
+    ?line ok.
     
 
 
@@ -102,6 +102,7 @@ static char *plusM_other_switches[] = {
     "ummc",
     "uycs",
     "im",
+    "ip",
     "is",
     "it",
     "Mamcbf",
@@ -123,6 +124,11 @@ static char *pluss_val_switches[] = {
     "ss",
     NULL
 };
+/* +h arguments with values */
+static char *plush_val_switches[] = {
+    "ss",
+    NULL
+};
 
 /*
  * Define sleep(seconds) in terms of Sleep() on Windows.
@@ -783,7 +789,6 @@ int main(int argc, char **argv)
 		  case 'a':
 		  case 'A':
 		  case 'b':
-		  case 'h':
 		  case 'i':
 		  case 'P':
 		  case 'S':
@@ -850,6 +855,29 @@ int main(int argc, char **argv)
 			  goto the_default;
 		      break;
 		  }
+		  case 'h':
+		      if (argv[i][2] == '\0') {
+			  if (i+1 >= argc)
+			      usage(argv[i]);
+			  argv[i][0] = '-';
+			  add_Eargs(argv[i]);
+			  add_Eargs(argv[i+1]);
+			  i++;
+		      }
+		      else if (!is_one_of_strings(&argv[i][2],
+						  plush_val_switches))
+			  goto the_default;
+		      else {
+			  if (i+1 >= argc
+			      || argv[i+1][0] == '-'
+			      || argv[i+1][0] == '+')
+			      usage(argv[i]);
+			  argv[i][0] = '-';
+			  add_Eargs(argv[i]);
+			  add_Eargs(argv[i+1]);
+			  i++;
+		      }
+		      break;
 		  case 's':
 		      if (!is_one_of_strings(&argv[i][2],
 					     pluss_val_switches))
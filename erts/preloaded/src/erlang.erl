@@ -31,8 +31,8 @@
 -export([suspend_process/1]).
 -export([min/2,max/2]).
 
--export([dlink/1, dunlink/1, dsend/2, dsend/3, dgroup_leader/2,
-	 dexit/2, dmonitor_node/3, dmonitor_p/2]).
+-export([dlink/1, dunlink/1, dsend/2, dsend/3, dsend_multi/3,
+	 dgroup_leader/2, dexit/2, dmonitor_node/3, dmonitor_p/2]).
 
 -export([delay_trap/2]).
 
@@ -377,6 +377,21 @@ dsend({Name, Node}, Msg, Opts) ->
 	ignored -> ok				% Not distributed.
     end.
 
+%% erlang:send_multi/2 traps here with the processes it could not
+%% send to directly, e.g. since their nodes are not connected, and
+%% the rest of the list which it has not looked at yet.
+dsend_multi(Dests, Rest, Msg) ->
+    dsend_multi_1(Dests, Msg),
+    erlang:send_multi(Rest, Msg).
+
+dsend_multi_1([Dest|Dests], Msg) ->
+    Dest ! Msg,
+    dsend_multi_1(Dests, Msg);
+dsend_multi_1([], _Msg) ->
+    ok;
+dsend_multi_1(_, _Msg) ->
+    erlang:error(badarg).
+
 dmonitor_p(process, ProcSpec) ->
     %% ProcSpec = pid() | {atom(),atom()}
     %% ProcSpec CANNOT be an atom because a locally registered process
@@ -187,6 +187,10 @@ open_int({Driver, Portopts}, File, Mode, Setopts) ->
 open_int(Port, File, Mode, Setopts) ->
     M = Mode band ?EFILE_MODE_MASK,
     case drv_command(Port, [<<?FILE_OPEN, M:32>>, File, 0]) of
+	{ok, _} when M band ?EFILE_COMPRESSED =/= 0 ->
+	    %% The number of a compressed file is the address of its
+	    %% zlib state, not a file descriptor
+	    open_int_setopts(Port, compressed, Setopts);
 	{ok, Number} ->
 	    open_int_setopts(Port, Number, Setopts);
 	Error ->
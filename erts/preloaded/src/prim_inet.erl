@@ -30,13 +30,14 @@
 -export([connect/3, connect/4, async_connect/4]).
 -export([accept/1, accept/2, async_accept/2]).
 -export([shutdown/2]).
--export([send/2, send/3, sendto/4, sendmsg/3]).
+-export([send/2, send/3, sendto/4, sendto_multi/2, sendmsg/3, sendfile/4]).
+-export([sendfd/3, recvfd/1]).
 -export([recv/2, recv/3, async_recv/3]).
 -export([unrecv/2]).
 -export([recvfrom/2, recvfrom/3]).
 -export([setopt/3, setopts/2, getopt/2, getopts/2, is_sockopt_val/2]).
 -export([chgopt/3, chgopts/2]).
--export([getstat/2, getfd/1, getindex/1, getstatus/1, gettype/1, 
+-export([getstat/2, getbufstat/1, getfd/1, getindex/1, getstatus/1, gettype/1, 
 	 getiflist/1, ifget/3, ifset/3,
 	 gethostname/1]).
 -export([getservbyname/3, getservbyport/3]).
@@ -66,12 +67,14 @@ open(Protocol)          -> open1(Protocol, ?INET_AF_INET).
 
 open(Protocol,   inet)  -> open1(Protocol, ?INET_AF_INET);
 open(Protocol,  inet6)  -> open1(Protocol, ?INET_AF_INET6);
+open(Protocol,  local)  -> open1(Protocol, ?INET_AF_LOCAL);
 open(_, _)              -> {error, einval}.
 
 fdopen(Protocol, Fd)        -> fdopen1(Protocol, ?INET_AF_INET, Fd).
 
 fdopen(Protocol, Fd, inet)  -> fdopen1(Protocol, ?INET_AF_INET, Fd);
 fdopen(Protocol, Fd, inet6) -> fdopen1(Protocol, ?INET_AF_INET6, Fd);
+fdopen(Protocol, Fd, local) -> fdopen1(Protocol, ?INET_AF_LOCAL, Fd);
 fdopen(_, _, _)             -> {error, einval}.
 
 open1(Protocol, Family) ->
@@ -251,6 +254,12 @@ connect(S, IP, Port, Time)     -> connect0(S, IP, Port, Time).
 
 connect0(S, IP, Port, Time) when is_port(S), Port > 0, Port =< 65535,
 				 is_integer(Time) ->
+    connect1(S, IP, Port, Time);
+%% Local addresses have no port
+connect0(S, {local,_}=Addr, 0, Time) when is_port(S), is_integer(Time) ->
+    connect1(S, Addr, 0, Time).
+
+connect1(S, IP, Port, Time) ->
     case async_connect(S, IP, Port, Time) of
 	{ok, S, Ref} ->
 	    receive
@@ -403,6 +412,92 @@ sendto(S, IP, Port, Data) when is_port(S), Port >= 0, Port =< 65535 ->
 	     {error,einval}
     end.
 
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%%
+%% SENDTO_MULTI(insock(), [{IP, Port, Data}]) -> ok | {error, Reason}
+%%
+%% send a list of Datagrams with as few system calls as possible. On error
+%% the Datagrams before the failing one have been sent.
+%%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+sendto_multi(S, Datagrams) when is_port(S) ->
+    ?DBG_FORMAT("prim_inet:sendto_multi(~p, ~p)~n", [S,Datagrams]),
+    try enc_datagrams(Datagrams) of
+	Buf ->
+	    case ctl_cmd(S, ?UDP_REQ_SENDMULTI, Buf) of
+		{ok,_} -> ok;
+		Error -> Error
+	    end
+    catch
+	error:_ ->
+	    ?DBG_FORMAT("prim_inet:sendto_multi() -> {error,einval}~n", []),
+	    {error,einval}
+    end.
+
+enc_datagrams([{IP,Port,Data}|Datagrams]) when Port >= 0, Port =< 65535 ->
+    [?int16(Port),ip_to_bytes(IP),?int32(iolist_size(Data)),Data
+     |enc_datagrams(Datagrams)];
+enc_datagrams([]) -> [].
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%%
+%% SENDFILE(insock(), Fd, Offset, Length) -> {ok,Sent} | {error, Reason}
+%%
+%% send Length bytes from Offset in the open file Fd, or the rest of the
+%% file if Length is 0. The file is sent after the data already queued
+%% on the socket. Fd goes to the driver as a 32-bit integer; anything
+%% larger is not a descriptor and is refused.
+%%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+sendfile(S, Fd, Offset, Length)
+  when is_port(S), is_integer(Fd), Fd >= 0, Fd < 16#80000000,
+       is_integer(Offset), Offset >= 0, is_integer(Length), Length >= 0 ->
+    case ctl_cmd(S, ?TCP_REQ_SENDFILE,
+		 [?int32(Fd),<<Offset:64,Length:64>>]) of
+	{ok,[R1,R0]} ->
+	    Ref = ?u16(R1,R0),
+	    receive
+		{inet_async, S, Ref, Status} -> Status;
+		{'EXIT', S, _Reason} ->
+		    {error, closed}
+	    end;
+	Error -> Error
+    end;
+sendfile(_, _, _, _) ->
+    {error, einval}.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%%
+%% SENDFD(insock(), Fd, Data) -> ok | {error, Reason}
+%%
+%% send Data on a local stream socket with the open descriptor Fd
+%% attached; the receiver gets its own copy of the descriptor from
+%% RECVFD. Fails with eagain while earlier data is queued on the socket.
+%%
+%% RECVFD(insock()) -> {ok, [Fd]} | {error, Reason}
+%%
+%% get the descriptors that came with the data read so far; the caller
+%% is responsible for closing them.
+%%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+sendfd(S, Fd, Data) when is_port(S), is_integer(Fd), Fd >= 0 ->
+    case ctl_cmd(S, ?TCP_REQ_SENDFD, [?int32(Fd),Data]) of
+	{ok,[]} -> ok;
+	Error -> Error
+    end.
+
+recvfd(S) when is_port(S) ->
+    case ctl_cmd(S, ?TCP_REQ_RECVFD, []) of
+	{ok,Fds} -> {ok,get_fds(Fds)};
+	Error -> Error
+    end.
+
+get_fds([F3,F2,F1,F0|Fds]) -> [?u32(F3,F2,F1,F0)|get_fds(Fds)];
+get_fds([]) -> [].
+
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %%
 %% SENDMSG(insock(), IP, Port, InitMsg, Data)   or
@@ -736,6 +831,25 @@ getstat(S, Stats) when is_port(S), is_list(Stats) ->
 	Error -> Error
     end.
 
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%%
+%% GETBUFSTAT(insock()) -> {ok,StatReply} | {error, Reason}
+%%
+%% get statistics of the receive buffer caches in the driver, which
+%% are shared by all sockets
+%%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+getbufstat(S) when is_port(S) ->
+    case ctl_cmd(S, ?INET_REQ_GETBUFSTAT, []) of
+	{ok, Data} ->
+	    <<Hits:64,Misses:64,Trims:64,Cached:64,Bytes:64>> =
+		list_to_binary(Data),
+	    {ok, [{hits,Hits},{misses,Misses},{trims,Trims},
+		  {cached,Cached},{cached_bytes,Bytes}]};
+	Error -> Error
+    end.
+
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %%
 %% GETFD(insock()) -> {ok,integer()} | {error, Reason}
@@ -776,6 +890,7 @@ gettype(S) when is_port(S) ->
 	    Family = case ?u32(F3,F2,F1,F0) of
 			 ?INET_AF_INET  ->  inet;
 			 ?INET_AF_INET6 ->  inet6;
+			 ?INET_AF_LOCAL ->  local;
 			 _ -> undefined
 		     end,
 	    Type = case ?u32(T3,T2,T1,T0) of
@@ -929,6 +1044,8 @@ attach(S) when is_port(S) ->
 %%
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+is_sockopt_val(active, N) when is_integer(N) ->
+    -32768 =< N andalso N =< 32767;
 is_sockopt_val(Opt, Val) ->
     Type = type_opt(set, Opt),
     try type_value(set, Type, Val)
@@ -940,6 +1057,7 @@ is_sockopt_val(Opt, Val) ->
 %% Socket options processing: Encoding option NAMES:
 %%
 enc_opt(reuseaddr)       -> ?INET_OPT_REUSEADDR;
+enc_opt(reuseport)       -> ?INET_OPT_REUSEPORT;
 enc_opt(keepalive)       -> ?INET_OPT_KEEPALIVE;
 enc_opt(dontroute)       -> ?INET_OPT_DONTROUTE;
 enc_opt(linger)          -> ?INET_OPT_LINGER;
@@ -967,6 +1085,7 @@ enc_opt(bit8)            -> ?INET_LOPT_BIT8;
 enc_opt(send_timeout)    -> ?INET_LOPT_TCP_SEND_TIMEOUT;
 enc_opt(send_timeout_close) -> ?INET_LOPT_TCP_SEND_TIMEOUT_CLOSE;
 enc_opt(delay_send)      -> ?INET_LOPT_TCP_DELAY_SEND;
+enc_opt(delay_send_threshold) -> ?INET_LOPT_TCP_DELAY_SEND_THRESHOLD;
 enc_opt(packet_size)     -> ?INET_LOPT_PACKET_SIZE;
 enc_opt(read_packets)    -> ?INET_LOPT_READ_PACKETS;
 enc_opt(raw)             -> ?INET_OPT_RAW;
@@ -994,6 +1113,7 @@ enc_opt(sctp_get_peer_addr_info)   -> ?SCTP_OPT_GET_PEER_ADDR_INFO.
 %% Decoding option NAMES:
 %%
 dec_opt(?INET_OPT_REUSEADDR)      -> reuseaddr;
+dec_opt(?INET_OPT_REUSEPORT)      -> reuseport;
 dec_opt(?INET_OPT_KEEPALIVE)      -> keepalive;
 dec_opt(?INET_OPT_DONTROUTE)      -> dontroute;
 dec_opt(?INET_OPT_LINGER)         -> linger;
@@ -1021,6 +1141,7 @@ dec_opt(?INET_LOPT_BIT8)          -> bit8;
 dec_opt(?INET_LOPT_TCP_SEND_TIMEOUT) -> send_timeout;
 dec_opt(?INET_LOPT_TCP_SEND_TIMEOUT_CLOSE) -> send_timeout_close;
 dec_opt(?INET_LOPT_TCP_DELAY_SEND)   -> delay_send;
+dec_opt(?INET_LOPT_TCP_DELAY_SEND_THRESHOLD) -> delay_send_threshold;
 dec_opt(?INET_LOPT_PACKET_SIZE)      -> packet_size;
 dec_opt(?INET_LOPT_READ_PACKETS)     -> read_packets;
 dec_opt(?INET_OPT_RAW)              -> raw;
@@ -1063,6 +1184,7 @@ type_opt(_,   Opt) ->
 %% Types of option values, by option name:
 %%
 type_opt_1(reuseaddr)       -> bool;
+type_opt_1(reuseport)       -> bool;
 type_opt_1(keepalive)       -> bool;
 type_opt_1(dontroute)       -> bool;
 type_opt_1(linger)          -> {bool,int};
@@ -1120,6 +1242,7 @@ type_opt_1(bit8) ->
 type_opt_1(send_timeout)    -> time;
 type_opt_1(send_timeout_close) -> bool;
 type_opt_1(delay_send)      -> bool;
+type_opt_1(delay_send_threshold) -> uint;
 type_opt_1(packet_size)     -> uint;
 type_opt_1(read_packets)    -> uint;
 %% 
@@ -1543,6 +1666,11 @@ enc_opt_val([{active,once}|Opts], Acc) ->
     %% every packet, not only once when initializing the socket.
     %% Measurements show that this optimization is worthwhile.
     enc_opt_val(Opts, [<<?INET_LOPT_ACTIVE:8,?INET_ONCE:32>>|Acc]);
+enc_opt_val([{active,N}|Opts], Acc)
+  when is_integer(N), -32768 =< N, N =< 32767 ->
+    %% {active,N} adds N to the count of packets the driver delivers
+    %% before it turns the socket passive.
+    enc_opt_val(Opts, [<<?INET_LOPT_ACTIVE:8,?INET_MULTI:32,N:16>>|Acc]);
 enc_opt_val([{raw,P,O,B}|Opts], Acc) ->
     enc_opt_val(Opts, Acc, raw, {P,O,B});
 enc_opt_val([{Opt,Val}|Opts], Acc) ->
@@ -1629,6 +1757,8 @@ dec_opt_val([B|Buf]=BBuf) ->
     end;
 dec_opt_val([]) -> [].
 
+dec_opt_val([0,0,0,?INET_MULTI,X3,X2,X1,X0|Buf], active, _) ->
+    [{active,?i32(X3,X2,X1,X0)}|dec_opt_val(Buf)];
 dec_opt_val(Buf, raw, Type) ->
     {{P,O,B},T} = dec_value(Type, Buf),
     [{raw,P,O,B}|dec_opt_val(T)];
@@ -1927,6 +2057,7 @@ rev(L) -> rev(L,[]).
 rev([C|L],Acc) -> rev(L,[C|Acc]);
 rev([],Acc) -> Acc.
 
+ip_to_bytes({local,Path}) -> local_to_bytes(Path);
 ip_to_bytes(IP) when tuple_size(IP) =:= 4 -> ip4_to_bytes(IP);
 ip_to_bytes(IP) when tuple_size(IP) =:= 8 -> ip6_to_bytes(IP).
 
@@ -1938,7 +2069,8 @@ ip6_to_bytes({A,B,C,D,E,F,G,H}) ->
      ?int16(E), ?int16(F), ?int16(G), ?int16(H)].
 
 get_ip(?INET_AF_INET, Addr)  -> get_ip4(Addr);
-get_ip(?INET_AF_INET6, Addr) -> get_ip6(Addr).
+get_ip(?INET_AF_INET6, Addr) -> get_ip6(Addr);
+get_ip(?INET_AF_LOCAL, [N|Addr]) -> get_local(N, Addr, []).
 
 get_ip4([A,B,C,D | T]) -> {{A,B,C,D},T}.
 
@@ -1946,6 +2078,15 @@ get_ip6([X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13,X14,X15,X16 | T]) ->
     { { ?u16(X1,X2),?u16(X3,X4),?u16(X5,X6),?u16(X7,X8),
 	?u16(X9,X10),?u16(X11,X12),?u16(X13,X14),?u16(X15,X16)}, T}.
 
+%% A local address is [Len | Path]
+local_to_bytes(Path) when is_list(Path) ->
+    local_to_bytes(list_to_binary(Path));
+local_to_bytes(Path) when is_binary(Path), byte_size(Path) =< 255 ->
+    [byte_size(Path) | binary_to_list(Path)].
+
+get_local(0, T, Acc) -> {{local,list_to_binary(lists:reverse(Acc))}, T};
+get_local(N, [X|T], Acc) -> get_local(N-1, T, [X|Acc]).
+
 
 %% Control command
 ctl_cmd(Port, Cmd, Args) ->
@@ -30,6 +30,9 @@
 	 reset_timer/1, cancel_timer/1,
 	 shutdown/3, shutdown/4]).
 
+%% Internal export
+-export([connect_lane/2]).
+
 -import(error_logger,[error_msg/2]).
 
 -include("dist_util.hrl").
@@ -53,6 +56,9 @@
 
 -define(int16(X), [((X) bsr 8) band 16#ff, (X) band 16#ff]).
 
+%% The runtime system allows up to 63 extra connections.
+-define(MAX_DIST_CONNECTIONS, 64).
+
 -define(int32(X), 
 	[((X) bsr 24) band 16#ff, ((X) bsr 16) band 16#ff,
 	 ((X) bsr 8) band 16#ff, (X) band 16#ff]).
@@ -115,10 +121,47 @@ make_this_flags(RequestType, OtherNode) ->
 	 ?DFLAG_NEW_FLOATS bor
 	 ?DFLAG_UNICODE_IO bor
 	 ?DFLAG_DIST_HDR_ATOM_CACHE bor
-	 ?DFLAG_SMALL_ATOM_TAGS).
+	 ?DFLAG_SMALL_ATOM_TAGS bor
+	 ?DFLAG_FRAGMENTS bor
+	 ?DFLAG_LZ_COMPRESSION) bor
+	lanes_flag().
+
+lanes_flag() ->
+    case dist_connections() of
+	1 -> 0;
+	_ -> ?DFLAG_DIST_LANES
+    end.
+
+%% Number of connections to open to other nodes; the
+%% first one is the primary connection.
+dist_connections() ->
+    case application:get_env(kernel, dist_connections) of
+	{ok, N} when is_integer(N), N > 1 ->
+	    erlang:min(N, ?MAX_DIST_CONNECTIONS);
+	_ ->
+	    1
+    end.
+
+%% Every node can uncompress LZ compressed messages, but it only
+%% compresses the messages it sends when configured to do so.
+compression_flags(Flags) ->
+    case application:get_env(kernel, dist_compression) of
+	{ok, lz} ->
+	    Flags;
+	_ ->
+	    remove_flag(?DFLAG_LZ_COMPRESSION, Flags)
+    end.
+
+handshake_other_started(HSData) ->
+    case recv_name(HSData) of
+	{lane,PreOtherFlags,Node,Version} ->
+	    accept_lane(HSData, PreOtherFlags, Node, Version);
+	{PreOtherFlags,Node,Version} ->
+	    handshake_other_started(HSData, PreOtherFlags, Node, Version)
+    end.
 
-handshake_other_started(#hs_data{request_type=ReqType}=HSData0) ->
-    {PreOtherFlags,Node,Version} = recv_name(HSData0),
+handshake_other_started(#hs_data{request_type=ReqType}=HSData0,
+			PreOtherFlags, Node, Version) ->
     PreThisFlags = make_this_flags(ReqType, Node),
     {ThisFlags, OtherFlags} = adjust_flags(PreThisFlags,
 					   PreOtherFlags),
@@ -139,7 +182,7 @@ handshake_other_started(#hs_data{request_type=ReqType}=HSData0) ->
     ChallengeB = recv_challenge_reply(HSData, ChallengeA, MyCookie),
     send_challenge_ack(HSData, gen_digest(ChallengeB, HisCookie)),
     ?debug({dist_util, self(), accept_connection, Node}),
-    connection(HSData).
+    connection(recv_lanes(HSData)).
 
 %%
 %% check if connecting node is allowed to connect
@@ -326,7 +369,147 @@ handshake_we_started(#hs_data{request_type=ReqType,
 			 gen_digest(ChallengeA,HisCookie)),
     reset_timer(NewHSData#hs_data.timer),
     recv_challenge_ack(NewHSData, MyChallenge, MyCookie),
-    connection(NewHSData).
+    connection(open_lanes(NewHSData)).
+
+%% --------------------------------------------------------------
+%% Extra connections (lanes).
+%%
+%% When both nodes have set DFLAG_DIST_LANES, the node that started
+%% the handshake opens dist_connections - 1 extra connections to the
+%% other node once the challenge has been acknowledged, and then tells
+%% the other node how many it opened in an 'L' message on the primary
+%% connection. An extra connection is authenticated like the primary
+%% one, but starts with an 'l' name message and is not marked pending;
+%% the accepting node hands it to the process setting up the primary
+%% connection. The lanes are attached to the node before the primary
+%% connection is set up, which is when the runtime system starts to
+%% spread signals over the connections by sender.
+%%
+%% A lane is owned by a process of its own, linked to the connection
+%% process, so if either goes down, both do.
+%% --------------------------------------------------------------
+
+open_lanes(#hs_data{this_flags = ThisFlags, other_flags = OtherFlags}
+	   = HSData)
+  when ThisFlags band OtherFlags band ?DFLAG_DIST_LANES =/= 0 ->
+    N = case HSData#hs_data.f_connect of
+	    undefined -> 0;
+	    _ -> dist_connections() - 1
+	end,
+    lists:foreach(fun(_) ->
+			  spawn_link(?MODULE, connect_lane, [HSData, self()])
+		  end, lists:seq(1, N)),
+    Lanes = collect_lanes(N),
+    send_lanes(HSData, N),
+    HSData#hs_data{lanes = Lanes};
+open_lanes(HSData) ->
+    HSData.
+
+recv_lanes(#hs_data{this_flags = ThisFlags, other_flags = OtherFlags,
+		    socket = Socket, f_recv = FRecv, 
+		    other_node = Node} = HSData)
+  when ThisFlags band OtherFlags band ?DFLAG_DIST_LANES =/= 0 ->
+    case FRecv(Socket, 0, infinity) of
+	{ok, [$L, N1, N0]} ->
+	    HSData#hs_data{lanes = collect_lanes(?u16(N1, N0))};
+	_ ->
+	    ?shutdown(Node)
+    end;
+recv_lanes(HSData) ->
+    HSData.
+
+collect_lanes(0) ->
+    [];
+collect_lanes(N) ->
+    receive
+	{LanePid, dist_lane, Port} ->
+	    [{LanePid, Port} | collect_lanes(N - 1)]
+    end.
+
+connect_lane(#hs_data{other_node = Node, f_connect = FConnect} = HSData0,
+	     Owner) ->
+    Timer = start_timer(net_kernel:connecttime()),
+    case FConnect() of
+	{ok, Socket} ->
+	    HSData = HSData0#hs_data{socket = Socket, timer = Timer},
+	    send_lane_name(HSData),
+	    recv_status(HSData),
+	    {_OtherFlags, ChallengeA} = recv_challenge(HSData),
+	    MyChallenge = gen_challenge(),
+	    {MyCookie,HisCookie} = get_cookies(Node),
+	    send_challenge_reply(HSData, MyChallenge,
+				 gen_digest(ChallengeA, HisCookie)),
+	    reset_timer(Timer),
+	    recv_challenge_ack(HSData, MyChallenge, MyCookie),
+	    lane(HSData, Owner);
+	_ ->
+	    ?shutdown(Node)
+    end.
+
+accept_lane(#hs_data{request_type = ReqType} = HSData0,
+	    PreOtherFlags, Node, Version) ->
+    PreThisFlags = make_this_flags(ReqType, Node),
+    {ThisFlags, OtherFlags} = adjust_flags(PreThisFlags, PreOtherFlags),
+    HSData = HSData0#hs_data{this_flags = ThisFlags,
+			     other_flags = OtherFlags,
+			     other_version = Version,
+			     other_node = Node,
+			     other_started = true},
+    is_allowed(HSData),
+    Owner = lane_owner(HSData),
+    send_status(HSData, ok),
+    {MyCookie,HisCookie} = get_cookies(Node),
+    ChallengeA = gen_challenge(),
+    send_challenge(HSData, ChallengeA),
+    reset_timer(HSData#hs_data.timer),
+    ChallengeB = recv_challenge_reply(HSData, ChallengeA, MyCookie),
+    send_challenge_ack(HSData, gen_digest(ChallengeB, HisCookie)),
+    ?debug({dist_util, self(), accept_lane, Node}),
+    lane(HSData, Owner).
+
+%% The process setting up the connection to Node.
+lane_owner(#hs_data{kernel_pid = Kernel, other_node = Node} = HSData) ->
+    Kernel ! {self(), {lane_owner, Node}},
+    receive
+	{Kernel, {lane_owner, Owner}} when is_pid(Owner) ->
+	    Owner;
+	{Kernel, {lane_owner, _}} ->
+	    send_status(HSData, not_allowed),
+	    ?shutdown(Node)
+    end.
+
+lane(#hs_data{other_node = Node, socket = Socket, timer = Timer,
+	      f_setopts_pre_nodeup = FPreNodeup,
+	      f_setopts_post_nodeup = FPostNodeup,
+	      f_getll = GetLL}, Owner) ->
+    link(Owner),
+    cancel_timer(Timer),
+    case FPreNodeup(Socket) of
+	ok ->
+	    case GetLL(Socket) of
+		{ok, Port} ->
+		    Owner ! {self(), dist_lane, Port},
+		    receive
+			{Owner, lane_up} ->
+			    case FPostNodeup(Socket) of
+				ok ->
+				    lane_loop(Node, Socket);
+				_ ->
+				    ?shutdown2(Node, connection_setup_failed)
+			    end
+		    end;
+		_ ->
+		    ?shutdown(Node)
+	    end;
+	_ ->
+	    ?shutdown(Node)
+    end.
+
+lane_loop(Node, Socket) ->
+    receive
+	{tcp_closed, Socket} ->
+	    ?shutdown2(Node, connection_closed)
+    end.
 
 %% --------------------------------------------------------------
 %% The connection has been established.
@@ -346,6 +529,9 @@ connection(#hs_data{other_node = Node,
 	    mark_nodeup(HSData,Address),
 	    case FPostNodeup(Socket) of
 		ok ->
+		    lists:foreach(fun({LanePid, _}) ->
+					  LanePid ! {self(), lane_up}
+				  end, HSData#hs_data.lanes),
 		    con_loop(HSData#hs_data.kernel_pid, 
 			     Node, 
 			     Socket, 
@@ -398,16 +584,15 @@ get_cookies(Node) ->
 %% No error return; either succeeds or terminates the process.
 do_setnode(#hs_data{other_node = Node, socket = Socket, 
 		    other_flags = Flags, other_version = Version,
-		    f_getll = GetLL}) ->
+		    f_getll = GetLL, lanes = Lanes}) ->
     case GetLL(Socket) of
 	{ok,Port} ->
 	    ?trace("setnode(md5,~p ~p ~p)~n", 
 		   [Node, Port, {publish_type(Flags), 
 				 '(', Flags, ')', 
 				 Version}]),
-	    case (catch 
-		  erlang:setnode(Node, Port, 
-				 {Flags, Version, '', ''})) of
+	    case (catch setnode(Node, Port, compression_flags(Flags),
+				Version, Lanes)) of
 		{'EXIT', {system_limit, _}} ->
 		    error_msg("** Distribution system limit reached, "
 			      "no table space left for node ~w ** ~n",
@@ -425,6 +610,16 @@ do_setnode(#hs_data{other_node = Node, socket = Socket,
 	    ?shutdown(Node)
     end.
 
+setnode(Node, Port, Flags, Version, []) ->
+    erlang:setnode(Node, Port, {Flags, Version, '', ''});
+setnode(Node, Port, Flags, Version, Lanes) ->
+    LanePorts = [LanePort || {_, LanePort} <- Lanes],
+    lists:foreach(fun(LanePort) ->
+			  true = erlang:setnode(Node, LanePort,
+						{lane, Flags, Version})
+		  end, LanePorts),
+    erlang:setnode(Node, Port, {Flags, Version, '', '', LanePorts}).
+
 mark_nodeup(#hs_data{kernel_pid = Kernel, 
 		     other_node = Node, 
 		     other_flags = Flags,
@@ -506,6 +701,19 @@ send_name(#hs_data{socket = Socket, this_node = Node,
     ?to_port(FSend, Socket, 
 	     [$n, ?int16(Version), ?int32(Flags), atom_to_list(Node)]).
 
+send_lane_name(#hs_data{socket = Socket, this_node = Node, 
+			f_send = FSend, 
+			this_flags = Flags,
+			other_version = Version}) ->
+    ?trace("send_lane_name: node=~w, version=~w\n",
+	   [Node,Version]),
+    ?to_port(FSend, Socket, 
+	     [$l, ?int16(Version), ?int32(Flags), atom_to_list(Node)]).
+
+send_lanes(#hs_data{socket = Socket, f_send = FSend}, N) ->
+    ?trace("send_lanes: ~w\n", [N]),
+    ?to_port(FSend, Socket, [$L, ?int16(N)]).
+
 send_challenge(#hs_data{socket = Socket, this_node = Node, 
 			other_version = Version, 
 			this_flags = Flags,
@@ -547,6 +755,9 @@ recv_name(#hs_data{socket = Socket, f_recv = Recv}) ->
 get_name([$n,VersionA, VersionB, Flag1, Flag2, Flag3, Flag4 | OtherNode]) ->
     {?u32(Flag1, Flag2, Flag3, Flag4), list_to_atom(OtherNode), 
      ?u16(VersionA,VersionB)};
+get_name([$l,VersionA, VersionB, Flag1, Flag2, Flag3, Flag4 | OtherNode]) ->
+    {lane, ?u32(Flag1, Flag2, Flag3, Flag4), list_to_atom(OtherNode), 
+     ?u16(VersionA,VersionB)};
 get_name(Data) ->
     ?shutdown(Data).
 
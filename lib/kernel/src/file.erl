@@ -41,7 +41,7 @@
 	 pread/2, pread/3, pwrite/2, pwrite/3,
 	 read_line/1,
 	 position/2, truncate/1, sync/1,
-	 copy/2, copy/3]).
+	 copy/2, copy/3, sendfile/4]).
 %% High level operations
 -export([consult/1, path_consult/2]).
 -export([eval/1, eval/2, path_eval/2, path_eval/3, path_open/3]).
@@ -661,6 +661,89 @@ copy_opened_int(Source, Dest, Length, Copied) ->
     end.
 
 
+-spec sendfile(File :: io_device(), Socket :: port(),
+	       Offset :: non_neg_integer(),
+	       Length :: non_neg_integer() | 'infinity') ->
+	{'ok', non_neg_integer()} | {'error', posix() | 'closed' | 'badarg'}.
+
+%% Send Length bytes from Offset in an open file to a connected TCP
+%% socket. A raw file is sent by the socket driver without copying it
+%% through the emulator, where the system allows it. A compressed raw
+%% file has no descriptor to send from, and is read like other files.
+sendfile(File, Socket, Offset, Length)
+  when is_port(Socket), is_integer(Offset), Offset >= 0,
+       is_integer(Length), Length >= 0;
+       is_port(Socket), is_integer(Offset), Offset >= 0,
+       Length =:= infinity ->
+    sendfile_int(File, Socket, Offset, Length);
+sendfile(_, _, _, _) ->
+    {error, badarg}.
+
+sendfile_int(_, _, _, 0) ->
+    {ok, 0};
+sendfile_int(#file_descriptor{module = prim_file, data = {_, Fd}} = File,
+	     Socket, Offset, Length) when is_integer(Fd) ->
+    Bytes = if is_atom(Length) -> 0; true -> Length end,
+    case prim_inet:sendfile(Socket, Fd, Offset, Bytes) of
+	{error, enotsup} ->
+	    sendfile_loop(pread_fun(File), Socket, Offset, Length, 0);
+	Result ->
+	    Result
+    end;
+sendfile_int(#file_descriptor{module = prim_file, data = {_, compressed}} = File,
+	     Socket, Offset, Length) ->
+    %% A compressed file cannot be pread; read it from Offset and
+    %% put the position back afterwards
+    case position(File, cur) of
+	{ok, Pos} ->
+	    Result = case position(File, Offset) of
+			 {ok, _} ->
+			     sendfile_loop(fun (_, N) -> read(File, N) end,
+					   Socket, Offset, Length, 0);
+			 Error ->
+			     Error
+		     end,
+	    _ = position(File, Pos),
+	    Result;
+	Error ->
+	    Error
+    end;
+sendfile_int(File, Socket, Offset, Length)
+  when is_pid(File);
+       is_record(File, file_descriptor) ->
+    sendfile_loop(pread_fun(File), Socket, Offset, Length, 0);
+sendfile_int(_, _, _, _) ->
+    {error, badarg}.
+
+pread_fun(File) ->
+    fun (Offset, N) -> pread(File, Offset, N) end.
+
+%% Without sendfile in the driver, read and send in the client process
+sendfile_loop(_, _, _, Length, Sent) when Length =< 0 -> % atom() > integer()
+    {ok, Sent};
+sendfile_loop(Read, Socket, Offset, Length, Sent) ->
+    N = if Length > 65536 -> 65536; true -> Length end, % atom() > integer() !
+    case Read(Offset, N) of
+	{ok, Data} ->
+	    M = iolist_size(Data),
+	    case gen_tcp:send(Socket, Data) of
+		ok when M < N ->
+		    {ok, Sent+M};
+		ok ->
+		    NewLength = if is_atom(Length) -> Length;
+				   true         -> Length-M
+				end,
+		    sendfile_loop(Read, Socket, Offset+M, NewLength, Sent+M);
+		{error, _} = Error ->
+		    Error
+	    end;
+	eof ->
+	    {ok, Sent};
+	{error, _} = Error ->
+	    Error
+    end.
+
+
 %% Special indirect pread function. Introduced for Dets.
 %% Reads a header from pos 'Pos', the header is first a size encoded as
 %% 32 bit big endian unsigned and then a position also encoded as
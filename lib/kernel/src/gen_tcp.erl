@@ -46,7 +46,7 @@ connect(Address, Port, Opts, Time) ->
     end.
 
 connect1(Address,Port,Opts,Timer) ->
-    Mod = mod(Opts),
+    Mod = mod(Opts, Address),
     case Mod:getaddrs(Address,Timer) of
 	{ok,IPs} ->
 	    case Mod:getserv(Port) of
@@ -179,14 +179,26 @@ fdopen(Fd, Opts) ->
 %% Get the tcp_module
 mod() -> inet_db:tcp_module().
 
-%% Get the tcp_module, but option tcp_module|inet|inet6 overrides
+%% Get the tcp_module, but option tcp_module|inet|inet6|local overrides
 mod([{tcp_module,Mod}|_]) ->
     Mod;
 mod([inet|_]) ->
     inet_tcp;
 mod([inet6|_]) ->
     inet6_tcp;
+mod([local|_]) ->
+    local_tcp;
+mod([{ip,{local,_}}|_]) ->
+    local_tcp;
+mod([{ifaddr,{local,_}}|_]) ->
+    local_tcp;
 mod([_|Opts]) ->
     mod(Opts);
 mod([]) ->
     mod().
+
+%% A local address selects the local_tcp module
+mod(_Opts, {local,_}) ->
+    local_tcp;
+mod(Opts, _Address) ->
+    mod(Opts).
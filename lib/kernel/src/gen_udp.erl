@@ -19,7 +19,7 @@
 -module(gen_udp).
 
 -export([open/1, open/2, close/1]).
--export([send/2, send/4, recv/2, recv/3, connect/3]).
+-export([send/2, send/4, send_multi/2, recv/2, recv/3, connect/3]).
 -export([controlling_process/2]).
 -export([fdopen/2]).
 
@@ -61,6 +61,34 @@ send(S, Packet) when is_port(S) ->
 	    Error
     end.
 
+send_multi(S, Datagrams) when is_port(S), is_list(Datagrams) ->
+    case inet_db:lookup_socket(S) of
+	{ok, Mod} ->
+	    case send_multi_addrs(Mod, Datagrams, []) of
+		{ok, Ds} -> Mod:send_multi(S, Ds);
+		Error -> Error
+	    end;
+	Error ->
+	    Error
+    end.
+
+send_multi_addrs(Mod, [{Address, Port, Packet}|Datagrams], Acc) ->
+    case Mod:getaddr(Address) of
+	{ok,IP} ->
+	    case Mod:getserv(Port) of
+		{ok,UP} ->
+		    send_multi_addrs(Mod, Datagrams, [{IP, UP, Packet}|Acc]);
+		{error,einval} -> exit(badarg);
+		Error -> Error
+	    end;
+	{error,einval} -> exit(badarg);
+	Error -> Error
+    end;
+send_multi_addrs(_Mod, [], Acc) ->
+    {ok, lists:reverse(Acc)};
+send_multi_addrs(_Mod, _, _) ->
+    exit(badarg).
+
 recv(S,Len) when is_port(S), is_integer(Len) ->
     case inet_db:lookup_socket(S) of
 	{ok, Mod} ->
@@ -97,20 +125,26 @@ controlling_process(S, NewOwner) ->
 %% Create a port/socket from a file descriptor 
 %%
 fdopen(Fd, Opts) ->
-    Mod = mod(),
+    Mod = mod(Opts),
     Mod:fdopen(Fd, Opts).
 
 
 %% Get the udp_module
 mod() -> inet_db:udp_module().
 
-%% Get the udp_module, but option udp_module|inet|inet6 overrides
+%% Get the udp_module, but option udp_module|inet|inet6|local overrides
 mod([{udp_module,Mod}|_]) ->
     Mod;
 mod([inet|_]) ->
     inet_udp;
 mod([inet6|_]) ->
     inet6_udp;
+mod([local|_]) ->
+    local_udp;
+mod([{ip,{local,_}}|_]) ->
+    local_udp;
+mod([{ifaddr,{local,_}}|_]) ->
+    local_udp;
 mod([_|Opts]) ->
     mod(Opts);
 mod([]) ->
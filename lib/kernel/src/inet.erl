@@ -27,7 +27,7 @@
 	 setopts/2, getopts/2, 
 	 getif/1, getif/0, getiflist/0, getiflist/1,
 	 ifget/3, ifget/2, ifset/3, ifset/2,
-	 getstat/1, getstat/2,
+	 getstat/1, getstat/2, getbufstat/1,
 	 ip/1, stats/0, options/0, 
 	 pushf/3, popf/1, close/1, gethostname/0, gethostname/1]).
 
@@ -37,6 +37,8 @@
 
 -export([getll/1, getfd/1, open/7, fdopen/5]).
 
+-export([sendfd/3, recvfd/1]).
+
 -export([tcp_controlling_process/2, udp_controlling_process/2,
 	 tcp_close/1, udp_close/1]).
 %% used by socks5
@@ -82,6 +84,7 @@
       {'raw', non_neg_integer(), non_neg_integer(), binary()} |
       %% TCP/UDP options
       {'reuseaddr',       boolean()} |
+      {'reuseport',       boolean()} |
       {'keepalive',       boolean()} |
       {'dontroute',       boolean()} |
       {'linger',          {boolean(), non_neg_integer()}} |
@@ -98,7 +101,7 @@
       {'drop_membership', {ip_address(), ip_address()}} |
       {'header',          non_neg_integer()} |
       {'buffer',          non_neg_integer()} |
-      {'active',          boolean() | 'once'} |
+      {'active',          boolean() | 'once' | -32768..32767} |
       {'packet',        
        0 | 1 | 2 | 4 | 'raw' | 'sunrm' |  'asn1' |
        'cdr' | 'fcgi' | 'line' | 'tpkt' | 'http' | 'httph' | 'http_bin' | 'httph_bin' } |
@@ -111,6 +114,7 @@
       {'send_timeout',    non_neg_integer() | 'infinity'} |
       {'send_timeout_close', boolean()} |
       {'delay_send',      boolean()} |
+      {'delay_send_threshold', non_neg_integer()} |
       {'packet_size',     non_neg_integer()} |
       {'read_packets',    non_neg_integer()} |
       %% SCTP options
@@ -134,14 +138,14 @@
       {'raw',
        non_neg_integer(), non_neg_integer(), binary()|non_neg_integer()} |
       %% TCP/UDP options
-      'reuseaddr' | 'keepalive' | 'dontroute' | 'linger' |
+      'reuseaddr' | 'reuseport' | 'keepalive' | 'dontroute' | 'linger' |
       'broadcast' | 'sndbuf' | 'recbuf' | 'priority' | 'tos' | 'nodelay' | 
       'multicast_ttl' | 'multicast_loop' | 'multicast_if' | 
       'add_membership' | 'drop_membership' | 
       'header' | 'buffer' | 'active' | 'packet' | 'mode' | 'port' | 
       'exit_on_close' | 'low_watermark' | 'high_watermark' | 'bit8' | 
       'send_timeout' | 'send_timeout_close' |
-      'delay_send' | 'packet_size' | 'read_packets' | 
+      'delay_send' | 'delay_send_threshold' | 'packet_size' | 'read_packets' | 
       %% SCTP options
       {'sctp_status',                #sctp_status{}} |
       'sctp_get_peer_addr_info' |
@@ -183,7 +187,7 @@
       'addr' | 'broadaddr' | 'dstaddr' | 
       'mtu' | 'netmask' | 'flags' |'hwaddr'.
 
--type family_option() :: 'inet' | 'inet6'.
+-type family_option() :: 'inet' | 'inet6' | 'local'.
 -type protocol_option() :: 'tcp' | 'udp' | 'sctp'.
 -type stat_option() :: 
 	'recv_cnt' | 'recv_max' | 'recv_avg' | 'recv_oct' | 'recv_dvi' |
@@ -208,7 +212,8 @@ close(Socket) ->
     end.
 
 -spec peername(Socket :: socket()) -> 
-	{'ok', {ip_address(), non_neg_integer()}} | {'error', posix()}.
+	{'ok', {ip_address() | local_address(), non_neg_integer()}} |
+	{'error', posix()}.
 
 peername(Socket) -> 
     prim_inet:peername(Socket).
@@ -223,7 +228,8 @@ setpeername(Socket, undefined) ->
 
 
 -spec sockname(Socket :: socket()) -> 
-	{'ok', {ip_address(), non_neg_integer()}} | {'error', posix()}.
+	{'ok', {ip_address() | local_address(), non_neg_integer()}} |
+	{'error', posix()}.
 
 sockname(Socket) -> 
     prim_inet:sockname(Socket).
@@ -387,6 +393,12 @@ getstat(Socket) ->
 getstat(Socket,What) ->
     prim_inet:getstat(Socket, What).
 
+-spec getbufstat(Socket :: socket()) ->
+	{'ok', [{atom(), non_neg_integer()}]} | {'error', posix()}.
+
+getbufstat(Socket) ->
+    prim_inet:getbufstat(Socket).
+
 -spec gethostbyname(Name :: string() | atom()) ->
 	{'ok', #hostent{}} | {'error', posix()}.
 
@@ -462,6 +474,22 @@ getll(Socket) when is_port(Socket) ->
 getfd(Socket) ->
     prim_inet:getfd(Socket).
 
+%%
+%% Pass open file descriptors over a local stream socket
+%%
+
+-spec sendfd(Socket :: socket(), Fd :: non_neg_integer(), Data :: iodata()) ->
+	'ok' | {'error', posix()}.
+
+sendfd(Socket, Fd, Data) ->
+    prim_inet:sendfd(Socket, Fd, Data).
+
+-spec recvfd(Socket :: socket()) ->
+	{'ok', [non_neg_integer()]} | {'error', posix()}.
+
+recvfd(Socket) ->
+    prim_inet:recvfd(Socket).
+
 %%
 %% Lookup an ip address
 %%
@@ -536,7 +564,7 @@ getservbyname(Name, Protocol) when is_atom(Name) ->
 %% Return a list of available options
 options() ->
     [
-     tos, priority, reuseaddr, keepalive, dontroute, linger,
+     tos, priority, reuseaddr, reuseport, keepalive, dontroute, linger,
      broadcast, sndbuf, recbuf, nodelay,
      buffer, header, active, packet, deliver, mode,
      multicast_if, multicast_ttl, multicast_loop,
@@ -556,10 +584,11 @@ stats() ->
 %% Available options for tcp:connect
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 connect_options() ->
-    [tos, priority, reuseaddr, keepalive, linger, sndbuf, recbuf, nodelay,
+    [tos, priority, reuseaddr, reuseport, keepalive, linger, sndbuf, recbuf,
+     nodelay,
      header, active, packet, packet_size, buffer, mode, deliver,
      exit_on_close, high_watermark, low_watermark, bit8, send_timeout,
-     send_timeout_close, delay_send,raw].
+     send_timeout_close, delay_send, delay_send_threshold, raw].
     
 connect_options(Opts, Family) ->
     BaseOpts = 
@@ -595,6 +624,7 @@ con_opt([Opt | Opts], R, As) ->
 	{tcp_module,_}  -> con_opt(Opts, R, As);
 	inet        -> con_opt(Opts, R, As);
 	inet6       -> con_opt(Opts, R, As);
+	local       -> con_opt(Opts, R, As);
 	{Name,Val} when is_atom(Name) -> con_add(Name, Val, R, Opts, As);
 	_ -> {error, badarg}
     end;
@@ -612,10 +642,11 @@ con_add(Name, Val, R, Opts, AllOpts) ->
 %% Available options for tcp:listen
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 listen_options() ->
-    [tos, priority, reuseaddr, keepalive, linger, sndbuf, recbuf, nodelay,
+    [tos, priority, reuseaddr, reuseport, keepalive, linger, sndbuf, recbuf,
+     nodelay,
      header, active, packet, buffer, mode, deliver, backlog,
      exit_on_close, high_watermark, low_watermark, bit8, send_timeout,
-     send_timeout_close, delay_send, packet_size,raw].
+     send_timeout_close, delay_send, delay_send_threshold, packet_size,raw].
 
 listen_options(Opts, Family) ->
     BaseOpts = 
@@ -652,6 +683,7 @@ list_opt([Opt | Opts], R, As) ->
 	{tcp_module,_}  -> list_opt(Opts, R, As);
 	inet         -> list_opt(Opts, R, As);
 	inet6        -> list_opt(Opts, R, As);
+	local        -> list_opt(Opts, R, As);
 	{Name,Val} when is_atom(Name) -> list_add(Name, Val, R, Opts, As);
 	_ -> {error, badarg}
     end;
@@ -669,8 +701,8 @@ list_add(Name, Val, R, Opts, As) ->
 %% Available options for udp:open
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 udp_options() ->
-    [tos, priority, reuseaddr, sndbuf, recbuf, header, active, buffer, mode, 
-     deliver,
+    [tos, priority, reuseaddr, reuseport, sndbuf, recbuf, header, active,
+     buffer, mode, deliver,
      broadcast, dontroute, multicast_if, multicast_ttl, multicast_loop,
      add_membership, drop_membership, read_packets,raw].
 
@@ -697,6 +729,7 @@ udp_opt([Opt | Opts], R, As) ->
 	{udp_module,_} -> udp_opt(Opts, R, As);
 	inet        -> udp_opt(Opts, R, As);
 	inet6       -> udp_opt(Opts, R, As);
+	local       -> udp_opt(Opts, R, As);
 	{Name,Val} when is_atom(Name) -> udp_add(Name, Val, R, Opts, As);
 	_ -> {error, badarg}
     end;
@@ -715,7 +748,7 @@ udp_add(Name, Val, R, Opts, As) ->
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %  Currently supported options include:
 %  (*) {mode,   list|binary}	 or just list|binary
-%  (*) {active, true|false|once}
+%  (*) {active, true|false|once|N}
 %  (*) {sctp_module, inet_sctp|inet6_sctp} or just inet|inet6
 %  (*) options set via setsockopt.
 %      The full list is below in sctp_options/0 .
@@ -808,6 +841,7 @@ translate_ip(any,      inet) -> {0,0,0,0};
 translate_ip(loopback, inet) -> {127,0,0,1};
 translate_ip(any,      inet6) -> {0,0,0,0,0,0,0,0};
 translate_ip(loopback, inet6) -> {0,0,0,0,0,0,0,1};
+translate_ip(any,      local) -> {local,<<>>};
 translate_ip(IP, _) -> IP.
 
 
@@ -994,11 +1028,11 @@ gethostbyaddr_tm_native(Addr, Timer, Opts) ->
     end.
 
 -spec open(Fd :: integer(),
-	   Addr :: ip_address(),
+	   Addr :: ip_address() | local_address(),
 	   Port :: ip_port(),
 	   Opts :: [socket_setopt()],
 	   Protocol :: protocol_option(),
-	   Family :: 'inet' | 'inet6',
+	   Family :: 'inet' | 'inet6' | 'local',
 	   Module :: atom()) ->
 	{'ok', socket()} | {'error', posix()}.
 
@@ -1175,6 +1209,8 @@ fmt_addr({ok,Addr}, Proto) ->
 	{{0,0,0,0,0,0,0,0},Port} -> "*:" ++ fmt_port(Port, Proto);
 	{{127,0,0,1},Port} -> "localhost:" ++ fmt_port(Port, Proto);
 	{{0,0,0,0,0,0,0,1},Port} -> "localhost:" ++ fmt_port(Port, Proto);
+	{{local,<<>>},_} -> "*";
+	{{local,Path},_} -> binary_to_list(Path);
 	{IP,Port} -> inet_parse:ntoa(IP) ++ ":" ++ fmt_port(Port, Proto)
     end.
 
@@ -1262,6 +1298,9 @@ tcp_sync_input(S, Owner, Flag) ->
 	{tcp_closed, S} ->
 	    Owner ! {tcp_closed, S},
 	    tcp_sync_input(S, Owner, true);
+	{tcp_passive, S} ->
+	    Owner ! {tcp_passive, S},
+	    tcp_sync_input(S, Owner, Flag);
 	{S, {data, Data}} ->
 	    Owner ! {S, {data, Data}},
 	    tcp_sync_input(S, Owner, Flag);	    
@@ -1300,6 +1339,8 @@ udp_sync_input(S, Owner) ->
 	{sctp, S, _, _, _}=Msg    -> udp_sync_input(S, Owner, Msg);
 	{udp, S, _, _, _}=Msg     -> udp_sync_input(S, Owner, Msg);
 	{udp_closed, S}=Msg       -> udp_sync_input(S, Owner, Msg);
+	{udp_passive, S}=Msg      -> udp_sync_input(S, Owner, Msg);
+	{sctp_passive, S}=Msg     -> udp_sync_input(S, Owner, Msg);
 	{S, {data,_}}=Msg         -> udp_sync_input(S, Owner, Msg);
 	{inet_async, S, _, _}=Msg -> udp_sync_input(S, Owner, Msg);
 	{inet_reply, S, _}=Msg    -> udp_sync_input(S, Owner, Msg)
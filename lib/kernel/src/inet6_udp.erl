@@ -19,7 +19,7 @@
 -module(inet6_udp).
 
 -export([open/1, open/2, close/1]).
--export([send/2, send/4, recv/2, recv/3, connect/3]).
+-export([send/2, send/4, send_multi/2, recv/2, recv/3, connect/3]).
 -export([controlling_process/2]).
 -export([fdopen/2]).
 
@@ -55,6 +55,15 @@ send(S, Addr = {A,B,C,D,E,F,G,H}, P, Data)
 
 send(S, Data) ->
     prim_inet:sendto(S, {0,0,0,0,0,0,0,0}, 0, Data).
+
+send_multi(S, Datagrams) ->
+    case lists:all(fun ({{A,B,C,D,E,F,G,H},P,_})
+			 when ?ip6(A,B,C,D,E,F,G,H), ?port(P) -> true;
+		       (_) -> false
+		   end, Datagrams) of
+	true -> prim_inet:sendto_multi(S, Datagrams);
+	false -> exit(badarg)
+    end.
     
 connect(S, Addr = {A,B,C,D,E,F,G,H}, P) 
   when ?ip6(A,B,C,D,E,F,G,H), ?port(P) ->
@@ -183,7 +183,7 @@ do_accept(Kernel, AcceptPid, Socket, MyNode, Allowed, SetupTime) ->
 					   [{active, true},
 					    {deliver, port},
 					    {packet, 4},
-					    nodelay()])
+					    nodelay() | delay_send()])
 		      end,
 		      f_getll = fun(S) ->
 					inet:getll(S)
@@ -215,6 +215,19 @@ nodelay() ->
 	_ ->
 	    {nodelay, true}
     end.
+
+%% delay_send makes the socket write many messages with one system
+%% call; with a threshold, as soon as that many bytes are queued.
+
+delay_send() ->
+    case application:get_env(kernel, dist_delay_send) of
+	{ok, true} ->
+	    [{delay_send, true}];
+	{ok, Bytes} when is_integer(Bytes), Bytes >= 0 ->
+	    [{delay_send, true}, {delay_send_threshold, Bytes}];
+	_ ->
+	    []
+    end.
 	    
 
 %% ------------------------------------------------------------
@@ -285,9 +298,15 @@ do_setup(Kernel, Node, Type, MyNode, LongOrShortNames,SetupTime) ->
 					 [{active, true},
 					  {deliver, port},
 					  {packet, 4},
-					  nodelay()])
+					  nodelay() | delay_send()])
 			      end,
 			      f_getll = fun inet:getll/1,
+			      f_connect =
+			      fun() ->
+				      inet_tcp:connect(Ip, TcpPort,
+						      [{active, false},
+						       {packet,2}])
+			      end,
 			      f_address = 
 			      fun(_,_) ->
 				      #net_address{
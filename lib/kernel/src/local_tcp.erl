@@ -0,0 +1,158 @@
+%%
+%% %CopyrightBegin%
+%%
+%% Copyright Ericsson AB 2009. All Rights Reserved.
+%%
+%% The contents of this file are subject to the Erlang Public License,
+%% Version 1.1, (the "License"); you may not use this file except in
+%% compliance with the License. You should have received a copy of the
+%% Erlang Public License along with this software. If not, it can be
+%% retrieved online at http://www.erlang.org/.
+%%
+%% Software distributed under the License is distributed on an "AS IS"
+%% basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+%% the License for the specific language governing rights and limitations
+%% under the License.
+%%
+%% %CopyrightEnd%
+%%
+-module(local_tcp).
+
+%% Socket server for stream sockets in the local (AF_UNIX) domain.
+%% Addresses are {local,Path} and the port is always 0.
+
+-export([connect/3, connect/4, listen/2, accept/1, accept/2, close/1]).
+-export([send/2, send/3, recv/2, recv/3, unrecv/2]).
+-export([shutdown/2]).
+-export([controlling_process/2]).
+-export([fdopen/2]).
+
+-export([getserv/1, getaddr/1, getaddr/2, getaddrs/1, getaddrs/2]).
+
+
+-include("inet_int.hrl").
+
+%% local_tcp port lookup
+getserv(0) -> {ok, 0};
+getserv(_) -> {error, einval}.
+
+%% local_tcp address lookup
+getaddr({local,_}=Address) -> {ok, Address};
+getaddr(_) -> {error, einval}.
+getaddr(Address,_Timer) -> getaddr(Address).
+
+%% local_tcp address lookup
+getaddrs(Address) ->
+    case getaddr(Address) of
+	{ok, Addr} -> {ok, [Addr]};
+	Error -> Error
+    end.
+getaddrs(Address,_Timer) -> getaddrs(Address).
+
+%%
+%% Send data on a socket
+%%
+send(Socket, Packet, Opts) -> prim_inet:send(Socket, Packet, Opts).
+send(Socket, Packet) -> prim_inet:send(Socket, Packet, []).
+
+%%
+%% Receive data from a socket (inactive only)
+%%
+recv(Socket, Length) -> prim_inet:recv(Socket, Length).
+recv(Socket, Length, Timeout) -> prim_inet:recv(Socket, Length, Timeout).
+
+unrecv(Socket, Data) -> prim_inet:unrecv(Socket, Data).
+
+%%
+%% Shutdown one end of a socket
+%%
+shutdown(Socket, How) ->
+    prim_inet:shutdown(Socket, How).
+
+%%
+%% Close a socket (async)
+%%
+close(Socket) ->
+    inet:tcp_close(Socket).
+
+%%
+%% Set controlling process
+%%
+controlling_process(Socket, NewOwner) ->
+    inet:tcp_controlling_process(Socket, NewOwner).
+
+%%
+%% Connect
+%%
+connect(Address, Port, Opts) ->
+    do_connect(Address, Port, Opts, infinity).
+
+connect(Address, Port, Opts, infinity) ->
+    do_connect(Address, Port, Opts, infinity);
+connect(Address, Port, Opts, Timeout) when is_integer(Timeout),
+                                           Timeout >= 0 ->
+    do_connect(Address, Port, Opts, Timeout).
+
+do_connect({local,_}=Address, 0, Opts, Time) ->
+    case inet:connect_options(Opts, local) of
+	{error, Reason} -> exit(Reason);
+	{ok, #connect_opts{fd=Fd,
+			   ifaddr=BAddr={local,_},
+			   port=0,
+			   opts=SockOpts}} ->
+	    case inet:open(Fd,BAddr,0,SockOpts,tcp,local,?MODULE) of
+		{ok, S} ->
+		    case prim_inet:connect(S, Address, 0, Time) of
+			ok    -> {ok,S};
+			Error ->  prim_inet:close(S), Error
+		    end;
+		Error -> Error
+	    end;
+	{ok, _} -> exit(badarg)
+    end.
+
+%%
+%% Listen
+%%
+listen(Port, Opts) ->
+    case inet:listen_options([{port,Port} | Opts], local) of
+	{error,Reason} -> exit(Reason);
+	{ok, #listen_opts{fd=Fd,
+			  ifaddr=BAddr={local,_},
+			  port=0,
+			  opts=SockOpts}=R} ->
+	    case inet:open(Fd,BAddr,0,SockOpts,tcp,local,?MODULE) of
+		{ok, S} ->
+		    case prim_inet:listen(S, R#listen_opts.backlog) of
+			ok -> {ok, S};
+			Error -> prim_inet:close(S), Error
+		    end;
+		Error -> Error
+	    end;
+	{ok, _} -> exit(badarg)
+    end.
+
+%%
+%% Accept
+%%
+accept(L)         ->
+    case prim_inet:accept(L) of
+	{ok, S} ->
+	    inet_db:register_socket(S, ?MODULE),
+	    {ok,S};
+	Error -> Error
+    end.
+
+accept(L,Timeout) ->
+    case prim_inet:accept(L,Timeout) of
+	{ok, S} ->
+	    inet_db:register_socket(S, ?MODULE),
+	    {ok,S};
+	Error -> Error
+    end.
+%%
+%% Create a port/socket from a file descriptor
+%% (the 'local' option only selects this module)
+%%
+fdopen(Fd, Opts) ->
+    inet:fdopen(Fd, lists:delete(local, Opts), tcp, local, ?MODULE).
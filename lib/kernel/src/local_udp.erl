@@ -0,0 +1,99 @@
+%%
+%% %CopyrightBegin%
+%%
+%% Copyright Ericsson AB 2009. All Rights Reserved.
+%%
+%% The contents of this file are subject to the Erlang Public License,
+%% Version 1.1, (the "License"); you may not use this file except in
+%% compliance with the License. You should have received a copy of the
+%% Erlang Public License along with this software. If not, it can be
+%% retrieved online at http://www.erlang.org/.
+%%
+%% Software distributed under the License is distributed on an "AS IS"
+%% basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+%% the License for the specific language governing rights and limitations
+%% under the License.
+%%
+%% %CopyrightEnd%
+%%
+-module(local_udp).
+
+%% Datagram sockets in the local (AF_UNIX) domain. Addresses are
+%% {local,Path} and the port is always 0.
+
+-export([open/1, open/2, close/1]).
+-export([send/2, send/4, send_multi/2, recv/2, recv/3, connect/3]).
+-export([controlling_process/2]).
+-export([fdopen/2]).
+
+-export([getserv/1, getaddr/1, getaddr/2]).
+
+-include("inet_int.hrl").
+
+-define(RECBUF, (8*1024)).
+
+
+
+%% local_udp port lookup
+getserv(0) -> {ok, 0};
+getserv(_) -> {error, einval}.
+
+%% local_udp address lookup
+getaddr({local,_}=Address) -> {ok, Address};
+getaddr(_) -> {error, einval}.
+getaddr(Address,_Timer) -> getaddr(Address).
+
+open(Port) -> open(Port, []).
+
+open(Port, Opts) ->
+    case inet:udp_options(
+	   [{port,Port}, {recbuf, ?RECBUF} | Opts],
+	   local) of
+	{error, Reason} -> exit(Reason);
+	{ok, #udp_opts{fd=Fd,
+		       ifaddr=BAddr={local,_},
+		       port=0,
+		       opts=SockOpts}} ->
+	    inet:open(Fd,BAddr,0,SockOpts,udp,local,?MODULE);
+	{ok, _} -> exit(badarg)
+    end.
+
+send(S,{local,_}=Address,0,Data) ->
+    prim_inet:sendto(S, Address, 0, Data).
+
+send(S, Data) ->
+    prim_inet:sendto(S, {local,<<>>}, 0, Data).
+
+send_multi(S, Datagrams) ->
+    case lists:all(fun ({{local,_},0,_}) -> true;
+		       (_) -> false
+		   end, Datagrams) of
+	true -> prim_inet:sendto_multi(S, Datagrams);
+	false -> exit(badarg)
+    end.
+
+connect(S, {local,_}=Address, 0) ->
+    prim_inet:connect(S, Address, 0).
+
+recv(S,Len) ->
+    prim_inet:recvfrom(S, Len).
+
+recv(S,Len,Time) ->
+    prim_inet:recvfrom(S, Len, Time).
+
+close(S) ->
+    inet:udp_close(S).
+
+%%
+%% Set controlling process
+%%
+controlling_process(Socket, NewOwner) ->
+    inet:udp_controlling_process(Socket, NewOwner).
+
+%%
+%% Create a port/socket from a file descriptor
+%% (the 'local' option only selects this module)
+%%
+fdopen(Fd, Opts) ->
+    inet:fdopen(Fd, [{recbuf, ?RECBUF} | lists:delete(local, Opts)],
+		udp, local, ?MODULE).
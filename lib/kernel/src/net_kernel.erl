@@ -636,6 +636,19 @@ handle_info({AcceptPid, {accept_pending,MyNode,Node,Address,Type}}, State) ->
 	    {noreply, State#state{conn_owners = Owners}}
     end;
 
+%%
+%% An extra connection (lane) to Node belongs to the process
+%% currently setting up the connection to Node.
+%%
+handle_info({LanePid, {lane_owner, Node}}, State) ->
+    Owner = case ets:lookup(sys_dist, Node) of
+		[#connection{state=pending, owner=Pid}] -> Pid;
+		[#connection{state=up_pending, pending_owner=Pid}] -> Pid;
+		_ -> false
+	    end,
+    LanePid ! {self(), {lane_owner, Owner}},
+    {noreply, State};
+
 handle_info({SetupPid, {is_pending, Node}}, State) ->
     Reply = lists:member({SetupPid,Node},State#state.conn_owners),
     SetupPid ! {self(), {is_pending, Reply}},
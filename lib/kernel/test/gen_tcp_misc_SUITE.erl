@@ -38,7 +38,9 @@
 	 accept_timeouts_mixed/1, 
 	 killing_acceptor/1,killing_multi_acceptors/1,killing_multi_acceptors2/1,
 	 several_accepts_in_one_go/1,active_once_closed/1, send_timeout/1, otp_7731/1,
-	 zombie_sockets/1, otp_7816/1, otp_8102/1]).
+	 zombie_sockets/1, otp_7816/1, otp_8102/1, delay_send_threshold/1,
+	 active_n/1, reuseport/1, sendfile/1, packet_batch/1,
+	 adaptive_buffer/1, local_stream/1, local_fdpass/1]).
 
 %% Internal exports.
 -export([sender/3, not_owner/1, passive_sockets_server/2, priority_server/1, otp_7731_server/1, zombie_server/2]).
@@ -65,7 +67,9 @@ all(suite) ->
      accept_timeouts_mixed, 
      killing_acceptor,killing_multi_acceptors,killing_multi_acceptors2,
      several_accepts_in_one_go, active_once_closed, send_timeout, otp_7731,
-     zombie_sockets, otp_7816, otp_8102].
+     zombie_sockets, otp_7816, otp_8102, delay_send_threshold, active_n,
+     reuseport, sendfile, packet_batch, adaptive_buffer,
+     local_stream, local_fdpass].
 
 
 default_options(doc) ->
@@ -2359,4 +2363,409 @@ otp_8102_do(LSocket, PortNum, {Bin,PType}) ->
     io:format("Got error msg, ok.\n",[]),
     gen_tcp:close(SSocket),    
     gen_tcp:close(RSocket).
-    
+
+delay_send_threshold(doc) ->
+    ["Tests that packets sent with delay_send and a delay_send_threshold "
+     "all arrive, in order"];
+delay_send_threshold(suite) -> [];
+delay_send_threshold(Config) when is_list(Config) ->
+    ?line {ok, LSocket} = gen_tcp:listen(0, [binary, {packet, 4},
+					     {active, false}]),
+    ?line {ok, PortNum} = inet:port(LSocket),
+    ?line lists:foreach(
+	    fun (Threshold) ->
+		    {ok, S} = gen_tcp:connect("localhost", PortNum,
+					      [binary, {packet, 4},
+					       {delay_send, true},
+					       {delay_send_threshold,
+						Threshold}]),
+		    {ok, [{delay_send, true},
+			  {delay_send_threshold, Threshold}]} =
+			inet:getopts(S, [delay_send, delay_send_threshold]),
+		    {ok, A} = gen_tcp:accept(LSocket),
+		    Packets = [list_to_binary(lists:duplicate(I rem 200, I))
+			       || I <- lists:seq(1, 255)]
+			++ [list_to_binary(lists:duplicate(100000, 17))],
+		    lists:foreach(fun (P) -> ok = gen_tcp:send(S, P) end,
+				  Packets ++ Packets),
+		    lists:foreach(fun (P) -> {ok, P} = gen_tcp:recv(A, 0) end,
+				  Packets ++ Packets),
+		    gen_tcp:close(S),
+		    gen_tcp:close(A)
+	    end,
+	    [0, 1, 1000, 1000000]),
+    ?line {error, einval} = inet:setopts(LSocket, [{delay_send_threshold, -1}]),
+    ?line gen_tcp:close(LSocket),
+    ok.
+
+active_n(doc) ->
+    ["Tests the {active,N} socket mode"];
+active_n(suite) -> [];
+active_n(Config) when is_list(Config) ->
+    ?line N = 3,
+    ?line {ok, L} = gen_tcp:listen(0, [binary, {packet, 1}, {active, N}]),
+    ?line {ok, [{active, N}]} = inet:getopts(L, [active]),
+    ?line {ok, PortNum} = inet:port(L),
+    ?line {ok, C} = gen_tcp:connect("localhost", PortNum,
+				    [binary, {packet, 1}, {active, false}]),
+    ?line {ok, S} = gen_tcp:accept(L),
+    ?line {ok, [{active, N}]} = inet:getopts(S, [active]),
+    %% The count goes up and down, and the socket turns passive at 0
+    ?line ok = inet:setopts(S, [{active, -1}]),
+    ?line {ok, [{active, 2}]} = inet:getopts(S, [active]),
+    ?line ok = inet:setopts(S, [{active, -2}]),
+    ?line active_n_passive(S),
+    ?line {ok, [{active, false}]} = inet:getopts(S, [active]),
+    ?line ok = inet:setopts(S, [{active, -5}]),
+    ?line active_n_passive(S),
+    ?line ok = inet:setopts(S, [{active, 32767}]),
+    ?line {error, einval} = inet:setopts(S, [{active, 1}]),
+    ?line {error, einval} = inet:setopts(S, [{active, 32768}]),
+    ?line ok = inet:setopts(S, [{active, true}]),
+    ?line ok = inet:setopts(S, [{active, 5}]),
+    ?line {ok, [{active, 5}]} = inet:getopts(S, [active]),
+    ?line ok = inet:setopts(S, [{active, false}]),
+    %% Packets are delivered N at a time
+    ?line Packets = [<<I>> || I <- lists:seq(1, 10)],
+    ?line lists:foreach(fun (P) -> ok = gen_tcp:send(C, P) end, Packets),
+    ?line {P1, Rest} = lists:split(4, Packets),
+    ?line ok = inet:setopts(S, [{active, 4}]),
+    ?line active_n_recv(S, P1),
+    ?line active_n_passive(S),
+    ?line {ok, [{active, false}]} = inet:getopts(S, [active]),
+    ?line ok = inet:setopts(S, [{active, 2}, {active, 4}]),
+    ?line active_n_recv(S, Rest),
+    ?line active_n_passive(S),
+    ?line receive Msg -> ?t:fail({unexpected, Msg}) after 100 -> ok end,
+    ?line ok = gen_tcp:close(C),
+    ?line ok = gen_tcp:close(S),
+    ?line ok = gen_tcp:close(L),
+    ok.
+
+active_n_recv(S, Packets) ->
+    lists:foreach(fun (P) ->
+			  receive
+			      {tcp, S, P} -> ok
+			  after 5000 -> ?t:fail({no_packet, P})
+			  end
+		  end, Packets).
+
+active_n_passive(S) ->
+    receive
+	{tcp_passive, S} -> ok
+    after 5000 -> ?t:fail(no_passive)
+    end.
+
+reuseport(doc) ->
+    ["Tests that listen sockets with reuseport can share a port"];
+reuseport(suite) -> [];
+reuseport(Config) when is_list(Config) ->
+    case gen_tcp:listen(0, [{reuseport, true}, {active, false}]) of
+	{error, einval} ->
+	    {skip, "reuseport not supported"};
+	{ok, L1} ->
+	    ?line {ok, [{reuseport, true}]} = inet:getopts(L1, [reuseport]),
+	    ?line {ok, PortNum} = inet:port(L1),
+	    ?line {ok, L2} = gen_tcp:listen(PortNum, [{reuseport, true},
+						      {active, false}]),
+	    ?line {error, eaddrinuse} = gen_tcp:listen(PortNum,
+							[{active, false}]),
+	    %% Every connection is accepted on one of the sockets
+	    ?line Self = self(),
+	    ?line As = [spawn_link(fun () -> reuseport_acceptor(Self, L) end)
+			|| L <- [L1, L2]],
+	    ?line Cs = [begin
+			    {ok, C} = gen_tcp:connect("localhost", PortNum,
+						      [{active, false}]),
+			    C
+			end || _ <- lists:seq(1, 20)],
+	    ?line [A ! {done, self()} || A <- As],
+	    ?line 20 = lists:sum([receive {accepted, A, N} -> N end
+				  || A <- As]),
+	    ?line [ok = gen_tcp:close(C) || C <- Cs],
+	    ?line ok = gen_tcp:close(L1),
+	    ?line ok = gen_tcp:close(L2),
+	    ok
+    end.
+
+reuseport_acceptor(Parent, L) ->
+    reuseport_acceptor(Parent, L, []).
+
+reuseport_acceptor(Parent, L, Ss) ->
+    case gen_tcp:accept(L, 100) of
+	{ok, S} ->
+	    reuseport_acceptor(Parent, L, [S|Ss]);
+	{error, timeout} ->
+	    receive
+		{done, _} ->
+		    Parent ! {accepted, self(), length(Ss)},
+		    [gen_tcp:close(S) || S <- Ss],
+		    ok
+	    after 0 ->
+		    reuseport_acceptor(Parent, L, Ss)
+	    end
+    end.
+
+sendfile(doc) ->
+    ["Tests sending files to a socket with file:sendfile/4"];
+sendfile(suite) -> [];
+sendfile(Config) when is_list(Config) ->
+    ?line Name = filename:join(?config(priv_dir, Config), "sendfile.dat"),
+    ?line Size = 1024*1024 + 17,
+    ?line Data = list_to_binary([I rem 251 || I <- lists:seq(1, Size)]),
+    ?line ok = file:write_file(Name, Data),
+    ?line {ok, L} = gen_tcp:listen(0, [binary, {active, false}]),
+    ?line {ok, PortNum} = inet:port(L),
+    ?line {ok, C} = gen_tcp:connect("localhost", PortNum,
+				    [binary, {active, false}]),
+    ?line {ok, S} = gen_tcp:accept(L),
+    ?line {ok, Raw} = file:open(Name, [raw, read, binary]),
+    ?line {ok, Cooked} = file:open(Name, [read, binary]),
+    %% The file goes between the data sent before and after it
+    ?line sendfile_recv(C, 4 + (Size - 10) + 4),
+    ?line ok = gen_tcp:send(S, <<"head">>),
+    ?line {ok, Sent} = file:sendfile(Raw, S, 10, Size - 10),
+    ?line Sent = Size - 10,
+    ?line ok = gen_tcp:send(S, <<"tail">>),
+    ?line <<"head", Part:Sent/binary, "tail">> = sendfile_result(C),
+    ?line <<_:10/binary, Part/binary>> = Data,
+    %% Beyond end of file, and up to end of file
+    ?line sendfile_recv(C, 200),
+    ?line {ok, 100} = file:sendfile(Raw, S, Size - 100, 1000),
+    ?line {ok, 100} = file:sendfile(Raw, S, Size - 100, infinity),
+    ?line {_, Last} = split_binary(Data, Size - 100),
+    ?line <<Last:100/binary, Last:100/binary>> = sendfile_result(C),
+    ?line {ok, 0} = file:sendfile(Raw, S, Size, infinity),
+    %% A file that is not raw is read and sent by the caller
+    ?line sendfile_recv(C, Size),
+    ?line {ok, Size} = file:sendfile(Cooked, S, 0, infinity),
+    ?line Data = sendfile_result(C),
+    ?line {error, badarg} = file:sendfile(Raw, S, -1, 10),
+    %% A compressed raw file has no descriptor; its uncompressed data
+    %% is read and sent by the caller
+    ?line GzName = Name ++ ".gz",
+    ?line {ok, GzW} = file:open(GzName, [raw, write, compressed]),
+    ?line ok = file:write(GzW, Data),
+    ?line ok = file:close(GzW),
+    ?line {ok, Gz} = file:open(GzName, [raw, read, binary, compressed]),
+    ?line sendfile_recv(C, Size - 10),
+    ?line {ok, <<_:3/binary>>} = file:read(Gz, 3),
+    ?line {ok, Sent} = file:sendfile(Gz, S, 10, infinity),
+    ?line Part = sendfile_result(C),
+    ?line {ok, 3} = file:position(Gz, cur),
+    ?line ok = file:close(Gz),
+    ?line ok = file:close(Raw),
+    ?line ok = file:close(Cooked),
+    ?line ok = gen_tcp:close(S),
+    ?line ok = gen_tcp:close(C),
+    ?line ok = gen_tcp:close(L),
+    ?line ok = file:delete(Name),
+    ?line ok = file:delete(GzName),
+    ok.
+
+sendfile_recv(C, N) ->
+    Self = self(),
+    spawn_link(fun () -> Self ! {sendfile, C, gen_tcp:recv(C, N)} end).
+
+sendfile_result(C) ->
+    receive
+	{sendfile, C, {ok, Bin}} -> Bin;
+	{sendfile, C, Error} -> ?t:fail(Error)
+    after 10000 -> ?t:fail(no_data)
+    end.
+
+packet_batch(doc) ->
+    ["Tests that packets received in one read in active mode are",
+     "delivered as sub-binaries of the receive buffer, and that",
+     "partial packets are not corrupted by it"];
+packet_batch(suite) -> [];
+packet_batch(Config) when is_list(Config) ->
+    ?line {ok, L} = gen_tcp:listen(0, [binary, {active, false}]),
+    ?line {ok, PortNum} = inet:port(L),
+    ?line {ok, C} = gen_tcp:connect("localhost", PortNum,
+				    [binary, {active, false}, {packet, 4},
+				     {buffer, 65536}]),
+    ?line {ok, S} = gen_tcp:accept(L),
+    ?line Pkts = [list_to_binary(lists:duplicate(100 + I, I)) ||
+		     I <- lists:seq(1, 20)],
+    %% Everything is in the socket before the first read
+    ?line ok = gen_tcp:send(S, [[<<(size(P)):32>>, P] || P <- Pkts]),
+    ?line ok = gen_tcp:send(S, [<<(size(hd(Pkts))):32>>,
+				element(1, split_binary(hd(Pkts), 50))]),
+    ?line receive after 500 -> ok end,
+    ?line {binary, Bins0} = process_info(self(), binary),
+    ?line ok = inet:setopts(C, [{active, true}]),
+    ?line Got = packet_batch_recv(C, 20),
+    ?line Pkts = Got,
+    %% ... so the packets refer to few binaries
+    ?line {binary, Bins} = process_info(self(), binary),
+    ?line Addrs = lists:usort([A || {A, _, _} <- Bins -- Bins0]),
+    ?line true = length(Addrs) < 10,
+    %% The partial packet was moved to a new buffer and completed there
+    ?line ok = gen_tcp:send(S, [element(2, split_binary(hd(Pkts), 50)),
+				<<3:32>>, "end"]),
+    ?line [P1, <<"end">>] = packet_batch_recv(C, 2),
+    ?line P1 = hd(Pkts),
+    ?line Pkts = Got,
+    ?line ok = gen_tcp:close(S),
+    ?line ok = gen_tcp:close(C),
+    ?line ok = gen_tcp:close(L),
+    ok.
+
+packet_batch_recv(_C, 0) ->
+    [];
+packet_batch_recv(C, N) ->
+    receive
+	{tcp, C, P} -> [P | packet_batch_recv(C, N - 1)]
+    after 5000 -> ?t:fail({missing_packets, N})
+    end.
+
+adaptive_buffer(doc) ->
+    ["Test that the reads of a raw socket grow beyond a small buffer ",
+     "size while there is data to read."];
+adaptive_buffer(suite) -> [];
+adaptive_buffer(Config) when is_list(Config) ->
+    ?line Size = 512*1024,
+    ?line {ok, L} = gen_tcp:listen(0, [binary, {active, false}]),
+    ?line {ok, PortNum} = inet:port(L),
+    ?line {ok, C} = gen_tcp:connect("localhost", PortNum,
+				    [binary, {active, false},
+				     {buffer, 1460}]),
+    ?line {ok, [{buffer, 1460}]} = inet:getopts(C, [buffer]),
+    ?line {ok, S} = gen_tcp:accept(L),
+    ?line Data = list_to_binary(lists:duplicate(Size, $a)),
+    ?line Sender = spawn_link(fun() -> ok = gen_tcp:send(S, Data) end),
+    ?line receive after 500 -> ok end,
+    ?line ok = inet:setopts(C, [{active, true}]),
+    ?line {Size, N} = adaptive_buffer_recv(C, Size, 0, 0),
+    ?line io:format("~w bytes in ~w messages~n", [Size, N]),
+    ?line true = N < Size div 1460 div 4,
+    ?line unlink(Sender),
+    %% The buffer option itself is unchanged
+    ?line {ok, [{buffer, 1460}]} = inet:getopts(C, [buffer]),
+    ?line ok = gen_tcp:close(S),
+    ?line ok = gen_tcp:close(C),
+    ?line ok = gen_tcp:close(L),
+    ok.
+
+adaptive_buffer_recv(_C, Size, Size, N) ->
+    {Size, N};
+adaptive_buffer_recv(C, Size, Got, N) ->
+    receive
+	{tcp, C, B} -> adaptive_buffer_recv(C, Size, Got + size(B), N + 1)
+    after 5000 -> ?t:fail({missing_data, Size - Got})
+    end.
+
+local_stream(doc) ->
+    ["Test local (AF_UNIX) stream sockets with packet and active modes, ",
+     "and abstract names on Linux."];
+local_stream(suite) -> [];
+local_stream(Config) when is_list(Config) ->
+    case os:type() of
+	{unix, _} ->
+	    ?line Path = local_path(Config, "local_stream"),
+	    ?line local_stream_echo({local, Path}),
+	    ?line {error, enoent} = file:read_file_info(Path),
+	    case os:type() of
+		{unix, linux} ->
+		    ?line local_stream_echo({local, <<0, "local_stream">>});
+		_ ->
+		    ok
+	    end;
+	_ ->
+	    {skip, "local sockets not supported"}
+    end.
+
+local_stream_echo({local, Name} = Addr) ->
+    ?line {ok, L} = gen_tcp:listen(0, [{ip, Addr}, binary, {packet, 4},
+				       {active, false}]),
+    ?line {ok, {{local, BinName}, 0}} = inet:sockname(L),
+    ?line BinName = iolist_to_binary(Name),
+    ?line {ok, C} = gen_tcp:connect(Addr, 0, [binary, {packet, 4}]),
+    ?line {ok, {{local, BinName}, 0}} = inet:peername(C),
+    ?line {ok, S} = gen_tcp:accept(L),
+    ?line {ok, {{local, <<>>}, 0}} = inet:peername(S),
+    ?line Data = list_to_binary(lists:seq(0, 255)),
+    ?line ok = gen_tcp:send(C, Data),
+    ?line {ok, Data} = gen_tcp:recv(S, 0, 5000),
+    ?line ok = gen_tcp:send(S, [Data, Data]),
+    ?line receive {tcp, C, <<Data:256/binary, Data:256/binary>>} -> ok
+	  after 5000 -> ?t:fail(flush([]))
+	  end,
+    ?line ok = gen_tcp:close(C),
+    ?line {error, closed} = gen_tcp:recv(S, 0, 5000),
+    ?line ok = gen_tcp:close(S),
+    ?line ok = gen_tcp:close(L),
+    case Name of
+	<<0, _/binary>> -> ok;
+	_ -> ?line ok = file:delete(Name)
+    end.
+
+local_fdpass(doc) ->
+    ["Test passing a socket over a local stream socket."];
+local_fdpass(suite) -> [];
+local_fdpass(Config) when is_list(Config) ->
+    case os:type() of
+	{unix, _} ->
+	    ?line Addr = {local, local_path(Config, "local_fdpass")},
+	    ?line {ok, L} = gen_tcp:listen(0, [{ip, Addr}, binary,
+					       {active, false}]),
+	    ?line {ok, C} = gen_tcp:connect(Addr, 0, [binary,
+						      {active, false}]),
+	    ?line {ok, S} = gen_tcp:accept(L),
+	    %% Pass our end of a tcp connection from S to C
+	    ?line {ok, TL} = gen_tcp:listen(0, [binary, {active, false}]),
+	    ?line {ok, TPort} = inet:port(TL),
+	    ?line {ok, T1} = gen_tcp:connect({127,0,0,1}, TPort,
+					     [binary, {active, false}]),
+	    ?line {ok, T2} = gen_tcp:accept(TL),
+	    ?line {ok, Fd} = inet:getfd(T1),
+	    ?line {error, einval} = inet:sendfd(S, Fd, []),
+	    ?line {error, enotconn} = inet:sendfd(TL, Fd, <<"fd">>),
+	    ?line ok = inet:sendfd(S, Fd, <<"fd">>),
+	    ?line {ok, <<"fd">>} = gen_tcp:recv(C, 2, 5000),
+	    ?line {ok, [NewFd]} = inet:recvfd(C),
+	    ?line {ok, []} = inet:recvfd(C),
+	    ?line true = NewFd =/= Fd,
+	    ?line {ok, T3} = gen_tcp:fdopen(NewFd, [binary, {active, false}]),
+	    ?line ok = gen_tcp:send(T3, <<"passed">>),
+	    ?line {ok, <<"passed">>} = gen_tcp:recv(T2, 6, 5000),
+	    ?line ok = gen_tcp:close(T1),
+	    ?line ok = gen_tcp:send(T2, <<"back">>),
+	    ?line {ok, <<"back">>} = gen_tcp:recv(T3, 4, 5000),
+	    %% Local sockets from fdopen own the descriptor
+	    ?line {ok, C2} = gen_tcp:connect(Addr, 0, [binary,
+						       {active, false}]),
+	    ?line {ok, S2} = gen_tcp:accept(L),
+	    ?line {ok, C2Fd} = inet:getfd(C2),
+	    ?line ok = inet:sendfd(S, C2Fd, <<"fd">>),
+	    ?line {ok, <<"fd">>} = gen_tcp:recv(C, 2, 5000),
+	    ?line {ok, [LFd]} = inet:recvfd(C),
+	    ?line {ok, T4} = gen_tcp:fdopen(LFd, [local, binary,
+						   {active, false}]),
+	    ?line {local, Path} = Addr,
+	    ?line BinPath = list_to_binary(Path),
+	    ?line {ok, {{local, BinPath}, 0}} = inet:peername(T4),
+	    ?line ok = gen_tcp:send(T4, <<"dup">>),
+	    ?line {ok, <<"dup">>} = gen_tcp:recv(S2, 3, 5000),
+	    ?line ok = gen_tcp:close(T4),
+	    ?line {error, ebadf} = inet:sendfd(S, LFd, <<"fd">>),
+	    ?line ok = gen_tcp:send(C2, <<"still open">>),
+	    ?line {ok, <<"still open">>} = gen_tcp:recv(S2, 10, 5000),
+	    ?line lists:foreach(fun gen_tcp:close/1,
+				[C2, S2, T2, T3, TL, C, S, L]),
+	    ?line ok = file:delete(Path);
+	_ ->
+	    {skip, "local sockets not supported"}
+    end.
+
+%% sun_path only holds some hundred bytes
+local_path(Config, Name) ->
+    Path = filename:join(?config(priv_dir, Config), Name),
+    case length(Path) < 100 of
+	true -> file:delete(Path), Path;
+	false ->
+	    Tmp = "/tmp/" ++ Name ++ "_" ++ os:getpid(),
+	    file:delete(Tmp),
+	    Tmp
+    end.
@@ -34,12 +34,13 @@
 
 -export([send_to_closed/1, 
 	 buffer_size/1, binary_passive_recv/1, bad_address/1,
-	 read_packets/1, open_fd/1]).
+	 read_packets/1, open_fd/1, active_n/1, send_multi/1,
+	 getbufstat/1, local_dgram/1]).
 
 all(suite) ->
     [send_to_closed, 
      buffer_size, binary_passive_recv, bad_address, read_packets,
-     open_fd].
+     open_fd, active_n, send_multi, getbufstat, local_dgram].
 
 init_per_testcase(_Case, Config) ->
     ?line Dog=test_server:timetrap(?default_timeout),
@@ -398,6 +399,97 @@ open_fd(Config) when is_list(Config) ->
 	    ?t:fail(io_lib:format("~w", [flush()]))
     end.
 
+active_n(suite) ->
+    [];
+active_n(doc) ->
+    ["Test the {active,N} socket mode"];
+active_n(Config) when is_list(Config) ->
+    ?line N = 5,
+    ?line {ok, R} = gen_udp:open(0, [binary, {active, N}]),
+    ?line {ok, [{active, N}]} = inet:getopts(R, [active]),
+    ?line ok = inet:setopts(R, [{active, -N}]),
+    ?line receive {udp_passive, R} -> ok after 5000 -> ?t:fail(no_passive) end,
+    ?line {ok, [{active, false}]} = inet:getopts(R, [active]),
+    ?line {ok, RP} = inet:port(R),
+    ?line {ok, S} = gen_udp:open(0, []),
+    ?line Packets = [<<I>> || I <- lists:seq(1, 2*N)],
+    ?line lists:foreach(fun (P) ->
+				ok = gen_udp:send(S, {127,0,0,1}, RP, P)
+			end, Packets),
+    ?line {P1, P2} = lists:split(N, Packets),
+    ?line ok = inet:setopts(R, [{active, N}]),
+    ?line active_n_recv(R, P1),
+    ?line ok = inet:setopts(R, [{active, N}]),
+    ?line active_n_recv(R, P2),
+    ?line receive
+	      Msg -> ?t:fail(io_lib:format("~w", [[Msg|flush()]]))
+	  after 100 -> ok
+	  end,
+    ?line ok = gen_udp:close(S),
+    ?line ok = gen_udp:close(R),
+    ok.
+
+active_n_recv(R, Packets) ->
+    lists:foreach(fun (P) ->
+			  receive
+			      {udp, R, _, _, P} -> ok
+			  after 5000 ->
+				  ?t:fail(io_lib:format("~w", [flush()]))
+			  end
+		  end, Packets),
+    receive
+	{udp_passive, R} -> ok
+    after 5000 ->
+	    ?t:fail(io_lib:format("~w", [flush()]))
+    end,
+    {ok, [{active, false}]} = inet:getopts(R, [active]).
+
+send_multi(suite) ->
+    [];
+send_multi(doc) ->
+    ["Test gen_udp:send_multi/2, and batched reads on an active socket"];
+send_multi(Config) when is_list(Config) ->
+    ?line {ok, R} = gen_udp:open(0, [binary, {active, false},
+				     {read_packets, 100},
+				     {recbuf, 1024*1024}]),
+    ?line {ok, RP} = inet:port(R),
+    ?line {ok, S} = gen_udp:open(0, [binary]),
+    ?line {ok, SP} = inet:port(S),
+    ?line Packets = [list_to_binary(lists:duplicate(I, I))
+		     || I <- lists:seq(1, 200)],
+    ?line ok = gen_udp:send_multi(S, [{{127,0,0,1}, RP, P} || P <- Packets]),
+    ?line ok = gen_udp:send_multi(S, []),
+    ?line {'EXIT', badarg} =
+	(catch gen_udp:send_multi(S, [{{127,0,0,1}, 65536, <<>>}])),
+    ?line {'EXIT', badarg} = (catch gen_udp:send_multi(S, [foo])),
+    %% The socket never reads more packets than it may deliver
+    ?line {P1, P2} = lists:split(50, Packets),
+    ?line ok = inet:setopts(R, [{active, 50}]),
+    ?line send_multi_recv(R, SP, P1),
+    ?line ok = inet:setopts(R, [{active, 150}]),
+    ?line send_multi_recv(R, SP, P2),
+    ?line receive
+	      Msg -> ?t:fail(io_lib:format("~w", [[Msg|flush()]]))
+	  after 100 -> ok
+	  end,
+    ?line ok = gen_udp:close(S),
+    ?line ok = gen_udp:close(R),
+    ok.
+
+send_multi_recv(R, SP, Packets) ->
+    lists:foreach(fun (P) ->
+			  receive
+			      {udp, R, {127,0,0,1}, SP, P} -> ok
+			  after 5000 ->
+				  ?t:fail(io_lib:format("~w", [flush()]))
+			  end
+		  end, Packets),
+    receive
+	{udp_passive, R} -> ok
+    after 5000 ->
+	    ?t:fail(io_lib:format("~w", [flush()]))
+    end.
+
 
 %
 % Utils
@@ -408,3 +500,78 @@ start_node(Name) ->
 
 stop_node(Node) ->
     ?t:stop_node(Node).
+
+getbufstat(doc) ->
+    ["Tests the statistics of the receive buffer caches"];
+getbufstat(suite) -> [];
+getbufstat(Config) when is_list(Config) ->
+    ?line {ok, R} = gen_udp:open(0, [binary, {active, false}]),
+    ?line {ok, RP} = inet:port(R),
+    ?line {ok, S} = gen_udp:open(0),
+    ?line {ok, Stats0} = inet:getbufstat(R),
+    ?line [hits, misses, trims, cached, cached_bytes] =
+	[K || {K, V} <- Stats0, is_integer(V), V >= 0],
+    ?line N = 20,
+    ?line lists:foreach(fun (I) ->
+				ok = gen_udp:send(S, {127,0,0,1}, RP, <<I>>),
+				{ok, {_, _, <<I>>}} = gen_udp:recv(R, 0, 5000)
+			end, lists:seq(1, N)),
+    ?line {ok, Stats1} = inet:getbufstat(R),
+    ?line Used = fun (St) ->
+			 proplists:get_value(hits, St) +
+			     proplists:get_value(misses, St)
+		 end,
+    ?line true = Used(Stats1) - Used(Stats0) >= N,
+    ?line ok = gen_udp:close(S),
+    ?line ok = gen_udp:close(R),
+    ok.
+
+local_dgram(doc) ->
+    ["Test local (AF_UNIX) datagram sockets"];
+local_dgram(suite) -> [];
+local_dgram(Config) when is_list(Config) ->
+    case os:type() of
+	{unix, _} ->
+	    ?line RPath = local_path(Config, "local_dgram_r"),
+	    ?line SPath = local_path(Config, "local_dgram_s"),
+	    ?line R = {local, list_to_binary(RPath)},
+	    ?line S = {local, list_to_binary(SPath)},
+	    ?line {ok, RS} = gen_udp:open(0, [{ip, R}, binary, {active, false}]),
+	    ?line {ok, {R, 0}} = inet:sockname(RS),
+	    ?line {ok, SS} = gen_udp:open(0, [local, {ip, {local, SPath}},
+					      binary]),
+	    ?line ok = gen_udp:send(SS, R, 0, <<"one">>),
+	    ?line {ok, {S, 0, <<"one">>}} = gen_udp:recv(RS, 0, 5000),
+	    ?line ok = gen_udp:send_multi(SS, [{R, 0, <<"two">>},
+					       {R, 0, <<"three">>}]),
+	    ?line {ok, {S, 0, <<"two">>}} = gen_udp:recv(RS, 0, 5000),
+	    ?line {ok, {S, 0, <<"three">>}} = gen_udp:recv(RS, 0, 5000),
+	    ?line ok = gen_udp:send(RS, S, 0, <<"back">>),
+	    ?line receive {udp, SS, R, 0, <<"back">>} -> ok
+		  after 5000 -> ?t:fail(flush())
+		  end,
+	    ?line ok = gen_udp:connect(SS, R, 0),
+	    ?line ok = gen_udp:send(SS, <<"connected">>),
+	    ?line {ok, {S, 0, <<"connected">>}} = gen_udp:recv(RS, 0, 5000),
+	    %% An unnamed sender has no address to answer to
+	    ?line {ok, US} = gen_udp:open(0, [local]),
+	    ?line {ok, {{local, <<>>}, 0}} = inet:sockname(US),
+	    ?line ok = gen_udp:send(US, R, 0, <<"anon">>),
+	    ?line {ok, {{local, <<>>}, 0, <<"anon">>}} = gen_udp:recv(RS, 0, 5000),
+	    ?line lists:foreach(fun gen_udp:close/1, [US, SS, RS]),
+	    ?line ok = file:delete(RPath),
+	    ?line ok = file:delete(SPath);
+	_ ->
+	    {skip, "local sockets not supported"}
+    end.
+
+%% sun_path only holds some hundred bytes
+local_path(Config, Name) ->
+    Path = filename:join(?config(priv_dir, Config), Name),
+    case length(Path) < 100 of
+	true -> file:delete(Path), Path;
+	false ->
+	    Tmp = "/tmp/" ++ Name ++ "_" ++ os:getpid(),
+	    file:delete(Tmp),
+	    Tmp
+    end.
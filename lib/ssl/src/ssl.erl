@@ -98,7 +98,7 @@ connect(Address, Port, Options) ->
     connect(Address, Port, Options, infinity).
 
 connect(Address, Port, Options0, Timeout) ->
-    case proplists:get_value(ssl_imp, Options0, old) of
+    case proplists:get_value(ssl_imp, Options0, default_imp()) of
         new ->
             new_connect(Address, Port, Options0, Timeout);
         old ->
@@ -121,7 +121,7 @@ connect(Address, Port, Options0, Timeout) ->
 listen(_Port, []) ->
     {error, enooptions};
 listen(Port, Options0) ->
-    case proplists:get_value(ssl_imp, Options0, old) of
+    case proplists:get_value(ssl_imp, Options0, default_imp()) of
 	new ->
 	    new_listen(Port, Options0);
 	old ->
@@ -129,7 +129,8 @@ listen(Port, Options0) ->
 	    %% so that new and old ssl can be run by the same
 	    %% code, however the option will be ignored by old ssl
 	    %% that hardcodes reuseaddr to true in its portprogram.
-	    Options =  proplists:delete(reuseaddr, Options0),
+	    Options1 = proplists:delete(reuseaddr, Options0),
+	    Options  = proplists:delete(ssl_imp, Options1),
 	    old_listen(Port, Options);
 	Value ->
 	    {error, {eoptions, {ssl_imp, Value}}}
@@ -436,6 +437,14 @@ versions() ->
 %%%--------------------------------------------------------------
 %%% Internal functions
 %%%--------------------------------------------------------------------
+%% The implementation used when the options do not name one, set
+%% with the ssl application environment variable ssl_imp.
+default_imp() ->
+    case application:get_env(ssl, ssl_imp) of
+	{ok, new} -> new;
+	_ -> old
+    end.
+
 new_connect(Address, Port, Options, Timeout) when is_list(Options) ->
     try handle_options(Options, client) of
 	{ok, Config} ->
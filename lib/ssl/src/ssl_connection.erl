@@ -64,7 +64,8 @@
           ssl_options,        % #ssl_options{}
           socket_options,     % #socket_options{}
           connection_states,  % #connection_states{} from ssl_record.hrl
-          tls_record_buffer,  % binary() buffer of incomplete records
+          tls_record_buffer,  % binary() | {Missing, [binary()]} buffer of
+                              % incomplete records, see ssl_record
           tls_handshake_buffer, % binary() buffer of incomplete handshakes
 	  %% {{md5_hash, sha_hash}, {prev_md5, prev_sha}} (binary())
           tls_handshake_hashes, % see above 
@@ -233,16 +233,31 @@ set_pending_cipher_state(#connection_states{pending_read = Read,
 %%--------------------------------------------------------------------
 %% Function: get_tls_record(Data, Buffer) -> Result
 %%      Result = {[#tls_compressed{}], NewBuffer}
-%%      Data = Buffer = NewBuffer = binary()
+%%      Data = binary()
+%%      Buffer = NewBuffer = binary() | {Missing, [binary()]}
 %%
 %% Description: given old buffer and new data from TCP, packs up a records
 %% and returns it as a list of #tls_compressed, also returns leftover
-%% data
+%% data. A record that comes in many TCP reads is kept as a list of
+%% the reads and the number of bytes still missing, and is only put
+%% together when it is complete.
 %%--------------------------------------------------------------------
 get_tls_records(Data, <<>>) ->
-    get_tls_records_aux(Data, []);
+    buffer_tls_records(get_tls_records_aux(Data, []));
+get_tls_records(Data, {Missing, Buffer}) when byte_size(Data) < Missing ->
+    {[], {Missing - byte_size(Data), [Data | Buffer]}};
+get_tls_records(Data, {_, Buffer}) ->
+    buffer_tls_records(
+      get_tls_records_aux(list_to_binary(lists:reverse(Buffer, [Data])), []));
 get_tls_records(Data, Buffer) ->
-    get_tls_records_aux(list_to_binary([Buffer, Data]), []).
+    buffer_tls_records(
+      get_tls_records_aux(list_to_binary([Buffer, Data]), [])).
+
+buffer_tls_records({Records, <<0:1, _:7, ?BYTE(_), ?BYTE(_),
+			      ?UINT16(Length), _/binary>> = Rest}) ->
+    {Records, {Length + 5 - byte_size(Rest), [Rest]}};
+buffer_tls_records(Result) ->
+    Result.
 
 get_tls_records_aux(<<?BYTE(?APPLICATION_DATA),?BYTE(MajVer),?BYTE(MinVer),
 		     ?UINT16(Length), Data:Length/binary, Rest/binary>>, 
@@ -0,0 +1 @@
+{topcase, {dir, "../ssl_test"}}.
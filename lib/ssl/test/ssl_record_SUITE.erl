@@ -0,0 +1,246 @@
+%%
+%% %CopyrightBegin%
+%%
+%% Copyright Ericsson AB 2009. All Rights Reserved.
+%%
+%% The contents of this file are subject to the Erlang Public License,
+%% Version 1.1, (the "License"); you may not use this file except in
+%% compliance with the License. You should have received a copy of the
+%% Erlang Public License along with this software. If not, it can be
+%% retrieved online at http://www.erlang.org/.
+%%
+%% Software distributed under the License is distributed on an "AS IS"
+%% basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+%% the License for the specific language governing rights and limitations
+%% under the License.
+%%
+%% %CopyrightEnd%
+%%
+
+%%
+-module(ssl_record_SUITE).
+
+%% Note: This directive should only be used in test suites.
+-compile(export_all).
+
+-include("test_server.hrl").
+-include("test_server_line.hrl").
+-include("ssl_internal.hrl").
+-include("ssl_record.hrl").
+-include("ssl_alert.hrl").
+-include("ssl_handshake.hrl").
+
+-define(TIMEOUT, 60000). % 1 min
+-define(SEGMENT, 1460).
+
+%% Test server callback functions
+%%--------------------------------------------------------------------
+%% Function: init_per_testcase(TestCase, Config) -> Config
+%% Case - atom()
+%%   Name of the test case that is about to be run.
+%% Config - [tuple()]
+%%   A list of key/value pairs, holding the test case configuration.
+%%
+%% Description: Initialization before each test case
+%%--------------------------------------------------------------------
+init_per_testcase(_TestCase, Config0) ->
+    Config = lists:keydelete(watchdog, 1, Config0),
+    Dog = test_server:timetrap(?TIMEOUT),
+    [{watchdog, Dog} | Config].
+
+%%--------------------------------------------------------------------
+%% Function: end_per_testcase(TestCase, Config) -> _
+%% Case - atom()
+%%   Name of the test case that is about to be run.
+%% Config - [tuple()]
+%%   A list of key/value pairs, holding the test case configuration.
+%% Description: Cleanup after each test case
+%%--------------------------------------------------------------------
+end_per_testcase(_TestCase, Config) ->
+    Dog = ?config(watchdog, Config),
+    case Dog of
+	undefined ->
+	    ok;
+	_ ->
+	    test_server:timetrap_cancel(Dog)
+    end.
+
+%%--------------------------------------------------------------------
+%% Function: all(Clause) -> TestCases
+%% Clause - atom() - suite | doc
+%% TestCases - [Case]
+%% Case - atom()
+%%   Name of a test case.
+%% Description: Returns a list of all test cases in this test suite
+%%--------------------------------------------------------------------
+all(doc) ->
+    ["Test how ssl_record splits TCP data into records"];
+
+all(suite) ->
+    [whole_records,
+     split_record,
+     split_records,
+     partial_header,
+     sslv2_hello,
+     record_overflow
+    ].
+
+%% Test cases starts here.
+%%--------------------------------------------------------------------
+whole_records(doc) ->
+    ["Records that come in one read are returned at once, and the "
+     "data after them is kept as a binary or as a list of reads"];
+whole_records(suite) ->
+    [];
+whole_records(Config) when is_list(Config) ->
+    R1 = record(?APPLICATION_DATA, 100),
+    R2 = record(?HANDSHAKE, 10),
+    R3 = record(?APPLICATION_DATA, 200),
+    ?line {[#ssl_tls{type = ?APPLICATION_DATA, version = {3,1},
+		     fragment = F1},
+	    #ssl_tls{type = ?HANDSHAKE, version = {3,1}, fragment = F2}],
+	   <<>>} = ssl_record:get_tls_records(list_to_binary([R1, R2]), <<>>),
+    ?line F1 = fragment(R1),
+    ?line F2 = fragment(R2),
+    %% The start of a third record after the two complete ones.
+    <<Head:50/binary, Tail/binary>> = R3,
+    ?line {[#ssl_tls{}, #ssl_tls{}], {155, [Head]}} =
+	ssl_record:get_tls_records(list_to_binary([R1, R2, Head]), <<>>),
+    ?line {[#ssl_tls{fragment = F3}], <<>>} =
+	ssl_record:get_tls_records(Tail, {155, [Head]}),
+    ?line F3 = fragment(R3),
+    ok.
+
+%%--------------------------------------------------------------------
+split_record(doc) ->
+    ["A record that comes in many reads is kept as a list of the reads "
+     "and the number of bytes missing until it is complete"];
+split_record(suite) ->
+    [];
+split_record(Config) when is_list(Config) ->
+    R = record(?APPLICATION_DATA, 16384),
+    [First | Segments] = split(R, ?SEGMENT),
+    ?line {[], {Missing0, [First]} = Buf0} =
+	ssl_record:get_tls_records(First, <<>>),
+    ?line Missing0 = byte_size(R) - ?SEGMENT,
+    ?line {[#ssl_tls{type = ?APPLICATION_DATA, fragment = F}], <<>>} =
+	feed(Segments, {[], Buf0}),
+    ?line F = fragment(R),
+    %% The same record one byte at a time.
+    [Byte | Bytes] = split(R, 1),
+    ?line {[#ssl_tls{fragment = F}], <<>>} =
+	feed(Bytes, ssl_record:get_tls_records(Byte, <<>>)),
+    ok.
+
+%%--------------------------------------------------------------------
+split_records(doc) ->
+    ["Reads that end in the middle of records give the same records "
+     "as one read of all the data"];
+split_records(suite) ->
+    [];
+split_records(Config) when is_list(Config) ->
+    Records = [record(?APPLICATION_DATA, N) ||
+		  N <- [1, 16384, 17, 4000, 1459, 1460, 1461, 16384]],
+    Data = list_to_binary(Records),
+    ?line {Expected, <<>>} = ssl_record:get_tls_records(Data, <<>>),
+    ?line 8 = length(Expected),
+    Check = fun(Size) ->
+		    {Recs, <<>>} = feed_all(split(Data, Size), <<>>, []),
+		    Expected = Recs
+	    end,
+    ?line lists:foreach(Check, [1, 3, 5, 6, 1000, ?SEGMENT, 16389, 70000]),
+    ok.
+
+%%--------------------------------------------------------------------
+partial_header(doc) ->
+    ["Data shorter than a record header is kept as a binary"];
+partial_header(suite) ->
+    [];
+partial_header(Config) when is_list(Config) ->
+    R = record(?HANDSHAKE, 300),
+    <<Head:3/binary, Rest/binary>> = R,
+    ?line {[], Head} = ssl_record:get_tls_records(Head, <<>>),
+    <<Next:2/binary, Tail/binary>> = Rest,
+    ?line {[], {300, [_]} = Buf} = ssl_record:get_tls_records(Next, Head),
+    ?line {[#ssl_tls{type = ?HANDSHAKE, fragment = F}], <<>>} =
+	ssl_record:get_tls_records(Tail, Buf),
+    ?line F = fragment(R),
+    %% A header that is cut after a complete record.
+    R2 = record(?APPLICATION_DATA, 10),
+    ?line {[#ssl_tls{}], Head} =
+	ssl_record:get_tls_records(list_to_binary([R2, Head]), <<>>),
+    ok.
+
+%%--------------------------------------------------------------------
+sslv2_hello(doc) ->
+    ["An SSLv2 client hello is converted to a handshake record, also "
+     "when it comes in many reads"];
+sslv2_hello(suite) ->
+    [];
+sslv2_hello(Config) when is_list(Config) ->
+    Body = list_to_binary(lists:seq(0, 99)),
+    Hello = <<?BYTE(?CLIENT_HELLO), ?BYTE(3), ?BYTE(1), Body/binary>>,
+    V2 = <<1:1, (byte_size(Hello)):15, Hello/binary>>,
+    Length = byte_size(Hello) - 1,
+    Fragment = <<?BYTE(?CLIENT_HELLO), ?UINT24(Length), ?BYTE(3), ?BYTE(1),
+		 Body/binary>>,
+    ?line {[#ssl_tls{type = ?HANDSHAKE, version = {3,1},
+		     fragment = Fragment}], <<>>} =
+	ssl_record:get_tls_records(V2, <<>>),
+    %% The SSLv2 header has no record length in the same place as
+    %% the TLS header; an incomplete hello stays a binary.
+    <<Head:1/binary, Middle:40/binary, Tail/binary>> = V2,
+    ?line {[], Head} = ssl_record:get_tls_records(Head, <<>>),
+    ?line {[], Buf} = ssl_record:get_tls_records(Middle, Head),
+    ?line true = is_binary(Buf),
+    ?line {[#ssl_tls{type = ?HANDSHAKE, fragment = Fragment}], <<>>} =
+	ssl_record:get_tls_records(Tail, Buf),
+    %% A TLS record following the hello in the same reads.
+    R = record(?HANDSHAKE, 50),
+    ?line {[#ssl_tls{fragment = Fragment}, #ssl_tls{}], <<>>} =
+	feed_all(split(list_to_binary([V2, R]), 7), <<>>, []),
+    ok.
+
+%%--------------------------------------------------------------------
+record_overflow(doc) ->
+    ["A record header with a too large length is refused at once, "
+     "and not buffered"];
+record_overflow(suite) ->
+    [];
+record_overflow(Config) when is_list(Config) ->
+    Length = ?MAX_CIPHER_TEXT_LENGTH + 1,
+    Header = <<?BYTE(?APPLICATION_DATA), ?BYTE(3), ?BYTE(1),
+	       ?UINT16(Length)>>,
+    ?line #alert{level = ?FATAL, description = ?RECORD_OVERFLOW} =
+	ssl_record:get_tls_records(Header, <<>>),
+    ?line #alert{description = ?RECORD_OVERFLOW} =
+	ssl_record:get_tls_records(<<Header/binary, 0:8000>>, <<>>),
+    ok.
+
+%%--------------------------------------------------------------------
+%% Internal functions
+%%--------------------------------------------------------------------
+record(Type, Size) ->
+    Fragment = list_to_binary([N band 255 || N <- lists:seq(1, Size)]),
+    <<?BYTE(Type), ?BYTE(3), ?BYTE(1), ?UINT16(Size), Fragment/binary>>.
+
+fragment(<<_:5/binary, Fragment/binary>>) ->
+    Fragment.
+
+split(Bin, Size) when byte_size(Bin) =< Size ->
+    [Bin];
+split(Bin, Size) ->
+    <<Head:Size/binary, Rest/binary>> = Bin,
+    [Head | split(Rest, Size)].
+
+%% Feeds reads that complete exactly one record.
+feed([Data], {[], Buf}) ->
+    ssl_record:get_tls_records(Data, Buf);
+feed([Data | Rest], {[], Buf}) ->
+    feed(Rest, ssl_record:get_tls_records(Data, Buf)).
+
+feed_all([], Buf, Acc) ->
+    {lists:append(lists:reverse(Acc)), Buf};
+feed_all([Data | Rest], Buf0, Acc) ->
+    {Records, Buf} = ssl_record:get_tls_records(Data, Buf0),
+    feed_all(Rest, Buf, [Records | Acc]).